@@ -14,6 +14,8 @@
  *      autoupdate_regpath_set
  *      autoupdate_isavailable
  *      autoupdate_execute
+ *      autoupdate_manifest_compile
+ *      autoupdate_manifest_free
  *
  *  Copyright (c) 2012 - 2025 Adam Young
  *
@@ -62,8 +64,11 @@
 #include "AutoLogger.h"
 #include "AutoThread.h"
 #include "AutoDownLoad.h"
+#include "AutoManifest.h"
+#include "AutoManifestImage.h"
 
 #include "util/Base64.h"
+#include "ed25519/src/ed25519.h"
 #include "localisation/NSLocalizedString.h"
 
 #if defined(PRAGMA_COMMENT_LIB)
@@ -500,6 +505,99 @@ autoupdate_execute(int mode, int interactive)
     return ret;
 }
 
+
+
+//  Compile the XML manifest to its binary feed, see ManifestIndex; an index followed by a
+//  segment per (channel, os-label), the index and each segment signed given 'keypair'.
+//  The feed is released using autoupdate_manifest_free().
+//
+LIBAUTOUPDATER_LINKAGE int LIBAUTOUPDATER_ENTRY
+autoupdate_manifest_compile(const char *xml, size_t length, const struct SignKeyPair *keypair, unsigned keyversion,
+        void **image, size_t *imagelen, char *error, size_t errlen)
+{
+    const char *label = "autoupdate_manifest_compile: ";
+    std::string msg;
+    int ret = -1;
+
+    if (image) *image = NULL;
+    if (imagelen) *imagelen = 0;
+
+    try {
+        std::vector<Updater::AutoManifest> manifests;
+        std::vector<Updater::ManifestImage::SectionKey> keys;
+        std::vector<std::vector<unsigned> > members;
+        std::vector<std::string> segments;
+        bool channels_omitted = false;
+
+        if (NULL == xml || NULL == image || NULL == imagelen || (keypair && 0 == keyversion)) {
+            throw AppException("invalid arguments");
+        }
+        if (NULL == keypair) {
+            keyversion = 0;
+        }
+
+        if (! Updater::AutoManifest::LoadAll(std::string(xml, length), manifests, channels_omitted)) {
+            throw AppException("manifest contains no items");
+        }
+
+        Updater::ManifestImage::Group(manifests, channels_omitted, keys, members);
+        for (unsigned s = 0; s < keys.size(); ++s) {
+            const std::vector<Updater::ManifestImage::SectionKey> t_keys(1, keys[s]);
+            const std::vector<std::vector<unsigned> > t_members(1, members[s]);
+
+            segments.push_back(Updater::ManifestImage::Build(manifests, t_keys, t_members, channels_omitted, keyversion));
+            if (keypair) {
+                std::string &segment = segments.back();
+                unsigned char signature[ED25519_SIGNATURE_LENGTH] = {0};
+
+                ed25519_sign(signature, reinterpret_cast<const unsigned char *>(segment.data()), segment.size(),
+                    keypair->public_key, keypair->private_key);
+                segment.append(reinterpret_cast<const char *>(signature), sizeof(signature));
+            }
+        }
+
+        std::string t_image = Updater::ManifestIndex::Build(keys, segments, channels_omitted, keyversion);
+        if (keypair) {
+            const size_t index_length = Updater::ManifestIndex::IndexLength(t_image.data(), t_image.size()),
+                content = index_length - Updater::ManifestIndex::SIGNATURE_SIZE;
+            unsigned char signature[ED25519_SIGNATURE_LENGTH] = {0};
+
+            ed25519_sign(signature, reinterpret_cast<const unsigned char *>(t_image.data()), content,
+                keypair->public_key, keypair->private_key);
+            t_image.replace(content, sizeof(signature), reinterpret_cast<const char *>(signature), sizeof(signature));
+        }
+
+        void *buffer = malloc(t_image.size());
+
+        if (NULL == buffer) {
+            throw AppException("memory allocation error");
+        }
+        memcpy(buffer, t_image.data(), t_image.size());
+        *image = buffer, *imagelen = t_image.size();
+        ret = 0;
+
+    } catch (const std::exception &e) {
+        LOG<LOG_ERROR>() << label << e.what() << LOG_ENDL;
+        msg = e.what();
+    } catch (...) {
+        LOG<LOG_ERROR>() << label << "Unknown exception" << LOG_ENDL;
+        msg = "Unknown exception";
+    }
+
+    if (error && errlen) {
+        strncpy(error, msg.c_str(), errlen - 1);
+        error[errlen - 1] = 0;
+    }
+    return ret;
+}
+
+
+LIBAUTOUPDATER_LINKAGE void LIBAUTOUPDATER_ENTRY
+autoupdate_manifest_free(void *image)
+{
+    free(image);
+}
+
 }   // extern "C"
 
 /*end*/
@@ -80,6 +80,13 @@ LIBAUTOUPDATER_LINKAGE int  LIBAUTOUPDATER_ENTRY
 LIBAUTOUPDATER_LINKAGE int  LIBAUTOUPDATER_ENTRY
     autoupdate_execute(int mode, int interactive);
 
+LIBAUTOUPDATER_LINKAGE int  LIBAUTOUPDATER_ENTRY
+    autoupdate_manifest_compile(const char *xml, size_t length, const struct SignKeyPair *keypair, unsigned keyversion,
+            void **image, size_t *imagelen, char *error, size_t errlen);
+
+LIBAUTOUPDATER_LINKAGE void LIBAUTOUPDATER_ENTRY
+    autoupdate_manifest_free(void *image);
+
 #if defined(__cplusplus)
 }
 #endif
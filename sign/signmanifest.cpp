@@ -40,6 +40,7 @@
 #include <assert.h>
 
 #include <string>
+#include <vector>
 #include <iostream>
 
 #define WINDOWS_LEAN_AND_MEAN
@@ -50,6 +51,8 @@
 
 #include "../util/Hex.h"
 #include "../util/Base64.h"
+#include "../util/Deflate.h"
+#include "../util/Chunker.h"
 #include "../util/Util.h"
 
 #include "signmanifest.h"
@@ -153,6 +156,18 @@ namespace {
             CloseHandle(hFile);
         }
 
+        void assign(const std::string &image) {
+            BYTE *t_fileBuffer = NULL;
+
+            if (image.empty() || NULL == (t_fileBuffer = static_cast<BYTE*>(malloc(image.size())))) {
+                throw std::runtime_error(SysError("Memory allocation error."));
+            }
+            memcpy(t_fileBuffer, image.data(), image.size());
+            free((void*)fileBuffer);
+            fileBuffer = t_fileBuffer;
+            fileSize = (DWORD)image.size();
+        }
+
         ~File() {
             free((void*)fileBuffer);
         }
@@ -161,10 +176,269 @@ namespace {
         DWORD fileSize;
     };
 
+
+    ///////////////////////////////////////////////////////////////////////////
+    //  Binary delta, bsdiff (Colin Percival) suffix sorting and match selection;
+    //  emitted in the AUPATCH1 format, see src/AutoPatch.h.
+
+    void
+    Split(int *I, int *V, int start, int len, int h)
+    {
+        int i, j, k, x, tmp, jj, kk;
+
+        if (len < 16) {
+            for (k = start; k < start + len; k += j) {
+                j = 1; x = V[I[k] + h];
+                for (i = 1; k + i < start + len; i++) {
+                    if (V[I[k + i] + h] < x) {
+                        x = V[I[k + i] + h];
+                        j = 0;
+                    }
+                    if (V[I[k + i] + h] == x) {
+                        tmp = I[k + j]; I[k + j] = I[k + i]; I[k + i] = tmp;
+                        j++;
+                    }
+                }
+                for (i = 0; i < j; i++) V[I[k + i]] = k + j - 1;
+                if (j == 1) I[k] = -1;
+            }
+            return;
+        }
+
+        x = V[I[start + len / 2] + h];
+        jj = 0; kk = 0;
+        for (i = start; i < start + len; i++) {
+            if (V[I[i] + h] < x) jj++;
+            if (V[I[i] + h] == x) kk++;
+        }
+        jj += start; kk += jj;
+
+        i = start; j = 0; k = 0;
+        while (i < jj) {
+            if (V[I[i] + h] < x) {
+                i++;
+            } else if (V[I[i] + h] == x) {
+                tmp = I[i]; I[i] = I[jj + j]; I[jj + j] = tmp;
+                j++;
+            } else {
+                tmp = I[i]; I[i] = I[kk + k]; I[kk + k] = tmp;
+                k++;
+            }
+        }
+
+        while (jj + j < kk) {
+            if (V[I[jj + j] + h] == x) {
+                j++;
+            } else {
+                tmp = I[jj + j]; I[jj + j] = I[kk + k]; I[kk + k] = tmp;
+                k++;
+            }
+        }
+
+        if (jj > start) Split(I, V, start, jj - start, h);
+        for (i = 0; i < kk - jj; i++) V[I[jj + i]] = kk - 1;
+        if (jj == kk - 1) I[jj] = -1;
+        if (start + len > kk) Split(I, V, kk, start + len - kk, h);
+    }
+
+    void
+    SuffixSort(int *I, int *V, const BYTE *old, int oldsize)
+    {
+        int buckets[256] = {0};
+        int i, h, len;
+
+        for (i = 0; i < oldsize; i++) buckets[old[i]]++;
+        for (i = 1; i < 256; i++) buckets[i] += buckets[i - 1];
+        for (i = 255; i > 0; i--) buckets[i] = buckets[i - 1];
+        buckets[0] = 0;
+
+        for (i = 0; i < oldsize; i++) I[++buckets[old[i]]] = i;
+        I[0] = oldsize;
+        for (i = 0; i < oldsize; i++) V[i] = buckets[old[i]];
+        V[oldsize] = 0;
+        for (i = 1; i < 256; i++) if (buckets[i] == buckets[i - 1] + 1) I[buckets[i]] = -1;
+        I[0] = -1;
+
+        for (h = 1; I[0] != -(oldsize + 1); h += h) {
+            len = 0;
+            for (i = 0; i < oldsize + 1;) {
+                if (I[i] < 0) {
+                    len -= I[i];
+                    i -= I[i];
+                } else {
+                    if (len) I[i - len] = -len;
+                    len = V[I[i]] + 1 - i;
+                    Split(I, V, i, len, h);
+                    i += len;
+                    len = 0;
+                }
+            }
+            if (len) I[i - len] = -len;
+        }
+
+        for (i = 0; i < oldsize + 1; i++) I[V[i]] = i;
+    }
+
+    int
+    MatchLength(const BYTE *old, int oldsize, const BYTE *image, int imagesize)
+    {
+        int i;
+        for (i = 0; i < oldsize && i < imagesize; i++) {
+            if (old[i] != image[i]) break;
+        }
+        return i;
+    }
+
+    int
+    Search(const int *I, const BYTE *old, int oldsize, const BYTE *image, int imagesize, int st, int en, int *pos)
+    {
+        while (en - st >= 2) {
+            const int x = st + (en - st) / 2;
+            const int length = (oldsize - I[x] < imagesize ? oldsize - I[x] : imagesize);
+
+            if (memcmp(old + I[x], image, length) < 0) {
+                st = x;
+            } else {
+                en = x;
+            }
+        }
+
+        const int x = MatchLength(old + I[st], oldsize - I[st], image, imagesize);
+        const int y = MatchLength(old + I[en], oldsize - I[en], image, imagesize);
+        if (x > y) {
+            *pos = I[st];
+            return x;
+        }
+        *pos = I[en];
+        return y;
+    }
+
+    void
+    Put64(std::string &out, long long value)
+    {
+        const unsigned long long t_value = (unsigned long long)value;
+        for (int i = 0; i < 8; ++i) {
+            out.push_back((char)((t_value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void
+    Put32(std::string &out, unsigned long value)
+    {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back((char)((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void
+    PutHash(std::string &out, const std::string &hex)
+    {
+        for (size_t i = 0; i + 1 < hex.length() && i < 40; i += 2) {
+            out.push_back((char)strtoul(hex.substr(i, 2).c_str(), NULL, 16));
+        }
+    }
+
+    std::string
+    Diff(const File &oldfile, const std::string &oldsha, const File &newfile, const std::string &newsha)
+    {
+        const BYTE *old = oldfile.fileBuffer, *image = newfile.fileBuffer;
+        const int oldsize = (int)oldfile.fileSize, imagesize = (int)newfile.fileSize;
+        std::vector<int> I(oldsize + 1), V(oldsize + 1);
+        std::string patch("AUPATCH1");
+
+        Put64(patch, oldsize);
+        Put64(patch, imagesize);
+        PutHash(patch, oldsha);
+        PutHash(patch, newsha);
+        if (patch.size() != 64) {
+            throw std::runtime_error("Patch header construction.");
+        }
+
+        SuffixSort(&I[0], &V[0], old, oldsize);
+        V.clear();
+
+        int scan = 0, len = 0, pos = 0;
+        int lastscan = 0, lastpos = 0, lastoffset = 0;
+
+        while (scan < imagesize) {
+            int oldscore = 0, scsc;
+
+            for (scsc = scan += len; scan < imagesize; scan++) {
+                len = Search(&I[0], old, oldsize, image + scan, imagesize - scan, 0, oldsize, &pos);
+
+                for (; scsc < scan + len; scsc++) {
+                    if ((scsc + lastoffset < oldsize) && (old[scsc + lastoffset] == image[scsc]))
+                        oldscore++;
+                }
+
+                if (((len == oldscore) && (len != 0)) || (len > oldscore + 8))
+                    break;
+
+                if ((scan + lastoffset < oldsize) && (old[scan + lastoffset] == image[scan]))
+                    oldscore--;
+            }
+
+            if ((len != oldscore) || (scan == imagesize)) {
+                int s = 0, Sf = 0, lenf = 0, lenb = 0, i;
+
+                for (i = 0; (lastscan + i < scan) && (lastpos + i < oldsize);) {
+                    if (old[lastpos + i] == image[lastscan + i]) s++;
+                    i++;
+                    if (s * 2 - i > Sf * 2 - lenf) {
+                        Sf = s; lenf = i;
+                    }
+                }
+
+                if (scan < imagesize) {
+                    int Sb = 0;
+                    s = 0;
+                    for (i = 1; (scan >= lastscan + i) && (pos >= i); i++) {
+                        if (old[pos - i] == image[scan - i]) s++;
+                        if (s * 2 - i > Sb * 2 - lenb) {
+                            Sb = s; lenb = i;
+                        }
+                    }
+                }
+
+                if (lastscan + lenf > scan - lenb) {
+                    const int overlap = (lastscan + lenf) - (scan - lenb);
+                    int Ss = 0, lens = 0;
+
+                    s = 0;
+                    for (i = 0; i < overlap; i++) {
+                        if (image[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) s++;
+                        if (image[scan - lenb + i] == old[pos - lenb + i]) s--;
+                        if (s > Ss) {
+                            Ss = s; lens = i + 1;
+                        }
+                    }
+                    lenf += lens - overlap;
+                    lenb -= lens;
+                }
+
+                const int insert = (scan - lenb) - (lastscan + lenf);
+
+                Put64(patch, lenf);             // record; control, add then insert.
+                Put64(patch, insert);
+                Put64(patch, (pos - lenb) - (lastpos + lenf));
+                for (i = 0; i < lenf; i++) {
+                    patch.push_back((char)(image[lastscan + i] - old[lastpos + i]));
+                }
+                patch.append((const char *)image + lastscan + lenf, insert);
+
+                lastscan = scan - lenb;
+                lastpos = pos - lenb;
+                lastoffset = pos - scan;
+            }
+        }
+        return patch;
+    }
+
 };  // namespace anon
 
 
 static std::string Hash(const File &file, int type);
+static std::string Chunks(const File &file);
 static std::string Sign(const File &file, const struct SignKeyPair *key);
 
 #if defined(__WATCOMC__) && (__WATCOMC__ <= 1300)
@@ -275,6 +549,227 @@ SignManifestEd(const char *filename, const char *version, const char *url,
 }
 
 
+//  Function: SignDeltaEd
+//      Generate a binary delta from the previous installer image, plus its manifest
+//      <updater:deltas> element. The patch is written gzip compressed alongside the
+//      installer as "<installer>-from-<previous-version>.patch.gz"; the signatures
+//      are those of the uncompressed patch, whilst the image reconstructed is
+//      verified against the enclosure itself.
+//
+//  Parameters:
+//      filename - Installer image.
+//      previous - Previous installer image.
+//      previous_version - Previous version label.
+//      url - URL to manifest.
+//      keypair - Key-pair.
+//      keyversion - KeyVersion.
+//
+//  Returns:
+//      nothing
+//
+
+void
+SignDeltaEd(const char *filename, const char *previous, const char *previous_version, const char *url,
+        const struct SignKeyPair *keypair, unsigned keyversion)
+{
+    try {
+        File file, prior;
+
+        file.load(filename);
+        prior.load(previous);
+
+        const std::string sha = Hash(file, CALG_SHA);
+        const std::string prior_sha = Hash(prior, CALG_SHA);
+
+        File patch;
+        patch.assign(Diff(prior, prior_sha, file, sha));
+
+        const std::string patch_sha = Hash(patch, CALG_SHA);
+        const std::string patch_dsa = (keypair ? Sign(patch, keypair) : "");
+        const std::string compressed = Updater::Deflate::gzip(patch.fileBuffer, patch.fileSize);
+
+        // <installer>-from-<version>.patch.gz, alongside the installer.
+        std::string patchname(filename);
+        const size_t dot = patchname.rfind('.');
+        if (std::string::npos != dot && dot > (size_t)(Updater::Util::Basename(filename) - filename)) {
+            patchname.erase(dot);
+        }
+        patchname += "-from-";
+        patchname += previous_version;
+        patchname += ".patch.gz";
+
+        FILE *strm = fopen(patchname.c_str(), "wb");
+        if (NULL == strm) {
+            throw std::runtime_error(SysError("Unable to create patch image."));
+        }
+        const bool written = (fwrite(compressed.data(), 1, compressed.size(), strm) == compressed.size());
+        if (0 != fclose(strm) || !written) {
+            throw std::runtime_error(SysError("Unable to write patch image."));
+        }
+
+        const char *basename = Updater::Util::Basename(patchname.c_str());
+        char t_url[1024] = {0};
+        ReplaceString(url, "%%", basename, t_url, sizeof(t_url));
+
+        std::cerr << "Delta: " << prior.fileSize << " -> " << file.fileSize << " bytes, patch "
+            << patch.fileSize << " (" << compressed.size() << " compressed)" << std::endl;
+
+        std::cout
+            << "\t<updater:deltas>\n"
+            << "\t\t<enclosure url=\"" << t_url << "\"\n"
+                << "\t\t\tdeltaFrom=\"" << previous_version << "\"\n"
+                << "\t\t\tdeltaFromShaSignature=\"" << prior_sha << "\"\n"
+                << "\t\t\tlength=\"" << patch.fileSize << "\"\n"
+                << "\t\t\tshaSignature=\"" << patch_sha << "\"\n"
+                << "\t\t\tedSignature=\"" << patch_dsa << "\"\n"
+                << "\t\t\tedKeyVersion=\"1." << keyversion << "\"\n"
+                << "\t\t\ttype=\"application/gzip\" />\n"
+            << "\t</updater:deltas>\n"
+            << "\n";
+
+    } catch (std::exception &e) {
+        std::string msg;
+
+        msg += "An error occurred during delta operations\n\n";
+        msg += e.what();
+        MessageBoxA(NULL, msg.c_str(), "Signature", MB_ICONWARNING | MB_OK);
+
+    } catch (...) {
+        const char *msg = "An unknown error occurred during delta operations\n";
+
+        MessageBoxA(NULL, msg, "Signature", MB_ICONERROR | MB_OK);
+    }
+}
+
+
+//  Function: SignChunks
+//      Generate the content-defined chunk index of the installer image, written alongside
+//      the installer as "<installer>.chunks", plus its enclosure attribute. Clients
+//      retaining a prior installer download only those chunks not already held, see
+//      Chunker.h; the image assembled is verified against the enclosure itself.
+//
+//  Parameters:
+//      filename - Installer image.
+//      url - URL to manifest.
+//
+//  Returns:
+//      nothing
+//
+
+void
+SignChunks(const char *filename, const char *url)
+{
+    try {
+        File file;
+
+        file.load(filename);
+
+        const std::string index = Chunks(file);
+        const std::string indexname = std::string(filename) + ".chunks";
+
+        FILE *strm = fopen(indexname.c_str(), "wb");
+        if (NULL == strm) {
+            throw std::runtime_error(SysError("Unable to create chunk index."));
+        }
+        const bool written = (fwrite(index.data(), 1, index.size(), strm) == index.size());
+        if (0 != fclose(strm) || !written) {
+            throw std::runtime_error(SysError("Unable to write chunk index."));
+        }
+
+        const char *basename = Updater::Util::Basename(indexname.c_str());
+        char t_url[1024] = {0};
+        ReplaceString(url, "%%", basename, t_url, sizeof(t_url));
+
+        const size_t count = (index.size() - Updater::Chunker::HEADER_SIZE) / Updater::Chunker::ENTRY_SIZE;
+        std::cerr << "Chunks: " << count << " chunks, average "
+            << (count ? file.fileSize / count : 0) << " bytes, index " << index.size() << std::endl;
+
+        std::cout
+            << "\t<!-- <enclosure> chunk index attribute -->\n"
+            << "\t\tchunks=\"" << t_url << "\"\n"
+            << "\n";
+
+    } catch (std::exception &e) {
+        std::string msg;
+
+        msg += "An error occurred during chunk operations\n\n";
+        msg += e.what();
+        MessageBoxA(NULL, msg.c_str(), "Signature", MB_ICONWARNING | MB_OK);
+
+    } catch (...) {
+        const char *msg = "An unknown error occurred during chunk operations\n";
+
+        MessageBoxA(NULL, msg, "Signature", MB_ICONERROR | MB_OK);
+    }
+}
+
+
+//  Function: SignCompile
+//      Compile the XML manifest into its binary feed, see AutoManifestImage.h; written by
+//      default alongside the manifest as "<manifest>.bin", from where clients retrieve it in
+//      preference to the XML. The feed leads with an index of its (channel, os-label)
+//      segments, permitting clients to retrieve only those applicable by range request.
+//      Given a key-pair the index and each segment are signed.
+//
+//  Parameters:
+//      filename - XML manifest.
+//      output - Optional image name, otherwise "<manifest>.bin".
+//      keypair - Key-pair.
+//      keyversion - KeyVersion.
+//
+//  Returns:
+//      nothing
+//
+
+void
+SignCompile(const char *filename, const char *output, const struct SignKeyPair *keypair, unsigned keyversion)
+{
+    try {
+        File file;
+
+        file.load(filename);
+
+        char error[256] = {0};
+        void *image = NULL;
+        size_t imagelen = 0;
+
+        if (0 != autoupdate_manifest_compile(reinterpret_cast<const char *>(file.fileBuffer), file.fileSize,
+                    keypair, keyversion, &image, &imagelen, error, sizeof(error))) {
+            throw std::runtime_error(std::string("Unable to compile manifest.\n\n") + error);
+        }
+
+        const std::string body(static_cast<const char *>(image), imagelen);
+        autoupdate_manifest_free(image);
+
+        const std::string imagename = (output && *output ? std::string(output) : std::string(filename) + ".bin");
+
+        FILE *strm = fopen(imagename.c_str(), "wb");
+        if (NULL == strm) {
+            throw std::runtime_error(SysError("Unable to create manifest image."));
+        }
+        const bool written = (fwrite(body.data(), 1, body.size(), strm) == body.size());
+        if (0 != fclose(strm) || !written) {
+            throw std::runtime_error(SysError("Unable to write manifest image."));
+        }
+
+        std::cerr << "Manifest: " << file.fileSize << " -> " << body.size() << " bytes"
+            << (keypair ? ", signed" : ", unsigned") << ", image " << imagename << std::endl;
+
+    } catch (std::exception &e) {
+        std::string msg;
+
+        msg += "An error occurred during manifest compilation\n\n";
+        msg += e.what();
+        MessageBoxA(NULL, msg.c_str(), "Signature", MB_ICONWARNING | MB_OK);
+
+    } catch (...) {
+        const char *msg = "An unknown error occurred during manifest compilation\n";
+
+        MessageBoxA(NULL, msg, "Signature", MB_ICONERROR | MB_OK);
+    }
+}
+
+
 //  Function: Hash
 //      Generate the manifest hash for the specified installer image.
 //
@@ -326,6 +821,61 @@ Hash(const File &file, int type)
 }
 
 
+//  Function: Chunks
+//      Content-defined chunk index of the specified image; boundaries plus SHA-1 per chunk.
+//
+//  Parameters:
+//      file - Image.
+//
+//  Returns:
+//      Chunk index image.
+//
+static std::string
+Chunks(const File &file)
+{
+    const Updater::Chunker chunker;
+    HCRYPTPROV hProv = 0;
+    std::string index(CHUNK_MAGIC);
+    std::string entries;
+    unsigned long count = 0;
+
+    if (! CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
+        throw std::runtime_error(SysError("CryptAcquireContext failed."));
+    }
+
+    for (DWORD offset = 0; offset < file.fileSize;) {
+        const DWORD length = (DWORD)chunker.next(file.fileBuffer + offset, file.fileSize - offset);
+        BYTE hashBuffer[20] = {0};
+        DWORD hashSize = sizeof(hashBuffer);
+        HCRYPTHASH hHash = 0;
+
+        if (! CryptCreateHash(hProv, CALG_SHA, 0, 0, &hHash) ||
+                ! CryptHashData(hHash, file.fileBuffer + offset, length, 0) ||
+                ! CryptGetHashParam(hHash, HP_HASHVAL, hashBuffer, &hashSize, 0)) {
+            DWORD dwStatus = GetLastError();
+            if (hHash) CryptDestroyHash(hHash);
+            CryptReleaseContext(hProv, 0);
+            throw std::runtime_error(SysError("Chunk hash failed.", dwStatus));
+        }
+        CryptDestroyHash(hHash);
+
+        Put32(entries, length);
+        entries.append((const char *)hashBuffer, sizeof(hashBuffer));
+        offset += length;
+        ++count;
+    }
+    CryptReleaseContext(hProv, 0);
+
+    Put64(index, file.fileSize);
+    Put32(index, count);
+    Put32(index, Updater::Chunker::MINIMUM);
+    Put32(index, Updater::Chunker::MAXIMUM);
+    Put32(index, Updater::Chunker::MASK_BITS);
+    assert(index.size() == Updater::Chunker::HEADER_SIZE);
+    return index + entries;
+}
+
+
 static std::string
 Sign(const File& file, const struct SignKeyPair *key)
 {
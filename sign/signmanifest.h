@@ -34,6 +34,11 @@ struct SignKeyPair;
 void SignManifest(const char *filename, const char *version, const char *hosturl);
 void SignManifestEd(const char *filename, const char *version, const char *hosturl, 
             const struct SignKeyPair *keypair, unsigned keyversion);
+void SignDeltaEd(const char *filename, const char *previous, const char *previous_version,
+            const char *hosturl, const struct SignKeyPair *keypair, unsigned keyversion);
+void SignChunks(const char *filename, const char *hosturl);
+void SignCompile(const char *filename, const char *output,
+            const struct SignKeyPair *keypair, unsigned keyversion);
 
 #if defined(__cplusplus)
 }
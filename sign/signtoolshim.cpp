@@ -60,12 +60,14 @@ static const char *ExeVersion(const char *executable, char *version, size_t vers
 int
 SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
 {
-    const char *options = (args->hosturlalt ? "H:AK:x:V:E:h" : "H:K:x:V:E:h");
+    const char *options = (args->hosturlalt ? "H:AK:x:V:E:D:P:CMh" : "H:K:x:V:E:D:P:CMh");
     const char *private_pem = NULL;
     const char *version = args->version,
         *hosturl = args->hosturl;
     const char *exename = NULL;
+    const char *previous = NULL, *previous_version = NULL;
     unsigned key_version = 1;
+    bool chunks = false, compile = false;
     int ch;
 
     // arguments
@@ -90,6 +92,18 @@ SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
         case 'E':   // executable name
             exename = Updater::optarg;
             break;
+        case 'D':   // previous installer, delta source
+            previous = Updater::optarg;
+            break;
+        case 'P':   // previous version
+            previous_version = Updater::optarg;
+            break;
+        case 'C':   // chunk index
+            chunks = true;
+            break;
+        case 'M':   // compile manifest
+            compile = true;
+            break;
         case 'h':
         default:
             Usage(*args);
@@ -109,6 +123,42 @@ SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
         Usage(*args);
     }
 
+    if (compile) { // manifest image; XML input, optional image output.
+        const char *inputname = argv[0], *outputname = argv[1];
+
+        if (outputname && 0 == strcmp(inputname, outputname)) {
+            std::cerr << "\n" <<
+                progname << ": <input> and <output> names must be different." << std::endl;
+            Usage(*args);
+        }
+
+        if (private_pem && 0 == key_version) {
+            std::cerr << "\n" <<
+                progname << ": -x <version> required, private key without version." << std::endl;
+            Usage(*args);
+        }
+
+        if (NULL != private_pem) {
+            if (0 != _access(private_pem, 0)) {
+                std::cout << "Private key <" << private_pem << "> not found.\n";
+                return EXIT_FAILURE;
+            }
+
+            struct SignKeyPair keypair = {0};
+
+            if (0 != ed25519_load_pem(private_pem, NULL, &keypair)) {
+                std::cerr << "\n" <<
+                    progname << ": error reading key files." << std::endl;
+                return 1;
+            }
+            SignCompile(inputname, outputname, &keypair, key_version);
+
+        } else {
+            SignCompile(inputname, outputname, NULL, 0);
+        }
+        return 0;
+    }
+
     if (version && exename) {
         std::cerr << "\n" <<
             progname << ": -V and -E are mutually exclusive options." << std::endl;
@@ -157,6 +207,18 @@ SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
         Usage(*args);
     }
 
+    char prevversion[64] = {0};
+    if (previous && (!previous_version || !*previous_version)) {
+        if (NULL != ExeVersion(previous, prevversion, sizeof(prevversion))) {
+            previous_version = prevversion;
+        }
+        if (!previous_version || !*previous_version) {
+            std::cerr << "\n" <<
+                progname << ": -P <version> required, no previous version information available." << std::endl;
+            Usage(*args);
+        }
+    }
+
     if (private_pem && 0 == key_version) {
         std::cerr << "\n" <<
             progname << ": -x <version> required, private key without version." << std::endl;
@@ -174,6 +236,9 @@ SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
 
         if (0 == ed25519_load_pem(private_pem, NULL, &keypair)) {
             SignManifestEd(inputname, version, hosturl, &keypair, key_version);
+            if (previous) {
+                SignDeltaEd(inputname, previous, previous_version, hosturl, &keypair, key_version);
+            }
         } else {
             std::cerr << "\n" <<
                 progname << ": error reading key files." << std::endl;
@@ -182,6 +247,13 @@ SignToolShim(int argc, char *argv[], const struct SignToolArgs *args)
 
     } else {
         SignManifest(inputname, version, hosturl);
+        if (previous) {
+            SignDeltaEd(inputname, previous, previous_version, hosturl, NULL, 0);
+        }
+    }
+
+    if (chunks) {
+        SignChunks(inputname, hosturl);
     }
     return 0;
 }
@@ -221,6 +293,13 @@ Usage(const struct SignToolArgs &args)
         "   -K <private-key>        Private key image, generates a Ed25519 signature.\n"\
         "   -x <version>            KeyVersion, default <1>.\n"\
         "\n"\
+        "   -D <installer>          Previous installer, generates a delta enclosure.\n"\
+        "   -P <version>            Previous version label, otherwise previous installer.\n"\
+        "   -C                      Chunk index, permitting chunk reuse downloads.\n"\
+        "\n"\
+        "   -M                      Compile the XML manifest <input> into its binary feed,\n"\
+        "                           written to <output>, otherwise <input>.bin; signed given -K.\n"\
+        "\n"\
         "Arguments:\n"\
         "   input                   Name of the input file.\n"\
         "   output                  Optional name of the results output file, otherwise stdout.\n"\
@@ -0,0 +1,506 @@
+//  $Id: AutoCache.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: HTTP response cache.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "AutoCache.h"
+#include "AutoTransport.h"
+#include "AutoConfig.h"
+#include "AutoLogger.h"
+#include "../util/Format.h"
+#include "../util/Base64.h"
+#include "../util/Hex.h"
+
+#include <shlobj.h>                             // SHGetFolderPath
+
+namespace Updater {
+
+#define CACHE_SIGNATURE     "AUTOUPDATE-CACHE 1"
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ResponseCache
+//
+
+//static
+bool
+ResponseCache::Lookup(const std::string &url, CacheEntry &entry)
+{
+    const std::string filename = Filename(url);
+    unsigned long long length = 0;
+    char line[2048];
+    FILE *strm;
+
+    if (filename.empty() || NULL == (strm = fopen(filename.c_str(), "rb"))) {
+        return false;
+    }
+
+    entry = CacheEntry();
+    if (NULL == fgets(line, sizeof(line), strm) || 0 != strncmp(line, CACHE_SIGNATURE, sizeof(CACHE_SIGNATURE) - 1)) {
+        fclose(strm);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), strm)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (0 == line[0]) {
+            break;                              // end-of-header
+        } else if (0 == strncmp(line, "url=", 4)) {
+            entry.url = line + 4;
+        } else if (0 == strncmp(line, "etag=", 5)) {
+            entry.etag = line + 5;
+        } else if (0 == strncmp(line, "last-modified=", 14)) {
+            entry.last_modified = line + 14;
+        } else if (0 == strncmp(line, "max-age=", 8)) {
+            entry.max_age = strtol(line + 8, NULL, 10);
+        } else if (0 == strncmp(line, "stored=", 7)) {
+            entry.stored = (time_t)_strtoi64(line + 7, NULL, 10);
+        } else if (0 == strncmp(line, "length=", 7)) {
+            length = _strtoui64(line + 7, NULL, 10);
+        }
+    }
+
+    bool success = false;
+    if (entry.url == url && length <= MAXIMUM_BODY) {
+        entry.body.resize((size_t)length);
+        success = (0 == length || fread(&entry.body[0], 1, (size_t)length, strm) == (size_t)length);
+    }
+    fclose(strm);
+
+    if (! success) {
+        LOG<LOG_INFO>() << "Cache: discarding corrupt entry <" << url << ">" << LOG_ENDL;
+        ::DeleteFileA(filename.c_str());
+    }
+    return success;
+}
+
+
+//static
+//  Freshness and validators; see RFC 7234 section 5.2 and RFC 7232.
+//
+bool
+ResponseCache::Update(CacheEntry &entry, const TransportResponse &response)
+{
+    const std::string &cc = response.cache_control;
+    size_t pos;
+
+    if (std::string::npos != cc.find("no-store")) {
+        return false;
+    }
+
+    entry.max_age = 0;                          // default, revalidate on each use.
+    if (std::string::npos == cc.find("no-cache") &&
+            std::string::npos != (pos = cc.find("max-age="))) {
+        entry.max_age = strtol(cc.c_str() + pos + 8, NULL, 10);
+        if (entry.max_age < 0) entry.max_age = 0;
+    }
+
+    if (! response.etag.empty()) {
+        entry.etag = response.etag;
+    }
+    if (! response.last_modified.empty()) {
+        entry.last_modified = response.last_modified;
+    }
+    entry.stored = time(NULL);
+    return (entry.max_age > 0 || entry.Revalidatable());
+}
+
+
+//static
+//  Write replacement and rename, readers observe either the old or new image.
+//
+bool
+ResponseCache::Store(const CacheEntry &entry)
+{
+    const std::string filename = Filename(entry.url);
+    FILE *strm;
+
+    if (filename.empty() || entry.body.size() > MAXIMUM_BODY) {
+        return false;
+    }
+
+    const std::string tempname = filename + Updater::format(".%lu.tmp", (unsigned long)::GetCurrentThreadId());
+    if (NULL == (strm = fopen(tempname.c_str(), "wb"))) {
+        return false;
+    }
+
+    fprintf(strm, CACHE_SIGNATURE "\nurl=%s\netag=%s\nlast-modified=%s\nmax-age=%ld\nstored=%lld\nlength=%lu\n\n",
+        entry.url.c_str(), entry.etag.c_str(), entry.last_modified.c_str(), entry.max_age,
+        (long long)entry.stored, (unsigned long)entry.body.size());
+    const bool success = (entry.body.empty() ||
+            fwrite(entry.body.data(), 1, entry.body.size(), strm) == entry.body.size());
+    if (0 != fclose(strm) || !success ||
+            ! ::MoveFileExA(tempname.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        ::DeleteFileA(tempname.c_str());
+        return false;
+    }
+
+    LOG<LOG_DEBUG>() << "Cache: stored <" << entry.url << ">, max-age=" << entry.max_age << LOG_ENDL;
+    return true;
+}
+
+
+//static
+void
+ResponseCache::Remove(const std::string &url)
+{
+    const std::string filename = Filename(url);
+    if (! filename.empty()) {
+        ::DeleteFileA(filename.c_str());
+    }
+}
+
+
+//static
+//  <LOCAL_APPDATA>\<AppName>\AutoUpdate\<component>
+//
+std::string
+ResponseCache::Directory(const char *component, bool shared)
+{
+    char path[MAX_PATH + 1] = {0};
+
+    if (! SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, path)) || !*path) {
+        return std::string();
+    }
+
+    std::string directory(path);
+    const char *components[] = { NULL, "AutoUpdate", component };
+    const std::string &appname = Config::GetAppName();
+
+    components[0] = (appname.empty() ? "AppUpdater" : appname.c_str());
+    for (unsigned idx = (shared ? 1 : 0); idx < (sizeof(components)/sizeof(components[0])); ++idx) {
+        directory += "\\";
+        directory += components[idx];
+        if (! ::CreateDirectoryA(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+            return std::string();
+        }
+    }
+    return directory;
+}
+
+
+//static/private
+//  Entry filename, FNV-1a hash of the url.
+//
+std::string
+ResponseCache::Filename(const std::string &url)
+{
+    const std::string directory = Directory();
+    unsigned long long hash = 14695981039346656037ULL;
+
+    if (directory.empty()) {
+        return std::string();
+    }
+
+    for (std::string::const_iterator it(url.begin()); it != url.end(); ++it) {
+        hash ^= (unsigned char)*it;
+        hash *= 1099511628211ULL;
+    }
+    return directory + Updater::format("\\%016llx.cache", hash);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  InstallerCache
+//
+//      <LOCAL_APPDATA>\<AppName>\AutoUpdate\Installer\prior.img
+//                                                  \prior.ini
+//
+//      <LOCAL_APPDATA>\AutoUpdate\Installers\<key>.img
+//
+
+#define INSTALLER_SIGNATURE "AUTOUPDATE-INSTALLER 1"
+
+//static
+//  Hard link where the volume permits, otherwise copy; the description is written last,
+//  as such an interrupted update leaves no prior image. Writers of the image replace rather
+//  than truncate the target (see FileDownloadSink::open()), so never write through the link.
+//
+bool
+InstallerCache::Retain(const std::string &image, const std::string &version, const std::string &sha)
+{
+    const std::string directory = ResponseCache::Directory("Installer");
+    FILE *strm;
+
+    if (directory.empty() || version.empty() || sha.empty()) {
+        return false;
+    }
+
+    const std::string imagename = directory + "\\prior.img", ininame = directory + "\\prior.ini";
+
+    ::DeleteFileA(ininame.c_str());
+    ::DeleteFileA(imagename.c_str());
+    if (! ::CreateHardLinkA(imagename.c_str(), image.c_str(), NULL) &&
+            ! ::CopyFileA(image.c_str(), imagename.c_str(), FALSE)) {
+        LOG<LOG_WARN>() << "Installer: unable to retain <" << image << "> : " << GetLastError() << LOG_ENDL;
+        return false;
+    }
+
+    if (NULL == (strm = fopen(ininame.c_str(), "w"))) {
+        ::DeleteFileA(imagename.c_str());
+        return false;
+    }
+    fprintf(strm, INSTALLER_SIGNATURE "\nversion=%s\nsha=%s\n", version.c_str(), sha.c_str());
+    if (0 != fclose(strm)) {
+        ::DeleteFileA(ininame.c_str());
+        ::DeleteFileA(imagename.c_str());
+        return false;
+    }
+
+    LOG<LOG_DEBUG>() << "Installer: retained <" << version << ">" << LOG_ENDL;
+    return true;
+}
+
+
+//static
+std::string
+InstallerCache::Prior(std::string &version, std::string &sha)
+{
+    const std::string directory = ResponseCache::Directory("Installer");
+    char line[1024];
+    FILE *strm;
+
+    version.clear(), sha.clear();
+    if (directory.empty() || NULL == (strm = fopen((directory + "\\prior.ini").c_str(), "r"))) {
+        return std::string();
+    }
+
+    if (NULL != fgets(line, sizeof(line), strm) && 0 == strncmp(line, INSTALLER_SIGNATURE, sizeof(INSTALLER_SIGNATURE) - 1)) {
+        while (fgets(line, sizeof(line), strm)) {
+            line[strcspn(line, "\r\n")] = 0;
+            if (0 == strncmp(line, "version=", 8)) {
+                version = line + 8;
+            } else if (0 == strncmp(line, "sha=", 4)) {
+                sha = line + 4;
+            }
+        }
+    }
+    fclose(strm);
+
+    const std::string imagename = directory + "\\prior.img";
+    if (version.empty() || sha.empty() || INVALID_FILE_ATTRIBUTES == ::GetFileAttributesA(imagename.c_str())) {
+        version.clear(), sha.clear();
+        return std::string();
+    }
+    return imagename;
+}
+
+//static
+//  "sha-<hex>" otherwise "ed-<hex>", the decoded edSignature; file-system safe by construction.
+//
+std::string
+InstallerCache::Key(const std::string &sha, const std::string &edSignature)
+{
+    if (40 == sha.length() && std::string::npos == sha.find_first_not_of("0123456789abcdefABCDEF")) {
+        std::string key("sha-");
+        for (std::string::const_iterator it(sha.begin()); it != sha.end(); ++it) {
+            key.push_back((char)tolower((unsigned char)*it));
+        }
+        return key;
+    }
+
+    if (! edSignature.empty()) {
+        uint8_t signature[64] = {0};
+        const int length = Base64::decode(edSignature.c_str(), edSignature.length(), signature, sizeof(signature));
+        if (length == (int)sizeof(signature)) {
+            return "ed-" + Hex::to_string(signature, sizeof(signature));
+        }
+    }
+    return std::string();
+}
+
+
+//static
+//  Hard link where the volume permits, otherwise copy via a temporary; an existing image
+//  of the same key is retained, being identical content.
+//
+bool
+InstallerCache::Store(const std::string &image, const std::string &key, uint64_t capacity)
+{
+    const std::string directory = ResponseCache::Directory("Installers", true);
+    WIN32_FILE_ATTRIBUTE_DATA attributes = {0};
+
+    if (directory.empty() || key.empty() || 0 == capacity ||
+            ! ::GetFileAttributesExA(image.c_str(), GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+
+    const uint64_t size = (((uint64_t)attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    if (size > capacity) {
+        LOG<LOG_DEBUG>() << "Installer: <" << key << "> exceeds cache capacity" << LOG_ENDL;
+        return false;
+    }
+
+    const std::string imagename = directory + "\\" + key + ".img";
+    if (INVALID_FILE_ATTRIBUTES != ::GetFileAttributesA(imagename.c_str())) {
+        Touch(imagename);
+
+    } else if (! ::CreateHardLinkA(imagename.c_str(), image.c_str(), NULL)) {
+        const std::string tempname = Updater::format("%s\\%s.%lu.tmp", directory.c_str(), key.c_str(), ::GetCurrentProcessId());
+
+        if (! ::CopyFileA(image.c_str(), tempname.c_str(), FALSE) ||
+                (! ::MoveFileExA(tempname.c_str(), imagename.c_str(), 0) && GetLastError() != ERROR_ALREADY_EXISTS)) {
+            LOG<LOG_WARN>() << "Installer: unable to cache <" << image << "> : " << GetLastError() << LOG_ENDL;
+            ::DeleteFileA(tempname.c_str());
+            return false;
+        }
+        ::DeleteFileA(tempname.c_str());        // lost race, if any.
+    }
+
+    LOG<LOG_DEBUG>() << "Installer: cached <" << key << ">, size=" << size << LOG_ENDL;
+    Trim(directory, imagename, capacity);
+    return true;
+}
+
+
+//static
+std::string
+InstallerCache::Lookup(const std::string &key)
+{
+    const std::string directory = ResponseCache::Directory("Installers", true);
+
+    if (directory.empty() || key.empty()) {
+        return std::string();
+    }
+
+    const std::string imagename = directory + "\\" + key + ".img";
+    if (INVALID_FILE_ATTRIBUTES == ::GetFileAttributesA(imagename.c_str())) {
+        return std::string();
+    }
+    return imagename;
+}
+
+
+//static
+bool
+InstallerCache::Fetch(const std::string &key, const std::string &target)
+{
+    const std::string imagename = Lookup(key);
+
+    if (imagename.empty()) {
+        return false;
+    }
+
+    ::DeleteFileA(target.c_str());              // partial image, if any; never written through a link.
+    if (! ::CreateHardLinkA(target.c_str(), imagename.c_str(), NULL) &&
+            ! ::CopyFileA(imagename.c_str(), target.c_str(), FALSE)) {
+        LOG<LOG_WARN>() << "Installer: unable to fetch <" << key << "> : " << GetLastError() << LOG_ENDL;
+        return false;
+    }
+    Touch(imagename);
+    return true;
+}
+
+
+//static
+void
+InstallerCache::Remove(const std::string &key)
+{
+    const std::string imagename = Lookup(key);
+
+    if (! imagename.empty()) {
+        ::DeleteFileA(imagename.c_str());
+    }
+}
+
+
+//static/private
+//  Mark as recently used; the last-write time orders eviction.
+//
+void
+InstallerCache::Touch(const std::string &filename)
+{
+    HANDLE handle = ::CreateFileA(filename.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (INVALID_HANDLE_VALUE != handle) {
+        FILETIME now;
+        ::GetSystemTimeAsFileTime(&now);
+        ::SetFileTime(handle, NULL, NULL, &now);
+        ::CloseHandle(handle);
+    }
+}
+
+
+namespace {
+struct CachedImage {
+    std::string filename;
+    uint64_t size;
+    uint64_t used;                              // last-write, FILETIME.
+
+    bool operator<(const CachedImage &rhs) const {
+        return (used < rhs.used);
+    }
+};
+}
+
+
+//static/private
+//  Evict least recently used images, other than 'retain', until within capacity; images
+//  in use (e.g. running installers) cannot be removed and are skipped.
+//
+void
+InstallerCache::Trim(const std::string &directory, const std::string &retain, uint64_t capacity)
+{
+    std::vector<CachedImage> images;
+    WIN32_FIND_DATAA fd = {0};
+    uint64_t total = 0;
+    HANDLE handle;
+
+    if (INVALID_HANDLE_VALUE == (handle = ::FindFirstFileA((directory + "\\*.img").c_str(), &fd))) {
+        return;
+    }
+
+    do {
+        if (0 == (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            CachedImage image;
+
+            image.filename = directory + "\\" + fd.cFileName;
+            image.size = (((uint64_t)fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+            image.used = (((uint64_t)fd.ftLastWriteTime.dwHighDateTime) << 32) | fd.ftLastWriteTime.dwLowDateTime;
+            total += image.size;
+            images.push_back(image);
+        }
+    } while (::FindNextFileA(handle, &fd));
+    ::FindClose(handle);
+
+    std::sort(images.begin(), images.end());
+    for (std::vector<CachedImage>::const_iterator it(images.begin()); it != images.end() && total > capacity; ++it) {
+        if (0 != _stricmp(it->filename.c_str(), retain.c_str()) && ::DeleteFileA(it->filename.c_str())) {
+            LOG<LOG_DEBUG>() << "Installer: evicted <" << it->filename << ">" << LOG_ENDL;
+            total -= it->size;
+        }
+    }
+}
+
+}   // namespace Updater
+
+//end
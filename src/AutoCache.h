@@ -0,0 +1,144 @@
+#ifndef AUTOCACHE_H_INCLUDED
+#define AUTOCACHE_H_INCLUDED
+//  $Id: AutoCache.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: HTTP response cache.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <ctime>
+
+namespace Updater {
+
+struct TransportResponse;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Response cache entry
+//
+
+struct CacheEntry {
+    CacheEntry() : max_age(-1), stored(0) {
+    }
+
+    bool Fresh(time_t now) const {
+        return (max_age > 0 && now >= stored && (now - stored) < max_age);
+    }
+
+    bool Revalidatable() const {
+        return (!etag.empty() || !last_modified.empty());
+    }
+
+    std::string url;                            // source url.
+    std::string etag;                           // entity tag; optional.
+    std::string last_modified;                  // last-modified HTTP-date; optional.
+    long max_age;                               // freshness lifetime, in seconds; -1 unknown.
+    time_t stored;                              // time of storage/revalidation.
+    std::string body;                           // content.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ResponseCache
+//
+//  RFC 7234 style private on-disk cache of small resources (manifests, GitHub API
+//  replies and release notes); one file per url under the user's local application
+//  data, see Directory().
+//
+
+class ResponseCache {
+public:
+    enum {
+        MAXIMUM_BODY = 4 * 1024 * 1024          // resources larger are not retained.
+    };
+
+    // Retrieve the cached entry for the url; returns false if none.
+    static bool         Lookup(const std::string &url, CacheEntry &entry);
+
+    // Update the entry from the response headers; returns false if not storable.
+    static bool         Update(CacheEntry &entry, const TransportResponse &response);
+
+    // Store or replace the entry.
+    static bool         Store(const CacheEntry &entry);
+
+    // Remove the cached entry for the url, if any.
+    static void         Remove(const std::string &url);
+
+    // Cache directory; <component> beneath the application's AutoUpdate directory,
+    // otherwise when 'shared' that common to all applications of the user.
+    static std::string  Directory(const char *component = "Cache", bool shared = false);
+
+private:
+    static std::string  Filename(const std::string &url);
+    ResponseCache();                            // cannot be instantiated
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  InstallerCache
+//
+//  Retains the most recently installed image, being the source of delta updates; see
+//  AutoManifest::deltas.
+//
+//  Plus a content-addressed store of verified installer images, keyed by signature and
+//  shared by all applications of the user; images are hard linked in and out where the
+//  volume permits, and evicted least recently used beyond the capacity. Images fetched
+//  are unverified, callers must verify against their own manifest.
+//
+
+class InstallerCache {
+public:
+    // Store key of an image, by SHA signature otherwise edSignature; empty if neither.
+    static std::string  Key(const std::string &sha, const std::string &edSignature);
+
+    // Add a verified image, evicting others beyond 'capacity' bytes.
+    static bool         Store(const std::string &image, const std::string &key, uint64_t capacity);
+
+    // Stored image path, otherwise empty.
+    static std::string  Lookup(const std::string &key);
+
+    // Link or copy the stored image to 'target', marking it recently used; false if none.
+    static bool         Fetch(const std::string &key, const std::string &target);
+
+    // Remove a stored image, for example failing verification.
+    static void         Remove(const std::string &key);
+
+
+    // Retain a verified installer image, replacing any prior image.
+    static bool         Retain(const std::string &image, const std::string &version, const std::string &sha);
+
+    // Prior installer image plus its version and SHA signature; returns an empty path if none.
+    static std::string  Prior(std::string &version, std::string &sha);
+
+private:
+    static void         Touch(const std::string &filename);
+    static void         Trim(const std::string &directory, const std::string &retain, uint64_t capacity);
+    InstallerCache();                           // cannot be instantiated
+};
+
+}   // namespace Updater
+
+#endif  //AUTOCACHE_H_INCLUDED
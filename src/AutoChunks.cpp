@@ -0,0 +1,211 @@
+//  $Id: AutoChunks.cpp,v 1.1 2026/10/16 14:02:11 cvsuser Exp $
+//
+//  AutoUpdater: chunk reuse downloads.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+
+#include "common.h"
+
+#include <string>
+#include <cassert>
+
+#include "AutoChunks.h"
+#include "AutoError.h"
+#include "AutoLogger.h"
+
+#include <Wincrypt.h>
+
+namespace Updater {
+
+static uint64_t
+Get(const uint8_t *p, unsigned width)
+{
+    uint64_t value = 0;
+    for (int i = (int)width - 1; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ChunkIndex
+//
+
+ChunkIndex::ChunkIndex() :
+    length_(0)
+{
+}
+
+
+bool
+ChunkIndex::Load(const std::string &image)
+{
+    const uint8_t *cursor = reinterpret_cast<const uint8_t *>(image.data());
+
+    chunks_.clear();
+    if (image.size() < Chunker::HEADER_SIZE || 0 != memcmp(cursor, CHUNK_MAGIC, 8)) {
+        LOG<LOG_WARN>() << "Chunks: invalid index signature" << LOG_ENDL;
+        return false;
+    }
+
+    const uint64_t count = Get(cursor + 16, 4);
+    length_ = Get(cursor + 8, 8);
+    chunker_ = Chunker((unsigned)Get(cursor + 20, 4), (unsigned)Get(cursor + 24, 4), (unsigned)Get(cursor + 28, 4));
+    if (! chunker_.valid() || (image.size() - Chunker::HEADER_SIZE) != (count * Chunker::ENTRY_SIZE)) {
+        LOG<LOG_WARN>() << "Chunks: invalid index header" << LOG_ENDL;
+        return false;
+    }
+
+    uint64_t offset = 0;
+    chunks_.resize((size_t)count);
+    cursor += Chunker::HEADER_SIZE;
+    for (std::vector<ChunkEntry>::iterator it(chunks_.begin()), end(chunks_.end()); it != end; ++it) {
+        it->offset = offset;
+        it->length = (uint32_t)Get(cursor, 4);
+        memcpy(it->sha, cursor + 4, sizeof(it->sha));
+        offset += it->length;
+        cursor += Chunker::ENTRY_SIZE;
+    }
+
+    if (offset != length_) {
+        LOG<LOG_WARN>() << "Chunks: index length mismatch" << LOG_ENDL;
+        chunks_.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ChunkSource
+//
+
+ChunkSource::ChunkSource(const std::string &filename) :
+    filename_(filename), handle_(INVALID_HANDLE_VALUE), mapping_(NULL), view_(NULL), length_(0)
+{
+}
+
+
+ChunkSource::~ChunkSource()
+{
+    Release();
+}
+
+
+bool
+ChunkSource::Scan(const ChunkIndex &index)
+{
+    LARGE_INTEGER size = {0};
+
+    Release();
+    handle_ = ::CreateFileA(filename_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                    FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == handle_ || ! ::GetFileSizeEx(handle_, &size) || 0 == size.QuadPart ||
+            (uint64_t)size.QuadPart > (uint64_t)(((size_t)-1) / 4)) {
+        LOG<LOG_WARN>() << "Chunks: source <" << filename_ << "> unavailable" << LOG_ENDL;
+        Release();
+        return false;
+    }
+    length_ = (uint64_t)size.QuadPart;
+
+    if (NULL == (mapping_ = ::CreateFileMappingA(handle_, NULL, PAGE_READONLY, 0, 0, NULL)) ||
+            NULL == (view_ = static_cast<const uint8_t *>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)))) {
+        LOG<LOG_WARN>() << "Chunks: unable to map <" << filename_ << "> : " << GetLastError() << LOG_ENDL;
+        Release();
+        return false;
+    }
+
+    HCRYPTPROV hProv = 0;
+    if (! CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT)) {
+        throw SysException("CryptAcquireContext failed.");
+    }
+
+    const Chunker &chunker = index.Parameters();
+    for (uint64_t offset = 0; offset < length_;) {
+        const size_t length = chunker.next(view_ + offset, (size_t)(length_ - offset));
+        BYTE hashBuffer[20] = {0};
+        DWORD hashSize = sizeof(hashBuffer);
+        HCRYPTHASH hHash = 0;
+
+        if (! CryptCreateHash(hProv, CALG_SHA, 0, 0, &hHash) ||
+                ! CryptHashData(hHash, view_ + offset, (DWORD)length, 0) ||
+                ! CryptGetHashParam(hHash, HP_HASHVAL, hashBuffer, &hashSize, 0)) {
+            DWORD dwStatus = GetLastError();
+            if (hHash) CryptDestroyHash(hHash);
+            CryptReleaseContext(hProv, 0);
+            throw SysException(dwStatus, "Chunk hash failed.");
+        }
+        CryptDestroyHash(hHash);
+
+        Location &location = chunks_[std::string((const char *)hashBuffer, sizeof(hashBuffer))];
+        location.offset = offset;               // duplicates, last wins; identical content.
+        location.length = (uint32_t)length;
+        offset += length;
+    }
+    CryptReleaseContext(hProv, 0);
+
+    LOG<LOG_DEBUG>() << "Chunks: source <" << filename_ << ">, length=" << length_
+        << ", chunks=" << chunks_.size() << LOG_ENDL;
+    return true;
+}
+
+
+const uint8_t *
+ChunkSource::Find(const ChunkEntry &chunk) const
+{
+    std::map<std::string, Location>::const_iterator it =
+        chunks_.find(std::string((const char *)chunk.sha, sizeof(chunk.sha)));
+
+    if (it == chunks_.end() || it->second.length != chunk.length) {
+        return NULL;
+    }
+    return view_ + it->second.offset;
+}
+
+
+//private
+void
+ChunkSource::Release()
+{
+    if (view_) {
+        ::UnmapViewOfFile(view_);
+        view_ = NULL;
+    }
+    if (mapping_) {
+        ::CloseHandle(mapping_);
+        mapping_ = NULL;
+    }
+    if (INVALID_HANDLE_VALUE != handle_) {
+        ::CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+    chunks_.clear();
+    length_ = 0;
+}
+
+}   // namespace Updater
+
+//end
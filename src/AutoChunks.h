@@ -0,0 +1,113 @@
+#ifndef AUTOCHUNKS_H_INCLUDED
+#define AUTOCHUNKS_H_INCLUDED
+//  $Id: AutoChunks.h,v 1.1 2026/10/16 14:02:11 cvsuser Exp $
+//
+//  AutoUpdater: chunk reuse downloads.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../util/Chunker.h"
+
+namespace Updater {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Chunk reuse
+//
+//  The published chunk index of an enclosure (see Chunker.h) against a locally retained
+//  image, scanned using the same parameters; chunks held locally are copied, with only
+//  the remainder downloaded as byte ranges.
+//
+
+struct ChunkEntry {
+    uint64_t        offset;                     // image offset.
+    uint32_t        length;
+    uint8_t         sha[20];                    // SHA-1.
+};
+
+
+class ChunkIndex {
+public:
+    ChunkIndex();
+
+    // Decode an index image; false when malformed.
+    bool Load(const std::string &image);
+
+    uint64_t Length() const {
+        return length_;
+    }
+    const Chunker &Parameters() const {
+        return chunker_;
+    }
+    const std::vector<ChunkEntry> &Chunks() const {
+        return chunks_;
+    }
+
+private:
+    uint64_t length_;                           // image length.
+    Chunker chunker_;
+    std::vector<ChunkEntry> chunks_;
+};
+
+
+class ChunkSource {
+    ChunkSource(const ChunkSource &rhs);
+    ChunkSource& operator=(const ChunkSource &rhs);
+
+public:
+    ChunkSource(const std::string &filename);
+    ~ChunkSource();
+
+    // Map and chunk the image, as per the index parameters; false if unavailable.
+    bool Scan(const ChunkIndex &index);
+
+    // Local content of the given chunk, otherwise NULL.
+    const uint8_t *Find(const ChunkEntry &chunk) const;
+
+private:
+    void Release();
+
+private:
+    struct Location {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    const std::string filename_;
+    HANDLE handle_;
+    HANDLE mapping_;
+    const uint8_t *view_;                       // image mapping.
+    uint64_t length_;
+    std::map<std::string, Location> chunks_;    // by SHA-1, binary.
+};
+
+}   // namespace Updater
+
+#endif  //AUTOCHUNKS_H_INCLUDED
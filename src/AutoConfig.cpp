@@ -691,26 +691,35 @@ std::string
 Config::GetDefaultRegistryPath()
 {
     if (default_registry_path_.empty()) {
-        default_registry_path_ = "Software\\";
-        std::string vendor = Config::GetCompanyName();
-        if (! vendor.empty()) {
-            default_registry_path_ += vendor + "\\";
-        }
-        default_registry_path_ += Config::GetAppName();
-        default_registry_path_ += "\\AutoUpdate";
+        default_registry_path_ = GetAppRegistryPath(Config::GetAppName());
     }
     return default_registry_path_;
 }
 
 
+//private
+//  Default registry path of the named application.
+//
+std::string
+Config::GetAppRegistryPath(const std::string &appname)
+{
+    std::string path("Software\\");
+    const std::string vendor = Config::GetCompanyName();
+    if (! vendor.empty()) {
+        path += vendor + "\\";
+    }
+    path += appname;
+    path += "\\AutoUpdate";
+    return path;
+}
+
+
 namespace {
 CriticalSection x_config_critical_section;
 
 void
-RegistryWrite(const char *name, const char *value)
+RegistryWrite(const std::string &subkey, const char *name, const char *value)
 {
-    const std::string subkey = Config::GetRegistryPath();
-
     HKEY key;
     LONG result = RegCreateKeyExA(HKEY_CURRENT_USER, subkey.c_str(),
                         0, NULL, REG_OPTION_NON_VOLATILE, KEY_SET_VALUE, NULL, &key, NULL);
@@ -727,11 +736,16 @@ RegistryWrite(const char *name, const char *value)
 }
 
 
-bool
-RegistryRead(HKEY root, const char *name, char *buf, size_t len)
+void
+RegistryWrite(const char *name, const char *value)
 {
-    const std::string subkey = Config::GetRegistryPath();
+    RegistryWrite(Config::GetRegistryPath(), name, value);
+}
+
 
+bool
+RegistryRead(HKEY root, const std::string &subkey, const char *name, char *buf, size_t len)
+{
     HKEY key;
     LONG result = RegOpenKeyExA(root, subkey.c_str(), 0, KEY_QUERY_VALUE, &key);
     if (result != ERROR_SUCCESS) {
@@ -759,11 +773,21 @@ RegistryRead(HKEY root, const char *name, char *buf, size_t len)
 }
 
 
+bool
+RegistryRead(const std::string &subkey, const char *name, char *buf, size_t len)
+{
+    if (RegistryRead(HKEY_CURRENT_USER, subkey, name, buf, len) ||
+            RegistryRead(HKEY_LOCAL_MACHINE, subkey, name, buf, len)) {
+        return true;
+    }
+    return false;
+}
+
+
 bool
 RegistryRead(const char *name, char *buf, size_t len)
 {
-    if (RegistryRead(HKEY_CURRENT_USER, name, buf, len) ||
-            RegistryRead(HKEY_LOCAL_MACHINE, name, buf, len)) {
+    if (RegistryRead(Config::GetRegistryPath(), name, buf, len)) {
         return true;
     }
     return false;
@@ -832,6 +856,31 @@ Config::ReadConfigValueImpl(const char *name)
 }
 
 
+//  Access the registry of the named application, rather than that configured; the default
+//  path is assumed, see AutoUpdateSuite.
+//
+void
+Config::WriteAppConfigValue(const std::string &appname, const char *name, const std::string &value)
+{
+    CriticalSection::Guard lock(x_config_critical_section);
+    RegistryWrite(GetAppRegistryPath(appname), name, value.c_str());
+    LOG<LOG_DEBUG>() << "RegistryWrite(" << appname << ":" << name << ") = \"" << value << "\"" << LOG_ENDL;
+}
+
+
+std::string
+Config::ReadAppConfigValue(const std::string &appname, const char *name)
+{
+    CriticalSection::Guard lock(x_config_critical_section);
+    char buf[1025];
+    if (! RegistryRead(GetAppRegistryPath(appname), name, buf, sizeof(buf))) {
+        buf[0] = 0;
+    }
+    LOG<LOG_DEBUG>() << "RegistryRead(" << appname << ":" << name << ") = \"" << buf << "\"" << LOG_ENDL;
+    return std::string(buf);
+}
+
+
 bool
 Config::DeleteConfigValue(const char *name)
 {
@@ -159,6 +159,10 @@ public:
     // Delete a value from the registry
     static bool             DeleteConfigValue(const char *name);
 
+    // Write/read a value under the default registry path of the named application.
+    static void             WriteAppConfigValue(const std::string &appname, const char *name, const std::string &value);
+    static std::string      ReadAppConfigValue(const std::string &appname, const char *name);
+
 private:
     Config();                                   // cannot be instantiated
 
@@ -179,6 +183,7 @@ private:
     static std::string      GetPrivateValue(const char *name, const char *type, bool required= true);
 
     static std::string      GetDefaultRegistryPath();
+    static std::string      GetAppRegistryPath(const std::string &appname);
 
     static void             WriteConfigValueImpl(const char *name, const char *value);
     static std::string      ReadConfigValueImpl(const char *name);
@@ -134,9 +134,13 @@ AutoConsoleUI::InstallDialog(AutoUpdater &owner)
     const bool is_critical =                    // disable skip if critical
         owner.Manifest().IsCriticalUpdate(owner.AppVersion());
 
+    const bool has_notes =                      // release notes; loading in the background.
+        ! owner.Manifest().releaseNotesLink.empty() || ! owner.Manifest().description.empty();
+
     std::cout
         << "Would you like to install it now? [Y(es), L(ater)"
             << (is_critical ? "" : ", S(kip)")
+            << (has_notes ? ", R(elease notes)" : "")
         << "]";
     std::cout.flush();
     std::fflush(stdout);
@@ -168,8 +172,25 @@ AutoConsoleUI::InstallDialog(AutoUpdater &owner)
             owner.InstallLater();
             return 0;
 
-        } else if ('r' == ch || 'R' == ch) {
-            //  --- show release notes ---
+        } else if ('r' == ch || 'R' == ch) {    // release notes
+            std::string content;
+
+            switch (owner.ReleaseNotes(content)) {
+            case AutoUpdater::NotesNone:
+                content = owner.Manifest().description;
+                break;
+            case AutoUpdater::NotesPending:
+                content = "(release notes loading, try again shortly)";
+                break;
+            case AutoUpdater::NotesFailed:
+                content = "(release notes unavailable, see " + owner.Manifest().releaseNotesLink + ")";
+                break;
+            default:
+                break;
+            }
+            std::cout << "\n\n" << content << "\n" << std::endl;
+            std::cout << "Install now? [Y(es), L(ater)" << (is_critical ? "" : ", S(kip)") << "]";
+            std::cout.flush();
 
         } else if (0x1b == ch) {                // cancel
             std::cout << std::endl;
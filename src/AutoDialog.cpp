@@ -274,6 +274,7 @@ AutoDialog::dialog_proc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     case WM_QUERYDRAGICON:
         return (INT_PTR)self->OnQueryDragIcon();
     case WM_TIMER:
+        self->OnTimer((UINT_PTR)wParam);
         break;
     case WM_DESTROY:
         self->OnDestroy();
@@ -379,6 +380,13 @@ AutoDialog::OnSize(UINT /*type*/, int /*cx*/, int /*cy*/)
 }
 
 
+//virtual
+void
+AutoDialog::OnTimer(UINT_PTR /*id*/)
+{
+}
+
+
 //virtual
 void
 AutoDialog::OnDestroy()
@@ -239,6 +239,7 @@ protected:
     virtual LRESULT OnCtlColorStatic(WPARAM wParam, LPARAM lParam);
     virtual void    OnPaint();
     virtual void    OnSize(UINT type, int cx, int cy);
+    virtual void    OnTimer(UINT_PTR id);
     virtual void    OnClose();
     virtual void    OnDestroy();
 
@@ -31,77 +31,65 @@
 #include <string>
 #include <cassert>
 
-#include "AutoString.h"
-#include "AutoConfig.h"
 #include "AutoDownLoad.h"
+#include "AutoTransport.h"
+#include "AutoCache.h"
+#include "AutoLogger.h"
 #include "AutoError.h"
 
-#include <wininet.h>
-#if defined(PRAGMA_COMMENT_LIB)
-#pragma comment(lib, "Wininet.lib")
-#endif
-
-// supported on Windows 10, version 1507 and later.
-#if !defined(INTERNET_OPTION_ENABLE_HTTP_PROTOCOL)
-#define INTERNET_OPTION_ENABLE_HTTP_PROTOCOL 148
-#endif
-#if !defined(HTTP_PROTOCOL_FLAG_HTTP2)
-#define HTTP_PROTOCOL_FLAG_HTTP2 0x2
-#endif
-
 namespace Updater {
 
-namespace {
-class INETHandle {
-    INETHandle(INETHandle &rhs);
-    INETHandle& operator=(INETHandle &rhs);
+#define IOBUFFER_SIZE       (64 * 1024)
+#define SEGMENT_MINIMUM     (1024 * 1024)       // minimum range length.
+#define SEGMENT_MAXIMUM     16                  // concurrent range limit.
+#define RACE_MAXIMUM        4                   // concurrent source candidates.
+#define PACE_POLL           250                 // milliseconds, cancellation poll whilst paced.
 
-public:
-    INETHandle(HINTERNET handle = 0) : handle_(handle), callback_(false) { }
+class DownloadContext;
 
-    ~INETHandle() {
-        close();
+struct DownloadSegment {
+    DownloadSegment(DownloadContext &context__, uint64_t offset__, uint64_t length__) :
+        context(context__), offset(offset__), length(length__), completed(0), transport(NULL), thread(NULL) {
     }
 
-    INETHandle& operator=(HINTERNET handle) {
-        if (handle != handle_) {
-            close(), handle_ = handle;
-        }
-        return *this;
+    ~DownloadSegment() {
+        delete transport;
+        delete thread;
     }
 
-    operator HINTERNET() const {
-        return handle_;
-    }
+    DownloadContext &context;
+    const uint64_t offset;                      // range start.
+    const uint64_t length;                      // range length.
+    uint64_t completed;                         // bytes written.
+    ITransport *transport;
+    Updater::Thread *thread;
+};
 
-    bool set_callback(INTERNET_STATUS_CALLBACK callback) {
-        INTERNET_STATUS_CALLBACK CallbackPointer =
-                ::InternetSetStatusCallback(handle_, callback);
-        if (INTERNET_INVALID_STATUS_CALLBACK == CallbackPointer) {
-            return false;
-        }
-        callback_ = true;
-        return true;
+
+struct DownloadProbe {
+    DownloadProbe(DownloadContext &context__, const std::string &url__, const TransportRequest &request__) :
+        context(context__), url(url__), request(request__), transport(NULL), thread(NULL), latency(-1),
+            done(false), success(false), dismissed(false) {
     }
 
-    void close() {
-        if (HINTERNET handle = handle_) {
-            handle_ = 0;
-            if (callback_) { //unhook callback, stop closing notification.
-                ::InternetSetStatusCallback(handle, NULL);
-                callback_ = false;
-            }
-            ::InternetCloseHandle(handle);
-        }
+    ~DownloadProbe() {
+        delete transport;
+        delete thread;
     }
 
-private:
-    HINTERNET handle_;
-    bool callback_;
+    DownloadContext &context;
+    const std::string url;                      // candidate source.
+    const TransportRequest &request;            // primary request, retargeted.
+    TransportResponse response;
+    ITransport *transport;
+    Updater::Thread *thread;
+    std::string error;
+    long latency;                               // milliseconds to response.
+    bool done;
+    bool success;
+    bool dismissed;                             // aborted, having lost the race.
 };
 
-}   //namespace anon
-
 
 class DownloadContext {
 public:
@@ -111,31 +99,73 @@ public:
     bool start();
     bool completion(bool pump = true);
     void shutdown();
+    void detach();
     void release();
 
 private:
     ~DownloadContext();
+    void configure();
+    void pace(size_t bytes, IDownloadSink &target);
     bool execute();
-    void InternetError(const char *message, const DWORD ret = GetLastError());
+    ITransport *decoding(const TransportResponse &response);
+    unsigned segmentation(const TransportResponse &response, IDownloadSink &target) const;
+    uint64_t execute_segmented(const TransportRequest &request, const TransportResponse &response, unsigned count, char *buffer);
+    void segment(DownloadSegment &segment);
+    bool race(const TransportRequest &request, TransportResponse &response);
+    void probe(DownloadProbe &probe);
+    bool failover(const TransportRequest &request, uint64_t position, const char *what);
+    void observed(const std::string &source, long latency);
+    uint64_t transfer(ITransport &source, uint64_t offset, uint64_t length, char *buffer);
+    void failed(const char *what);
+    void decline();
+    void replay(IDownloadSink &target, const std::string &body);
+    void signal();
 
 private:
     static unsigned int __cdecl threadproc(void *param);
-    static VOID CALLBACK callback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus,
-            LPVOID lpvStatusInformation, DWORD dwStatusInformationLength);
+    static unsigned int __cdecl segmentproc(void *param);
+    static unsigned int __cdecl probeproc(void *param);
 
 public:
-    Download &owner;
+    Download &owner;                            // completion() and signal() alone; see configure().
     const std::string url;
+    int connect_timeout;                        // owner settings, as of construction.
+    int response_timeout;
+    bool enable_login;
+    bool decompress;
+    unsigned segment_limit;
+    uint64_t resume_offset;
+    std::string resume_validator;
+    uint64_t range_offset;
+    uint64_t range_length;
+    unsigned race_limit;
+    std::vector<std::string> sources;           // url, then any mirrors.
+    std::vector<std::string>::size_type next_source; // next race candidate.
+    std::string location;                       // source in use.
+    IDownloadCompletion *callback;              // asynchronous completion; optional.
     FileDownloadSink file_sink;
     IDownloadSink &sink;
     const unsigned flags;
+    TransportSession *session;
+    RateLimiter *limiter;
     CriticalSection lock;
     unsigned references;
-    INETHandle session_handle;
-    INETHandle request_handle;
-    HANDLE callback_trigger;
+    ITransport *transport;
+    ITransport *decoders[2];                    // decompression stages; content then image.
+    std::vector<DownloadSegment *> segments;    // active range workers.
+    std::vector<DownloadProbe *> probes;        // active source candidates.
+    HANDLE race_trigger;                        // probe completion.
+    std::map<std::string, long> latencies;      // observed source latency.
+    std::string error;                          // first segment error.
+    std::string segment_validator;              // If-Range of the segments; the first response.
     HANDLE completion_trigger;
+    HANDLE abort_trigger;                       // shutdown(); manual reset.
+    HANDLE interrupt_trigger;                   // owner cancellation, optional; see completion().
+    bool aborted;
+    bool cancelled;
+    bool declined;                              // a range answered in full; single stream.
     bool success;
+    bool concluded;                             // signalled.
 };
 
 
@@ -144,15 +174,29 @@ public:
 //
 
 Download::Download() :
-    context_(NULL), connect_timeout_(-1), response_timeout_(-1), enable_login_(false)
+    context_(NULL), session_(new TransportSession), limiter_(NULL), interrupt_(NULL), connect_timeout_(-1), response_timeout_(-1), enable_login_(false),
+        decompress_(false), segments_(0), resume_offset_(0), range_offset_(0), range_length_(0), race_(2)
 {
 }
 
 
+Download::Download(TransportSession *session) :
+    context_(NULL), session_(session), limiter_(NULL), interrupt_(NULL), connect_timeout_(-1), response_timeout_(-1), enable_login_(false),
+        decompress_(false), segments_(0), resume_offset_(0), range_offset_(0), range_length_(0), race_(2)
+{
+    if (session_) {
+        session_->AddRef();
+    }
+}
+
+
 Download::~Download()
 {
     if (context_) {
-        context_->shutdown();
+        context_->detach();
+    }
+    if (session_) {
+        session_->Release();
     }
 }
 
@@ -187,6 +231,22 @@ Download::get(const std::string &url, const char *filename, unsigned flags /*= 0
 }
 
 
+bool
+Download::get_async(const std::string &url, IDownloadSink &sink, IDownloadCompletion &on_done, unsigned flags /*= 0*/)
+{
+    if (! context_) {
+        DownloadContext *context = new DownloadContext(*this, url, sink, flags);
+        context->callback = &on_done;
+        if (context->start()) {
+            context_ = context;
+            return true;
+        }
+        context->release();
+    }
+    return false;
+}
+
+
 bool
 Download::completion(bool pump /*true*/)
 {
@@ -206,649 +266,1804 @@ Download::cancel()
         DownloadContext *context = context_;
         context_ = NULL;
         context->shutdown();
+        context->release();
     }
 }
 
 
-/////////////////////////////////////////////////////////////////////////////////////////
-//  FileDownloadSink
-//
-
-FileDownloadSink::FileDownloadSink(const char *filename) :
-    filename_(filename?filename:""), filesize_((size_t)-1), handle_(INVALID_HANDLE_VALUE) 
+void
+Download::segments(unsigned count)
 {
+    segments_ = (count > SEGMENT_MAXIMUM ? SEGMENT_MAXIMUM : count);
 }
 
 
-FileDownloadSink::~FileDownloadSink() 
+void
+Download::resume(uint64_t offset, const std::string &validator)
 {
-    close();
+    resume_offset_ = offset;
+    resume_validator_ = validator;
 }
 
 
-//virtual
 void
-FileDownloadSink::set_size(size_t size) 
+Download::range(uint64_t offset, uint64_t length)
 {
-    filesize_ = size;
+    range_offset_ = offset;
+    range_length_ = length;
 }
 
 
-//virtual
-bool
-FileDownloadSink::open() 
+void
+Download::decompress(bool enable)
 {
-    if (INVALID_HANDLE_VALUE == handle_) {
-        handle_ = ::CreateFileA(filename_.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                        NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    }
-    return (INVALID_HANDLE_VALUE != handle_);
+    decompress_ = enable;
 }
 
 
-//virtual
 void
-FileDownloadSink::close()
+Download::mirrors(const std::vector<std::string> &alternates, unsigned race /*= 2*/)
 {
-    if (INVALID_HANDLE_VALUE != handle_) {
-        ::CloseHandle(handle_);
-        handle_ = INVALID_HANDLE_VALUE;
-    }
+    mirrors_ = alternates;
+    race_ = (0 == race ? 1 : (race > RACE_MAXIMUM ? RACE_MAXIMUM : race));
 }
 
 
-//virtual
-void
-FileDownloadSink::append(const void *data, size_t len) 
+const std::map<std::string, long> &
+Download::latencies() const
 {
-    DWORD dwWriteSize = (DWORD)len, dwWriteNum = 0;
-    if (! ::WriteFile(handle_, data, dwWriteSize, &dwWriteNum, NULL) ||
-                dwWriteSize != dwWriteNum) {
-        throw SysException("Writing download image");
-    }
+    return latencies_;
 }
 
 
-/////////////////////////////////////////////////////////////////////////////////////////
-//  DownloadContext
-//
+void
+Download::statistics(unsigned &requests, unsigned &reused) const
+{
+    requests = (session_ ? session_->Requests() : 0);
+    reused = (session_ ? session_->Reused() : 0);
+}
 
-DownloadContext::DownloadContext(Download &owner__, const std::string &url__, IDownloadSink &sink__, unsigned flags__) :
-        owner(owner__), url(url__), file_sink(), sink(sink__), flags(flags__),
-    references(1), callback_trigger(INVALID_HANDLE_VALUE), completion_trigger(INVALID_HANDLE_VALUE),
-    success(false)
+
+void
+Download::limiter(RateLimiter *limiter)
 {
+    limiter_ = limiter;
 }
 
 
-DownloadContext::DownloadContext(Download &owner__, const std::string &url__, const char *filename__, unsigned flags__) :
-        owner(owner__), url(url__), file_sink(filename__), sink(file_sink), flags(flags__),
-    references(1), callback_trigger(INVALID_HANDLE_VALUE), completion_trigger(INVALID_HANDLE_VALUE),
-    success(false)
+void
+Download::interrupt(HANDLE event)
 {
+    interrupt_ = event;
 }
 
 
-bool
-DownloadContext::start()
+/////////////////////////////////////////////////////////////////////////////////////////
+//  RateLimiter
+//
+
+RateLimiter::RateLimiter(uint64_t rate, uint64_t burst) :
+    rate_(0), burst_(0), tokens_(0), last_(::GetTickCount64()), throttled_(0)
 {
-    assert(INVALID_HANDLE_VALUE == completion_trigger);
-    assert(INVALID_HANDLE_VALUE == callback_trigger);
-    if (NULL != (completion_trigger = ::CreateEventW(NULL, FALSE, FALSE, NULL)) &&
-                NULL != (callback_trigger = ::CreateEventW(NULL, FALSE, FALSE, NULL))) {
+    set(rate, burst);
+}
 
-        Updater::Thread *thread;
-        if (NULL != (thread = Updater::Thread::Begin(threadproc, (void *)this))) {
-            ++references;
-            thread->SetAutoDelete();
-            thread->ResumeThread();
-            return true;
-        }
 
-        ::CloseHandle(callback_trigger);
-        ::CloseHandle(completion_trigger);
-        callback_trigger = INVALID_HANDLE_VALUE;
-        completion_trigger = INVALID_HANDLE_VALUE;
+void
+RateLimiter::set(uint64_t rate, uint64_t burst)
+{
+    CriticalSection::Guard guard(lock_);
+    refill();
+    rate_ = rate;
+    burst_ = (burst ? burst : rate);            // default, one second.
+    if (tokens_ > (int64_t)burst_) {
+        tokens_ = (int64_t)burst_;
     }
-    return false;
 }
 
 
+//  Account for 'bytes' read, pacing the caller whilst the bucket is in debt. Returns false
+//  should 'abort' be signalled or 'timeout' milliseconds elapse ahead of repayment, the debt
+//  standing; a subsequent acquire(0) resumes the wait. Waits are bounded, so rate changes
+//  apply promptly.
+//
 bool
-DownloadContext::completion(bool pump)
+RateLimiter::acquire(size_t bytes, HANDLE abort, DWORD timeout)
 {
-    HANDLE t_trigger;
-    MSG msg = {0};
-
-    assert(references);
-
-    {   CriticalSection::Guard guard(lock);
-        assert(INVALID_HANDLE_VALUE != completion_trigger);
-        if (INVALID_HANDLE_VALUE == (t_trigger = completion_trigger)) {
-            return false;
+    {   CriticalSection::Guard guard(lock_);
+        if (0 == rate_) {
+            return true;                        // unlimited.
         }
+        refill();
+        tokens_ -= (int64_t)bytes;
     }
 
-    for (bool done = false; !done;) {       // message pump loop.
-        if (::MsgWaitForMultipleObjects(1, &t_trigger,
-                    FALSE, 100, QS_ALLEVENTS) == WAIT_OBJECT_0) {
-            CriticalSection::Guard guard(lock);
-            if (INVALID_HANDLE_VALUE != completion_trigger) {
-                assert(t_trigger == completion_trigger);
-                completion_trigger = INVALID_HANDLE_VALUE;
-                ::CloseHandle(t_trigger);
+    for (DWORD waited = 0;;) {
+        DWORD wait;
+
+        {   CriticalSection::Guard guard(lock_);
+            if (0 == rate_) {
+                tokens_ = 0;
+                return true;
             }
-            done = true;                    // trigger complete or quit.
-            break;
+            refill();
+            if (tokens_ >= 0) {
+                return true;
+            }
+            const uint64_t deficit = (uint64_t)(-tokens_);
+            wait = (DWORD)(((deficit * 1000) / rate_) + 1);
+            if (wait > 100) wait = 100;
         }
 
-        if (pump) {
-            while (::PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE)) {
-                if (WM_QUIT == msg.message) {
-                    done = true;
-                    break;
-                } else if (::GetMessage(&msg, NULL, 0, 0) > 0) {
-                    if (! IsDialogMessage(NULL, &msg)) {
-                        TranslateMessage(&msg);
-                        DispatchMessage(&msg);
-                    }
-                }
+        if (INFINITE != timeout) {
+            if (waited >= timeout) {
+                return false;
             }
+            if (wait > timeout - waited) wait = timeout - waited;
         }
-    }
-
-    const bool t_success = success;
-    release();
-    return t_success;
-}
 
+        bool t_aborted = false;
+        if (abort) {
+            t_aborted = (WAIT_OBJECT_0 == ::WaitForSingleObject(abort, wait));
+        } else {
+            ::Sleep(wait);
+        }
+        waited += wait;
 
-void
-DownloadContext::shutdown()
-{
-    CriticalSection::Guard guard(lock);
-    if (session_handle) {
-        if (request_handle) {
-            request_handle.close();
-            ::SetEvent(callback_trigger);
+        CriticalSection::Guard guard(lock_);
+        throttled_ += wait;
+        if (t_aborted) {
+            return false;
         }
-        session_handle.close();
-        ::CloseHandle(callback_trigger);
-        callback_trigger = INVALID_HANDLE_VALUE;
     }
 }
 
 
-void
-DownloadContext::release()
+uint64_t
+RateLimiter::throttled() const
 {
-    unsigned t_references;
-    {   CriticalSection::Guard guard(lock);
-        assert(references);
-        t_references = --references;
-    }
-    if (0 == t_references) {
-        delete this;
-    }
+    CriticalSection::Guard guard(lock_);
+    return throttled_;
 }
 
 
-DownloadContext::~DownloadContext()
+//private
+void
+RateLimiter::refill()
 {
-    assert(0 == references);
-    if (INVALID_HANDLE_VALUE != callback_trigger) {
-        ::CloseHandle(callback_trigger);
-    }
-    if (INVALID_HANDLE_VALUE != completion_trigger) {
-        ::CloseHandle(completion_trigger);
+    const unsigned long long now = ::GetTickCount64();
+
+    if (0 == rate_) {
+        last_ = now;
+
+    } else if (now > last_) {
+        const int64_t added = (int64_t)(((now - last_) * rate_) / 1000);
+        if (added) {                            // otherwise accumulate, retaining fractions.
+            tokens_ += added;
+            if (tokens_ > (int64_t)burst_) {
+                tokens_ = (int64_t)burst_;
+            }
+            last_ = now;
+        }
     }
 }
 
 
-//static/private
-unsigned int __cdecl
-DownloadContext::threadproc(void *param)
-{
-    DownloadContext *self = reinterpret_cast<DownloadContext *>(param);
-    assert(self && self->references);
-    if (self) {
-        try {
-            self->success = self->execute();
-            LOG<LOG_INFO>() << "Download: <" << self->url << "> complete" << LOG_ENDL;
-        } catch (std::exception &e) {
-            LOG<LOG_ERROR>() << "Download: <" << self->url << "> exception : " << e.what() << LOG_ENDL;
-        } catch (...) {
-            LOG<LOG_ERROR>() << "Download: <" << self->url << "> unhandled exception" << LOG_ENDL;
-        }
+/////////////////////////////////////////////////////////////////////////////////////////
+//  FileWriter
+//
+//  Write-behind of sequential content; the producer fills ring buffers in turn, each
+//  submitted once full or discontiguous, the writer draining them in order by positional
+//  writes. The producer blocks only whilst every buffer is queued.
+//
 
-        if (INVALID_HANDLE_VALUE != self->completion_trigger) {
-            ::SetEvent(self->completion_trigger);
-        }
+class FileWriter {
+    FileWriter(const FileWriter &rhs);
+    FileWriter& operator=(const FileWriter &rhs);
 
-        self->shutdown();
-        self->release();
-    }
-    return 0;
-}
+    enum {
+        BUFFER_SIZE = 256 * 1024
+    };
 
+    struct Buffer {
+        Buffer() : offset(0), length(0) {
+        }
+        std::vector<char> data;
+        uint64_t offset;
+        size_t length;
+    };
 
-//private
-bool
-DownloadContext::execute()
-{
-    //  local resources
-    // ------------------------------------------------------------------------
-
-    if (0 == url.find("\\\\.\\") || 0 == url.find("file:///")) {
-        //
-        //  allows local paths, in two forms:
-        //      \\.\C:\appname.manifest
-        //      file:///X:/appname.manifest
-        //
-        const char *source = url.c_str();
-        const char *filename = ('f' == *source ? source + 8 : source);
-        HANDLE fd;
-
-        LOG<LOG_DEBUG>() << "Download: local file=" << filename << LOG_ENDL;
-
-        fd = ::CreateFileA(filename, GENERIC_READ,
-                    FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (INVALID_HANDLE_VALUE == fd) {
-            std::string message;
-            message = "opening <", message += source, message += ">";
-            throw SysException(message);
-        }
-
-        size_t result = 0;
-        sink.set_size((size_t) GetFileSize(fd, NULL));
-
-        if (sink.open()) {
-            char buffer[8 * 1024];
-            for (;;) {
-                DWORD read = 0;
-
-                if (! ::ReadFile(fd, buffer, sizeof(buffer), &read, NULL)) {
-                    std::string message;
-                    message = "reading <", message += filename, message += ">";
-                    ::CloseHandle(fd);
-                    throw SysException(message);
-                }
+public:
+    FileWriter(HANDLE handle, unsigned depth, FileDownloadSink::FlushPolicy flush) :
+        handle_(handle), flush_(flush), ring_(depth), fill_(0), head_(0), queued_(0),
+            thread_(NULL), error_(0), blocked_(0), stopping_(false) {
+    }
 
-                if (0 == read) break; // EOF
-                sink.append(buffer, read);
-                result += read;
+    ~FileWriter() {
+        if (thread_) {
+            {   CriticalSection::Guard guard(lock_);
+                stopping_ = true;
             }
-            sink.close();
+            work_.Trigger();
+            ::WaitForSingleObject(thread_->handle_, INFINITE);
+            delete thread_;
         }
+    }
 
-        LOG<LOG_DEBUG>() << "Download: size=" << result << LOG_ENDL;
-        ::CloseHandle(fd);
+    bool start() {
+        for (std::vector<Buffer>::iterator it(ring_.begin()); it != ring_.end(); ++it) {
+            it->data.resize(BUFFER_SIZE);
+        }
+        if (! work_.Create(false) || ! space_.Create(false) ||
+                NULL == (thread_ = Updater::Thread::Begin(writerproc, (void *)this))) {
+            return false;
+        }
+        thread_->ResumeThread();
         return true;
     }
 
-    // remote resources
-    // ------------------------------------------------------------------------
+    void write(uint64_t offset, const void *data, size_t length) {
+        const char *cursor = static_cast<const char *>(data);
 
-    // extract url components
-    URL_COMPONENTSA uc = { sizeof(uc) };
+        while (length) {
+            Buffer &buffer = ring_[fill_];
 
-    uc.dwHostNameLength = 1;
-    uc.dwUrlPathLength = 1;
-    uc.dwExtraInfoLength = 1;
-    if (! InternetCrackUrlA(url.c_str(), 0, 0, &uc)) {
-        throw SysException("Invalid URL");
-    }
+            if (buffer.length && (buffer.offset + buffer.length) != offset) {
+                submit();                       // discontiguous, e.g. following lent views.
+                continue;
+            }
 
-    if (NULL == uc.lpszHostName || 0 == uc.dwHostNameLength) {
-        throw AppException("Invalid URL, missing hostname");
+            if (0 == buffer.length) {
+                buffer.offset = offset;
+            }
 
-    } else if (NULL == uc.lpszUrlPath || 0 == uc.dwUrlPathLength) {
-        throw AppException("Invalid URL, missing url_path");
+            size_t count = BUFFER_SIZE - buffer.length;
+            if (count > length) count = length;
+            memcpy(&buffer.data[buffer.length], cursor, count);
+            buffer.length += count;
+            cursor += count, offset += count, length -= count;
 
-    } else if (INTERNET_SCHEME_HTTP == uc.nScheme) {
-        throw AppException("Invalid URL, insecure transport");
+            if (BUFFER_SIZE == buffer.length) {
+                submit();
+            }
+        }
     }
 
-    // open session
-    const DWORD dwFlags =
-            INTERNET_FLAG_RELOAD | // Forces a download of the requested file from the origin server, not from the cache.
-            INTERNET_FLAG_NO_CACHE_WRITE | // Does not add the returned entity to the cache.
-            (uc.nScheme == INTERNET_SCHEME_HTTPS ? INTERNET_FLAG_SECURE : 0) | // Secure transaction semantics.
-            (Download::NOCACHED & flags ? INTERNET_FLAG_PRAGMA_NOCACHE : 0);
-
-    const std::string user_agent =
-        Config::GetAppName() + "/" +  Config::GetAppVersion() + " AutoUpdate";
-    session_handle =
-        InternetOpenA(user_agent.c_str(), INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL,  0);
-    if (! session_handle) {
-        InternetError("Opening Internet connection");
+    // Queue any partial buffer and await the writer; returns the first error, if any.
+    DWORD drain() {
+        if (ring_[fill_].length) {
+            submit();
+        }
+        wait(0);
+        if (FileDownloadSink::FLUSH_NEVER != flush_ && 0 == error_) {
+            if (! ::FlushFileBuffers(handle_)) {
+                error_ = GetLastError();
+            }
+        }
+        return error_;
     }
 
-    DWORD http2_option = HTTP_PROTOCOL_FLAG_HTTP2;
-    ::InternetSetOption(session_handle, INTERNET_OPTION_ENABLE_HTTP_PROTOCOL, &http2_option, sizeof(http2_option));
-
-    if (owner.connect_timeout_ >= 0) {
-        DWORD dw = (owner.connect_timeout_ == 0 ? 0xFFFFFFFF : owner.connect_timeout_ * 1000);
-        ::InternetSetOption(session_handle, INTERNET_OPTION_CONNECT_TIMEOUT, &dw, sizeof(dw));
+    uint64_t written(uint64_t cursor) {
+        CriticalSection::Guard guard(lock_);
+        if (queued_) {
+            return ring_[head_].offset;
+        }
+        return (ring_[fill_].length ? ring_[fill_].offset : cursor);
     }
 
-    if (owner.response_timeout_ >= 0) {
-        DWORD dw = (owner.response_timeout_ == 0 ? 0xFFFFFFFF : owner.response_timeout_ * 1000);
-        ::InternetSetOption(session_handle, INTERNET_OPTION_SEND_TIMEOUT, &dw, sizeof(dw));
-        ::InternetSetOption(session_handle, INTERNET_OPTION_RECEIVE_TIMEOUT, &dw, sizeof(dw));
+    uint64_t blocked() const {
+        return blocked_;
     }
 
-    // url canonicalization
-    char canonical_url[2000] = {0};
-    DWORD nSize = sizeof(canonical_url);
-    if (! InternetCanonicalizeUrlA(url.c_str(), canonical_url, &nSize, ICU_BROWSER_MODE)) {
-        InternetError("Canonicalizing URL");
+private:
+    // Pass the fill buffer to the writer, then await a free buffer; raising writer errors.
+    void submit() {
+        {   CriticalSection::Guard guard(lock_);
+            ++queued_;
+        }
+        work_.Trigger();
+        fill_ = (fill_ + 1) % ring_.size();
+        wait((unsigned)ring_.size() - 1);
+        if (error_) {
+            throw SysException(error_, "Writing download image");
+        }
     }
 
-    session_handle.set_callback(callback);
+    // Block whilst more than 'limit' buffers are queued.
+    void wait(unsigned limit) {
+        unsigned long long start = 0;
 
-    // request
-again:
-    request_handle =
-        ::InternetOpenUrlA(session_handle, canonical_url, NULL, (DWORD)-1, dwFlags, (DWORD_PTR)this);
-    if (! request_handle) {
-        const DWORD ret = GetLastError();
-        if (ERROR_IO_PENDING != ret) {
-            std::string msg;
-
-            msg += "Opening URL <", msg += canonical_url, msg += ">";
-            if (ERROR_INVALID_HANDLE == ret) {
-                msg += "\nUnable to connect";
-                throw AppException(msg);
+        for (;;) {
+            {   CriticalSection::Guard guard(lock_);
+                if (queued_ <= limit) {
+                    break;
+                }
             }
-            InternetError(msg.c_str(), ret);
+            if (0 == start) {
+                start = ::GetTickCount64();
+            }
+            space_.Wait(INFINITE);
+        }
+        if (start) {
+            blocked_ += ::GetTickCount64() - start;
         }
     }
 
-    ::WaitForSingleObject(callback_trigger, 0);
+    static unsigned int __cdecl writerproc(void *param) {
+        FileWriter *self = reinterpret_cast<FileWriter *>(param);
 
-    // status
-    DWORD status_code = 0, status_code_len = sizeof(status_code);
-    if (! HttpQueryInfo(request_handle, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, 
-            &status_code, &status_code_len, 0)) {
-        InternetError("Reading Internet connection");
-
-    } else if (status_code >= 400) {                // error, decode and report
-        DWORD http_msg_len = 0;
+        for (;;) {
+            Buffer *buffer = NULL;
 
-        if (owner.enable_login_) {
-            if (HTTP_STATUS_PROXY_AUTH_REQ == status_code) {
-                if (::InternetErrorDlg(GetDesktopWindow(), request_handle, ERROR_INTERNET_INCORRECT_PASSWORD,
-                        FLAGS_ERROR_UI_FILTER_FOR_ERRORS |FLAGS_ERROR_UI_FLAGS_GENERATE_DATA |
-                        FLAGS_ERROR_UI_FLAGS_CHANGE_OPTIONS, NULL) == ERROR_INTERNET_FORCE_RETRY) {
-                    goto again;
+            {   CriticalSection::Guard guard(self->lock_);
+                if (self->queued_) {
+                    buffer = &self->ring_[self->head_];
+                } else if (self->stopping_) {
+                    break;
                 }
             }
 
-            if (HTTP_STATUS_DENIED == status_code) {
-                if (::InternetErrorDlg(GetDesktopWindow(), request_handle, ERROR_INTERNET_INCORRECT_PASSWORD,
-                        FLAGS_ERROR_UI_FILTER_FOR_ERRORS |FLAGS_ERROR_UI_FLAGS_GENERATE_DATA |
-                        FLAGS_ERROR_UI_FLAGS_CHANGE_OPTIONS, NULL) == ERROR_INTERNET_FORCE_RETRY) {
-                    goto again;
-                }
+            if (NULL == buffer) {
+                self->work_.Wait(INFINITE);
+                continue;
             }
-        }
 
-        if (! ::HttpQueryInfoA(request_handle, HTTP_QUERY_STATUS_TEXT, NULL, &http_msg_len, 0) &&
-                    GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-            std::string http_msg;
+            if (0 == self->error_) {            // once failed, drain without writing.
+                DWORD dwWriteSize = (DWORD)buffer->length, dwWriteNum = 0;
+                OVERLAPPED ov = {0};
+
+                ov.Offset = (DWORD)(buffer->offset & 0xffffffff);
+                ov.OffsetHigh = (DWORD)(buffer->offset >> 32);
+                if (! ::WriteFile(self->handle_, &buffer->data[0], dwWriteSize, &dwWriteNum, &ov) ||
+                            dwWriteSize != dwWriteNum) {
+                    self->error_ = (GetLastError() ? GetLastError() : ERROR_WRITE_FAULT);
+                } else if (FileDownloadSink::FLUSH_WRITE == self->flush_) {
+                    ::FlushFileBuffers(self->handle_);
+                }
+            }
 
-            http_msg.resize(http_msg_len);
-            if (::HttpQueryInfoA(request_handle, HTTP_QUERY_STATUS_TEXT, NULL, &http_msg_len, 0)) {
-                throw AppException(http_msg);
+            {   CriticalSection::Guard guard(self->lock_);
+                buffer->length = 0;
+                self->head_ = (self->head_ + 1) % self->ring_.size();
+                --self->queued_;
             }
+            self->space_.Trigger();
         }
-
-        throw AppException("Unable to download component");
-
-    } else if (status_code < 200 || status_code >= 300) {
-                                                    // reject?
-        LOG<LOG_INFO>() << "Download: unexpected status_code=" << status_code << LOG_ENDL;
+        return 0;
     }
 
-    // context type
-    {   char content_type[1000] = {0};
-        DWORD content_type_len = sizeof(content_type);
-        if (::HttpQueryInfoA(request_handle, HTTP_QUERY_CONTENT_TYPE,
-                    content_type, &content_type_len, NULL)) {
-            LOG<LOG_INFO>() << "Download: content_type=" << content_type << LOG_ENDL;
-        }
-    }
+private:
+    CriticalSection lock_;
+    const HANDLE handle_;
+    const FileDownloadSink::FlushPolicy flush_;
+    std::vector<Buffer> ring_;
+    size_t fill_;                               // producer buffer.
+    size_t head_;                               // next to be written.
+    unsigned queued_;                           // buffers awaiting the writer.
+    WaitableEvent work_;                        // buffer queued.
+    WaitableEvent space_;                       // buffer released.
+    Updater::Thread *thread_;
+    volatile DWORD error_;                      // first write error.
+    uint64_t blocked_;                          // milliseconds, producer blocked.
+    bool stopping_;
+};
 
-    // context size, if available
-    {   char content_length[1000] = {0};
-        DWORD content_length_len = sizeof(content_length);
-        if (::HttpQueryInfoA(request_handle, HTTP_QUERY_CONTENT_LENGTH,
-                content_length, &content_length_len, NULL)) {
-            const int size = atoi(content_length);
-            if (size > 0) {
-                LOG<LOG_INFO>() << "Download: size=" << size << LOG_ENDL;
-                sink.set_size(size);
-            }
-        }
-    }
 
-    // last modified; if available
-    {   SYSTEMTIME last_modified = {0};
-        DWORD last_modified_len = sizeof(last_modified);
-        if (::HttpQueryInfoA(request_handle, HTTP_QUERY_LAST_MODIFIED | HTTP_QUERY_FLAG_SYSTEMTIME,
-                &last_modified, &last_modified_len, NULL)) {
-            char last_modified_sz[32];
-            FILETIME filetime = {0};
+/////////////////////////////////////////////////////////////////////////////////////////
+//  FileDownloadSink
+//
 
-            ::SystemTimeToFileTime(&last_modified, &filetime);
-            sprintf_s(last_modified_sz, sizeof(last_modified_sz), "%04u/%02u/%02u %02u:%02u",
-                last_modified.wYear, last_modified.wMonth, last_modified.wDay, last_modified.wHour, last_modified.wMinute);
-            LOG<LOG_INFO>() << "Download: last_modified=" << last_modified_sz << LOG_ENDL;
-        }
-    }
+FileDownloadSink::FileDownloadSink(const char *filename) :
+    filename_(filename?filename:""), filesize_((size_t)-1), offset_(0), copied_(0), cursor_(0), handle_(INVALID_HANDLE_VALUE),
+        mapping_(NULL), view_(NULL), view_offset_(0), view_length_(0), lent_(false), unmappable_(false),
+        depth_(0), flush_(FLUSH_NEVER), writer_(NULL), blocked_(0)
+{
+}
 
-    // read content
-#define IOBUFFER_SIZE (64 * 1024)
-    char *buffer = static_cast<char *>(malloc(IOBUFFER_SIZE));
-    if (NULL == buffer) {
-        throw AppException("Unable to allocate download buffer");
+
+FileDownloadSink::~FileDownloadSink() 
+{
+    try {
+        close();
+    } catch (...) {
     }
+}
 
-    (void) memset(buffer, 0, IOBUFFER_SIZE);
-    if (sink.open()) {
-        for (;;) {
-            DWORD read = 0;
-            if (! InternetReadFile(request_handle, buffer, IOBUFFER_SIZE, &read)) {
-                throw SysException("Reading Internet connection");
-            }
 
-            if (0 == read)
-                break;                              // EOF
-            sink.append(buffer, read);
-            if (sink.cancelled()) 
-                break;
-        }
-        sink.close();
+//virtual
+//  Image size; preallocated, immediately when already open otherwise upon open().
+//
+void
+FileDownloadSink::set_size(size_t size) 
+{
+    filesize_ = size;
+    if (INVALID_HANDLE_VALUE != handle_) {
+        preallocate();
     }
-    free(buffer);
-
-    return true;
 }
 
 
-//static
 void
-DownloadContext::InternetError(const char *message, const DWORD ret)
+FileDownloadSink::write_behind(unsigned depth, FlushPolicy flush)
 {
-    if (ERROR_INTERNET_EXTENDED_ERROR == ret) {
-        char buffer[256] = {0};
-        DWORD err, buflen = sizeof(buffer);
+    depth_ = depth;
+    flush_ = flush;
+}
 
-        ::InternetGetLastResponseInfoA(&err, buffer, &buflen);
-        do {
-            char *p = buffer + strlen(buffer) - 1;
-            if (*p == '\n' || *p == '\r') {
-                *p = '\0';
-                continue; //next
-            }
-        } while(0);
 
-        std::string msg;
-        msg += message, msg += " : ", msg += buffer;
+uint64_t
+FileDownloadSink::blocked() const
+{
+    return blocked_ + (writer_ ? writer_->blocked() : 0);
+}
 
-        LOG<LOG_ERROR>() << "Download: " << msg << LOG_ENDL;
-        throw AppException(msg);
-    }
 
-    LOG<LOG_ERROR>() << "Download: " << message << " : " << ret << LOG_ENDL;
-    throw SysException(ret, message);
+uint64_t
+FileDownloadSink::written() const
+{
+    return (writer_ ? writer_->written(cursor_) : cursor_);
+}
+
+
+//virtual
+bool
+FileDownloadSink::resume(uint64_t offset)
+{
+    offset_ = offset;
+    return true;
+}
+
+
+//virtual
+//  CopyFileEx(), permitting server-side copy offload from network shares.
+//
+bool
+FileDownloadSink::copy_file(const char *source)
+{
+    BOOL cancel = FALSE;
+
+    if (INVALID_HANDLE_VALUE != handle_ || offset_) {
+        return false;                           // already open or resuming.
+    }
+
+    copied_ = 0;
+    ::DeleteFileA(filename_.c_str());           // prior image, if any; never written through a link.
+    if (! ::CopyFileExA(source, filename_.c_str(), copy_progress, this, &cancel, 0)) {
+        const DWORD error = GetLastError();
+        if (ERROR_REQUEST_ABORTED == error) {  // destination removed; not a fallback case.
+            LOG<LOG_INFO>() << "Download: copy cancelled" << LOG_ENDL;
+            throw AppException("Download: copy cancelled");
+        }
+        throw SysException(error, "Copying download image");
+    }
+    return true;
+}
+
+
+//static/private
+DWORD CALLBACK
+FileDownloadSink::copy_progress(LARGE_INTEGER /*TotalFileSize*/, LARGE_INTEGER TotalBytesTransferred,
+        LARGE_INTEGER /*StreamSize*/, LARGE_INTEGER /*StreamBytesTransferred*/, DWORD /*dwStreamNumber*/,
+        DWORD /*dwCallbackReason*/, HANDLE /*hSourceFile*/, HANDLE /*hDestinationFile*/, LPVOID lpData)
+{
+    FileDownloadSink *self = reinterpret_cast<FileDownloadSink *>(lpData);
+    const uint64_t transferred = (uint64_t)TotalBytesTransferred.QuadPart;
+
+    if (transferred > self->copied_) {
+        self->copied(transferred - self->copied_);
+        self->copied_ = transferred;
+    }
+    return (self->cancelled() ? PROGRESS_CANCEL : PROGRESS_CONTINUE);
+}
+
+
+//virtual
+bool
+FileDownloadSink::open() 
+{
+    if (INVALID_HANDLE_VALUE == handle_) {
+        if (0 == offset_) {                     // prior image, if any; never written through a link.
+            ::DeleteFileA(filename_.c_str());   // see InstallerCache::Retain().
+        }
+        handle_ = ::CreateFileA(filename_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        NULL, (offset_ ? OPEN_ALWAYS : CREATE_ALWAYS), FILE_ATTRIBUTE_NORMAL, NULL);
+
+        if (INVALID_HANDLE_VALUE != handle_) {
+            cursor_ = offset_;                  // start or resumption point.
+            preallocate();
+
+            if (depth_) {
+                FileWriter *writer = new FileWriter(handle_, depth_, flush_);
+                if (writer->start()) {
+                    writer_ = writer;
+                } else {
+                    LOG<LOG_WARN>() << "Download: write-behind unavailable, writing synchronously" << LOG_ENDL;
+                    delete writer;
+                }
+            }
+        }
+    }
+    return (INVALID_HANDLE_VALUE != handle_);
+}
+
+
+//virtual
+//  Close the image, draining any write-behind; a deferred write error is raised.
+//
+void
+FileDownloadSink::close()
+{
+    DWORD error = 0;
+
+    if (writer_) {
+        error = writer_->drain();
+        blocked_ += writer_->blocked();
+        delete writer_;
+        writer_ = NULL;
+    } else if (INVALID_HANDLE_VALUE != handle_ && FLUSH_NEVER != flush_) {
+        if (view_) {                            // lent content, then the file.
+            ::FlushViewOfFile(view_, 0);
+        }
+        ::FlushFileBuffers(handle_);
+    }
+
+    unmap();
+    if (INVALID_HANDLE_VALUE != handle_) {
+        ::CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+
+    if (error) {
+        throw SysException(error, "Writing download image");
+    }
+}
+
+
+//private
+//  Extend the image to the expected size, then restore the sequential position.
+//
+void
+FileDownloadSink::preallocate()
+{
+    LARGE_INTEGER position;
+
+    if ((size_t)-1 != filesize_ && filesize_) {
+        position.QuadPart = (LONGLONG)filesize_;
+        if (! ::SetFilePointerEx(handle_, position, NULL, FILE_BEGIN) || ! ::SetEndOfFile(handle_)) {
+            LOG<LOG_WARN>() << "Download: unable to preallocate <" << filename_ << "> : " << GetLastError() << LOG_ENDL;
+        }
+    }
+
+    position.QuadPart = (LONGLONG)cursor_;
+    ::SetFilePointerEx(handle_, position, NULL, FILE_BEGIN);
+}
+
+
+//virtual
+void
+FileDownloadSink::append(const void *data, size_t len) 
+{
+    if (writer_) {                              // write-behind; positional.
+        writer_->write(cursor_, data, len);
+        cursor_ += len;
+        return;
+    }
+
+    if (lent_) {                                // resynchronise following lent views.
+        LARGE_INTEGER position;
+
+        position.QuadPart = (LONGLONG)cursor_;
+        ::SetFilePointerEx(handle_, position, NULL, FILE_BEGIN);
+        lent_ = false;
+    }
+
+    DWORD dwWriteSize = (DWORD)len, dwWriteNum = 0;
+    if (! ::WriteFile(handle_, data, dwWriteSize, &dwWriteNum, NULL) ||
+                dwWriteSize != dwWriteNum) {
+        throw SysException("Writing download image");
+    }
+    cursor_ += len;
+}
+
+
+//virtual
+//  Lend the preallocated image, mapped as a sliding view at the sequential position;
+//  unavailable under write-behind, when the image size is unknown, or once the content
+//  exceeds it.
+//
+void *
+FileDownloadSink::acquire(size_t &length)
+{
+    if (INVALID_HANDLE_VALUE == handle_ || unmappable_ || writer_ ||
+            (size_t)-1 == filesize_ || cursor_ >= (uint64_t)filesize_) {
+        return NULL;
+    }
+
+    if (NULL == mapping_) {
+        if (NULL == (mapping_ = ::CreateFileMappingW(handle_, NULL, PAGE_READWRITE, 0, 0, NULL))) {
+            LOG<LOG_DEBUG>() << "Download: image not mappable : " << GetLastError() << LOG_ENDL;
+            unmappable_ = true;
+            return NULL;
+        }
+    }
+
+    if (NULL == view_ || cursor_ < view_offset_ || cursor_ >= (view_offset_ + view_length_)) {
+        const uint64_t offset = cursor_ & ~(uint64_t)(VIEW_ALIGNMENT - 1),
+            remaining = (uint64_t)filesize_ - offset;
+
+        if (view_) {
+            if (FLUSH_WRITE == flush_) {        // as each write-behind buffer.
+                ::FlushViewOfFile(view_, 0);
+                ::FlushFileBuffers(handle_);
+            }
+            ::UnmapViewOfFile(view_);
+        }
+        view_length_ = (size_t)(remaining < VIEW_SIZE ? remaining : VIEW_SIZE);
+        view_offset_ = offset;
+        if (NULL == (view_ = static_cast<uint8_t *>(::MapViewOfFile(mapping_, FILE_MAP_WRITE,
+                            (DWORD)(offset >> 32), (DWORD)(offset & 0xffffffff), view_length_)))) {
+            LOG<LOG_DEBUG>() << "Download: image view unavailable : " << GetLastError() << LOG_ENDL;
+            unmap();
+            unmappable_ = true;
+            return NULL;
+        }
+    }
+
+    const size_t available = (size_t)((view_offset_ + view_length_) - cursor_);
+    if (length > available) {
+        length = available;
+    }
+    return view_ + (size_t)(cursor_ - view_offset_);
+}
+
+
+//virtual
+void
+FileDownloadSink::commit(size_t length)
+{
+    cursor_ += length;
+    lent_ = true;
+}
+
+
+//private
+void
+FileDownloadSink::unmap()
+{
+    if (view_) {
+        ::UnmapViewOfFile(view_);
+        view_ = NULL;
+    }
+    if (mapping_) {
+        ::CloseHandle(mapping_);
+        mapping_ = NULL;
+    }
+    view_offset_ = 0, view_length_ = 0;
+}
+
+
+//virtual
+void
+FileDownloadSink::write_at(uint64_t offset, const void *data, size_t len)
+{
+    DWORD dwWriteSize = (DWORD)len, dwWriteNum = 0;
+    OVERLAPPED ov = {0};                        // explicit offset; file pointer unaffected.
+
+    ov.Offset = (DWORD)(offset & 0xffffffff);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    if (! ::WriteFile(handle_, data, dwWriteSize, &dwWriteNum, &ov) ||
+                dwWriteSize != dwWriteNum) {
+        throw SysException("Writing download image");
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  DownloadContext
+//
+
+DownloadContext::DownloadContext(Download &owner__, const std::string &url__, IDownloadSink &sink__, unsigned flags__) :
+        owner(owner__), url(url__), next_source(0), callback(NULL), file_sink(), sink(sink__), flags(flags__), session(owner__.session_), limiter(owner__.limiter_),
+    references(1), transport(NULL), race_trigger(NULL), completion_trigger(INVALID_HANDLE_VALUE), abort_trigger(NULL), interrupt_trigger(NULL),
+    aborted(false), cancelled(false), declined(false), success(false), concluded(false)
+{
+    decoders[0] = decoders[1] = NULL;
+    configure();
+}
+
+
+DownloadContext::DownloadContext(Download &owner__, const std::string &url__, const char *filename__, unsigned flags__) :
+        owner(owner__), url(url__), next_source(0), callback(NULL), file_sink(filename__), sink(file_sink), flags(flags__), session(owner__.session_), limiter(owner__.limiter_),
+    references(1), transport(NULL), race_trigger(NULL), completion_trigger(INVALID_HANDLE_VALUE), abort_trigger(NULL), interrupt_trigger(NULL),
+    aborted(false), cancelled(false), declined(false), success(false), concluded(false)
+{
+    decoders[0] = decoders[1] = NULL;
+    configure();
+}
+
+
+//private
+//  Copy the owner's settings; a stale revalidation outlives the owner, hence the worker
+//  must not reference it beyond signal().
+//
+void
+DownloadContext::configure()
+{
+    connect_timeout = owner.connect_timeout_;
+    response_timeout = owner.response_timeout_;
+    enable_login = owner.enable_login_;
+    decompress = owner.decompress_;
+    segment_limit = owner.segments_;
+    resume_offset = owner.resume_offset_;
+    resume_validator = owner.resume_validator_;
+    range_offset = owner.range_offset_;
+    range_length = owner.range_length_;
+    race_limit = owner.race_;
+    interrupt_trigger = owner.interrupt_;
+    sources.push_back(url);
+    sources.insert(sources.end(), owner.mirrors_.begin(), owner.mirrors_.end());
+    location = url;
+    if (limiter) {                              // otherwise, polled alone.
+        abort_trigger = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+    }
+    if (session) {
+        session->AddRef();
+    }
+}
+
+
+bool
+DownloadContext::start()
+{
+    assert(INVALID_HANDLE_VALUE == completion_trigger);
+    if (NULL != (completion_trigger = ::CreateEventW(NULL, FALSE, FALSE, NULL))) {
+
+        Updater::Thread *thread;
+        if (NULL != (thread = Updater::Thread::Begin(threadproc, (void *)this))) {
+            ++references;
+            thread->SetAutoDelete();
+            thread->ResumeThread();
+            return true;
+        }
+
+        ::CloseHandle(completion_trigger);
+    }
+    completion_trigger = INVALID_HANDLE_VALUE;
+    return false;
+}
+
+
+bool
+DownloadContext::completion(bool pump)
+{
+    HANDLE t_trigger;
+
+    assert(references);
+
+    {   CriticalSection::Guard guard(lock);
+        assert(INVALID_HANDLE_VALUE != completion_trigger);
+        if (INVALID_HANDLE_VALUE == (t_trigger = completion_trigger)) {
+            return false;
+        }
+    }
+
+    HANDLE t_handles[2] = { t_trigger, interrupt_trigger };
+    const DWORD t_count = (interrupt_trigger ? 2 : 1);
+    bool interrupted = false;
+
+    if (! pump) {                           // worker alone, or interrupt.
+        if ((WAIT_OBJECT_0 + 1) == ::WaitForMultipleObjects(t_count, t_handles, FALSE, INFINITE)) {
+            interrupted = true;
+        }
+
+    } else {                                // message pump loop; woken by either.
+        MSG msg = {0};
+
+        for (bool done = false; !done;) {
+            const DWORD ret =           // including input already queued.
+                ::MsgWaitForMultipleObjectsEx(t_count, t_handles, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+            if (WAIT_OBJECT_0 == ret) {
+                break;                      // trigger.
+            } else if (2 == t_count && (WAIT_OBJECT_0 + 1) == ret) {
+                interrupted = true;
+                break;                      // interrupt.
+            } else if ((WAIT_OBJECT_0 + t_count) != ret) {
+                break;                      // WAIT_FAILED.
+            }
+
+            while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+                if (WM_QUIT == msg.message) {
+                    ::PostQuitMessage((int)msg.wParam);
+                    done = true;            // quit; repost for the owning loop.
+                    break;
+                }
+                if (! IsDialogMessage(NULL, &msg)) {
+                    TranslateMessage(&msg);
+                    DispatchMessage(&msg);
+                }
+            }
+        }
+    }
+
+    if (interrupted) {                      // stop the transfer, then await the worker.
+        LOG<LOG_INFO>() << "Download: <" << url << "> interrupted" << LOG_ENDL;
+        shutdown();
+        ::WaitForSingleObject(t_trigger, INFINITE);
+    }
+
+    bool t_success;
+    {   CriticalSection::Guard guard(lock);
+        if (INVALID_HANDLE_VALUE != completion_trigger) {
+            assert(t_trigger == completion_trigger);
+            completion_trigger = INVALID_HANDLE_VALUE;
+            ::CloseHandle(t_trigger);
+        }
+        t_success = (success && ! interrupted);
+        if (! latencies.empty()) {
+            owner.latencies_ = latencies;
+        }
+    }
+    release();
+    return t_success;
+}
+
+
+void
+DownloadContext::shutdown()
+{
+    CriticalSection::Guard guard(lock);
+    aborted = true;
+    if (abort_trigger) {
+        ::SetEvent(abort_trigger);              // paced reads.
+    }
+    if (transport) {
+        transport->Abort();
+    }
+    for (std::vector<DownloadSegment *>::iterator it(segments.begin()); it != segments.end(); ++it) {
+        if ((*it)->transport) {
+            (*it)->transport->Abort();
+        }
+    }
+    for (std::vector<DownloadProbe *>::iterator it(probes.begin()); it != probes.end(); ++it) {
+        if ((*it)->transport) {
+            (*it)->transport->Abort();
+        }
+    }
+}
+
+
+//  Owner release without completion(); a transfer yet to conclude is stopped, otherwise
+//  the worker continues, e.g. a stale revalidation.
+//
+void
+DownloadContext::detach()
+{
+    bool t_concluded;
+    {   CriticalSection::Guard guard(lock);
+        t_concluded = concluded;
+    }
+    if (! t_concluded) {
+        shutdown();
+    }
+    release();
+}
+
+
+void
+DownloadContext::release()
+{
+    unsigned t_references;
+    {   CriticalSection::Guard guard(lock);
+        assert(references);
+        t_references = --references;
+    }
+    if (0 == t_references) {
+        delete this;
+    }
+}
+
+
+DownloadContext::~DownloadContext()
+{
+    assert(0 == references);
+    delete decoders[1];
+    delete decoders[0];
+    delete transport;
+    if (session) {
+        session->Release();
+    }
+    if (INVALID_HANDLE_VALUE != completion_trigger) {
+        ::CloseHandle(completion_trigger);
+    }
+    if (abort_trigger) {
+        ::CloseHandle(abort_trigger);
+    }
+}
+
+
+//static/private
+unsigned int __cdecl
+DownloadContext::threadproc(void *param)
+{
+    DownloadContext *self = reinterpret_cast<DownloadContext *>(param);
+    assert(self && self->references);
+    if (self) {
+        if (Download::BACKGROUND & self->flags) {
+            ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        }
+
+        try {
+            self->success = self->execute();
+            LOG<LOG_INFO>() << "Download: <" << self->url << "> complete" << LOG_ENDL;
+        } catch (std::exception &e) {
+            LOG<LOG_ERROR>() << "Download: <" << self->url << "> exception : " << e.what() << LOG_ENDL;
+        } catch (...) {
+            LOG<LOG_ERROR>() << "Download: <" << self->url << "> unhandled exception" << LOG_ENDL;
+        }
+
+        self->signal();
+        self->shutdown();
+        self->release();
+    }
+    return 0;
+}
+
+
+//private
+bool
+DownloadContext::execute()
+{
+    TransportRequest request(url, flags);
+    TransportResponse response;
+
+    request.connect_timeout = connect_timeout;
+    request.response_timeout = response_timeout;
+    request.enable_login = enable_login;
+    if (range_length) {                         // partial content.
+        request.range_offset = (int64_t)range_offset;
+        request.range_length = (int64_t)range_length;
+    } else if (resume_offset) {                 // resumption; conditional on the validator.
+        request.range_offset = (int64_t)resume_offset;
+        request.if_range = resume_validator;
+    }
+
+    // response cache
+    StringDownloadSink shadow;                  // background revalidation target.
+    IDownloadSink *target = &sink;
+    CacheEntry cached;
+    bool cacheable = false;
+
+    if ((Download::CACHED & flags) && 0 == resume_offset && 0 == range_length && !Transport::IsLocal(url)) {
+        if (ResponseCache::Lookup(url, cached)) {
+            const bool reload = (0 != (Download::NOCACHED & flags));
+
+            if (! reload && cached.Fresh(time(NULL))) {
+                LOG<LOG_INFO>() << "Download: cache hit <" << url << ">" << LOG_ENDL;
+                replay(sink, cached.body);
+                return true;
+            }
+
+            request.if_none_match = cached.etag;
+            request.if_modified_since = cached.last_modified;
+
+            if (! reload && (Download::STALE & flags)) {
+                LOG<LOG_INFO>() << "Download: cache stale <" << url << ">, revalidating" << LOG_ENDL;
+                replay(sink, cached.body);
+                success = true;
+                signal();                       // release caller; 'sink' and 'owner' no longer valid.
+                target = &shadow;
+                limiter = NULL;                 // the caller's, likewise; unpaced.
+            }
+        }
+        cacheable = true;
+    }
+
+    // transport selection and request; alternate sources are raced.
+    if (sources.size() > 1) {
+        if (! race(request, response)) {
+            return false;
+        }
+
+    } else {
+        {   ITransport *t_transport = Transport::Create(url, flags, session);
+            CriticalSection::Guard guard(lock);
+            transport = t_transport;
+            if (aborted) {
+                return false;
+            }
+        }
+
+        LOG<LOG_DEBUG>() << "Download: transport=" << transport->Name() << LOG_ENDL;
+
+        transport->Open(request, response);
+    }
+
+    if (304 == response.status_code && !cached.url.empty()) {
+        LOG<LOG_INFO>() << "Download: not modified <" << url << ">" << LOG_ENDL;
+        if (ResponseCache::Update(cached, response)) {
+            ResponseCache::Store(cached);
+        } else {
+            ResponseCache::Remove(url);
+        }
+        if (target == &sink) {
+            replay(sink, cached.body);
+        }
+        return true;
+    }
+
+    ITransport *source = decoding(response);    // content, possibly via decompression stages.
+
+    const std::string validator = Transport::Validator(response);
+    if (! validator.empty() && source == transport) {
+        target->set_validator(validator);       // decoded offsets are not addressable; not resumable.
+    }
+
+    uint64_t offset = 0;
+    if (range_length) {
+        if (206 != response.status_code || request.range_offset != response.range_offset || source != transport) {
+            throw AppException("Download: range request not honoured");
+        }
+    } else if (request.range_offset > 0) {
+        if (206 == response.status_code && request.range_offset == response.range_offset) {
+            if (source != transport) {
+                throw AppException("Download: compressed content not resumable");
+            }
+            if (! target->resume((uint64_t)request.range_offset)) {
+                throw AppException("Download: sink not resumable");
+            }
+            offset = (uint64_t)request.range_offset;
+            LOG<LOG_INFO>() << "Download: resuming at " << offset << LOG_ENDL;
+        } else {
+            LOG<LOG_INFO>() << "Download: resumption declined, status_code=" << response.status_code << LOG_ENDL;
+        }
+    }
+
+    if (response.content_length >= 0 && source == transport) {
+        target->set_size((size_t) (offset + response.content_length));
+    }
+
+    // read content
+    char *buffer = static_cast<char *>(malloc(IOBUFFER_SIZE));
+    if (NULL == buffer) {
+        throw AppException("Unable to allocate download buffer");
+    }
+
+    uint64_t result = 0;
+    std::string body;                           // cache image.
+    bool capture = (cacheable && 200 == response.status_code &&
+                        response.content_length <= (int64_t)ResponseCache::MAXIMUM_BODY);
+    bool eof = false;
+
+    try {
+        const char *path = source->Path();
+        const void *view = NULL;
+        size_t length = 0;
+
+        if (path && target->copy_file(path)) { // local, kernel-side copy.
+            LOG<LOG_DEBUG>() << "Download: copied <" << path << ">" << LOG_ENDL;
+            result = (response.content_length > 0 ? response.content_length : 0);
+
+        } else if (target->open()) {
+            const unsigned count = segmentation(response, *target);
+
+            if (NULL != (view = source->View(length))) {
+                target->append(view, length);   // local, presented as a single view.
+                result = length;
+
+            } else if (count > 1) {
+                result = execute_segmented(request, response, count, buffer);
+
+            } else {
+                const uint64_t origin =         // resource offset of the content.
+                    (206 == response.status_code && response.range_offset > 0 ? (uint64_t)response.range_offset : 0);
+
+                for (;;) {
+                    size_t capacity = IOBUFFER_SIZE, read;
+                    char *destination =         // lent by the sink, otherwise local.
+                        static_cast<char *>(target->acquire(capacity));
+
+                    if (NULL == destination || 0 == capacity) {
+                        destination = buffer, capacity = IOBUFFER_SIZE;
+                    }
+
+                    try {
+                        read = source->Read(destination, capacity);
+                    } catch (std::exception &e) {
+                        if (source != transport || ! failover(request, origin + result, e.what())) {
+                            throw;
+                        }
+                        source = transport;     // continue upon the alternate.
+                        capture = false, body.clear();
+                        continue;
+                    }
+
+                    if (0 == read) {
+                        if (source == transport && response.content_length >= 0 &&
+                                result < (uint64_t)response.content_length && sources.size() > 1) {
+                            if (! failover(request, origin + result, "connection closed prematurely")) {
+                                throw AppException("Download: connection closed prematurely");
+                            }
+                            source = transport;
+                            capture = false, body.clear();
+                            continue;
+                        }
+                        eof = true;
+                        break;                  // EOF
+                    }
+                    if (capture) {
+                        if (body.size() + read > ResponseCache::MAXIMUM_BODY) {
+                            capture = false, body.clear();
+                        } else {
+                            body.append(destination, read);
+                        }
+                    }
+                    if (destination == buffer) {
+                        target->append(buffer, read);
+                    } else {
+                        target->commit(read);
+                    }
+                    pace(read, *target);
+                    result += read;
+                    if (target->cancelled())
+                        break;
+                }
+            }
+            target->close();
+        }
+    } catch (...) {
+        free(buffer);
+        throw;
+    }
+    free(buffer);
+
+    if (capture && eof) {                       // (re)populate cache.
+        CacheEntry entry;
+
+        entry.url = url;
+        entry.body.swap(body);
+        if (ResponseCache::Update(entry, response)) {
+            ResponseCache::Store(entry);
+        } else {
+            ResponseCache::Remove(url);
+        }
+    }
+
+    LOG<LOG_DEBUG>() << "Download: size=" << result << LOG_ENDL;
+    return true;
+}
+
+
+//private
+//  Deliver cached content to the sink.
+//
+void
+DownloadContext::replay(IDownloadSink &target, const std::string &body)
+{
+    target.set_size(body.size());
+    if (target.open()) {
+        if (! body.empty()) {
+            target.append(body.data(), body.size());
+        }
+        target.close();
+    }
+}
+
+
+//private
+//  Pace 'bytes' read against the limiter; the wait ending upon shutdown(), or upon the
+//  sink's cancellation as polled, the caller then observing either.
+//
+void
+DownloadContext::pace(size_t bytes, IDownloadSink &target)
+{
+    if (limiter) {
+        for (size_t t_bytes = bytes; ! limiter->acquire(t_bytes, abort_trigger, PACE_POLL); t_bytes = 0) {
+            bool t_aborted;
+            {   CriticalSection::Guard guard(lock);
+                t_aborted = aborted;
+            }
+            if (t_aborted || target.cancelled()) {
+                break;
+            }
+        }
+    }
+}
+
+
+//private
+//  Signal completion, notifying any asynchronous callback; the caller may return prior to
+//  the worker's termination.
+//
+void
+DownloadContext::signal()
+{
+    IDownloadCompletion *t_callback;
+    bool t_success;
+
+    {   CriticalSection::Guard guard(lock);
+        if (INVALID_HANDLE_VALUE != completion_trigger) {
+            ::SetEvent(completion_trigger);
+        }
+        concluded = true;
+        if (NULL != (t_callback = callback)) {
+            callback = NULL;                    // once.
+            if (! latencies.empty()) {
+                owner.latencies_ = latencies;
+            }
+        }
+        t_success = success;
+    }
+
+    if (t_callback) {                           // outside the lock; may release the owner.
+        t_callback->completed(t_success);
+    }
+}
+
+
+//private
+//  Stack decompression stages over the transport, as the Content-Encoding and Download::decompress()
+//  require; returns the resulting content source.
+//
+ITransport *
+DownloadContext::decoding(const TransportResponse &response)
+{
+    ITransport *source = transport;
+    Inflater::Format format = Inflater::FORMAT_GZIP;
+    unsigned stages = 0;
+
+    if (200 != response.status_code && 206 != response.status_code) {
+        return source;
+    }
+
+    if (! response.content_encoding.empty() && 0 != _stricmp(response.content_encoding.c_str(), "identity")) {
+        if (! Inflater::Encoding(response.content_encoding, format)) {
+            throw AppException("Download: unsupported content-encoding <" + response.content_encoding + ">");
+        }
+        LOG<LOG_DEBUG>() << "Download: decoding, content-encoding=" << response.content_encoding << LOG_ENDL;
+        stages = 1;
+    }
+
+    if (decompress) {                    // image, after any content encoding.
+        LOG<LOG_DEBUG>() << "Download: decompressing image" << LOG_ENDL;
+        stages |= 2;
+    }
+
+    for (unsigned stage = 0; stage < 2; ++stage) {
+        if (stages & (1 << stage)) {
+            ITransport *decoder =
+                Transport::CreateDecoder(*source, (0 == stage ? format : Inflater::FORMAT_GZIP));
+
+            if (NULL == decoder) {
+                throw AppException("Unable to allocate download decoder");
+            }
+            decoders[stage] = source = decoder;
+        }
+    }
+    return source;
+}
+
+
+//private
+//  Determine the number of concurrent ranges applicable to the response; 1 when single stream.
+//
+unsigned
+DownloadContext::segmentation(const TransportResponse &response, IDownloadSink &target) const
+{
+    if (&target != &sink || segment_limit <= 1 || !target.positional() || decoders[0] || decoders[1]) {
+        return 1;
+    }
+
+    if (! response.accept_ranges) {
+        LOG<LOG_INFO>() << "Download: ranges not advertised, single stream" << LOG_ENDL;
+        return 1;
+    }
+
+    if (200 != response.status_code || response.content_length < (2 * SEGMENT_MINIMUM)) {
+        return 1;
+    }
+
+    if (Transport::Validator(response).empty()) {
+        LOG<LOG_INFO>() << "Download: no validator, single stream" << LOG_ENDL;
+        return 1;                               // ranges could not be made conditional.
+    }
+
+    const uint64_t limit = (uint64_t)response.content_length / SEGMENT_MINIMUM;
+    return (unsigned)(limit < segment_limit ? limit : segment_limit);
+}
+
+
+//private
+//  Segmented transfer; the first range is read from the already open stream, with
+//  the remaining ranges each issued upon their own transport and worker, conditional
+//  (If-Range) on the validator of the first response. Should any range be answered in
+//  full, the entity having changed or ranges not honoured, the remaining ranges are
+//  released and the open stream, itself the whole entity, is read to its end.
+//
+uint64_t
+DownloadContext::execute_segmented(const TransportRequest &request, const TransportResponse &response, unsigned count, char *buffer)
+{
+    const uint64_t total = (uint64_t)response.content_length,
+        span = total / count;
+    uint64_t result = 0, first = 0;
+    std::string t_failure;                      // first range.
+
+    LOG<LOG_INFO>() << "Download: segmented, ranges=" << count << ", span=" << span << LOG_ENDL;
+
+    segment_validator = Transport::Validator(response);
+    try {
+        for (unsigned idx = 1; idx < count; ++idx) {
+            const uint64_t offset = span * idx,
+                length = (idx == count - 1 ? total - offset : span);
+            DownloadSegment *segment = new DownloadSegment(*this, offset, length);
+
+            {   CriticalSection::Guard guard(lock);
+                segments.push_back(segment);
+            }
+
+            if (NULL == (segment->thread = Updater::Thread::Begin(segmentproc, (void *)segment))) {
+                throw AppException("Unable to create download worker");
+            }
+            segment->thread->ResumeThread();
+        }
+
+        result = first = transfer(*transport, 0, span, buffer);
+
+    } catch (std::exception &e) {
+        t_failure = e.what();
+        failed(e.what());
+    }
+
+    // join workers
+    std::vector<DownloadSegment *> t_segments;
+    {   CriticalSection::Guard guard(lock);
+        t_segments = segments;
+    }
+
+    for (std::vector<DownloadSegment *>::iterator it(t_segments.begin()); it != t_segments.end(); ++it) {
+        if ((*it)->thread) {
+            ::WaitForSingleObject((*it)->thread->handle_, INFINITE);
+        }
+        result += (*it)->completed;
+    }
+
+    bool t_declined;
+    {   CriticalSection::Guard guard(lock);
+        segments.clear();
+        t_declined = declined;
+    }
+
+    for (std::vector<DownloadSegment *>::iterator it(t_segments.begin()); it != t_segments.end(); ++it) {
+        delete *it;
+    }
+
+    if (! error.empty()) {
+        throw AppException(error);
+    }
+
+    if (t_declined && ! t_failure.empty()) {    // first stream unusable; see failed().
+        throw AppException(t_failure);
+
+    } else if (t_declined) {                    // single stream, from where the first range ended.
+        bool t_aborted;
+        {   CriticalSection::Guard guard(lock);
+            t_aborted = (aborted || cancelled);
+        }
+        if (! t_aborted) {
+            LOG<LOG_INFO>() << "Download: range declined, continuing single stream at " << first << LOG_ENDL;
+            result = first + transfer(*transport, first, total - first, buffer);
+        }
+    }
+    return result;
+}
+
+
+//private
+void
+DownloadContext::segment(DownloadSegment &segment)
+{
+    TransportRequest request(location, flags);
+    TransportResponse response;
+
+    request.connect_timeout = connect_timeout;
+    request.response_timeout = response_timeout;
+    request.range_offset = (int64_t)segment.offset;
+    request.range_length = (int64_t)segment.length;
+    request.if_range = segment_validator;       // same entity as the first range, otherwise in full.
+
+    {   ITransport *t_transport = Transport::Create(location, flags, session);
+        CriticalSection::Guard guard(lock);
+        segment.transport = t_transport;
+        if (aborted || declined) {
+            return;
+        }
+    }
+
+    segment.transport->Open(request, response);
+    if (200 == response.status_code) {          // entity changed, or range ignored.
+        LOG<LOG_INFO>() << "Download: range " << segment.offset << " answered in full" << LOG_ENDL;
+        decline();
+        return;
+    }
+    if (206 != response.status_code || (int64_t)segment.offset != response.range_offset) {
+        throw AppException("Download: range request not honoured");
+    }
+
+    char *buffer = static_cast<char *>(malloc(IOBUFFER_SIZE));
+    if (NULL == buffer) {
+        throw AppException("Unable to allocate download buffer");
+    }
+
+    try {
+        segment.completed = transfer(*segment.transport, segment.offset, segment.length, buffer);
+    } catch (...) {
+        free(buffer);
+        throw;
+    }
+    free(buffer);
+}
+
+
+//private
+//  Positional copy of the range [offset, offset + length) from the given source.
+//
+uint64_t
+DownloadContext::transfer(ITransport &source, uint64_t offset, uint64_t length, char *buffer)
+{
+    uint64_t completed = 0;
+
+    while (completed < length) {
+        const uint64_t remaining = length - completed;
+        const size_t read = source.Read(buffer,
+                                (remaining < IOBUFFER_SIZE ? (size_t)remaining : IOBUFFER_SIZE));
+
+        if (0 == read) {
+            throw AppException("Download: connection closed prematurely");
+        }
+        sink.write_at(offset + completed, buffer, read);
+        completed += read;
+        pace(read, sink);
+        if (sink.cancelled()) {
+            {   CriticalSection::Guard guard(lock);
+                cancelled = true;
+            }
+            shutdown();                         // release sibling ranges.
+            break;
+        }
+    }
+    return completed;
+}
+
+
+//private
+//  Race the sources, url then alternates, opening up to Download::mirrors() 'race' candidates
+//  at a time; the first to respond is retained as the transport, the remainder aborted. Further
+//  candidates are tried should an entire batch fail. Returns false when aborted.
+//
+bool
+DownloadContext::race(const TransportRequest &request, TransportResponse &response)
+{
+    std::string t_error;
+
+    if (NULL == (race_trigger = ::CreateEventW(NULL, FALSE, FALSE, NULL))) {
+        throw SysException("Unable to create download event");
+    }
+
+    while (next_source < sources.size()) {
+        std::vector<DownloadProbe *> t_probes;
+        DownloadProbe *winner = NULL;
+
+        for (unsigned count = 0; count < race_limit && next_source < sources.size(); ++count) {
+            DownloadProbe *probe = new DownloadProbe(*this, sources[next_source++], request);
+
+            {   CriticalSection::Guard guard(lock);
+                probes.push_back(probe);
+            }
+            t_probes.push_back(probe);
+
+            if (NULL == (probe->thread = Updater::Thread::Begin(probeproc, (void *)probe))) {
+                probe->error = "Unable to create download worker";
+                probe->done = true;
+            } else {
+                probe->thread->ResumeThread();
+            }
+        }
+
+        // first response
+        for (;;) {
+            unsigned pending = 0;
+            bool t_aborted;
+
+            {   CriticalSection::Guard guard(lock);
+                for (std::vector<DownloadProbe *>::iterator it(t_probes.begin()); it != t_probes.end(); ++it) {
+                    if ((*it)->success && NULL == winner) {
+                        winner = *it;
+                    } else if (! (*it)->done) {
+                        ++pending;
+                    }
+                }
+                t_aborted = aborted;
+            }
+
+            if (winner || 0 == pending || t_aborted) {
+                break;
+            }
+            ::WaitForSingleObject(race_trigger, INFINITE);
+        }
+
+        // dismiss the remainder and join
+        {   CriticalSection::Guard guard(lock);
+            for (std::vector<DownloadProbe *>::iterator it(t_probes.begin()); it != t_probes.end(); ++it) {
+                if (*it != winner && ! (*it)->done) {
+                    (*it)->dismissed = true;
+                    if ((*it)->transport) {
+                        (*it)->transport->Abort();
+                    }
+                }
+            }
+        }
+
+        for (std::vector<DownloadProbe *>::iterator it(t_probes.begin()); it != t_probes.end(); ++it) {
+            if ((*it)->thread) {
+                ::WaitForSingleObject((*it)->thread->handle_, INFINITE);
+            }
+        }
+
+        bool t_aborted;
+        {   CriticalSection::Guard guard(lock);
+            t_aborted = aborted;
+            probes.clear();
+            if (winner) {
+                transport = winner->transport;
+                winner->transport = NULL;
+                location = winner->url;
+                response = winner->response;
+            }
+        }
+
+        for (std::vector<DownloadProbe *>::iterator it(t_probes.begin()); it != t_probes.end(); ++it) {
+            DownloadProbe *probe = *it;
+
+            if (probe->success) {
+                observed(probe->url, probe->latency);
+            } else if (! probe->dismissed && ! t_aborted) {
+                LOG<LOG_WARN>() << "Download: source <" << probe->url << "> : " << probe->error << LOG_ENDL;
+                observed(probe->url, -1);
+                if (t_error.empty()) {
+                    t_error = probe->error;
+                }
+            }
+            delete probe;
+        }
+
+        if (winner || t_aborted) {
+            break;
+        }
+    }
+
+    ::CloseHandle(race_trigger);
+    race_trigger = NULL;
+
+    {   CriticalSection::Guard guard(lock);
+        if (aborted) {
+            return false;
+        }
+    }
+
+    if (NULL == transport) {
+        throw AppException(t_error.empty() ? "Download: no source available" : t_error);
+    }
+
+    LOG<LOG_INFO>() << "Download: source <" << location << ">, transport=" << transport->Name() << LOG_ENDL;
+    return true;
+}
+
+
+//private
+//  Single candidate; request as the primary, against the candidate source.
+//
+void
+DownloadContext::probe(DownloadProbe &probe)
+{
+    TransportRequest t_request(probe.url, probe.request.flags);
+
+    t_request.connect_timeout = probe.request.connect_timeout;
+    t_request.response_timeout = probe.request.response_timeout;
+    t_request.enable_login = probe.request.enable_login;
+    t_request.range_offset = probe.request.range_offset;
+    t_request.range_length = probe.request.range_length;
+    t_request.if_range = probe.request.if_range;
+    t_request.if_none_match = probe.request.if_none_match;
+    t_request.if_modified_since = probe.request.if_modified_since;
+
+    {   ITransport *t_transport = Transport::Create(probe.url, flags, session);
+        CriticalSection::Guard guard(lock);
+        probe.transport = t_transport;
+        if (aborted || probe.dismissed) {
+            return;
+        }
+    }
+
+    probe.transport->Open(t_request, probe.response);
+    if (probe.response.status_code >= 300 && 304 != probe.response.status_code) {
+        throw AppException("Download: unexpected response");
+    }
+
+    CriticalSection::Guard guard(lock);
+    probe.success = ! probe.dismissed;
+}
+
+
+//static/private
+unsigned int __cdecl
+DownloadContext::probeproc(void *param)
+{
+    DownloadProbe *probe = reinterpret_cast<DownloadProbe *>(param);
+    DownloadContext &self = probe->context;
+    const unsigned long long start = ::GetTickCount64();
+
+    if (Download::BACKGROUND & self.flags) {
+        ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    }
+
+    try {
+        self.probe(*probe);
+    } catch (std::exception &e) {
+        probe->error = e.what();
+    } catch (...) {
+        probe->error = "Download: source failure";
+    }
+
+    {   CriticalSection::Guard guard(self.lock);
+        probe->latency = (long)(::GetTickCount64() - start);
+        probe->done = true;
+        ::SetEvent(self.race_trigger);
+    }
+    return 0;
+}
+
+
+//private
+//  Mid-transfer failure of the current source; continue at the resource 'position' upon
+//  an alternate by range request, in source order, including those dismissed by the race
+//  but excluding those already failed. Returns false when none remain or all fail, the
+//  original error then standing.
+//
+bool
+DownloadContext::failover(const TransportRequest &request, uint64_t position, const char *what)
+{
+    std::vector<std::string> candidates;
+
+    {   CriticalSection::Guard guard(lock);
+        for (std::vector<std::string>::const_iterator it(sources.begin()); it != sources.end(); ++it) {
+            std::map<std::string, long>::const_iterator latency(latencies.find(*it));
+            if (*it != location && (latency == latencies.end() || latency->second >= 0)) {
+                candidates.push_back(*it);
+            }
+        }
+    }
+
+    if (candidates.empty()) {
+        return false;
+    }
+
+    LOG<LOG_WARN>() << "Download: source <" << location << "> failed at " << position << " : " << what << LOG_ENDL;
+    observed(location, -1);
+
+    for (std::vector<std::string>::const_iterator it(candidates.begin()); it != candidates.end(); ++it) {
+        const std::string &t_url = *it;
+        TransportRequest t_request(t_url, flags);
+        TransportResponse t_response;
+
+        t_request.connect_timeout = request.connect_timeout;
+        t_request.response_timeout = request.response_timeout;
+        t_request.enable_login = request.enable_login;
+        t_request.range_offset = (int64_t)position;
+        if (request.range_length > 0) {         // remainder of the requested range.
+            t_request.range_length = (request.range_offset + request.range_length) - (int64_t)position;
+        }
+
+        try {
+            ITransport *t_transport = Transport::Create(t_url, flags, session), *t_previous;
+
+            {   CriticalSection::Guard guard(lock);
+                t_previous = transport;
+                transport = t_transport;        // abortable whilst opening.
+                location = t_url;
+            }
+            delete t_previous;
+
+            {   CriticalSection::Guard guard(lock);
+                if (aborted) {
+                    return false;
+                }
+            }
+
+            const unsigned long long start = ::GetTickCount64();
+            t_transport->Open(t_request, t_response);
+            if (206 != t_response.status_code || t_request.range_offset != t_response.range_offset) {
+                throw AppException("Download: range request not honoured");
+            }
+            observed(t_url, (long)(::GetTickCount64() - start));
+
+        } catch (std::exception &e) {
+            LOG<LOG_WARN>() << "Download: source <" << t_url << "> : " << e.what() << LOG_ENDL;
+            observed(t_url, -1);
+            continue;
+        }
+
+        LOG<LOG_INFO>() << "Download: continuing upon <" << t_url << "> at " << position << LOG_ENDL;
+        return true;
+    }
+    return false;
+}
+
+
+//private
+void
+DownloadContext::observed(const std::string &source, long latency)
+{
+    CriticalSection::Guard guard(lock);
+    latencies[source] = latency;
+}
+
+
+//private
+//  Record the first error, ignoring those resulting from cancellation, and stop all ranges.
+//
+void
+DownloadContext::failed(const char *what)
+{
+    {   CriticalSection::Guard guard(lock);
+        if (declined) {
+            return;                             // ranges released; see decline().
+        }
+        if (! cancelled && error.empty()) {
+            error = (what && *what ? what : "Download: segment failure");
+        }
+    }
+    shutdown();
+}
+
+
+//private
+//  A range was answered in full; release the remaining ranges, the first stream continuing
+//  alone. Their failures, as released, are disregarded; see failed().
+//
+void
+DownloadContext::decline()
+{
+    CriticalSection::Guard guard(lock);
+    declined = true;
+    for (std::vector<DownloadSegment *>::iterator it(segments.begin()); it != segments.end(); ++it) {
+        if ((*it)->transport) {
+            (*it)->transport->Abort();
+        }
+    }
 }
 
 
 //static/private
-VOID CALLBACK
-DownloadContext::callback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus,
-        LPVOID lpvStatusInformation, DWORD dwStatusInformationLength)
-{
-    DownloadContext *self = reinterpret_cast<DownloadContext *>(dwContext);
-
-    assert(1 == self->references || 2 == self->references);
-    switch (dwInternetStatus) {
-    case INTERNET_STATUS_COOKIE_SENT:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Cookie found and will be sent with request" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_COOKIE_RECEIVED:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Cookie Received" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_COOKIE_HISTORY: {
-            InternetCookieHistory cookieHistory =
-                    *((InternetCookieHistory*)lpvStatusInformation);
-
-            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-                    " Status: Cookie History" << LOG_ENDL;
-
-            if (cookieHistory.fAccepted) {
-                LOG<LOG_DEBUG>() << "Download: Cookie Accepted" << LOG_ENDL;
-            }
-            if (cookieHistory.fLeashed) {
-                LOG<LOG_DEBUG>() << "Download: Cookie Leashed" << LOG_ENDL;
-            }
-            if (cookieHistory.fDowngraded) {
-                LOG<LOG_DEBUG>() << "Download: Cookie Downgraded" << LOG_ENDL;
-            }
-            if (cookieHistory.fRejected) {
-                LOG<LOG_DEBUG>() << "Download: Cookie Rejected" << LOG_ENDL;
-            }
-        }
-        break;
-
-    case INTERNET_STATUS_CLOSING_CONNECTION:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Closing Connection" << LOG_ENDL;
-        ::SetEvent(self->callback_trigger);
-        break;
-
-    case INTERNET_STATUS_CONNECTED_TO_SERVER:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Connected to Server=" <<  ((const char *)lpvStatusInformation) << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_CONNECTING_TO_SERVER:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Connecting to Server=" << ((const char *)lpvStatusInformation) << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_CONNECTION_CLOSED:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Connection Closed" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_HANDLE_CREATED: {
-            const INTERNET_ASYNC_RESULT *res = (const INTERNET_ASYNC_RESULT*)lpvStatusInformation;
-            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-                " Created: Handle created" << LOG_ENDL;
-            self->request_handle = (HINTERNET)(res->dwResult);
-        }
-        break;
-
-    case INTERNET_STATUS_HANDLE_CLOSING:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Handle Closing" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_INTERMEDIATE_RESPONSE:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Intermediate response" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_RECEIVING_RESPONSE:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Receiving Response" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_RESPONSE_RECEIVED:
-        assert(dwStatusInformationLength == sizeof(DWORD));
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Response received=" << *((LPDWORD)lpvStatusInformation) << " bytes" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_REDIRECT:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Redirect=" << to_string((const wchar_t *)lpvStatusInformation) << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_REQUEST_COMPLETE: {
-            const INTERNET_ASYNC_RESULT *res = (const INTERNET_ASYNC_RESULT*)lpvStatusInformation;
-            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-                " Status: Request complete, result=" << res->dwResult << ", error=" << res->dwError << LOG_ENDL;
-        }
-        break;
-
-    case INTERNET_STATUS_REQUEST_SENT:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Request sent=" << *((LPDWORD)lpvStatusInformation) << " bytes" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_DETECTING_PROXY:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Detecting Proxy" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_RESOLVING_NAME:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Resolving Name=" << to_string((const wchar_t *)lpvStatusInformation) << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_NAME_RESOLVED:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Name Resolved=" << ((const char *)lpvStatusInformation) << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_SENDING_REQUEST:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Sending request" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_STATE_CHANGE:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: State Change" << LOG_ENDL;
-        break;
-
-    case INTERNET_STATUS_P3P_HEADER:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Received P3P header" << LOG_ENDL;
-        break;
-
-    default:
-        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
-            " Status: Unknown <" << dwInternetStatus << ">" << LOG_ENDL;
-        break;
+unsigned int __cdecl
+DownloadContext::segmentproc(void *param)
+{
+    DownloadSegment *segment = reinterpret_cast<DownloadSegment *>(param);
+    DownloadContext &self = segment->context;
+
+    if (Download::BACKGROUND & self.flags) {
+        ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    }
+
+    try {
+        self.segment(*segment);
+        LOG<LOG_DEBUG>() << "Download: range " << segment->offset << "+" << segment->completed << " complete" << LOG_ENDL;
+    } catch (std::exception &e) {
+        LOG<LOG_ERROR>() << "Download: range " << segment->offset << " exception : " << e.what() << LOG_ENDL;
+        self.failed(e.what());
+    } catch (...) {
+        self.failed(NULL);
     }
+    return 0;
 }
 
 }   // namespace Updater
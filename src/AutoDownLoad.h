@@ -30,6 +30,10 @@
 #include "common.h"
 
 #include <string>
+#include <vector>
+#include <map>
+
+#include "AutoThread.h"
 
 namespace Updater {
 
@@ -39,6 +43,53 @@ struct IDownloadSink {
     virtual void append(const void *data, size_t len) = 0;
     virtual bool cancelled() = 0;
     virtual void close() = 0;
+
+    // Positional writes, permitting segmented transfers; see Download::segments().
+    // When supported, write_at() may be invoked concurrently from several workers.
+    virtual bool positional() {
+        return false;
+    }
+    virtual void write_at(uint64_t offset, const void *data, size_t len) {
+        (void) offset, (void) data, (void) len;
+    }
+
+    // Resumption; see Download::resume(). Invoked prior to set_size() and open() when the
+    // server honoured the range, the leading 'offset' bytes are to be retained.
+    virtual bool resume(uint64_t offset) {
+        (void) offset;
+        return false;
+    }
+
+    // Entity validator (strong ETag otherwise Last-Modified), when reported; prior to open().
+    virtual void set_validator(const std::string &validator) {
+        (void) validator;
+    }
+
+    // Kernel-side copy of a local source, in place of open()/append()/close();
+    // returns false when unsupported, the content is then presented via append().
+    // Failure, including cancellation, throws.
+    virtual bool copy_file(const char *source) {
+        (void) source;
+        return false;
+    }
+
+    // Lent buffers, in place of append(); content is read directly into the region returned,
+    // 'length' requested and updated to the extent lent, then commit() the bytes filled. A
+    // region not committed is lent again. NULL when unsupported, append() then applies.
+    virtual void *acquire(size_t &length) {
+        (void) length;
+        return NULL;
+    }
+    virtual void commit(size_t length) {
+        (void) length;
+    }
+};
+
+
+// Asynchronous completion, see Download::get_async(); invoked once, from the download
+// worker, as the transfer concludes.
+struct IDownloadCompletion {
+    virtual void completed(bool success) = 0;
 };
 
 
@@ -47,17 +98,17 @@ class StringDownloadSink : public IDownloadSink {
     StringDownloadSink& operator=(const StringDownloadSink &rsh);
 
 public:
-    StringDownloadSink() : data_(&t_destination) {
+    StringDownloadSink() : data_(&t_destination), length_(0) {
     }
 
-    StringDownloadSink(std::string *destination) : data_(destination) {
+    StringDownloadSink(std::string *destination) : data_(destination), length_(destination->size()) {
     }
 
     virtual ~StringDownloadSink() {
     }
 
     virtual void set_size(size_t size) {
-        data_->reserve(size);
+        data_->reserve(length_ + size);
     }
 
     virtual bool open() {
@@ -65,10 +116,30 @@ public:
     }
 
     virtual void append(const void *data, size_t len) {
+        trim();
         data_->append(reinterpret_cast<const char*>(data), len);
+        length_ = data_->size();
+    }
+
+    // Spare capacity; the string is grown, zero filled once, ahead of the content.
+    virtual void *acquire(size_t &length) {
+        if (data_->size() - length_ < length) {
+            size_t size = data_->capacity();
+            if (size < length_ + length) {
+                size = length_ + (length > length_ ? length : length_);
+            }
+            data_->resize(size);
+        }
+        length = data_->size() - length_;
+        return &(*data_)[length_];
+    }
+
+    virtual void commit(size_t length) {
+        length_ += length;
     }
 
     virtual void close() {
+        trim();
     }
 
     virtual bool cancelled() {
@@ -76,15 +147,26 @@ public:
     }
 
     const std::string &data() {
+        trim();
         return *data_;
     }
 
+private:
+    void trim() {                           // release unused spare capacity.
+        if (data_->size() != length_) {
+            data_->resize(length_);
+        }
+    }
+
 private:
     std::string t_destination;              // local payload.
     std::string *data_;
+    size_t length_;                         // content length; data_ may hold spare capacity.
 };
 
 
+class FileWriter;
+
 struct FileDownloadSink : public IDownloadSink {
     FileDownloadSink(const FileDownloadSink &rsh);
     FileDownloadSink& operator=(const FileDownloadSink &rsh);
@@ -101,35 +183,192 @@ public:
     }
     virtual void close();
 
+    virtual bool positional() {
+        return true;
+    }
+    virtual void write_at(uint64_t offset, const void *data, size_t len);
+    virtual bool resume(uint64_t offset);
+    virtual bool copy_file(const char *source);
+    virtual void *acquire(size_t &length);
+    virtual void commit(size_t length);
+
+    enum FlushPolicy {
+        FLUSH_NEVER = 0,                    // system lazy writer.
+        FLUSH_CLOSE = 1,                    // FlushFileBuffers() upon close().
+        FLUSH_WRITE = 2                     // plus following each write-behind buffer.
+    };
+
+    // Write-behind; append()ed content is queued through a ring of 'depth' buffers to a
+    // background writer, overlapping network reads and disk writes; 0 synchronous (default).
+    // Prior to open(); errors are raised by a later append() or close(). Exclusive of lent
+    // views, acquire() declining whilst the writer is active; 'flush' applies to either.
+    void write_behind(unsigned depth, FlushPolicy flush = FLUSH_NEVER);
+
+    // Milliseconds append() has spent blocked awaiting the writer.
+    uint64_t blocked() const;
+
+    // Sequential position below which content has been written, excluding that queued.
+    uint64_t written() const;
+
+    const std::string &filename() const {
+        return filename_;
+    }
+
+protected:
+    // copy_file() progress, bytes since the last notification.
+    virtual void copied(uint64_t length) {
+        (void) length;
+    }
+
 private:
+    static DWORD CALLBACK copy_progress(LARGE_INTEGER TotalFileSize, LARGE_INTEGER TotalBytesTransferred,
+            LARGE_INTEGER StreamSize, LARGE_INTEGER StreamBytesTransferred, DWORD dwStreamNumber,
+            DWORD dwCallbackReason, HANDLE hSourceFile, HANDLE hDestinationFile, LPVOID lpData);
+
+    void preallocate();
+    void unmap();
+
+private:
+    enum {
+        VIEW_SIZE = 4 * 1024 * 1024,        // lent view, see acquire().
+        VIEW_ALIGNMENT = 64 * 1024          // allocation granularity.
+    };
+
     std::string filename_;
     size_t filesize_;
+    uint64_t offset_;                       // resumption offset.
+    uint64_t copied_;                       // copy_file() progress.
+    uint64_t cursor_;                       // sequential position.
     HANDLE handle_;
+    HANDLE mapping_;                        // image mapping, whilst lending.
+    uint8_t *view_;                         // mapped view; offset and length.
+    uint64_t view_offset_;
+    size_t view_length_;
+    bool lent_;                             // cursor_ ahead of the file pointer.
+    bool unmappable_;
+    unsigned depth_;                        // write-behind buffers, 0 synchronous.
+    FlushPolicy flush_;
+    FileWriter *writer_;                    // write-behind, whilst open.
+    uint64_t blocked_;                      // prior writer blocked time.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  RateLimiter
+//
+//  Token-bucket bandwidth pacing; 'rate' bytes/second with a 'burst' allowance, zero
+//  being unlimited. May be shared by concurrent transfers and adjusted whilst in use.
+//
+
+class RateLimiter {
+    RateLimiter(const RateLimiter &rhs);
+    RateLimiter& operator=(const RateLimiter &rhs);
+
+public:
+    RateLimiter(uint64_t rate = 0, uint64_t burst = 0);
+
+    void set(uint64_t rate, uint64_t burst = 0);
+    bool acquire(size_t bytes, HANDLE abort = NULL, DWORD timeout = INFINITE);
+    uint64_t throttled() const;             // milliseconds spent throttled.
+
+private:
+    void refill();
+
+private:
+    mutable CriticalSection lock_;
+    uint64_t rate_;
+    uint64_t burst_;
+    int64_t tokens_;                        // available; negative whilst in debt.
+    unsigned long long last_;               // last refill, tick count.
+    uint64_t throttled_;
 };
 
 
 class DownloadContext;
+class TransportSession;
 class Download {
 public:
     enum Flags {
-        NOCACHED = 1                        // ignore cache.
+        NOCACHED = 1,                       // ignore cache.
+        SOCKETS = 2,                        // Winsock transport (http://), otherwise WinINet.
+        CACHED = 4,                         // response cache, with conditional revalidation.
+        STALE = 8,                          // CACHED, serve stale content whilst revalidating in the background.
+        BACKGROUND = 16,                    // low cpu and i/o priority, speculative transfers.
+        COMPRESSED = 32,                    // negotiate Content-Encoding (gzip, deflate); whole resources only.
+        LOOPBACK = 64                       // WinINet, permit http:// to the loopback host; benchmarks alone.
     };
 
 public:
     Download();
+    Download(TransportSession *session);
     ~Download();
 
     bool get(const std::string &url, IDownloadSink &sink, unsigned flags = 0);
     bool get(const std::string &url, const char *localfile, unsigned flags = 0);
+
+    // Asynchronous transfer; 'on_done' is notified from the worker upon conclusion, the
+    // Download and 'sink' must remain valid until then. completion() remains available,
+    // returning immediately once concluded; otherwise destruction releases the transfer.
+    bool get_async(const std::string &url, IDownloadSink &sink, IDownloadCompletion &on_done, unsigned flags = 0);
+
+    // Await conclusion; 'pump' dispatching the caller's window messages whilst waiting,
+    // otherwise blocking on the worker alone.
     bool completion(bool pump = true);
     void cancel();
 
+    // Segmented transfer; split into up to 'count' concurrent byte ranges.
+    // Applied only when the server advertises "Accept-Ranges" and the sink is positional.
+    void segments(unsigned count);
+
+    // Resume a prior partial transfer of 'offset' bytes, conditional on the entity
+    // validator; the sink must support IDownloadSink::resume().
+    void resume(uint64_t offset, const std::string &validator);
+
+    // Partial content; the range [offset, offset + length) alone is requested and presented
+    // to the sink, a response other than the range (206) failing the transfer.
+    void range(uint64_t offset, uint64_t length);
+
+    // Connection reuse; requests issued and those served over an existing connection.
+    void statistics(unsigned &requests, unsigned &reused) const;
+
+    // Bandwidth pacing of network reads; the limiter must outlive the transfer.
+    void limiter(RateLimiter *limiter);
+
+    // External cancellation; should 'event' be signalled whilst awaiting completion() the
+    // transfer is shut down, completion() failing. The event must outlive the transfer.
+    void interrupt(HANDLE event);
+
+    // Decompress gzip content (e.g. a ".gz" enclosure) ahead of the sink, independent of any
+    // Content-Encoding; the transfer is then neither segmented nor resumable.
+    void decompress(bool enable);
+
+    // Alternate sources of the same resource; connection setup and response are raced across
+    // up to 'race' candidates at a time, the url first then the alternates in order, the first
+    // to respond retained. An undecoded transfer failing mid-stream continues upon another,
+    // not yet failed, candidate by range request.
+    void mirrors(const std::vector<std::string> &alternates, unsigned race = 2);
+
+    // Response latency by source url, milliseconds or -1 on failure; following completion().
+    const std::map<std::string, long> &latencies() const;
+
 private:
     friend class DownloadContext;
     DownloadContext *context_;              // download context.
+    TransportSession *session_;             // connection state, shared across requests.
+    RateLimiter *limiter_;                  // optional bandwidth pacing.
+    HANDLE interrupt_;                      // optional cancellation event.
     int connect_timeout_;
     int response_timeout_;
     bool enable_login_;
+    bool decompress_;                       // gzip image.
+    unsigned segments_;                     // concurrent ranges; 0/1 single stream.
+    uint64_t resume_offset_;                // resumption offset, 0 if none.
+    std::string resume_validator_;          // resumption validator.
+    uint64_t range_offset_;                 // partial content, see range().
+    uint64_t range_length_;                 // range length, 0 if none.
+    std::vector<std::string> mirrors_;      // alternate sources.
+    unsigned race_;                         // concurrent source candidates.
+    std::map<std::string, long> latencies_; // observed source latency.
 };
 
 }   // namespace Updater
@@ -0,0 +1,644 @@
+//  $Id: AutoInflate.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: streaming gzip/deflate decoder.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <cstring>
+#include <cassert>
+
+#include "AutoInflate.h"
+#include "AutoError.h"
+
+namespace Updater {
+
+#define MAXBITS             15                  // maximum code length.
+#define MAXLCODES           288                 // literal/length codes.
+#define MAXDCODES           30                  // distance codes.
+#define FASTBITS            9                   // direct lookup, code length limit.
+
+struct Inflater::Huffman {
+    short count[MAXBITS + 1];                   // codes of each length.
+    short symbol[MAXLCODES];                    // symbols, canonical order.
+    unsigned short fast[1 << FASTBITS];         // (symbol << 4) | length; 0 when longer.
+};
+
+static const unsigned short lbase[29] = {       // length base, codes 257..285.
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char lext[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short dbase[30] = {       // distance base, codes 0..29.
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char dext[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+namespace {
+
+struct Tables {
+    Tables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (unsigned k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+            }
+            crc[n] = c;
+        }
+    }
+    uint32_t crc[256];
+};
+
+static const Tables tables;
+
+
+static uint32_t
+crc32(uint32_t crc, const unsigned char *data, size_t length)
+{
+    crc = ~crc;
+    while (length--) {
+        crc = tables.crc[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+static uint32_t
+adler32(uint32_t adler, const unsigned char *data, size_t length)
+{
+    uint32_t a = adler & 0xffff, b = adler >> 16;
+
+    while (length) {
+        size_t n = (length < 5552 ? length : 5552);   // defer modulo, avoiding overflow.
+        length -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+}   // namespace anon
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Inflater
+//
+
+Inflater::Inflater(ISource &source, Format format) :
+    source_(source), format_(format), state_(ST_HEADER), input_(NULL), in_pos_(0), in_end_(0), in_total_(0),
+        bitbuf_(0), bitcnt_(0), eof_(false), last_(false), window_(NULL), wpos_(0), out_total_(0), member_(0),
+        check_(0), stored_(0), copy_(0), distance_(0), lencode_(NULL), distcode_(NULL), dynamic_(NULL)
+{
+    input_ = static_cast<unsigned char *>(malloc(INPUT_SIZE));
+    window_ = static_cast<unsigned char *>(malloc(WINDOW_SIZE));
+    dynamic_ = new(std::nothrow) Huffman[4];    // dynamic pair plus fixed pair.
+    if (NULL == input_ || NULL == window_ || NULL == dynamic_) {
+        free(input_), free(window_);
+        delete[] dynamic_;
+        throw AppException("Unable to allocate decoder");
+    }
+
+    unsigned char lengths[MAXLCODES];           // fixed tables, RFC 1951 3.2.6.
+    unsigned symbol = 0;
+
+    for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+    for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+    for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+    for (; symbol < MAXLCODES; ++symbol) lengths[symbol] = 8;
+    Build(dynamic_[2], lengths, MAXLCODES);
+    for (symbol = 0; symbol < MAXDCODES; ++symbol) lengths[symbol] = 5;
+    Build(dynamic_[3], lengths, MAXDCODES);
+}
+
+
+Inflater::~Inflater()
+{
+    free(input_);
+    free(window_);
+    delete[] dynamic_;
+}
+
+
+//static
+bool
+Inflater::Encoding(const std::string &name, Format &format)
+{
+    if (0 == _stricmp(name.c_str(), "gzip") || 0 == _stricmp(name.c_str(), "x-gzip") ||
+            0 == _stricmp(name.c_str(), "application/gzip") || 0 == _stricmp(name.c_str(), "application/x-gzip") ||
+            0 == _stricmp(name.c_str(), ".gz")) {
+        format = FORMAT_GZIP;
+        return true;
+    }
+
+    if (0 == _stricmp(name.c_str(), "deflate")) {
+        format = FORMAT_ZLIB;
+        return true;
+    }
+    return false;
+}
+
+
+size_t
+Inflater::Read(void *buffer, size_t length)
+{
+    unsigned char *out = static_cast<unsigned char *>(buffer);
+    size_t produced = 0;
+
+    while (produced < length && ST_DONE != state_) {
+        switch (state_) {
+        case ST_HEADER:
+            Header();
+            break;
+        case ST_BLOCK:
+            Block();
+            break;
+        case ST_STORED:
+            produced += Stored(out + produced, length - produced);
+            break;
+        case ST_CODES:
+            produced += Codes(out + produced, length - produced);
+            break;
+        case ST_TRAILER:
+            if (produced) {                     // checks cover all output, complete the member.
+                check_ = (FORMAT_GZIP == format_ ? crc32(check_, out, produced) :
+                            FORMAT_ZLIB == format_ ? adler32(check_, out, produced) : 0);
+                out += produced, length -= produced;
+                produced = 0;
+            }
+            Trailer();
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (produced) {
+        if (FORMAT_GZIP == format_) {
+            check_ = crc32(check_, out, produced);
+        } else if (FORMAT_ZLIB == format_) {
+            check_ = adler32(check_, out, produced);
+        }
+    }
+    return (size_t)((out + produced) - static_cast<unsigned char *>(buffer));
+}
+
+
+//private
+//  Fill the bit accumulator to 'count' bits; false if the source is exhausted.
+//
+bool
+Inflater::Pull(unsigned count)
+{
+    while (bitcnt_ < count) {
+        if (in_pos_ == in_end_ && ! Refill()) {
+            return false;
+        }
+        bitbuf_ |= ((uint64_t)input_[in_pos_++]) << bitcnt_;
+        bitcnt_ += 8;
+    }
+    return true;
+}
+
+
+//private
+//  Replenish the input buffer; false if the source is exhausted.
+//
+bool
+Inflater::Refill()
+{
+    if (eof_) {
+        return false;
+    }
+    in_pos_ = 0;
+    if (0 == (in_end_ = source_.Fill(input_, INPUT_SIZE))) {
+        eof_ = true;
+        return false;
+    }
+    in_total_ += in_end_;
+    return true;
+}
+
+
+//private
+unsigned
+Inflater::Need(unsigned count)
+{
+    if (! Pull(count)) {
+        throw AppException("Decoder: truncated stream");
+    }
+    return (unsigned)(bitbuf_ & ((1U << count) - 1));
+}
+
+
+//private
+unsigned
+Inflater::Bits(unsigned count)
+{
+    const unsigned value = Need(count);
+    bitbuf_ >>= count;
+    bitcnt_ -= count;
+    return value;
+}
+
+
+//private
+//  Decode a symbol; direct lookup for short codes, otherwise canonical bitwise decode.
+//
+int
+Inflater::Decode(const Huffman &h)
+{
+    (void) Pull(FASTBITS);                      // may fall short at end-of-stream.
+
+    const unsigned entry = h.fast[bitbuf_ & ((1U << FASTBITS) - 1)];
+    if (entry && (entry & 15) <= bitcnt_) {
+        bitbuf_ >>= (entry & 15);
+        bitcnt_ -= (entry & 15);
+        return (int)(entry >> 4);
+    }
+
+    int code = 0, first = 0, index = 0;         // RFC 1951 canonical ordering.
+    for (unsigned len = 1; len <= MAXBITS; ++len) {
+        code |= (int)Bits(1);
+        const int count = h.count[len];
+        if (code - count < first) {
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    throw AppException("Decoder: invalid code");
+}
+
+
+//static/private
+//  Construct canonical decoding tables from code lengths; returns the number of unused
+//  codes, negative if over-subscribed.
+//
+int
+Inflater::Build(Huffman &h, const unsigned char *lengths, unsigned count)
+{
+    short offs[MAXBITS + 1];
+    unsigned next[MAXBITS + 1];
+    int left = 1;
+
+    memset(h.count, 0, sizeof(h.count));
+    memset(h.fast, 0, sizeof(h.fast));
+    for (unsigned symbol = 0; symbol < count; ++symbol) {
+        ++h.count[lengths[symbol]];
+    }
+    if (h.count[0] == (short)count) {
+        return 0;                               // no codes; complete, yet unusable.
+    }
+
+    for (unsigned len = 1; len <= MAXBITS; ++len) {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0) {
+            return left;                        // over-subscribed.
+        }
+    }
+
+    offs[1] = 0, next[1] = 0;
+    for (unsigned len = 1; len < MAXBITS; ++len) {
+        offs[len + 1] = offs[len] + h.count[len];
+        next[len + 1] = (next[len] + h.count[len]) << 1;
+    }
+
+    for (unsigned symbol = 0; symbol < count; ++symbol) {
+        const unsigned len = lengths[symbol];
+        if (0 == len) {
+            continue;
+        }
+
+        h.symbol[offs[len]++] = (short)symbol;
+
+        const unsigned code = next[len]++;
+        if (len <= FASTBITS) {                  // codes are stored bit-reversed.
+            unsigned reversed = 0;
+            for (unsigned bit = 0; bit < len; ++bit) {
+                reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+            }
+            for (unsigned idx = reversed; idx < (1U << FASTBITS); idx += (1U << len)) {
+                h.fast[idx] = (unsigned short)((symbol << 4) | len);
+            }
+        }
+    }
+    return left;
+}
+
+
+//private
+void
+Inflater::Header()
+{
+    member_ = 0;
+    last_ = false;
+
+    if (FORMAT_GZIP == format_) {               // RFC 1952
+        if (0x1f != Bits(8) || 0x8b != Bits(8) || 8 != Bits(8)) {
+            throw AppException("Decoder: invalid gzip header");
+        }
+        const unsigned flags = Bits(8);
+        for (unsigned i = 0; i < 6; ++i) {
+            (void) Bits(8);                     // mtime, xfl, os.
+        }
+        if (flags & 0x04) {                     // FEXTRA
+            unsigned xlen = Bits(16);
+            while (xlen--) (void) Bits(8);
+        }
+        if (flags & 0x08) {                     // FNAME
+            while (Bits(8)) ;
+        }
+        if (flags & 0x10) {                     // FCOMMENT
+            while (Bits(8)) ;
+        }
+        if (flags & 0x02) {                     // FHCRC
+            (void) Bits(16);
+        }
+        check_ = 0;
+
+    } else if (FORMAT_ZLIB == format_) {        // RFC 1950, otherwise raw.
+        const unsigned cmf = Need(16) & 0xff, flg = (unsigned)((bitbuf_ >> 8) & 0xff);
+        if (8 == (cmf & 0x0f) && (cmf >> 4) <= 7 && 0 == ((cmf << 8) | flg) % 31) {
+            if (flg & 0x20) {
+                throw AppException("Decoder: zlib preset dictionary not supported");
+            }
+            (void) Bits(16);
+            check_ = 1;
+        } else {
+            format_ = FORMAT_RAW;
+        }
+    }
+    state_ = ST_BLOCK;
+}
+
+
+//private
+void
+Inflater::Block()
+{
+    if (last_) {
+        state_ = ST_TRAILER;
+        return;
+    }
+
+    last_ = (0 != Bits(1));
+    switch (Bits(2)) {
+    case 0:                                     // stored
+        Bits(bitcnt_ & 7);                      // byte align.
+        stored_ = Bits(16);
+        if ((stored_ ^ 0xffff) != Bits(16)) {
+            throw AppException("Decoder: stored block length mismatch");
+        }
+        state_ = ST_STORED;
+        break;
+    case 1:                                     // fixed
+        lencode_ = &dynamic_[2], distcode_ = &dynamic_[3];
+        state_ = ST_CODES;
+        break;
+    case 2:                                     // dynamic
+        Dynamic();
+        lencode_ = &dynamic_[0], distcode_ = &dynamic_[1];
+        state_ = ST_CODES;
+        break;
+    default:
+        throw AppException("Decoder: invalid block type");
+    }
+}
+
+
+//private
+void
+Inflater::Dynamic()
+{
+    static const unsigned char order[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    unsigned char lengths[MAXLCODES + MAXDCODES];
+    const unsigned nlen = Bits(5) + 257, ndist = Bits(5) + 1, ncode = Bits(4) + 4;
+    unsigned index;
+
+    if (nlen > 286 || ndist > MAXDCODES) {
+        throw AppException("Decoder: invalid code counts");
+    }
+
+    memset(lengths, 0, sizeof(lengths));
+    for (index = 0; index < ncode; ++index) {
+        lengths[order[index]] = (unsigned char)Bits(3);
+    }
+
+    Huffman &lencode = dynamic_[0];             // code length code, transient.
+    if (0 != Build(lencode, lengths, 19)) {
+        throw AppException("Decoder: incomplete code length code");
+    }
+
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = Decode(lencode);
+
+        if (symbol < 16) {
+            lengths[index++] = (unsigned char)symbol;
+
+        } else {
+            unsigned char len = 0;
+            unsigned repeat;
+
+            if (16 == symbol) {
+                if (0 == index) {
+                    throw AppException("Decoder: repeat without length");
+                }
+                len = lengths[index - 1];
+                repeat = 3 + Bits(2);
+            } else if (17 == symbol) {
+                repeat = 3 + Bits(3);
+            } else {
+                repeat = 11 + Bits(7);
+            }
+            if (index + repeat > nlen + ndist) {
+                throw AppException("Decoder: too many lengths");
+            }
+            while (repeat--) {
+                lengths[index++] = len;
+            }
+        }
+    }
+
+    if (0 == lengths[256]) {
+        throw AppException("Decoder: missing end-of-block code");
+    }
+
+    const int lleft = Build(dynamic_[0], lengths, nlen);
+    if (lleft < 0 || (lleft > 0 && nlen - dynamic_[0].count[0] != 1)) {
+        throw AppException("Decoder: invalid literal/length code");
+    }
+
+    const int dleft = Build(dynamic_[1], lengths + nlen, ndist);
+    if (dleft < 0 || (dleft > 0 && ndist - dynamic_[1].count[0] != 1)) {
+        throw AppException("Decoder: invalid distance code");
+    }
+}
+
+
+//private
+size_t
+Inflater::Stored(unsigned char *out, size_t length)
+{
+    size_t produced = 0;
+
+    while (stored_ && produced < length) {
+        if (bitcnt_) {                          // drain accumulator.
+            const unsigned char c = (unsigned char)Bits(8);
+            out[produced++] = c;
+            window_[wpos_++ & (WINDOW_SIZE - 1)] = c;
+            --stored_;
+            continue;
+        }
+
+        if (in_pos_ == in_end_ && ! Refill()) {
+            throw AppException("Decoder: truncated stream");
+        }
+
+        size_t count = in_end_ - in_pos_;
+        if (count > stored_) count = stored_;
+        if (count > length - produced) count = length - produced;
+
+        memcpy(out + produced, input_ + in_pos_, count);
+        for (size_t idx = 0; idx < count; ++idx) {
+            window_[wpos_++ & (WINDOW_SIZE - 1)] = input_[in_pos_ + idx];
+        }
+        in_pos_ += count;
+        produced += count;
+        stored_ -= (uint32_t)count;
+    }
+
+    member_ += produced;
+    out_total_ += produced;
+    if (0 == stored_) {
+        state_ = ST_BLOCK;
+    }
+    return produced;
+}
+
+
+//private
+size_t
+Inflater::Codes(unsigned char *out, size_t length)
+{
+    unsigned char *window = window_;
+    unsigned wpos = wpos_;
+    size_t produced = 0;
+
+    for (;;) {
+        while (copy_ && produced < length) {    // pending match.
+            const unsigned char c = window[(wpos - distance_) & (WINDOW_SIZE - 1)];
+            out[produced++] = c;
+            window[wpos++ & (WINDOW_SIZE - 1)] = c;
+            --copy_;
+        }
+
+        if (produced >= length) {
+            break;
+        }
+
+        int symbol = Decode(*lencode_);
+        if (symbol < 256) {                     // literal
+            out[produced++] = (unsigned char)symbol;
+            window[wpos++ & (WINDOW_SIZE - 1)] = (unsigned char)symbol;
+
+        } else if (256 == symbol) {             // end-of-block
+            state_ = ST_BLOCK;
+            break;
+
+        } else {                                // length/distance pair
+            symbol -= 257;
+            if (symbol >= 29) {
+                throw AppException("Decoder: invalid length symbol");
+            }
+            copy_ = lbase[symbol] + Bits(lext[symbol]);
+
+            symbol = Decode(*distcode_);
+            if (symbol >= MAXDCODES) {
+                throw AppException("Decoder: invalid distance symbol");
+            }
+            distance_ = dbase[symbol] + Bits(dext[symbol]);
+            if (distance_ > member_ + produced) {
+                throw AppException("Decoder: distance too far back");
+            }
+        }
+    }
+
+    wpos_ = wpos;
+    member_ += produced;
+    out_total_ += produced;
+    return produced;
+}
+
+
+//private
+void
+Inflater::Trailer()
+{
+    Bits(bitcnt_ & 7);                          // byte align.
+
+    if (FORMAT_GZIP == format_) {
+        const uint32_t crc_low = Bits(16);      // little-endian, low half first.
+        const uint32_t crc = crc_low | (Bits(16) << 16);
+        const uint32_t isize_low = Bits(16);
+        const uint32_t isize = isize_low | (Bits(16) << 16);
+
+        if (crc != check_ || isize != (uint32_t)(member_ & 0xffffffff)) {
+            throw AppException("Decoder: gzip trailer mismatch");
+        }
+
+        if (Pull(8) && 0x1f == (bitbuf_ & 0xff)) {
+            state_ = ST_HEADER;                 // concatenated member.
+            return;
+        }
+
+    } else if (FORMAT_ZLIB == format_) {
+        uint32_t adler = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            adler = (adler << 8) | Bits(8);
+        }
+        if (adler != check_) {
+            throw AppException("Decoder: zlib checksum mismatch");
+        }
+    }
+    state_ = ST_DONE;
+}
+
+}   // namespace Updater
+
+//end
@@ -0,0 +1,138 @@
+#ifndef AUTOINFLATE_H_INCLUDED
+#define AUTOINFLATE_H_INCLUDED
+//  $Id: AutoInflate.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: streaming gzip/deflate decoder.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace Updater {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Inflater
+//
+//  RFC 1951 decoder with RFC 1950 (zlib) and RFC 1952 (gzip) framing; pull model,
+//  compressed input is drawn from the source on demand:
+//
+//      Read()          Next decoded segment, 0 on end-of-stream; throws on corrupt
+//                      or truncated content, and on trailer check failure.
+//
+//  Concatenated gzip members are decoded as a single stream. "deflate" content is
+//  accepted with or without zlib framing, as servers differ.
+//
+
+class Inflater {
+    Inflater(const Inflater &rhs);
+    Inflater& operator=(const Inflater &rhs);
+
+public:
+    enum Format {
+        FORMAT_RAW,                             // deflate stream, unframed.
+        FORMAT_ZLIB,                            // zlib, otherwise raw.
+        FORMAT_GZIP                             // gzip.
+    };
+
+    struct ISource {
+        virtual ~ISource() {}
+        virtual size_t Fill(void *buffer, size_t length) = 0;   // 0 on end-of-content.
+    };
+
+public:
+    Inflater(ISource &source, Format format);
+    ~Inflater();
+
+    size_t              Read(void *buffer, size_t length);
+
+    uint64_t            In() const {            // compressed bytes consumed.
+        return in_total_ - (in_end_ - in_pos_) - (bitcnt_ / 8);
+    }
+    uint64_t            Out() const {           // decoded bytes produced.
+        return out_total_;
+    }
+
+    // Content-Encoding/enclosure type mapping; false if not supported.
+    static bool         Encoding(const std::string &name, Format &format);
+
+private:
+    struct Huffman;
+
+    enum State {
+        ST_HEADER,                              // stream header.
+        ST_BLOCK,                               // block header.
+        ST_STORED,                              // stored block.
+        ST_CODES,                               // compressed block.
+        ST_TRAILER,                             // stream trailer.
+        ST_DONE
+    };
+
+    bool                Refill();
+    bool                Pull(unsigned count);
+    unsigned            Need(unsigned count);
+    unsigned            Bits(unsigned count);
+    int                 Decode(const Huffman &h);
+    static int          Build(Huffman &h, const unsigned char *lengths, unsigned count);
+
+    void                Header();
+    void                Block();
+    void                Dynamic();
+    size_t              Stored(unsigned char *out, size_t length);
+    size_t              Codes(unsigned char *out, size_t length);
+    void                Trailer();
+
+private:
+    enum {
+        WINDOW_SIZE = 32 * 1024,
+        INPUT_SIZE = 64 * 1024
+    };
+
+    ISource &source_;
+    Format format_;
+    State state_;
+    unsigned char *input_;                      // input buffer.
+    size_t in_pos_, in_end_;
+    uint64_t in_total_;
+    uint64_t bitbuf_;                           // bit accumulator, LSB first.
+    unsigned bitcnt_;
+    bool eof_;                                  // source exhausted.
+    bool last_;                                 // final block.
+    unsigned char *window_;                     // history, WINDOW_SIZE.
+    unsigned wpos_;
+    uint64_t out_total_;                        // decoded, all members.
+    uint64_t member_;                           // decoded, current member.
+    uint32_t check_;                            // crc32 or adler32.
+    uint32_t stored_;                           // stored block remaining.
+    unsigned copy_;                             // pending match length.
+    unsigned distance_;                         // pending match distance.
+    Huffman *lencode_, *distcode_;              // active tables.
+    Huffman *dynamic_;                          // dynamic tables; literal/length + distance.
+};
+
+}   // namespace Updater
+
+#endif  //AUTOINFLATE_H_INCLUDED
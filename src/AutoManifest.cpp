@@ -28,11 +28,13 @@
 #include "common.h"
 
 #include "AutoManifest.h"
+#include "AutoManifestImage.h"
 #include "AutoVersion.h"
 #include "AutoError.h"
 #include "AutoLogger.h"
 
 #include <cstdio>
+#include <cstring>
 
 #include <algorithm>
 #include <vector>
@@ -68,7 +70,8 @@ namespace {
 //
 //                  <updater:minimumSystemVersion>xxx</updater:minimumSystemVersion>
 //
-//          TODO:   <updater:phasedRolloutInterval>xxx</updater:phasedRolloutInterval>
+//                  <updater:phasedRolloutInterval>xxx</updater:phasedRolloutInterval>
+//                                                  ^ seconds, between rollout groups.
 //
 //                  <updater:criticalUpdate [updater:version="1.2.4"]></updater:criticalUpdate>
 //                                                  ^ optional less than comparison.
@@ -90,7 +93,22 @@ namespace {
 //                      md5Signature=
 //                      edSignature=
 //                      edKeyVersion=
+//                      chunks=             Chunk index URL; optional, see Chunker.h.
+//                      mirrors=            Alternate URLs of the same image, whitespace separated; optional.
 //                  />
+//
+//                  <updater:deltas>
+//                      <enclosure ...
+//                          deltaFrom=              Source version.
+//                          deltaFromShaSignature=  Source image SHA; optional.
+//                          url=
+//                          length=                 Patch length, uncompressed.
+//                          type="application/gzip"
+//                          shaSignature=           Patch signatures.
+//                          edSignature=
+//                          edKeyVersion=
+//                      />
+//                  </updater:deltas>
 //              </item>
 //                   :  :
 //
@@ -110,11 +128,13 @@ namespace {
 #define ATOM_RELEASENOTESLINK   "releaseNotesLink"
 #define ATOM_VERSION            "version"
 #define ATOM_MINIMUMSYSTEMVERSION "minimumSystemVersion"
+#define ATOM_PHASEDROLLOUTINTERVAL "phasedRolloutInterval"
 #define ATOM_CRITICALUPDATE     "criticalUpdate"
 #define ATOM_PUBLISHED          "published"
 #define ATOM_PUBDATE            "pubDate"
 #define ATOM_INSTALLERARGUMENTS "installerArguments"
 #define ATOM_TAGS               "tags"
+#define ATOM_DELTAS             "deltas"
 
 #define ATOM_ENCLOSURE          "enclosure"
 #define ATTR_NAME               "name"
@@ -128,6 +148,10 @@ namespace {
 #define ATTR_MD5SIGNATURE       "md5Signature"
 #define ATTR_EDSIGNATURE        "edSignature"
 #define ATTR_EDKEYVERSION       "edKeyVersion"
+#define ATTR_DELTAFROM          "deltaFrom"
+#define ATTR_DELTAFROMSHA       "deltaFromShaSignature"
+#define ATTR_CHUNKS             "chunks"
+#define ATTR_MIRRORS            "mirrors"
 
 namespace {
 
@@ -137,13 +161,14 @@ struct ParserContext {
 
     ParserContext(XML_Parser parser__, const char *required_channel__)
         : parser(parser__), required_channel(required_channel__ ? required_channel__ : ""),
-            channel_status(CHANNEL_NONE), in_item(false), in_tags(false),
+            all_channels(false), channel_status(CHANNEL_NONE), in_item(false), in_tags(false), in_deltas(false),
             title_level(0),
             link_level(0),
             description_level(0),
             releaseNotesLink_level(0),
             version_level(0),
             minimumSystemVersion_level(0),
+            phasedRolloutInterval_level(0),
             tags_level(0),
             criticalUpdate_level(0),
             installerArguments_level(0),
@@ -164,14 +189,27 @@ struct ParserContext {
         return (channel.empty() || channel == "release");
     }
 
-    bool ChannelMatch(const std::string &channel) {
-        if (channel == required_channel ||
-                (EmptyOrRelease(channel) && EmptyOrRelease(required_channel))) {
+    static bool ChannelMatch(const std::string &channel, const std::string &required) {
+        if (channel == required ||
+                (EmptyOrRelease(channel) && EmptyOrRelease(required))) {
             return true;
         }
         return false;
     }
 
+    bool ChannelMatch(const std::string &channel) {
+        if (all_channels) {                     // first of each channel, as selection.
+            for (std::vector<std::string>::const_iterator it(seen_channels.begin()), end(seen_channels.end()); it != end; ++it) {
+                if (ChannelMatch(channel, *it)) {
+                    return false;
+                }
+            }
+            seen_channels.push_back(channel);
+            return true;
+        }
+        return ChannelMatch(channel, required_channel);
+    }
+
     void ParserError(const char *msg) {
         error.assign(msg);
         XML_StopParser(parser, XML_FALSE);
@@ -191,7 +229,9 @@ struct ParserContext {
     }
 
     void ParserComplete() {
-        XML_StopParser(parser, XML_TRUE);
+        if (! all_channels) {
+            XML_StopParser(parser, XML_TRUE);
+        }
     }
 
     unsigned LineNumber() const {
@@ -225,18 +265,23 @@ struct ParserContext {
 
     XML_Parser      parser;                     // XML parser instance.
     const std::string required_channel;         // required channel; optional.
+    bool            all_channels;               // all channels, see AutoManifest::LoadAll().
+    std::vector<std::string> seen_channels;     // and those encountered.
     std::string     error;                      // last error.
     std::vector<std::string> warnings;          // none or more warnings.
     enum ChannelStatus channel_status;          // <channel> status
     std::string     channel_name;               // and associated channel name; if any.
     bool            in_item;                    // <item>
     bool            in_tags;                    // <tags>
+    bool            in_deltas;                  // <updater:deltas>
     int             title_level;                // <title>
     int             link_level;                 // <link>
     int             description_level;          // <description>
     int             releaseNotesLink_level;     // <updater:releaseNotesLink>
     int             version_level;              // <updater:version>
     int             minimumSystemVersion_level; // <updater:minimumSystemVersion>
+    int             phasedRolloutInterval_level; // <updater:phasedRolloutInterval>
+    std::string     phasedRolloutInterval;      // and associated text.
     int             tags_level;                 // <updater:tags>
     int             criticalUpdate_level;       // <updater:criticalUpdate>
     int             installerArguments_level;   // <updater:installerArguments>
@@ -525,6 +570,12 @@ OnStartElement(void *data, const char *name, const char **attrs)
                                                 // <updater:minimumSystemVersion>
         } else if (ctx.PrefixFieldMatch(name, ATOM_MINIMUMSYSTEMVERSION)) {
             ++ctx.minimumSystemVersion_level;
+                                                // <updater:phasedRolloutInterval>
+        } else if (ctx.PrefixFieldMatch(name, ATOM_PHASEDROLLOUTINTERVAL)) {
+            if (0 == ctx.phasedRolloutInterval_level) {
+                ctx.phasedRolloutInterval.clear();
+            }
+            ++ctx.phasedRolloutInterval_level;
                                                 // <published>
         } else if (0 == strcmp(name, ATOM_PUBLISHED)) {
             ++ctx.published_level;
@@ -554,6 +605,48 @@ OnStartElement(void *data, const char *name, const char **attrs)
                 return;
             }
             ctx.in_tags = true;
+                                                // <updater:deltas>
+        } else if (ctx.PrefixFieldMatch(name, ATOM_DELTAS)) {
+            if (ctx.in_deltas) {
+                ctx.ParserError("nested deltas component");
+                return;
+            }
+            ctx.in_deltas = true;
+                                                // <updater:deltas><enclosure [options]>
+        } else if (ctx.in_deltas && 0 == strcmp(name, ATOM_ENCLOSURE)) {
+            if (AutoManifest *manifest = ctx.manifest) {
+                AutoDelta delta;
+
+                for (unsigned i = 0; attrs[i]; i += 2) {
+                    const char *var = attrs[i], *value = attrs[i+1];
+
+                    LOG<LOG_TRACE>() << "Manifest[" << ctx.LineNumber() << "]"
+                            << "->delta<" << var << "=" << value << ">" << LOG_ENDL;
+                    if (ctx.PrefixFieldMatch(var, ATTR_DELTAFROM)) {
+                        delta.deltaFrom = value;
+                    } else if (ctx.PrefixFieldMatch(var, ATTR_DELTAFROMSHA)) {
+                        delta.deltaFromSHASignature = value;
+                    } else if (0 == strcmp(var, ATTR_URL)) {
+                        delta.attributeURL = value;
+                    } else if (0 == strcmp(var, ATTR_LENGTH)) {
+                        delta.attributeLength = value;
+                    } else if (0 == strcmp(var, ATTR_TYPE)) {
+                        delta.attributeType = value;
+                    } else if (ctx.PrefixFieldMatch(var, ATTR_SHASIGNATURE)) {
+                        delta.attributeSHASignature = value;
+                    } else if (ctx.PrefixFieldMatch(var, ATTR_EDSIGNATURE)) {
+                        delta.attributeEDSignature = value;
+                    } else if (ctx.PrefixFieldMatch(var, ATTR_EDKEYVERSION)) {
+                        delta.attributeEDKeyVersion = value;
+                    }
+                }
+
+                if (delta.deltaFrom.empty() || delta.attributeURL.empty() || delta.attributeLength.empty()) {
+                    ctx.ParserWarning("incomplete delta enclosure ignored");
+                } else {
+                    manifest->deltas.push_back(delta);
+                }
+            }
                                                 // <enclosure [options]>
         } else if (0 == strcmp(name, ATOM_ENCLOSURE)) {
             if (AutoManifest *manifest = ctx.manifest) {
@@ -592,6 +685,18 @@ OnStartElement(void *data, const char *name, const char **attrs)
                         manifest->attributeEDSignature = value;
                     } else if (0 == strcmp(var, ATTR_EDKEYVERSION)) {
                         manifest->attributeEDKeyVersion = value;
+                    } else if (0 == strcmp(var, ATTR_CHUNKS)) {
+                        manifest->attributeChunks = value;
+                    } else if (0 == strcmp(var, ATTR_MIRRORS)) {
+                        manifest->attributeMirrors.clear();
+                        for (const char *cursor = value; *cursor;) {
+                            const size_t length = strcspn(cursor, " \t\r\n");
+                            if (length) {
+                                manifest->attributeMirrors.push_back(std::string(cursor, length));
+                            }
+                            cursor += length;
+                            cursor += strspn(cursor, " \t\r\n");
+                        }
                     }
                 }
             }
@@ -613,8 +718,11 @@ OnEndElement(void *data, const char *name)
         }
 
     } else if (ctx.in_item) {
+                                                // </updater:deltas>
+        if (ctx.PrefixFieldMatch(name, ATOM_DELTAS)) {
+            ctx.in_deltas = false;
                                                 // </title>
-        if (0 == strcmp(name, ATOM_TITLE)) {
+        } else if (0 == strcmp(name, ATOM_TITLE)) {
             if (1 == ctx.title_level && manifest) {
                 trim(manifest->title);
                 LOG<LOG_TRACE>() << "Manifest[" << ctx.LineNumber() << "]"
@@ -666,6 +774,19 @@ OnEndElement(void *data, const char *name)
                         << "->minimumSystemVersion" << manifest->minimumSystemVersion << ">" << LOG_ENDL;
             }
             --ctx.minimumSystemVersion_level;
+                                                // </updater:phasedRolloutInterval>
+        } else if (ctx.PrefixFieldMatch(name, ATOM_PHASEDROLLOUTINTERVAL)) {
+            if (1 == ctx.phasedRolloutInterval_level && manifest) {
+                const long interval = strtol(ctx.phasedRolloutInterval.c_str(), NULL, 10);
+                if (interval < 0) {
+                    ctx.ParserWarning("invalid phasedRolloutInterval");
+                } else {
+                    manifest->phasedRolloutInterval = (time_t)interval;
+                }
+                LOG<LOG_TRACE>() << "Manifest[" << ctx.LineNumber() << "]"
+                        << "->phasedRolloutInterval<" << manifest->phasedRolloutInterval << ">" << LOG_ENDL;
+            }
+            --ctx.phasedRolloutInterval_level;
                                                 // </updater:criticalUpdate>
         } else if (ctx.PrefixFieldMatch(name, ATOM_CRITICALUPDATE)) {
             if (1 == ctx.criticalUpdate_level && manifest) {
@@ -704,6 +825,7 @@ OnEndElement(void *data, const char *name)
         } else if (0 == strcmp(name, ATOM_ITEM)) {
             ctx.manifest = NULL;
             ctx.in_item = false;
+            ctx.in_deltas = false;
         }
                                                 // </channel>
     } else if (0 == strcmp(name, ATOM_CHANNEL)) {
@@ -745,6 +867,9 @@ OnText(void *data, const char *s, int len)
                                                 // <updater:minimumSystemVersion>
         } else if (1 == ctx.minimumSystemVersion_level) {
             manifest->minimumSystemVersion.append(s, len);
+                                                // <updater:phasedRolloutInterval>
+        } else if (1 == ctx.phasedRolloutInterval_level) {
+            ctx.phasedRolloutInterval.append(s, len);
 
                                                 // <installerArguments>
         } else if (1 == ctx.installerArguments_level) {
@@ -782,40 +907,366 @@ OnText(void *data, const char *s, int len)
 
 }   // anonymous namespace
 
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Manifest parser; content presented whole, see AutoManifest::Load(), otherwise in
+//  parts via the parser's buffer, see ManifestSink.
+//
+
+class ManifestParser {
+    ManifestParser(const ManifestParser &rhs);
+    ManifestParser& operator=(const ManifestParser &rhs);
+
+public:
+    ManifestParser(const std::string &channel, const std::string &os_label, bool all_channels = false) :
+            parser_(XML_ParserCreate(NULL)), ctx_(parser_, channel.c_str()), status_(XML_STATUS_OK) {
+        LOG<LOG_INFO>() << "Parsing XML for channel=" << (all_channels ? "*" : channel) << ", osl=" << os_label << LOG_ENDL;
+        if (NULL == parser_) {
+            throw AppException("Failed to create XML parser.");
+        }
+        ctx_.all_channels = all_channels;
+        XML_SetElementHandler(parser_, OnStartElement, OnEndElement);
+        XML_SetCharacterDataHandler(parser_, OnText);
+        XML_SetUserData(parser_, &ctx_);
+    }
+
+    ~ManifestParser() {
+        if (parser_) XML_ParserFree(parser_);
+    }
+
+    void parse(const char *data, size_t length, bool final) {
+        if (XML_STATUS_OK == status_) {
+            status_ = XML_Parse(parser_, data, (int)length, final ? XML_TRUE : XML_FALSE);
+        }
+    }
+
+    void *buffer(size_t length) {           // NULL once concluded.
+        if (XML_STATUS_OK == status_) {
+            return XML_GetBuffer(parser_, (int)length);
+        }
+        return NULL;
+    }
+
+    void parse_buffer(size_t length, bool final) {
+        if (XML_STATUS_OK == status_) {
+            status_ = XML_ParseBuffer(parser_, (int)length, final ? XML_TRUE : XML_FALSE);
+        }
+    }
+
+    bool concluded() const {                // channel complete (suspended) or error.
+        return (XML_STATUS_OK != status_);
+    }
+
+    bool suspended() const {
+        return (XML_STATUS_SUSPENDED == status_);
+    }
+
+    bool select(AutoManifest &manifest) const {
+        error();
+        if (const AutoManifest *t_manifest = ctx_.best_match()) {
+            manifest = *t_manifest;
+            return true;
+        }
+        return false;
+    }
+
+    bool all(std::vector<AutoManifest> &manifests, bool &channels_omitted) const {
+        error();
+        manifests = ctx_.manifests;
+        channels_omitted = (ParserContext::CHANNEL_OMITTED == ctx_.channel_status);
+        return (! manifests.empty());
+    }
+
+private:
+    void error() const {
+        if (XML_STATUS_ERROR == status_) {
+            std::string msg("XML parser error: ");
+            msg.append(XML_ErrorString(XML_GetErrorCode(parser_)));
+            throw AppException(msg);
+        }
+    }
+
+private:
+    XML_Parser parser_;
+    ParserContext ctx_;
+    XML_Status status_;
+};
+
+
+//  Load the manifest, either form; selecting the suitable element of the channel.
+//
 bool
 AutoManifest::Load(const std::string& xml, const std::string &channel, const std::string &os_label)
 {
-    LOG<LOG_INFO>() << "Parsing XML for channel=" << channel << ", osl=" << os_label << LOG_ENDL;
+    if (ManifestImage::IsImage(xml.data(), xml.size())) {
+        return LoadImage(xml.data(), xml.size(), channel, os_label);
+    }
+    if (ManifestIndex::IsIndex(xml.data(), xml.size())) {
+        return LoadFeed(xml.data(), xml.size(), channel, os_label);
+    }
+
+    ManifestParser parser(channel, os_label);
+
+    parser.parse(xml.c_str(), xml.size(), true);
+    return parser.select(*this);            // select suitable element.
+}
+
+
+//  Load the compiled form, see ManifestImage; selection as the XML form, the first of the
+//  greatest weight by document order, only the element selected being materialised.
+//
+bool
+AutoManifest::LoadImage(const void *image, size_t length, const std::string &channel, const std::string &os_label)
+{
+    std::vector<ManifestImage> images(1);
 
-    // load manifest
-    XML_Parser parser = XML_ParserCreate(NULL);
-    if (NULL == parser) {
-        throw AppException("Failed to create XML parser.");
+    if (! images[0].Open(image, length)) {
+        throw AppException("Manifest image malformed.");
     }
+    return LoadImages(images, channel, os_label);
+}
+
+
+//  Selection across the images, as LoadImage(); segments of a feed each retain the
+//  document order of the manifest compiled.
+//
+bool
+AutoManifest::LoadImages(const std::vector<ManifestImage> &images, const std::string &channel, const std::string &os_label)
+{
+    LOG<LOG_INFO>() << "Loading image for channel=" << channel << ", osl=" << os_label << LOG_ENDL;
+
+    AutoManifest candidate;
+    const ManifestImage *selected_image = NULL;
+    unsigned selected = 0;
+    uint32_t order = 0;
+    DWORD weight = 0;
 
-    ParserContext ctx(parser, channel.c_str());
-    XML_SetElementHandler(parser, OnStartElement, OnEndElement);
-    XML_SetCharacterDataHandler(parser, OnText);
-    XML_SetUserData(parser, &ctx);
+    for (std::vector<ManifestImage>::const_iterator it(images.begin()), end(images.end()); it != end; ++it) {
+        const ManifestImage &reader = *it;
 
-    XML_Status st = XML_Parse(parser, xml.c_str(), (int)xml.size(), XML_TRUE);
-    if (st == XML_STATUS_ERROR) {
-        std::string msg("XML parser error: ");
-        msg.append(XML_ErrorString(XML_GetErrorCode(parser)));
-        XML_ParserFree(parser);
-        throw AppException(msg);
+        for (unsigned s = 0; s < reader.Sections(); ++s) {
+            if (! reader.ChannelsOmitted() &&
+                    ! ParserContext::ChannelMatch(reader.SectionChannel(s).str(), channel)) {
+                continue;
+            }
+
+            candidate.OSLabel = reader.SectionOS(s).str();
+            candidate.minimumSystemVersion.clear();
+            if (0 == ParserContext::SelectionWeight(candidate)) {
+                continue;                       // unsuitable os-label.
+            }
+
+            unsigned first = 0, count = 0;
+            reader.SectionItems(s, first, count);
+            for (unsigned item = first; item < first + count; ++item) {
+                candidate.minimumSystemVersion = reader.Item(item, ManifestImage::IT_MINIMUMSYSTEMVERSION).str();
+
+                const DWORD t_weight = ParserContext::SelectionWeight(candidate);
+                const uint32_t t_order = reader.ItemOrder(item);
+                if (t_weight > weight || (t_weight && t_weight == weight && t_order < order)) {
+                    selected_image = &reader, selected = item, weight = t_weight, order = t_order;
+                }
+            }
+        }
     }
-    XML_ParserFree(parser);
 
-    // select suitable element
-    if (const AutoManifest *manifest = ctx.best_match()) {
-        *this = *manifest;
+    if (weight) {
+        selected_image->Extract(selected, *this);
+        this->weight = weight;
         return true;
     }
     return false;
 }
 
 
+//  Load the compiled feed, held in full; see ManifestIndex.
+//
+bool
+AutoManifest::LoadFeed(const void *feed, size_t length, const std::string &channel, const std::string &os_label)
+{
+    ManifestIndex index;
+    std::vector<ManifestImage> images;
+
+    if (! index.Open(feed, length)) {
+        throw AppException("Manifest feed malformed.");
+    }
+    FeedSegments(index, channel, feed, 0, length, images);
+    return LoadImages(images, channel, os_label);
+}
+
+
+//  All elements of all channels, in document order; the first of each channel alone,
+//  as selection. Elements within a channel are labelled by the channel (BuildLabel).
+//
+bool
+AutoManifest::LoadAll(const std::string& xml, std::vector<AutoManifest> &manifests, bool &channels_omitted)
+{
+    ManifestParser parser("", "", true);
+
+    parser.parse(xml.c_str(), xml.size(), true);
+    return parser.all(manifests, channels_omitted);
+}
+
+
+//  Those segments of the channel with a suitable os-label; as LoadImages(), minimum system
+//  versions aside. Segments of a channel are consecutive, so typically a single range.
+//
+static bool
+FeedEntry(const ManifestIndex &index, unsigned entry, const std::string &channel)
+{
+    AutoManifest candidate;
+
+    if (! index.ChannelsOmitted() &&
+            ! ParserContext::ChannelMatch(index.EntryChannel(entry).str(), channel)) {
+        return false;
+    }
+    candidate.OSLabel = index.EntryOS(entry).str();
+    return (0 != ParserContext::SelectionWeight(candidate));
+}
+
+
+bool
+AutoManifest::FeedSpan(const ManifestIndex &index, const std::string &channel, uint64_t &offset, uint64_t &length)
+{
+    uint64_t start = 0, end = 0;
+    bool found = false;
+
+    for (unsigned entry = 0; entry < index.Entries(); ++entry) {
+        if (FeedEntry(index, entry, channel)) {
+            uint32_t segment = 0, segment_length = 0;
+
+            index.EntrySegment(entry, segment, segment_length);
+            if (! found || segment < start) start = segment;
+            if (! found || segment + (uint64_t)segment_length > end) end = segment + (uint64_t)segment_length;
+            found = true;
+        }
+    }
+    offset = start, length = end - start;
+    return found;
+}
+
+
+//  Open the applicable segments, held within 'segments' at feed 'offset'.
+//
+void
+AutoManifest::FeedSegments(const ManifestIndex &index, const std::string &channel,
+        const void *segments, uint64_t offset, size_t length, std::vector<ManifestImage> &images)
+{
+    images.clear();
+    for (unsigned entry = 0; entry < index.Entries(); ++entry) {
+        if (FeedEntry(index, entry, channel)) {
+            uint32_t segment = 0, segment_length = 0;
+
+            index.EntrySegment(entry, segment, segment_length);
+            if (segment < offset || segment + (uint64_t)segment_length > offset + length) {
+                throw AppException("Manifest feed incomplete.");
+            }
+
+            images.push_back(ManifestImage());
+            if (! images.back().Open(static_cast<const uint8_t *>(segments) + (size_t)(segment - offset), segment_length)) {
+                throw AppException("Manifest image malformed.");
+            }
+        }
+    }
+}
+
+
+ManifestSink::ManifestSink(const std::string &channel, const std::string &os_label) :
+        channel_(channel), os_label_(os_label), parser_(NULL), received_(0)
+{
+}
+
+
+ManifestSink::~ManifestSink()
+{
+    delete parser_;
+}
+
+
+bool
+ManifestSink::open()
+{
+    delete parser_;                             // restarted transfer.
+    parser_ = NULL;
+    parser_ = new ManifestParser(channel_, os_label_);
+    received_ = 0;
+    return true;
+}
+
+
+void
+ManifestSink::append(const void *data, size_t length)
+{
+    if (NULL == parser_ || 0 == length) {
+        return;
+    }
+
+    void *buffer = parser_->buffer(length);
+    if (buffer) {
+        memcpy(buffer, data, length);
+        commit(length);
+    }
+}
+
+
+//  Read directly into the parser's buffer; NULL once parsing has concluded.
+void *
+ManifestSink::acquire(size_t &length)
+{
+    if (NULL == parser_) {
+        return NULL;
+    }
+    return parser_->buffer(length);
+}
+
+
+void
+ManifestSink::commit(size_t length)
+{
+    if (parser_) {
+        parser_->parse_buffer(length, false);
+        received_ += length;
+        if (parser_->suspended()) {
+            LOG<LOG_INFO>() << "Manifest: channel complete, " << received_ << " bytes" << LOG_ENDL;
+        }
+    }
+}
+
+
+//  Conclude the transfer once the required channel is complete, or the content in error.
+bool
+ManifestSink::cancelled()
+{
+    return (parser_ && parser_->concluded());
+}
+
+
+void
+ManifestSink::close()
+{
+    if (parser_) {
+        parser_->parse_buffer(0, true);         // final, unless concluded.
+    }
+}
+
+
+bool
+ManifestSink::complete() const
+{
+    return (parser_ && parser_->suspended());
+}
+
+
+bool
+ManifestSink::load(AutoManifest &manifest)
+{
+    if (NULL == parser_) {
+        return false;
+    }
+    return parser_->select(manifest);
+}
+
+
 bool
 AutoManifest::IsCriticalUpdate(const std::string &app_version) const
 {
@@ -842,4 +1293,47 @@ AutoManifest::IsCriticalUpdate(const std::string &app_version) const
     return false;
 }
 
+
+//  Whether the item is withheld from the rollout 'group' at 'now'; group N is offered the
+//  item N intervals after publication, group zero immediately.
+//
+bool
+AutoManifest::IsPhased(unsigned group, time_t now) const
+{
+    if (phasedRolloutInterval <= 0 || published <= 0) {
+        return false;
+    }
+
+    group %= PHASED_GROUPS;
+    const time_t opens = published + ((time_t)group * phasedRolloutInterval);
+    if (now < opens) {
+        LOG<LOG_INFO>() << "IsPhased: yes, group=" << group << ", opens in "
+            << (long)(opens - now) << " seconds" << LOG_ENDL;
+        return true;
+    }
+    return false;
+}
+
+
+//  Rollout group of an installation; stable across runs given a persisted identifier.
+//  FNV-1a, plus a final avalanche so the low-order residue is evenly spread.
+//
+//static
+unsigned
+AutoManifest::PhasedGroup(const std::string &install_id)
+{
+    uint32_t hash = 2166136261U;
+
+    for (std::string::const_iterator it(install_id.begin()); it != install_id.end(); ++it) {
+        hash ^= (uint8_t)*it;
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return hash % PHASED_GROUPS;
+}
+
 }   // namespace Updater
@@ -29,12 +29,35 @@
 
 #include <time.h>
 #include <string>
+#include <vector>
+
+#include "AutoDownLoad.h"
 
 namespace Updater {
+
+// Delta enclosure; patch from a prior installer image, see AutoPatch.h.
+struct AutoDelta {
+    std::string     deltaFrom;                  // Source version.
+    std::string     deltaFromSHASignature;      // Source image SHA signature; optional.
+    std::string     attributeURL;               // Patch URL.
+    std::string     attributeLength;            // Patch length, in bytes, uncompressed.
+    std::string     attributeType;              // Patch type, "application/gzip" when compressed.
+    std::string     attributeSHASignature;      // Patch SHA signature.
+    std::string     attributeEDSignature;       // Patch EdSignature.
+    std::string     attributeEDKeyVersion;      // EdKeyVersion.
+};
+
+class ManifestImage;
+class ManifestIndex;
+
 class AutoManifest {
 public:
+    enum {
+        PHASED_GROUPS = 7                       // phased rollout groups.
+    };
+
     AutoManifest() :
-        published(0), weight(0)
+        published(0), phasedRolloutInterval(0), weight(0)
     {}
 
     std::string     BuildLabel;                 // Optional build label, "release", "debug" etc.
@@ -49,6 +72,7 @@ public:
     std::string     installerArguments;         // Optional installer options.
 
     time_t          published;                  // Published time-stamp.
+    time_t          phasedRolloutInterval;      // Interval between rollout groups, seconds; optional.
     std::string     pubDate;                    // Human readable publish time-stamp.
     std::string     description;                // Release description.
     std::string     releaseNotesLink;           // Release notes.
@@ -63,11 +87,75 @@ public:
     std::string     attributeMD5Signature;      // MD5 signature.
     std::string     attributeEDSignature;       // EdSignature.
     std::string     attributeEDKeyVersion;      // EdKeyVersion.
+    std::string     attributeChunks;            // Chunk index URL; optional.
+    std::vector<std::string> attributeMirrors;  // Alternate download URLs; optional.
+
+    std::vector<AutoDelta> deltas;              // Optional delta enclosures.
 
     mutable unsigned weight;
 
     bool            Load(const std::string& xml, const std::string &channel, const std::string &os_label);
+    bool            LoadImage(const void *image, size_t length, const std::string &channel, const std::string &os_label);
+    bool            LoadImages(const std::vector<ManifestImage> &images, const std::string &channel, const std::string &os_label);
+    bool            LoadFeed(const void *feed, size_t length, const std::string &channel, const std::string &os_label);
     bool            IsCriticalUpdate(const std::string &current_version) const;
+    bool            IsPhased(unsigned group, time_t now) const;
+
+    static unsigned PhasedGroup(const std::string &install_id);
+    static bool     LoadAll(const std::string& xml, std::vector<AutoManifest> &manifests, bool &channels_omitted);
+
+    // Compiled feed, see ManifestIndex; the segments applicable to the channel, their span and images.
+    static bool     FeedSpan(const ManifestIndex &index, const std::string &channel, uint64_t &offset, uint64_t &length);
+    static void     FeedSegments(const ManifestIndex &index, const std::string &channel,
+                        const void *segments, uint64_t offset, size_t length, std::vector<ManifestImage> &images);
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ManifestSink
+//
+//  Incremental manifest parsing; content is parsed as it arrives, read directly into the
+//  parser's own buffer, and the transfer concluded once the required channel has been seen
+//  in full, or upon a parse error. Selection and error reporting are those of Load().
+//
+
+class ManifestParser;
+
+class ManifestSink : public IDownloadSink {
+    ManifestSink(const ManifestSink &rhs);
+    ManifestSink& operator=(const ManifestSink &rhs);
+
+public:
+    ManifestSink(const std::string &channel, const std::string &os_label);
+    virtual ~ManifestSink();
+
+    virtual void set_size(size_t size) {
+        (void) size;
+    }
+    virtual bool open();
+    virtual void append(const void *data, size_t length);
+    virtual bool cancelled();
+    virtual void close();
+
+    virtual void *acquire(size_t &length);
+    virtual void commit(size_t length);
+
+    // Whether parsing concluded ahead of the content, the required channel complete.
+    bool complete() const;
+
+    // Content parsed, in bytes.
+    uint64_t received() const {
+        return received_;
+    }
+
+    // Select the suitable element; following the transfer.
+    bool load(AutoManifest &manifest);
+
+private:
+    const std::string channel_;
+    const std::string os_label_;
+    ManifestParser *parser_;
+    uint64_t received_;
 };
 
 }   // namespace Updater
@@ -0,0 +1,700 @@
+//  $Id: AutoManifestImage.cpp,v 1.1 2026/10/16 21:10:44 cvsuser Exp $
+//
+//  AutoUpdater: compiled manifest image.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cassert>
+
+#include "AutoManifestImage.h"
+#include "AutoManifest.h"
+#include "AutoEd25519.h"
+#include "AutoError.h"
+#include "AutoLogger.h"
+
+#include "../ed25519/src/ed25519.h"
+
+namespace Updater {
+
+namespace {
+
+static uint64_t
+Get(const uint8_t *cursor, unsigned length)
+{
+    uint64_t value = 0;
+    for (unsigned i = length; i--;) {
+        value = (value << 8) | cursor[i];
+    }
+    return value;
+}
+
+static void
+Put(std::string &out, uint64_t value, unsigned length)
+{
+    for (unsigned i = 0; i < length; ++i) {
+        out.push_back((char)((value >> (8 * i)) & 0xff));
+    }
+}
+
+//  String pool under construction; identical text is held once.
+class StringPool {
+public:
+    void Add(std::string &out, const std::string &text) {
+        uint32_t offset = 0;
+
+        if (! text.empty()) {
+            std::map<std::string, uint32_t>::const_iterator it = index_.find(text);
+            if (it == index_.end()) {
+                offset = (uint32_t)pool_.size();
+                index_.insert(std::make_pair(text, offset));
+                pool_.append(text);
+            } else {
+                offset = it->second;
+            }
+        }
+        Put(out, offset, 4);
+        Put(out, text.size(), 4);
+    }
+
+    const std::string &data() const {
+        return pool_;
+    }
+
+private:
+    std::string pool_;
+    std::map<std::string, uint32_t> index_;
+};
+
+
+static std::string
+Join(const std::vector<std::string> &values)
+{
+    std::string result;
+    for (std::vector<std::string>::const_iterator it(values.begin()), end(values.end()); it != end; ++it) {
+        if (! result.empty()) result.push_back(' ');
+        result.append(*it);
+    }
+    return result;
+}
+
+}   // namespace anon
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ManifestImage
+//
+
+ManifestImage::ManifestImage() :
+    image_(NULL), length_(0), sections_(0), items_(0), deltas_(0), items_base_(0), deltas_base_(0),
+        pool_(0), pool_length_(0), descriptions_(0), descriptions_length_(0)
+{
+}
+
+
+bool
+ManifestImage::IsImage(const void *data, size_t length)
+{
+    return (length >= HEADER_SIZE && 0 == memcmp(data, MANIFEST_IMAGE_MAGIC, 8));
+}
+
+
+//  Validate the header, tables and every reference; accessors are then unchecked.
+//
+bool
+ManifestImage::Open(const void *data, size_t length)
+{
+    const uint8_t *image = static_cast<const uint8_t *>(data);
+
+    image_ = NULL, length_ = 0;
+    if (! IsImage(data, length) || Get(image + 8, 4) != length ||
+            (Get(image + 16, 4) && length < HEADER_SIZE + SIGNATURE_SIZE)) {
+        LOG<LOG_WARN>() << "Manifest: invalid image header" << LOG_ENDL;
+        return false;
+    }
+
+    const uint64_t content = length - (Get(image + 16, 4) ? SIGNATURE_SIZE : 0);
+    const uint64_t sections = Get(image + 20, 4), items = Get(image + 24, 4), deltas = Get(image + 28, 4);
+    const uint64_t pool = Get(image + 32, 4), pool_length = Get(image + 36, 4);
+    const uint64_t descriptions = Get(image + 40, 4), descriptions_length = Get(image + 44, 4);
+    const uint64_t tables = HEADER_SIZE + (sections * SECTION_SIZE) + (items * ITEM_SIZE) + (deltas * DELTA_SIZE);
+
+    if (tables > content || pool < tables || pool + pool_length > content ||
+            descriptions < tables || descriptions + descriptions_length > content) {
+        LOG<LOG_WARN>() << "Manifest: invalid image tables" << LOG_ENDL;
+        return false;
+    }
+
+    image_ = image, length_ = length;
+    sections_ = (unsigned)sections, items_ = (unsigned)items, deltas_ = (unsigned)deltas;
+    items_base_ = (unsigned)(HEADER_SIZE + (sections * SECTION_SIZE));
+    deltas_base_ = (unsigned)(items_base_ + (items * ITEM_SIZE));
+    pool_ = (uint32_t)pool, pool_length_ = (uint32_t)pool_length;
+    descriptions_ = (uint32_t)descriptions, descriptions_length_ = (uint32_t)descriptions_length;
+
+    bool valid = true;
+
+    for (unsigned s = 0; valid && s < sections_; ++s) {
+        const uint8_t *section = Record(HEADER_SIZE, s, SECTION_SIZE);
+
+        valid = (Valid(section) && Valid(section + REF_SIZE) &&
+                    Get(section + 16, 4) + Get(section + 20, 4) <= items);
+    }
+
+    for (unsigned i = 0; valid && i < items_; ++i) {
+        const uint8_t *item = Record(items_base_, i, ITEM_SIZE);
+        const uint8_t *fields = item + (ITEM_TEXTS * REF_SIZE);
+
+        for (unsigned t = 0; valid && t < ITEM_TEXTS; ++t) {
+            valid = Valid(item + (t * REF_SIZE), IT_DESCRIPTION == t);
+        }
+        valid = (valid && Get(fields + 16, 4) + Get(fields + 20, 4) <= deltas);
+    }
+
+    for (unsigned d = 0; valid && d < deltas_; ++d) {
+        const uint8_t *delta = Record(deltas_base_, d, DELTA_SIZE);
+
+        for (unsigned t = 0; valid && t < DELTA_TEXTS; ++t) {
+            valid = Valid(delta + (t * REF_SIZE));
+        }
+    }
+
+    if (! valid) {                              // reference out of bounds.
+        LOG<LOG_WARN>() << "Manifest: invalid image reference" << LOG_ENDL;
+        image_ = NULL, length_ = 0;
+        return false;
+    }
+    return true;
+}
+
+
+unsigned
+ManifestImage::KeyVersion() const
+{
+    return (image_ ? (unsigned)Get(image_ + 16, 4) : 0);
+}
+
+
+bool
+ManifestImage::Verify(const void *public_key, size_t length) const
+{
+    if (NULL == image_ || 0 == KeyVersion() || NULL == public_key || ED25519_PUBLIC_LENGTH != length) {
+        return false;
+    }
+
+    const size_t content = length_ - SIGNATURE_SIZE;
+    return (1 == ed25519_verify(image_ + content, image_, content, static_cast<const unsigned char *>(public_key)));
+}
+
+
+bool
+ManifestImage::ChannelsOmitted() const
+{
+    return (image_ && 0 != (Get(image_ + 12, 4) & FLAG_CHANNELS_OMITTED));
+}
+
+
+ManifestImage::Text
+ManifestImage::SectionChannel(unsigned section) const
+{
+    assert(section < sections_);
+    return Reference(Record(HEADER_SIZE, section, SECTION_SIZE));
+}
+
+
+ManifestImage::Text
+ManifestImage::SectionOS(unsigned section) const
+{
+    assert(section < sections_);
+    return Reference(Record(HEADER_SIZE, section, SECTION_SIZE) + REF_SIZE);
+}
+
+
+void
+ManifestImage::SectionItems(unsigned section, unsigned &first, unsigned &count) const
+{
+    const uint8_t *record = Record(HEADER_SIZE, section, SECTION_SIZE);
+
+    assert(section < sections_);
+    first = (unsigned)Get(record + 16, 4);
+    count = (unsigned)Get(record + 20, 4);
+}
+
+
+ManifestImage::Text
+ManifestImage::Item(unsigned item, ItemText text) const
+{
+    assert(item < items_ && text < ITEM_TEXTS);
+    return Reference(Record(items_base_, item, ITEM_SIZE) + (text * REF_SIZE), IT_DESCRIPTION == text);
+}
+
+
+int64_t
+ManifestImage::ItemPublished(unsigned item) const
+{
+    assert(item < items_);
+    return (int64_t)Get(Record(items_base_, item, ITEM_SIZE) + (ITEM_TEXTS * REF_SIZE), 8);
+}
+
+
+uint32_t
+ManifestImage::ItemPhasedInterval(unsigned item) const
+{
+    assert(item < items_);
+    return (uint32_t)Get(Record(items_base_, item, ITEM_SIZE) + (ITEM_TEXTS * REF_SIZE) + 8, 4);
+}
+
+
+uint32_t
+ManifestImage::ItemOrder(unsigned item) const
+{
+    assert(item < items_);
+    return (uint32_t)Get(Record(items_base_, item, ITEM_SIZE) + (ITEM_TEXTS * REF_SIZE) + 12, 4);
+}
+
+
+void
+ManifestImage::Extract(unsigned item, AutoManifest &manifest) const
+{
+    const uint8_t *fields = Record(items_base_, item, ITEM_SIZE) + (ITEM_TEXTS * REF_SIZE);
+
+    assert(item < items_);
+    manifest = AutoManifest();
+    manifest.BuildLabel = Item(item, IT_BUILD).str();
+    manifest.OSLabel = Item(item, IT_OS).str();
+    manifest.title = Item(item, IT_TITLE).str();
+    manifest.link = Item(item, IT_LINK).str();
+    manifest.version = Item(item, IT_VERSION).str();
+    manifest.minimumSystemVersion = Item(item, IT_MINIMUMSYSTEMVERSION).str();
+    manifest.criticalUpdate = Item(item, IT_CRITICALUPDATE).str();
+    manifest.installerArguments = Item(item, IT_INSTALLERARGUMENTS).str();
+    manifest.published = (time_t)ItemPublished(item);
+    manifest.phasedRolloutInterval = (time_t)ItemPhasedInterval(item);
+    manifest.pubDate = Item(item, IT_PUBDATE).str();
+    manifest.description = Item(item, IT_DESCRIPTION).str();
+    manifest.releaseNotesLink = Item(item, IT_RELEASENOTESLINK).str();
+    manifest.attributeURL = Item(item, IT_URL).str();
+    manifest.attributeName = Item(item, IT_NAME).str();
+    manifest.attributeVersion = Item(item, IT_ATTRVERSION).str();
+    manifest.attributeLength = Item(item, IT_LENGTH).str();
+    manifest.attributeType = Item(item, IT_TYPE).str();
+    manifest.attributeSHASignature = Item(item, IT_SHASIGNATURE).str();
+    manifest.attributeMD5Signature = Item(item, IT_MD5SIGNATURE).str();
+    manifest.attributeEDSignature = Item(item, IT_EDSIGNATURE).str();
+    manifest.attributeEDKeyVersion = Item(item, IT_EDKEYVERSION).str();
+    manifest.attributeChunks = Item(item, IT_CHUNKS).str();
+
+    const Text mirrors = Item(item, IT_MIRRORS);
+    for (size_t cursor = 0; cursor < mirrors.length;) {
+        const char *space = static_cast<const char *>(memchr(mirrors.data + cursor, ' ', mirrors.length - cursor));
+        const size_t end = (space ? (size_t)(space - mirrors.data) : mirrors.length);
+
+        if (end > cursor) {
+            manifest.attributeMirrors.push_back(std::string(mirrors.data + cursor, end - cursor));
+        }
+        cursor = end + 1;
+    }
+
+    const unsigned first = (unsigned)Get(fields + 16, 4), count = (unsigned)Get(fields + 20, 4);
+    for (unsigned d = first; d < first + count; ++d) {
+        const uint8_t *record = Record(deltas_base_, d, DELTA_SIZE);
+        AutoDelta delta;
+
+        delta.deltaFrom = Reference(record + (DT_FROM * REF_SIZE)).str();
+        delta.deltaFromSHASignature = Reference(record + (DT_FROMSHASIGNATURE * REF_SIZE)).str();
+        delta.attributeURL = Reference(record + (DT_URL * REF_SIZE)).str();
+        delta.attributeLength = Reference(record + (DT_LENGTH * REF_SIZE)).str();
+        delta.attributeType = Reference(record + (DT_TYPE * REF_SIZE)).str();
+        delta.attributeSHASignature = Reference(record + (DT_SHASIGNATURE * REF_SIZE)).str();
+        delta.attributeEDSignature = Reference(record + (DT_EDSIGNATURE * REF_SIZE)).str();
+        delta.attributeEDKeyVersion = Reference(record + (DT_EDKEYVERSION * REF_SIZE)).str();
+        manifest.deltas.push_back(delta);
+    }
+}
+
+
+//  Compile; all sections.
+//
+std::string
+ManifestImage::Build(const std::vector<AutoManifest> &manifests, bool channels_omitted, unsigned keyversion)
+{
+    std::vector<SectionKey> keys;
+    std::vector<std::vector<unsigned> > members;
+
+    Group(manifests, channels_omitted, keys, members);
+    return Build(manifests, keys, members, channels_omitted, keyversion);
+}
+
+
+//  Sections in order of first appearance, grouped by channel; the items of each retaining
+//  their document order.
+//
+void
+ManifestImage::Group(const std::vector<AutoManifest> &manifests, bool channels_omitted,
+        std::vector<SectionKey> &keys, std::vector<std::vector<unsigned> > &members)
+{
+    keys.clear(), members.clear();
+
+    for (unsigned i = 0; i < manifests.size(); ++i) {
+        const AutoManifest &manifest = manifests[i];
+        const SectionKey key((channels_omitted ? std::string() : manifest.BuildLabel), manifest.OSLabel);
+        unsigned s = 0, after = (unsigned)keys.size();
+
+        while (s < keys.size() && keys[s] != key) {
+            if (keys[s].first == key.first) {
+                after = s + 1;                  // following the channel's last section.
+            }
+            ++s;
+        }
+        if (s == keys.size()) {
+            s = after;
+            keys.insert(keys.begin() + s, key);
+            members.insert(members.begin() + s, std::vector<unsigned>());
+        }
+        members[s].push_back(i);
+    }
+}
+
+
+//  Compile the sections given; the document order of each item is its index within
+//  'manifests', so retained by images holding a subset.
+//
+std::string
+ManifestImage::Build(const std::vector<AutoManifest> &manifests, const std::vector<SectionKey> &keys,
+        const std::vector<std::vector<unsigned> > &members, bool channels_omitted, unsigned keyversion)
+{
+    StringPool strings;
+    std::string sections, items, deltas, descriptions;
+    unsigned item_count = 0, delta_count = 0;
+
+    for (unsigned s = 0; s < keys.size(); ++s) {
+        strings.Add(sections, keys[s].first);
+        strings.Add(sections, keys[s].second);
+        Put(sections, item_count, 4);
+        Put(sections, members[s].size(), 4);
+
+        for (std::vector<unsigned>::const_iterator it(members[s].begin()), end(members[s].end()); it != end; ++it) {
+            const AutoManifest &manifest = manifests[*it];
+
+            strings.Add(items, manifest.BuildLabel);
+            strings.Add(items, manifest.OSLabel);
+            strings.Add(items, manifest.title);
+            strings.Add(items, manifest.link);
+            strings.Add(items, manifest.version);
+            strings.Add(items, manifest.minimumSystemVersion);
+            strings.Add(items, manifest.criticalUpdate);
+            strings.Add(items, manifest.installerArguments);
+            strings.Add(items, manifest.pubDate);
+            strings.Add(items, manifest.releaseNotesLink);
+            strings.Add(items, manifest.attributeURL);
+            strings.Add(items, manifest.attributeName);
+            strings.Add(items, manifest.attributeVersion);
+            strings.Add(items, manifest.attributeLength);
+            strings.Add(items, manifest.attributeType);
+            strings.Add(items, manifest.attributeSHASignature);
+            strings.Add(items, manifest.attributeMD5Signature);
+            strings.Add(items, manifest.attributeEDSignature);
+            strings.Add(items, manifest.attributeEDKeyVersion);
+            strings.Add(items, manifest.attributeChunks);
+            strings.Add(items, Join(manifest.attributeMirrors));
+            Put(items, descriptions.size(), 4);   // IT_DESCRIPTION, out of line.
+            Put(items, manifest.description.size(), 4);
+            descriptions.append(manifest.description);
+
+            Put(items, (uint64_t)(int64_t)manifest.published, 8);
+            Put(items, (uint64_t)manifest.phasedRolloutInterval, 4);
+            Put(items, *it, 4);                 // document order.
+            Put(items, delta_count, 4);
+            Put(items, manifest.deltas.size(), 4);
+
+            for (std::vector<AutoDelta>::const_iterator dt(manifest.deltas.begin()), dend(manifest.deltas.end()); dt != dend; ++dt) {
+                strings.Add(deltas, dt->deltaFrom);
+                strings.Add(deltas, dt->deltaFromSHASignature);
+                strings.Add(deltas, dt->attributeURL);
+                strings.Add(deltas, dt->attributeLength);
+                strings.Add(deltas, dt->attributeType);
+                strings.Add(deltas, dt->attributeSHASignature);
+                strings.Add(deltas, dt->attributeEDSignature);
+                strings.Add(deltas, dt->attributeEDKeyVersion);
+                ++delta_count;
+            }
+            ++item_count;
+        }
+    }
+
+    assert(sections.size() == keys.size() * SECTION_SIZE);
+    assert(items.size() == item_count * ITEM_SIZE);
+    assert(deltas.size() == delta_count * DELTA_SIZE);
+
+    const uint64_t pool = HEADER_SIZE + sections.size() + items.size() + deltas.size();
+    const uint64_t length = pool + strings.data().size() + descriptions.size() + (keyversion ? SIGNATURE_SIZE : 0);
+
+    if (length > 0xffffffffU) {
+        throw AppException("Manifest image exceeds 4GB.");
+    }
+
+    std::string image(MANIFEST_IMAGE_MAGIC);
+    Put(image, length, 4);
+    Put(image, (channels_omitted ? FLAG_CHANNELS_OMITTED : 0), 4);
+    Put(image, keyversion, 4);
+    Put(image, keys.size(), 4);
+    Put(image, item_count, 4);
+    Put(image, delta_count, 4);
+    Put(image, pool, 4);
+    Put(image, strings.data().size(), 4);
+    Put(image, pool + strings.data().size(), 4);
+    Put(image, descriptions.size(), 4);
+    assert(image.size() == HEADER_SIZE);
+
+    image.reserve((size_t)length);
+    image.append(sections);
+    image.append(items);
+    image.append(deltas);
+    image.append(strings.data());
+    image.append(descriptions);
+    return image;
+}
+
+
+//private
+ManifestImage::Text
+ManifestImage::Reference(const uint8_t *ref, bool description) const
+{
+    Text text;
+
+    text.data = reinterpret_cast<const char *>(image_ + (description ? descriptions_ : pool_) + Get(ref, 4));
+    text.length = (size_t)Get(ref + 4, 4);
+    return text;
+}
+
+
+//private
+bool
+ManifestImage::Valid(const uint8_t *ref, bool description) const
+{
+    return (Get(ref, 4) + Get(ref + 4, 4) <= (description ? descriptions_length_ : pool_length_));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ManifestIndex
+//
+
+ManifestIndex::ManifestIndex() :
+    index_(NULL), length_(0), entries_(0), strings_(0), strings_length_(0)
+{
+}
+
+
+bool
+ManifestIndex::IsIndex(const void *data, size_t length)
+{
+    return (length >= HEADER_SIZE && 0 == memcmp(data, MANIFEST_INDEX_MAGIC, 8));
+}
+
+
+size_t
+ManifestIndex::IndexLength(const void *data, size_t length)
+{
+    return (IsIndex(data, length) ? (size_t)Get(static_cast<const uint8_t *>(data) + 8, 4) : 0);
+}
+
+
+//  Validate the header, entries and every reference; segments are validated as opened,
+//  see ManifestImage::Open().
+//
+bool
+ManifestIndex::Open(const void *data, size_t length)
+{
+    const uint8_t *index = static_cast<const uint8_t *>(data);
+    const uint64_t index_length = IndexLength(data, length);
+
+    index_ = NULL, length_ = 0;
+    if (index_length < HEADER_SIZE || index_length > length || Get(index + 12, 4) < index_length ||
+            (Get(index + 20, 4) && index_length < HEADER_SIZE + SIGNATURE_SIZE)) {
+        LOG<LOG_WARN>() << "Manifest: invalid index header" << LOG_ENDL;
+        return false;
+    }
+
+    const uint64_t content = index_length - (Get(index + 20, 4) ? SIGNATURE_SIZE : 0);
+    const uint64_t entries = Get(index + 24, 4), strings = HEADER_SIZE + (entries * ENTRY_SIZE);
+    const uint64_t feed_length = Get(index + 12, 4);
+
+    if (strings > content) {
+        LOG<LOG_WARN>() << "Manifest: invalid index entries" << LOG_ENDL;
+        return false;
+    }
+
+    bool valid = true;
+
+    for (unsigned e = 0; valid && e < entries; ++e) {
+        const uint8_t *entry = index + HEADER_SIZE + (e * ENTRY_SIZE);
+        const uint64_t offset = Get(entry + 16, 4), segment_length = Get(entry + 20, 4);
+
+        valid = (Get(entry, 4) + Get(entry + 4, 4) <= content - strings &&
+                    Get(entry + 8, 4) + Get(entry + 12, 4) <= content - strings &&
+                    offset >= index_length && offset + segment_length <= feed_length);
+    }
+
+    if (! valid) {                              // reference out of bounds.
+        LOG<LOG_WARN>() << "Manifest: invalid index reference" << LOG_ENDL;
+        return false;
+    }
+
+    index_ = index, length_ = (size_t)index_length;
+    entries_ = (unsigned)entries;
+    strings_ = (uint32_t)strings, strings_length_ = (uint32_t)(content - strings);
+    return true;
+}
+
+
+unsigned
+ManifestIndex::KeyVersion() const
+{
+    return (index_ ? (unsigned)Get(index_ + 20, 4) : 0);
+}
+
+
+bool
+ManifestIndex::Verify(const void *public_key, size_t length) const
+{
+    if (NULL == index_ || 0 == KeyVersion() || NULL == public_key || ED25519_PUBLIC_LENGTH != length) {
+        return false;
+    }
+
+    const size_t content = length_ - SIGNATURE_SIZE;
+    return (1 == ed25519_verify(index_ + content, index_, content, static_cast<const unsigned char *>(public_key)));
+}
+
+
+bool
+ManifestIndex::ChannelsOmitted() const
+{
+    return (index_ && 0 != (Get(index_ + 16, 4) & ManifestImage::FLAG_CHANNELS_OMITTED));
+}
+
+
+uint32_t
+ManifestIndex::FeedLength() const
+{
+    return (index_ ? (uint32_t)Get(index_ + 12, 4) : 0);
+}
+
+
+ManifestIndex::Text
+ManifestIndex::EntryChannel(unsigned entry) const
+{
+    assert(entry < entries_);
+    return Reference(Record(entry));
+}
+
+
+ManifestIndex::Text
+ManifestIndex::EntryOS(unsigned entry) const
+{
+    assert(entry < entries_);
+    return Reference(Record(entry) + ManifestImage::REF_SIZE);
+}
+
+
+void
+ManifestIndex::EntrySegment(unsigned entry, uint32_t &offset, uint32_t &length) const
+{
+    const uint8_t *record = Record(entry);
+
+    assert(entry < entries_);
+    offset = (uint32_t)Get(record + 16, 4);
+    length = (uint32_t)Get(record + 20, 4);
+}
+
+
+//  Compose; the index, then the segments in the order given.
+//
+std::string
+ManifestIndex::Build(const std::vector<ManifestImage::SectionKey> &keys,
+        const std::vector<std::string> &segments, bool channels_omitted, unsigned keyversion)
+{
+    StringPool strings;
+    std::string entries;
+
+    assert(keys.size() == segments.size());
+    for (unsigned e = 0; e < keys.size(); ++e) {
+        strings.Add(entries, keys[e].first);
+        strings.Add(entries, keys[e].second);
+        Put(entries, 0, 8);                     // segment, below.
+    }
+
+    const uint64_t index_length = HEADER_SIZE + entries.size() + strings.data().size() + (keyversion ? SIGNATURE_SIZE : 0);
+    uint64_t length = index_length;
+
+    for (unsigned e = 0; e < segments.size(); ++e) {
+        std::string segment;
+
+        Put(segment, length, 4);
+        Put(segment, segments[e].size(), 4);
+        entries.replace((e * ENTRY_SIZE) + 16, 8, segment);
+        length += segments[e].size();
+    }
+
+    if (length > 0xffffffffU) {
+        throw AppException("Manifest feed exceeds 4GB.");
+    }
+
+    std::string feed(MANIFEST_INDEX_MAGIC);
+    Put(feed, index_length, 4);
+    Put(feed, length, 4);
+    Put(feed, (channels_omitted ? ManifestImage::FLAG_CHANNELS_OMITTED : 0), 4);
+    Put(feed, keyversion, 4);
+    Put(feed, keys.size(), 4);
+    assert(feed.size() == HEADER_SIZE);
+
+    feed.reserve((size_t)length);
+    feed.append(entries);
+    feed.append(strings.data());
+    feed.append((size_t)(index_length - feed.size()), '\0');  // signature, reserved.
+    for (unsigned e = 0; e < segments.size(); ++e) {
+        feed.append(segments[e]);
+    }
+    return feed;
+}
+
+
+//private
+ManifestIndex::Text
+ManifestIndex::Reference(const uint8_t *ref) const
+{
+    Text text;
+
+    text.data = reinterpret_cast<const char *>(index_ + strings_ + Get(ref, 4));
+    text.length = (size_t)Get(ref + 4, 4);
+    return text;
+}
+
+}   // namespace Updater
+
+//end
@@ -0,0 +1,291 @@
+#ifndef AUTOMANIFESTIMAGE_H_INCLUDED
+#define AUTOMANIFESTIMAGE_H_INCLUDED
+//  $Id: AutoManifestImage.h,v 1.1 2026/10/16 21:10:44 cvsuser Exp $
+//
+//  AutoUpdater: compiled manifest image.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  The XML manifest compiled by signtool into fixed width tables, the items of each
+//  (channel, os-label) section being consecutive; text is held within a string pool and
+//  descriptions out of line, only that of the item selected being copied. The image is
+//  validated once as opened, the tables and references being bounds checked, and then
+//  read in place.
+//
+//  Image, integers little-endian:
+//
+//      header          magic       "AUMANIF1"
+//                      u32         image length, including any signature
+//                      u32         flags, FLAG_CHANNELS_OMITTED
+//                      u32         key version; 0 unsigned, otherwise Ed25519 "1.<version>"
+//                      u32         section count
+//                      u32         item count
+//                      u32         delta count
+//                      u32         string pool offset
+//                      u32         string pool length
+//                      u32         description offset
+//                      u32         description length
+//
+//      section(s)      ref         channel, empty when omitted
+//                      ref         os-label
+//                      u32         first item
+//                      u32         item count
+//
+//      item(s)         ref[22]     text, see ItemText; IT_DESCRIPTION within the descriptions
+//                      i64         published
+//                      u32         phased rollout interval
+//                      u32         document order
+//                      u32         first delta
+//                      u32         delta count
+//
+//      delta(s)        ref[8]      text, see DeltaText
+//
+//      strings, descriptions, then the signature (64) covering all prior content.
+//
+//  References (ref) are u32 offset and u32 length within the string pool, otherwise the
+//  descriptions; text is not terminated.
+//
+//  Published, images are carried within a feed; a leading index mapping each (channel,
+//  os-label) to the byte range of its segment, itself an image of the one section. Clients
+//  retrieve the index and then only those segments applicable by range request.
+//
+//  Feed:
+//
+//      header          magic       "AUMINDX1"
+//                      u32         index length, including any signature
+//                      u32         feed length
+//                      u32         flags, FLAG_CHANNELS_OMITTED
+//                      u32         key version; 0 unsigned, otherwise Ed25519 "1.<version>"
+//                      u32         entry count
+//
+//      entry(s)        ref         channel, empty when omitted
+//                      ref         os-label
+//                      u32         segment offset, from the start of the feed
+//                      u32         segment length
+//
+//      strings, then the signature (64) covering the index.
+//
+//      segment(s)      image, each signed individually; those of a channel are consecutive.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace Updater {
+
+class AutoManifest;
+
+#define MANIFEST_IMAGE_MAGIC    "AUMANIF1"
+#define MANIFEST_INDEX_MAGIC    "AUMINDX1"
+
+class ManifestImage {
+public:
+    enum {
+        HEADER_SIZE = 48,
+        REF_SIZE = 8,
+        SECTION_SIZE = (2 * REF_SIZE) + 8,
+        SIGNATURE_SIZE = 64                     // ED25519_SIGNATURE_LENGTH
+    };
+
+    enum {
+        FLAG_CHANNELS_OMITTED = 0x0001          // items without an enclosing <channel>.
+    };
+
+    enum ItemText {
+        IT_BUILD,
+        IT_OS,
+        IT_TITLE,
+        IT_LINK,
+        IT_VERSION,
+        IT_MINIMUMSYSTEMVERSION,
+        IT_CRITICALUPDATE,
+        IT_INSTALLERARGUMENTS,
+        IT_PUBDATE,
+        IT_RELEASENOTESLINK,
+        IT_URL,
+        IT_NAME,
+        IT_ATTRVERSION,
+        IT_LENGTH,
+        IT_TYPE,
+        IT_SHASIGNATURE,
+        IT_MD5SIGNATURE,
+        IT_EDSIGNATURE,
+        IT_EDKEYVERSION,
+        IT_CHUNKS,
+        IT_MIRRORS,                             // space separated.
+        IT_DESCRIPTION,                         // descriptions.
+        ITEM_TEXTS,
+        ITEM_SIZE = (ITEM_TEXTS * REF_SIZE) + 24
+    };
+
+    enum DeltaText {
+        DT_FROM,
+        DT_FROMSHASIGNATURE,
+        DT_URL,
+        DT_LENGTH,
+        DT_TYPE,
+        DT_SHASIGNATURE,
+        DT_EDSIGNATURE,
+        DT_EDKEYVERSION,
+        DELTA_TEXTS,
+        DELTA_SIZE = (DELTA_TEXTS * REF_SIZE)
+    };
+
+    typedef std::pair<std::string, std::string> SectionKey; // channel, os-label.
+
+    struct Text {                               // view within the image.
+        const char *data;
+        size_t length;
+
+        std::string str() const {
+            return std::string(data, length);
+        }
+        bool operator==(const char *rhs) const {
+            return (strlen(rhs) == length && 0 == memcmp(data, rhs, length));
+        }
+    };
+
+public:
+    ManifestImage();
+
+    static bool IsImage(const void *data, size_t length);
+
+    // Validate and open an image, held by the caller whilst in use; false when malformed.
+    bool Open(const void *data, size_t length);
+
+    // Signature; key version, zero when unsigned, and verification against the key.
+    unsigned KeyVersion() const;
+    bool Verify(const void *public_key, size_t length) const;
+
+    bool ChannelsOmitted() const;
+
+    unsigned Sections() const {
+        return sections_;
+    }
+    Text SectionChannel(unsigned section) const;
+    Text SectionOS(unsigned section) const;
+    void SectionItems(unsigned section, unsigned &first, unsigned &count) const;
+
+    unsigned Items() const {
+        return items_;
+    }
+    Text Item(unsigned item, ItemText text) const;
+    int64_t ItemPublished(unsigned item) const;
+    uint32_t ItemPhasedInterval(unsigned item) const;
+    uint32_t ItemOrder(unsigned item) const;
+
+    // Materialise an item, including its deltas.
+    void Extract(unsigned item, AutoManifest &manifest) const;
+
+    // Compile; the items of all channels in document order, as AutoManifest::LoadAll().
+    // The image is returned unsigned, its length allowing for the signature when 'keyversion'
+    // is non-zero; the signature, covering the image returned, is then to be appended.
+    static std::string Build(const std::vector<AutoManifest> &manifests, bool channels_omitted, unsigned keyversion);
+
+    // Sections, the items of each by document order; those of a channel consecutive.
+    static void Group(const std::vector<AutoManifest> &manifests, bool channels_omitted,
+                    std::vector<SectionKey> &keys, std::vector<std::vector<unsigned> > &members);
+
+    // Compile the sections given, document order retained; as Build() otherwise.
+    static std::string Build(const std::vector<AutoManifest> &manifests, const std::vector<SectionKey> &keys,
+                    const std::vector<std::vector<unsigned> > &members, bool channels_omitted, unsigned keyversion);
+
+private:
+    const uint8_t *Record(unsigned base, unsigned index, unsigned size) const {
+        return image_ + base + (index * size);
+    }
+    Text Reference(const uint8_t *ref, bool description = false) const;
+    bool Valid(const uint8_t *ref, bool description = false) const;
+
+private:
+    const uint8_t *image_;
+    size_t length_;
+    unsigned sections_, items_, deltas_;
+    unsigned items_base_, deltas_base_;         // table offsets.
+    uint32_t pool_, pool_length_;               // string pool.
+    uint32_t descriptions_, descriptions_length_;
+};
+
+
+class ManifestIndex {
+public:
+    enum {
+        HEADER_SIZE = 28,
+        ENTRY_SIZE = (2 * ManifestImage::REF_SIZE) + 8,
+        SIGNATURE_SIZE = ManifestImage::SIGNATURE_SIZE,
+        PREFIX_SIZE = 4 * 1024                  // initial range request; typically the index in full.
+    };
+
+    typedef ManifestImage::Text Text;
+
+public:
+    ManifestIndex();
+
+    static bool IsIndex(const void *data, size_t length);
+
+    // Index length, as the header; zero when not an index.
+    static size_t IndexLength(const void *data, size_t length);
+
+    // Validate and open the index, 'length' at least that of the index; false when malformed.
+    bool Open(const void *data, size_t length);
+
+    unsigned KeyVersion() const;
+    bool Verify(const void *public_key, size_t length) const;
+
+    bool ChannelsOmitted() const;
+    uint32_t FeedLength() const;
+
+    unsigned Entries() const {
+        return entries_;
+    }
+    Text EntryChannel(unsigned entry) const;
+    Text EntryOS(unsigned entry) const;
+    void EntrySegment(unsigned entry, uint32_t &offset, uint32_t &length) const;
+
+    // Compose the feed from the segments, one per section, see ManifestImage::Group(). The
+    // index signature, when 'keyversion' is non-zero, is to be written into the space
+    // reserved at its end, covering the preceding IndexLength() - SIGNATURE_SIZE bytes.
+    static std::string Build(const std::vector<ManifestImage::SectionKey> &keys,
+                    const std::vector<std::string> &segments, bool channels_omitted, unsigned keyversion);
+
+private:
+    const uint8_t *Record(unsigned entry) const {
+        return index_ + HEADER_SIZE + (entry * ENTRY_SIZE);
+    }
+    Text Reference(const uint8_t *ref) const;
+
+private:
+    const uint8_t *index_;
+    size_t length_;                             // index length.
+    unsigned entries_;
+    uint32_t strings_, strings_length_;
+};
+
+}   // namespace Updater
+
+#endif  /*AUTOMANIFESTIMAGE_H_INCLUDED*/
@@ -0,0 +1,336 @@
+//  $Id: AutoPatch.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: binary delta application.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <cassert>
+
+#include "AutoPatch.h"
+#include "AutoVerify.h"
+#include "AutoError.h"
+#include "AutoLogger.h"
+
+#include "../util/Hex.h"
+
+namespace Updater {
+
+static uint64_t
+Get64(const uint8_t *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  PatchSink
+//
+
+PatchSink::PatchSink(IDownloadSink &target, const std::string &source, ImageVerifier *verifier) :
+    target_(target), source_(source), verifier_(verifier), handle_(INVALID_HANDLE_VALUE), state_(ST_HEADER),
+        collected_(0), source_length_(0), target_length_(0), produced_(0), position_(0), add_(0), insert_(0), seek_(0),
+        window_offset_(0), window_length_(0), opened_(false)
+{
+    memset(fields_, 0, sizeof(fields_));
+}
+
+
+PatchSink::~PatchSink()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+
+void
+PatchSink::expect(const std::string &source_sha, const std::string &target_sha)
+{
+    source_sha_ = source_sha;
+    target_sha_ = target_sha;
+}
+
+
+//virtual
+bool
+PatchSink::open()
+{
+    if (INVALID_HANDLE_VALUE == handle_) {
+        handle_ = ::CreateFileA(source_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_RANDOM_ACCESS, NULL);
+        if (INVALID_HANDLE_VALUE == handle_) {
+            LOG<LOG_WARN>() << "Patch: unable to open source <" << source_ << "> : " << GetLastError() << LOG_ENDL;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//virtual
+void
+PatchSink::append(const void *data, size_t length)
+{
+    const uint8_t *cursor = static_cast<const uint8_t *>(data);
+
+    if (verifier_) {                            // patch image; throws on overrun.
+        verifier_->Update(data, length);
+    }
+
+    while (length) {
+        size_t count;
+
+        switch (state_) {
+        case ST_HEADER:
+            if (Collect(cursor, length, PATCH_HEADER_SIZE)) {
+                Header();
+            }
+            break;
+        case ST_CONTROL:
+            if (Collect(cursor, length, PATCH_CONTROL_SIZE)) {
+                Control();
+            }
+            break;
+        case ST_ADD:
+            count = (add_ < length ? (size_t)add_ : length);
+            Add(cursor, count);
+            cursor += count, length -= count;
+            if (0 == (add_ -= count)) {
+                if (insert_) {
+                    state_ = ST_INSERT;
+                } else {
+                    Next();
+                }
+            }
+            break;
+        case ST_INSERT:
+            count = (insert_ < length ? (size_t)insert_ : length);
+            Emit(cursor, count);
+            cursor += count, length -= count;
+            if (0 == (insert_ -= count)) {
+                Next();
+            }
+            break;
+        case ST_DONE:
+        default:
+            throw AppException("Patch: trailing content");
+        }
+    }
+}
+
+
+//virtual
+void
+PatchSink::close()
+{
+    if (INVALID_HANDLE_VALUE != handle_) {
+        ::CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+
+    if (opened_) {
+        target_.close();
+        opened_ = false;
+    }
+}
+
+
+//private
+//  Assemble a fixed length field; true once complete.
+//
+bool
+PatchSink::Collect(const uint8_t *&data, size_t &length, size_t required)
+{
+    assert(required <= sizeof(fields_) && collected_ < required);
+
+    size_t count = required - collected_;
+    if (count > length) count = length;
+    memcpy(fields_ + collected_, data, count);
+    data += count, length -= count;
+    if ((collected_ += count) < required) {
+        return false;
+    }
+    collected_ = 0;
+    return true;
+}
+
+
+//private
+//  Header; validated against the source image and any expectations, then the target opened.
+//
+void
+PatchSink::Header()
+{
+    if (0 != memcmp(fields_, PATCH_MAGIC, 8)) {
+        throw AppException("Patch: invalid signature");
+    }
+
+    source_length_ = Get64(fields_ + 8);
+    target_length_ = Get64(fields_ + 16);
+
+    const std::string source_sha = Hex::to_string(fields_ + 24, 20),
+        target_sha = Hex::to_string(fields_ + 44, 20);
+
+    LOG<LOG_TRACE>() << "Patch: source=" << source_length_ << "/" << source_sha
+            << ", target=" << target_length_ << "/" << target_sha << LOG_ENDL;
+
+    LARGE_INTEGER size = {0};
+    if (INVALID_HANDLE_VALUE == handle_ || ! ::GetFileSizeEx(handle_, &size) ||
+            (uint64_t)size.QuadPart != source_length_) {
+        throw AppException("Patch: source image mismatch");
+    }
+
+    if ((!source_sha_.empty() && 0 != _stricmp(source_sha_.c_str(), source_sha.c_str())) ||
+            (!target_sha_.empty() && 0 != _stricmp(target_sha_.c_str(), target_sha.c_str()))) {
+        throw AppException("Patch: image signature mismatch");
+    }
+
+    window_.resize(WINDOW_SIZE);
+    buffer_.resize(BUFFER_SIZE);
+
+    target_.set_size((size_t)target_length_);
+    if (! target_.open()) {
+        throw SysException("Patch: unable to open target image");
+    }
+    opened_ = true;
+    state_ = (target_length_ ? ST_CONTROL : ST_DONE);
+}
+
+
+//private
+void
+PatchSink::Control()
+{
+    const uint64_t remaining = target_length_ - produced_;
+
+    add_ = Get64(fields_);
+    insert_ = Get64(fields_ + 8);
+    seek_ = (int64_t)Get64(fields_ + 16);
+
+    if (add_ > remaining || insert_ > (remaining - add_)) {
+        throw AppException("Patch: corrupt control record");
+    }
+
+    if (add_) {
+        state_ = ST_ADD;
+    } else if (insert_) {
+        state_ = ST_INSERT;
+    } else {
+        Next();
+    }
+}
+
+
+//private
+//  Record complete; apply the source seek.
+//
+void
+PatchSink::Next()
+{
+    position_ += seek_;
+    state_ = (produced_ == target_length_ ? ST_DONE : ST_CONTROL);
+}
+
+
+//private
+void
+PatchSink::Add(const uint8_t *diff, size_t length)
+{
+    uint8_t *buffer = &buffer_[0];
+
+    while (length) {
+        const size_t count = (length < buffer_.size() ? length : buffer_.size());
+
+        Source(position_, buffer, count);
+        for (size_t i = 0; i < count; ++i) {
+            buffer[i] += diff[i];
+        }
+        Emit(buffer, count);
+        position_ += count;
+        diff += count, length -= count;
+    }
+}
+
+
+//private
+//  Source content, via the read-ahead window; beyond the image reads as zero.
+//
+void
+PatchSink::Source(int64_t position, uint8_t *buffer, size_t length)
+{
+    while (length) {
+        if (position < 0 || (uint64_t)position >= source_length_) {
+            uint64_t count = length;            // zero fill, to the image start or end.
+            if (position < 0 && (uint64_t)(-position) < count) {
+                count = (uint64_t)(-position);
+            }
+            memset(buffer, 0, (size_t)count);
+            buffer += count, position += count, length -= (size_t)count;
+            continue;
+        }
+
+        const uint64_t offset = (uint64_t)position;
+        if (offset < window_offset_ || offset >= (window_offset_ + window_length_)) {
+            const uint64_t available = source_length_ - offset;
+            OVERLAPPED ov = {0};
+            DWORD read = 0;
+
+            window_offset_ = offset, window_length_ = 0;
+            ov.Offset = (DWORD)(offset & 0xffffffff);
+            ov.OffsetHigh = (DWORD)(offset >> 32);
+            if (! ::ReadFile(handle_, &window_[0], (DWORD)(available < window_.size() ? available : window_.size()),
+                        &read, &ov) || 0 == read) {
+                throw SysException("Patch: reading source image");
+            }
+            window_length_ = read;
+        }
+
+        const size_t skip = (size_t)(offset - window_offset_);
+        size_t count = window_length_ - skip;
+        if (count > length) count = length;
+        memcpy(buffer, &window_[skip], count);
+        buffer += count, position += count, length -= count;
+    }
+}
+
+
+//private
+void
+PatchSink::Emit(const void *data, size_t length)
+{
+    target_.append(data, length);
+    produced_ += length;
+}
+
+}   // namespace Updater
+
+//end
@@ -0,0 +1,151 @@
+#ifndef AUTOPATCH_H_INCLUDED
+#define AUTOPATCH_H_INCLUDED
+//  $Id: AutoPatch.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: binary delta application.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+#include "AutoDownLoad.h"
+
+namespace Updater {
+
+class ImageVerifier;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Patch image
+//
+//  bsdiff style delta, uncompressed; compression, if any, is applied to the image as
+//  a whole (e.g. gzip, see Download::decompress()). Integers are little-endian.
+//
+//      header          magic       "AUPATCH1"
+//                      u64         source length
+//                      u64         target length
+//                      byte[20]    source SHA-1
+//                      byte[20]    target SHA-1
+//
+//      record(s)       u64         add length
+//                      u64         insert length
+//                      i64         source seek, applied following the record
+//                      byte[add]   target - source, bytewise; source beyond its image reads as zero
+//                      byte[insert] target
+//
+//  Records continue until the target length is reached.
+//
+
+#define PATCH_MAGIC         "AUPATCH1"
+
+enum {
+    PATCH_HEADER_SIZE = 64,
+    PATCH_CONTROL_SIZE = 24
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  PatchSink
+//
+//  Streaming patch application; the patch is presented as download content, the target
+//  image being reconstructed against the source image and passed to the target sink.
+//  Header/source/target inconsistencies and malformed records throw, concluding the
+//  transfer; the caller then falls back to the full image.
+//
+
+class PatchSink : public IDownloadSink {
+    PatchSink(const PatchSink &rhs);
+    PatchSink& operator=(const PatchSink &rhs);
+
+    enum {
+        WINDOW_SIZE = 1024 * 1024,              // source read-ahead.
+        BUFFER_SIZE = 64 * 1024                 // target assembly.
+    };
+
+public:
+    PatchSink(IDownloadSink &target, const std::string &source, ImageVerifier *verifier = NULL);
+    virtual ~PatchSink();
+
+    // Optional expected source and target SHA-1, hex; checked against the patch header.
+    void expect(const std::string &source_sha, const std::string &target_sha);
+
+    virtual void set_size(size_t size) {
+        (void) size;                            // patch length; target length given by the header.
+    }
+    virtual bool open();
+    virtual void append(const void *data, size_t length);
+    virtual bool cancelled() {
+        return target_.cancelled();
+    }
+    virtual void close();
+
+    // Whether the target has been reconstructed in full.
+    bool complete() const {
+        return (ST_DONE == state_);
+    }
+
+private:
+    enum State {
+        ST_HEADER,
+        ST_CONTROL,
+        ST_ADD,
+        ST_INSERT,
+        ST_DONE
+    };
+
+    bool Collect(const uint8_t *&data, size_t &length, size_t required);
+    void Next();
+    void Header();
+    void Control();
+    void Add(const uint8_t *diff, size_t length);
+    void Source(int64_t position, uint8_t *buffer, size_t length);
+    void Emit(const void *data, size_t length);
+
+private:
+    IDownloadSink &target_;
+    const std::string source_;                  // source image.
+    ImageVerifier *verifier_;                   // optional patch verification.
+    std::string source_sha_, target_sha_;
+    HANDLE handle_;
+    State state_;
+    uint8_t fields_[PATCH_HEADER_SIZE];         // header/control assembly.
+    size_t collected_;
+    uint64_t source_length_;
+    uint64_t target_length_;
+    uint64_t produced_;                         // target bytes emitted.
+    int64_t position_;                          // source cursor.
+    uint64_t add_, insert_;                     // current record, remaining.
+    int64_t seek_;
+    std::vector<uint8_t> window_;               // source read-ahead; offset and length.
+    uint64_t window_offset_;
+    size_t window_length_;
+    std::vector<uint8_t> buffer_;
+    bool opened_;                               // target opened.
+};
+
+}   // namespace Updater
+
+#endif  //AUTOPATCH_H_INCLUDED
@@ -0,0 +1,729 @@
+//  $Id: AutoSocket.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: download transport, Winsock HTTP/1.1 implementation.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+//  Notes:
+//      Plain Winsock, no TLS; intended for loopback/benchmark and local http mirrors.
+//      https:// resources remain the domain of the WinINet transport.
+//      Windows only, as is the download worker; a POSIX port is outstanding, see TODO.md.
+//
+
+#include <winsock2.h>                           // before <windows.h>
+#include <ws2tcpip.h>
+#if defined(_MSC_VER) || defined(__WATCOMC__)
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <cassert>
+
+#include "AutoTransport.h"
+#include "AutoDownLoad.h"
+#include "AutoConfig.h"
+#include "AutoLogger.h"
+#include "AutoError.h"
+#include "../util/Format.h"
+
+namespace Updater {
+
+namespace {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  SocketState
+//
+//  Idle keep-alive connections of a session, by host:port.
+//
+
+class SocketState : public TransportSession::State {
+    SocketState(const SocketState &rhs);
+    SocketState& operator=(const SocketState &rhs);
+
+    enum {
+        MAX_IDLE = 4
+    };
+
+    struct Idle {
+        std::string key;
+        SOCKET socket;
+    };
+
+public:
+    SocketState() : wsa_(false) {
+        WSADATA wsaData = {0};
+        wsa_ = (0 == ::WSAStartup(MAKEWORD(2, 2), &wsaData));
+    }
+
+    virtual ~SocketState() {
+        for (std::vector<Idle>::iterator it(idle_.begin()); it != idle_.end(); ++it) {
+            closesocket(it->socket);
+        }
+        if (wsa_) {
+            ::WSACleanup();
+        }
+    }
+
+    SOCKET Acquire(const std::string &key) {
+        for (std::vector<Idle>::iterator it(idle_.begin()); it != idle_.end(); ++it) {
+            if (it->key == key) {
+                const SOCKET s = it->socket;
+                idle_.erase(it);
+                return s;
+            }
+        }
+        return INVALID_SOCKET;
+    }
+
+    void Recycle(const std::string &key, SOCKET s) {
+        if (idle_.size() >= MAX_IDLE) {         // evict oldest.
+            closesocket(idle_.front().socket);
+            idle_.erase(idle_.begin());
+        }
+        Idle idle;
+        idle.key = key, idle.socket = s;
+        idle_.push_back(idle);
+    }
+
+private:
+    std::vector<Idle> idle_;
+    bool wsa_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  SocketTransport
+//
+
+class SocketTransport : public ITransport {
+    SocketTransport(const SocketTransport &rhs);
+    SocketTransport& operator=(const SocketTransport &rhs);
+
+    enum {
+        MAX_REDIRECTS = 5,
+        RECV_BUFFER = 16 * 1024
+    };
+
+    enum {
+        CHUNKED_NONE = 0, CHUNKED_HEADER, CHUNKED_BODY, CHUNKED_TRAILER
+    };
+
+public:
+    SocketTransport(TransportSession *session);
+    virtual ~SocketTransport();
+
+    virtual const char *Name() const {
+        return "socket";
+    }
+
+    virtual void Open(const TransportRequest &request, TransportResponse &response);
+    virtual size_t Read(void *buffer, size_t length);
+    virtual void Abort();
+
+private:
+    bool Request(const TransportRequest &request, const std::string &url, TransportResponse &response, std::string &location);
+    bool Connect(const std::string &host, const std::string &port, const TransportRequest &request, bool pooled);
+    void Disconnect();
+    void Recycle();
+    void Send(const std::string &data);
+    size_t Receive(void *buffer, size_t length);
+    bool Fill();
+    bool ReadLine(std::string &line);
+    size_t ReadBody(void *buffer, size_t length);
+
+    static bool CrackURL(const std::string &url, std::string &host, std::string &port, std::string &path);
+    static std::string Authority(const std::string &host, const std::string &port, bool explicit_port);
+    static bool HeaderMatch(const std::string &line, const char *name, std::string &value);
+
+private:
+    TransportSession *session_;
+    std::string key_;                           // connection host:port.
+    bool keep_alive_;                           // connection may be reused.
+    SOCKET socket_;
+    std::vector<char> rxbuffer_;                // receive buffer.
+    size_t rxcursor_, rxend_;                   // buffer cursor/end.
+    int64_t remaining_;                         // body remaining; -1 unknown/close delimited.
+    int chunked_;                               // chunked transfer state.
+    int64_t chunk_remaining_;                   // current chunk remaining.
+    volatile bool aborted_;
+    bool wsa_;
+};
+
+
+SocketTransport::SocketTransport(TransportSession *session) :
+    session_(session), keep_alive_(false), socket_(INVALID_SOCKET), rxbuffer_(RECV_BUFFER), rxcursor_(0), rxend_(0),
+        remaining_(-1), chunked_(CHUNKED_NONE), chunk_remaining_(0), aborted_(false), wsa_(false)
+{
+    WSADATA wsaData = {0};
+    wsa_ = (0 == ::WSAStartup(MAKEWORD(2, 2), &wsaData));
+    if (session_) {
+        session_->AddRef();
+    }
+}
+
+
+SocketTransport::~SocketTransport()
+{
+    Disconnect();
+    if (session_) {
+        session_->Release();
+    }
+    if (wsa_) {
+        ::WSACleanup();
+    }
+}
+
+
+void
+SocketTransport::Open(const TransportRequest &request, TransportResponse &response)
+{
+    std::string url(request.url), location;
+
+    for (unsigned redirects = 0;; ++redirects) {
+        if (Request(request, url, response, location)) {
+            return;                             // success
+        }
+
+        if (redirects >= MAX_REDIRECTS) {
+            throw AppException("Download: too many redirects");
+        }
+
+        LOG<LOG_DEBUG>() << "Download: redirect=" << location << LOG_ENDL;
+        if (0 == location.find("/")) {          // relative
+            std::string host, port, path;
+            CrackURL(url, host, port, path);
+            location = "http://" + Authority(host, port, true) + location;
+        }
+        url = location;
+        Disconnect();
+    }
+}
+
+
+//private
+//  Issue the request, returning false on redirection.
+//
+bool
+SocketTransport::Request(const TransportRequest &request, const std::string &url,
+        TransportResponse &response, std::string &location)
+{
+    std::string host, port, path;
+
+    if (! CrackURL(url, host, port, path)) {
+        if (0 == url.find("https://")) {
+            throw AppException("Invalid URL, https requires the WinINet transport");
+        }
+        throw AppException("Invalid URL");
+    }
+
+    bool reused = Connect(host, port, request, true);
+
+    // request
+    std::string rq;
+    rq  = "GET " + path + " HTTP/1.1\r\n";
+    rq += "Host: " + Authority(host, port, false) + "\r\n";
+    rq += "User-Agent: " + Config::GetAppName() + "/" + Config::GetAppVersion() + " AutoUpdate\r\n";
+    rq += "Accept: */*\r\n";
+    if (Download::NOCACHED & request.flags) {
+        rq += "Cache-Control: no-cache\r\n";
+        rq += "Pragma: no-cache\r\n";
+    }
+    rq += Transport::RequestHeaders(request);
+    if (NULL == session_) {
+        rq += "Connection: close\r\n";         // otherwise HTTP/1.1 persistent.
+    }
+    rq += "\r\n";
+
+    // status
+    std::string line, value;
+    unsigned major = 0, minor = 0, status_code = 0;
+
+    for (;;) {
+        try {
+            Send(rq);
+            if (ReadLine(line)) {
+                break;
+            }
+        } catch (...) {
+            if (! reused || aborted_) throw;
+        }
+        if (! reused) {
+            throw AppException("Download: malformed HTTP response");
+        }
+                                                // idle connection closed by peer, retry fresh.
+        LOG<LOG_DEBUG>() << "Download: stale connection <" << key_ << ">, reconnecting" << LOG_ENDL;
+        Disconnect();
+        reused = Connect(host, port, request, false);
+    }
+
+    if (session_) {
+        session_->Count(reused);
+    }
+
+    do {                                        // consume 1xx interim responses.
+        if (line.empty() && ! ReadLine(line)) {
+            throw AppException("Download: malformed HTTP response");
+        }
+        if (sscanf(line.c_str(), "HTTP/%u.%u %u", &major, &minor, &status_code) != 3) {
+            throw AppException("Download: malformed HTTP response");
+        }
+        line.clear();
+
+        if (status_code >= 100 && status_code < 200) {
+            while (ReadLine(value) && !value.empty())
+                /**/;
+        }
+    } while (status_code >= 100 && status_code < 200);
+
+    // headers
+    response = TransportResponse();
+    response.status_code = status_code;
+    remaining_ = -1, chunked_ = CHUNKED_NONE, chunk_remaining_ = 0;
+    keep_alive_ = (NULL != session_ && (major > 1 || (1 == major && minor >= 1)));
+
+    for (;;) {
+        if (! ReadLine(line)) {
+            throw AppException("Download: truncated HTTP headers");
+        }
+
+        if (line.empty()) {
+            break;                              // end-of-headers
+        }
+
+        if (HeaderMatch(line, "Content-Length", value)) {
+            remaining_ = response.content_length = _strtoi64(value.c_str(), NULL, 10);
+        } else if (HeaderMatch(line, "Transfer-Encoding", value)) {
+            if (std::string::npos != value.find("chunked")) {
+                chunked_ = CHUNKED_HEADER;
+            }
+        } else if (HeaderMatch(line, "Content-Type", value)) {
+            response.content_type = value;
+        } else if (HeaderMatch(line, "Content-Encoding", value)) {
+            response.content_encoding = value;
+        } else if (HeaderMatch(line, "Last-Modified", value)) {
+            response.last_modified = value;
+        } else if (HeaderMatch(line, "ETag", value)) {
+            response.etag = value;
+        } else if (HeaderMatch(line, "Cache-Control", value)) {
+            response.cache_control = value;
+        } else if (HeaderMatch(line, "Connection", value)) {
+            if (std::string::npos != value.find("close")) {
+                keep_alive_ = false;
+            }
+        } else if (HeaderMatch(line, "Location", value)) {
+            location = value;
+        } else if (HeaderMatch(line, "Accept-Ranges", value)) {
+            response.accept_ranges = (std::string::npos != value.find("bytes"));
+        } else if (HeaderMatch(line, "Content-Range", value)) {
+            if (206 == status_code) {
+                Transport::ContentRange(value.c_str(), response.range_offset);
+            }
+        }
+    }
+
+    if (206 == status_code) {                   // partial content implies range support.
+        response.accept_ranges = true;
+    }
+
+    if (chunked_) {                             // chunked, length is advisory only.
+        remaining_ = -1;
+        response.content_length = -1;
+    }
+
+    if (204 == status_code || 304 == status_code) {
+        chunked_ = CHUNKED_NONE;                // no content.
+        remaining_ = response.content_length = 0;
+    }
+
+    if (CHUNKED_NONE == chunked_ && 0 == remaining_) {
+        Recycle();                              // no body; connection available.
+    }
+
+    LOG<LOG_INFO>() << "Download: status_code=" << status_code
+        << ", size=" << response.content_length << (chunked_ ? " (chunked)" : "") << LOG_ENDL;
+
+    if (status_code >= 300 && status_code < 400 && status_code != 304 && !location.empty()) {
+        return false;                           // redirect
+
+    } else if (status_code >= 400) {
+        throw AppException(Updater::format("Unable to download component (HTTP %u)", status_code));
+
+    } else if (status_code < 200 || status_code >= 300) {
+        LOG<LOG_INFO>() << "Download: unexpected status_code=" << status_code << LOG_ENDL;
+    }
+    return true;
+}
+
+
+size_t
+SocketTransport::Read(void *buffer, size_t length)
+{
+    if (CHUNKED_NONE == chunked_) {
+        if (0 == remaining_) {
+            return 0;                           // EOF
+        }
+        if (remaining_ > 0 && (int64_t)length > remaining_) {
+            length = (size_t)remaining_;
+        }
+
+        const size_t count = ReadBody(buffer, length);
+        if (0 == count) {
+            if (remaining_ > 0) {
+                throw AppException("Download: connection closed prematurely");
+            }
+            return 0;
+        }
+        if (remaining_ > 0 && 0 == (remaining_ -= count)) {
+            Recycle();                          // body complete.
+        }
+        return count;
+    }
+
+    // chunked transfer-encoding
+    //
+    //      chunk-size [; ext] CRLF
+    //      data CRLF
+    //          ::
+    //      0 CRLF
+    //      [trailer] CRLF
+    //
+    for (;;) {
+        std::string line;
+
+        switch (chunked_) {
+        case CHUNKED_HEADER:
+            if (! ReadLine(line)) {
+                throw AppException("Download: truncated chunk header");
+            }
+            chunk_remaining_ = _strtoi64(line.c_str(), NULL, 16);
+            chunked_ = (chunk_remaining_ > 0 ? CHUNKED_BODY : CHUNKED_TRAILER);
+            break;
+
+        case CHUNKED_BODY: {
+                if (chunk_remaining_ > 0) {
+                    if ((int64_t)length > chunk_remaining_) {
+                        length = (size_t)chunk_remaining_;
+                    }
+                    const size_t count = ReadBody(buffer, length);
+                    if (0 == count) {
+                        throw AppException("Download: connection closed prematurely");
+                    }
+                    chunk_remaining_ -= count;
+                    return count;
+                }
+                if (! ReadLine(line) || !line.empty()) {
+                    throw AppException("Download: malformed chunk");
+                }
+                chunked_ = CHUNKED_HEADER;
+            }
+            break;
+
+        case CHUNKED_TRAILER:
+            while (ReadLine(line) && !line.empty())
+                /**/;
+            chunked_ = CHUNKED_NONE, remaining_ = 0;
+            Recycle();
+            return 0;                           // EOF
+        }
+    }
+    /*NOTREACHED*/
+}
+
+
+void
+SocketTransport::Abort()
+{
+    aborted_ = true;
+    if (INVALID_SOCKET != socket_) {
+        ::shutdown(socket_, SD_BOTH);  // unblock pending recv(); closure on destruction.
+    }
+}
+
+
+//private
+//  Establish the connection, returning true when an idle session connection was reused.
+//
+bool
+SocketTransport::Connect(const std::string &host, const std::string &port, const TransportRequest &request, bool pooled)
+{
+    struct addrinfo hints = {0}, *result = NULL, *ai;
+
+    if (aborted_) {
+        throw AppException("Download aborted");
+    }
+
+    key_ = host + ":" + port;
+    rxcursor_ = rxend_ = 0;
+    if (session_ && pooled) {
+        CriticalSection::Guard guard(session_->Lock());
+        if (SocketState *state = static_cast<SocketState *>(session_->GetState(TransportSession::SLOT_SOCKET))) {
+            if (INVALID_SOCKET != (socket_ = state->Acquire(key_))) {
+                return true;
+            }
+        }
+    }
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    if (0 != ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result)) {
+        throw AppException("Download: unable to resolve <" + host + ">");
+    }
+
+    for (ai = result; ai; ai = ai->ai_next) {
+        SOCKET s = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (INVALID_SOCKET == s) {
+            continue;
+        }
+
+        if (request.response_timeout > 0) {     // send/receive timeout.
+            DWORD tv = request.response_timeout * 1000;
+            ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof(tv));
+            ::setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tv, sizeof(tv));
+        }
+
+        if (0 == ::connect(s, ai->ai_addr, (int)ai->ai_addrlen)) {
+            int nodelay = 1;
+            ::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&nodelay, sizeof(nodelay));
+            socket_ = s;
+            break;
+        }
+        closesocket(s);
+    }
+    ::freeaddrinfo(result);
+
+    if (INVALID_SOCKET == socket_) {
+        throw AppException("Download: unable to connect <" + host + ":" + port + ">");
+    }
+    return false;
+}
+
+
+//private
+void
+SocketTransport::Disconnect()
+{
+    if (INVALID_SOCKET != socket_) {
+        closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+    rxcursor_ = rxend_ = 0;
+}
+
+
+//private
+//  Return a connection, its response fully consumed, to the session for reuse.
+//
+void
+SocketTransport::Recycle()
+{
+    if (! keep_alive_ || aborted_ || INVALID_SOCKET == socket_ || rxcursor_ != rxend_) {
+        return;                                 // not persistent, or unexpected trailing data.
+    }
+
+    CriticalSection::Guard guard(session_->Lock());
+    SocketState *state = static_cast<SocketState *>(session_->GetState(TransportSession::SLOT_SOCKET));
+    if (NULL == state) {
+        session_->SetState(TransportSession::SLOT_SOCKET, state = new SocketState);
+    }
+    state->Recycle(key_, socket_);
+    socket_ = INVALID_SOCKET;
+    keep_alive_ = false;
+}
+
+
+//private
+void
+SocketTransport::Send(const std::string &data)
+{
+    const char *cursor = data.data();
+    size_t length = data.length();
+
+    while (length) {
+        const int ret = ::send(socket_, cursor, (int)length, 0);
+        if (ret <= 0 || aborted_) {
+            throw AppException("Download: sending request");
+        }
+        cursor += ret, length -= ret;
+    }
+}
+
+
+//private
+size_t
+SocketTransport::Receive(void *buffer, size_t length)
+{
+    if (length > INT_MAX) length = INT_MAX;
+    const int ret = ::recv(socket_, (char *)buffer, (int)length, 0);
+    if (ret < 0 || aborted_) {
+        throw AppException(aborted_ ? "Download aborted" : "Download: reading connection");
+    }
+    return (size_t)ret;
+}
+
+
+//private
+bool
+SocketTransport::Fill()
+{
+    if (rxcursor_ == rxend_) {
+        rxcursor_ = rxend_ = 0;
+    } else if (rxcursor_) {                     // compact.
+        memmove(&rxbuffer_[0], &rxbuffer_[rxcursor_], rxend_ - rxcursor_);
+        rxend_ -= rxcursor_, rxcursor_ = 0;
+    }
+
+    if (rxend_ >= rxbuffer_.size()) {
+        throw AppException("Download: HTTP header line too long");
+    }
+
+    const size_t count = Receive(&rxbuffer_[rxend_], rxbuffer_.size() - rxend_);
+    rxend_ += count;
+    return (count > 0);
+}
+
+
+//private
+bool
+SocketTransport::ReadLine(std::string &line)
+{
+    line.clear();
+    for (;;) {
+        const char *start = &rxbuffer_[0] + rxcursor_, *end = &rxbuffer_[0] + rxend_;
+        for (const char *cursor = start; cursor < end; ++cursor) {
+            if ('\n' == *cursor) {
+                const char *eol = cursor;
+                if (eol > start && '\r' == eol[-1]) --eol;
+                line.assign(start, eol);
+                rxcursor_ += (cursor - start) + 1;
+                return true;
+            }
+        }
+
+        if (! Fill()) {
+            return false;                       // EOF
+        }
+    }
+}
+
+
+//private
+//  Body data; buffered remains first, otherwise direct into the caller buffer.
+//
+size_t
+SocketTransport::ReadBody(void *buffer, size_t length)
+{
+    if (rxcursor_ < rxend_) {
+        const size_t available = rxend_ - rxcursor_;
+        if (length > available) length = available;
+        memcpy(buffer, &rxbuffer_[rxcursor_], length);
+        rxcursor_ += length;
+        return length;
+    }
+    return Receive(buffer, length);
+}
+
+
+//static/private
+bool
+SocketTransport::CrackURL(const std::string &url, std::string &host, std::string &port, std::string &path)
+{
+    if (0 != url.find("http://")) {
+        return false;
+    }
+
+    const size_t start = 7,
+        slash = url.find('/', start);
+    const std::string authority =
+        url.substr(start, std::string::npos == slash ? std::string::npos : slash - start);
+
+    path = (std::string::npos == slash ? "/" : url.substr(slash));
+
+    const size_t colon = authority.rfind(':'),
+        bracket = authority.rfind(']');             // [ipv6]:port
+    if (std::string::npos != colon && (std::string::npos == bracket || colon > bracket)) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    } else {
+        host = authority;
+        port = "80";
+    }
+
+    if (host.length() > 2 && '[' == host[0]) {
+        host = host.substr(1, host.length() - 2);
+    }
+    return (!host.empty() && !port.empty());
+}
+
+
+//static/private
+//  URL authority, host[:port]; IPv6 literals bracketed.
+//
+std::string
+SocketTransport::Authority(const std::string &host, const std::string &port, bool explicit_port)
+{
+    std::string authority;
+
+    if (std::string::npos != host.find(':')) {
+        authority = "[" + host + "]";
+    } else {
+        authority = host;
+    }
+    if (explicit_port || port != "80") {
+        authority += ":" + port;
+    }
+    return authority;
+}
+
+
+//static/private
+bool
+SocketTransport::HeaderMatch(const std::string &line, const char *name, std::string &value)
+{
+    const size_t namelen = strlen(name);
+
+    if (line.length() > namelen && ':' == line[namelen] &&
+            0 == _strnicmp(line.c_str(), name, namelen)) {
+        const size_t start = line.find_first_not_of(" \t", namelen + 1);
+        value = (std::string::npos == start ? "" : line.substr(start));
+        return true;
+    }
+    return false;
+}
+
+}   //namespace anon
+
+
+//static
+ITransport *
+Transport::CreateSocket(TransportSession *session)
+{
+    return new(std::nothrow) SocketTransport(session);
+}
+
+}   // namespace Updater
+
+//end
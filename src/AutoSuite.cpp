@@ -0,0 +1,476 @@
+//  $Id: AutoSuite.cpp,v 1.1 2026/10/16 18:20:05 cvsuser Exp $
+//
+//  AutoUpdater: multiple application interface.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cassert>
+
+#include "AutoSuite.h"
+#include "AutoUpdater.h"
+
+#include "AutoConfig.h"
+#include "AutoVersion.h"
+#include "AutoError.h"
+#include "AutoLogger.h"
+#include "AutoThread.h"
+#include "AutoDownLoad.h"
+#include "AutoTransport.h"
+#include "AutoGitHub.h"
+#include "AutoEd25519.h"
+#include "AutoManifestImage.h"
+
+#include "../util/Format.h"
+#include "../util/Base64.h"
+
+using namespace Updater;
+
+namespace {
+
+struct SuiteApplication {
+    SuiteApplication() : keyversion(0), status(-1) {
+    }
+
+    std::string appname;
+    std::string version;
+    std::string hosturl;
+    std::string publickey;
+    unsigned keyversion;
+    std::string channel;
+    std::string oslabel;
+
+    int status;                                 // 1=available,0=up-to-date,-1=error,-2=channel not available.
+    std::string error;
+    AutoManifest manifest;
+};
+
+
+struct SuiteFeed {
+    std::string url;
+    std::vector<unsigned> applications;         // those naming the feed.
+};
+
+}   //namespace anon
+
+
+class AutoUpdateSuiteImpl {
+    AutoUpdateSuiteImpl(const AutoUpdateSuiteImpl &rhs);
+    AutoUpdateSuiteImpl& operator=(const AutoUpdateSuiteImpl &rhs);
+
+public:
+    AutoUpdateSuiteImpl(unsigned workers) :
+            d_workers(workers), d_session(new TransportSession), d_flags(0), d_next(0) {
+        if (d_workers < 1) {
+            d_workers = 1;
+        } else if (d_workers > AutoUpdateSuite::WORKERS_MAXIMUM) {
+            d_workers = AutoUpdateSuite::WORKERS_MAXIMUM;
+        }
+    }
+
+    ~AutoUpdateSuiteImpl() {
+        d_session->Release();
+    }
+
+    const SuiteApplication &Get(unsigned index) const {
+        if (index >= d_applications.size()) {
+            throw AppException("Suite: application index out of range");
+        }
+        return d_applications[index];
+    }
+
+    void Check(int flags);
+
+private:
+    static unsigned __cdecl workerproc(void *param);
+    void Work();
+    void Fetch(const SuiteFeed &feed);
+    void Evaluate(SuiteApplication &application, const std::string &xml);
+
+public:
+    std::vector<SuiteApplication> d_applications;
+    std::vector<SuiteFeed> d_feeds;             // distinct feeds, last Check().
+
+private:
+    unsigned            d_workers;              // pool limit.
+    TransportSession   *d_session;              // connections, shared by the workers.
+    int                 d_flags;                // download flags.
+    CriticalSection     d_lock;
+    size_t              d_next;                 // next feed, under d_lock.
+};
+
+
+//  Retrieve each distinct feed once, upon a pool of at most 'd_workers' threads.
+//
+void
+AutoUpdateSuiteImpl::Check(int flags)
+{
+    std::map<std::string, unsigned> feeds;
+
+    d_feeds.clear();
+    for (unsigned index = 0; index < d_applications.size(); ++index) {
+        SuiteApplication &application = d_applications[index];
+        std::map<std::string, unsigned>::const_iterator it = feeds.find(application.hosturl);
+
+        application.status = -1;
+        application.error.clear();
+        application.manifest = AutoManifest();
+        if (it == feeds.end()) {
+            it = feeds.insert(std::make_pair(application.hosturl, (unsigned)d_feeds.size())).first;
+            d_feeds.push_back(SuiteFeed());
+            d_feeds.back().url = application.hosturl;
+        }
+        d_feeds[it->second].applications.push_back(index);
+    }
+
+    LOG<LOG_INFO>() << "Suite: " << d_applications.size() << " applications, "
+        << d_feeds.size() << " feeds" << LOG_ENDL;
+
+    d_flags = flags | Download::CACHED | Download::COMPRESSED;
+    d_next = 0;
+
+    std::vector<Updater::Thread *> threads;
+    const size_t count = (d_feeds.size() < d_workers ? d_feeds.size() : d_workers);
+
+    for (size_t t = 1; t < count; ++t) {        // caller being the first worker.
+        Updater::Thread *thread = Updater::Thread::Begin(workerproc, this);
+        if (NULL == thread) {
+            LOG<LOG_WARN>() << "Suite: unable to create worker : " << GetLastError() << LOG_ENDL;
+            break;
+        }
+        threads.push_back(thread);
+        thread->ResumeThread();
+    }
+
+    Work();
+
+    for (std::vector<Updater::Thread *>::iterator it = threads.begin(); it != threads.end(); ++it) {
+        ::WaitForSingleObject((*it)->handle_, INFINITE);
+        delete *it;
+    }
+}
+
+
+//static
+unsigned __cdecl
+AutoUpdateSuiteImpl::workerproc(void *param)
+{
+    static_cast<AutoUpdateSuiteImpl *>(param)->Work();
+    return 0;
+}
+
+
+void
+AutoUpdateSuiteImpl::Work()
+{
+    for (;;) {
+        const SuiteFeed *feed;
+        {
+            CriticalSection::Guard lock(d_lock);
+            if (d_next >= d_feeds.size()) {
+                break;
+            }
+            feed = &d_feeds[d_next++];
+        }
+        Fetch(*feed);
+    }
+}
+
+
+//  Retrieve the manifest, then evaluate each application naming the feed; applications are
+//  owned by a single feed, hence a single worker.
+//
+void
+AutoUpdateSuiteImpl::Fetch(const SuiteFeed &feed)
+{
+    StringDownloadSink manifest;
+    std::string error;
+
+    LOG<LOG_INFO>() << "Suite: manifest source <" << feed.url << ">" << LOG_ENDL;
+
+    try {
+        Download inet(d_session);               // connection reuse across workers.
+        Updater::GitHub github;
+        std::string manifest_url;
+
+        if (feed.url.empty()) {
+            error = "Host URL not configured.";
+
+        } else if (github.IsEndpoint(feed.url)) {
+            std::string result;                 // GitHub redirection
+
+            if (! github.GetLatestRelease(feed.url, inet, d_flags, result)) {
+                error = (result.empty() ? "GitHub manifest not available" : result);
+            } else if (result.empty()) {
+                error = "GitHub manifest not available";
+            } else {
+                manifest_url = result;
+            }
+
+        } else {
+            manifest_url = feed.url;
+        }
+
+        if (! manifest_url.empty()) {
+            if (! inet.get(manifest_url, manifest, d_flags) || ! inet.completion(false)) {
+                error = "Unable to download manifest";
+            }
+        }
+
+    } catch (const std::exception &e) {
+        LOG<LOG_ERROR>() << "Suite: exception : " << e.what() << LOG_ENDL;
+        error = e.what();
+
+    } catch (...) {
+        LOG<LOG_ERROR>() << "Suite: unhandled exception" << LOG_ENDL;
+        error = "unhandled exception";
+    }
+
+    for (std::vector<unsigned>::const_iterator it = feed.applications.begin(); it != feed.applications.end(); ++it) {
+        SuiteApplication &application = d_applications[*it];
+
+        if (! error.empty()) {
+            application.error = error;
+            application.status = -1;
+            continue;
+        }
+
+        try {
+            Evaluate(application, manifest.data());
+        } catch (const std::exception &e) {
+            application.error = e.what();
+            application.status = -1;
+        }
+    }
+}
+
+
+//  As AutoUpdater::IsAvailable(false), against the application descriptor; phased rollout
+//  applies, by the group of the named application.
+//
+void
+AutoUpdateSuiteImpl::Evaluate(SuiteApplication &application, const std::string &xml)
+{
+    AutoManifest &manifest = application.manifest;
+
+    if (application.keyversion &&               // compiled form, signature required.
+            (ManifestImage::IsImage(xml.data(), xml.size()) || ManifestIndex::IsIndex(xml.data(), xml.size()))) {
+        const std::string key =
+            Updater::Base64::decode_to_string(application.publickey.c_str(), application.publickey.size());
+        bool valid = false;
+
+        if (ManifestImage::IsImage(xml.data(), xml.size())) {
+            ManifestImage image;
+
+            valid = (image.Open(xml.data(), xml.size()) && image.KeyVersion() == application.keyversion &&
+                        image.Verify(key.data(), key.size()));
+
+        } else {                                // feed; the index and every segment.
+            ManifestIndex index;
+
+            valid = (index.Open(xml.data(), xml.size()) && index.KeyVersion() == application.keyversion &&
+                        index.Verify(key.data(), key.size()));
+            for (unsigned entry = 0; valid && entry < index.Entries(); ++entry) {
+                ManifestImage image;
+                uint32_t offset = 0, length = 0;
+
+                index.EntrySegment(entry, offset, length);
+                valid = (offset + (uint64_t)length <= xml.size() && image.Open(xml.data() + offset, length) &&
+                            image.KeyVersion() == application.keyversion && image.Verify(key.data(), key.size()));
+            }
+        }
+
+        if (! valid) {
+            application.error = "Manifest image signature invalid, contact maintainer.";
+            return;
+        }
+    }
+
+    if (! manifest.Load(xml, application.channel,
+                (application.oslabel.empty() ? Config::GetOSLabel() : application.oslabel))) {
+        application.error = "Channel/label not available";
+        application.status = -2;                // channel not available.
+        return;
+    }
+
+    if (application.keyversion) {               // signature required.
+        unsigned type = 0, version = 0;
+
+        if (manifest.attributeEDSignature.empty()) {
+            application.error = "Manifest missing edSignature, contact maintainer.";
+            return;
+
+        } else if (2 != sscanf(manifest.attributeEDKeyVersion.c_str(), "%u.%u", &type, &version) ||
+                        1 != type || version != application.keyversion) {
+            application.error = Updater::format("Manifest: unknown edKeyVersion <%s>, contact maintainer.",
+                                    manifest.attributeEDKeyVersion.c_str());
+            return;
+        }
+    }
+
+    LOG<LOG_INFO>() << "Suite: " << application.appname << ", current version=" << application.version
+        << ", manifest=" << manifest.attributeVersion << LOG_ENDL;
+
+    if (AutoVersion::Compare(application.version, manifest.attributeVersion) >= 0) {
+        application.status = 0;                 // same or newer version is already installed.
+
+    } else if (manifest.phasedRolloutInterval > 0 &&
+                    manifest.IsPhased(AutoUpdater::PhasedGroup(application.appname), time(NULL)) &&
+                    ! manifest.IsCriticalUpdate(application.version)) {
+        LOG<LOG_INFO>() << "Suite: " << application.appname << ", rollout group not yet open" << LOG_ENDL;
+        application.status = 0;                 // rollout group not yet open; as a non-interactive check.
+
+    } else {
+        application.status = 1;                 // update available.
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  AutoUpdateSuite
+//
+
+AutoUpdateSuite::AutoUpdateSuite(unsigned workers) :
+    d_impl(new AutoUpdateSuiteImpl(workers))
+{
+}
+
+
+AutoUpdateSuite::~AutoUpdateSuite()
+{
+    delete d_impl;
+}
+
+
+unsigned
+AutoUpdateSuite::Add(const Application &descriptor)
+{
+    SuiteApplication application;
+
+    if (NULL == descriptor.appname || NULL == descriptor.version || NULL == descriptor.hosturl) {
+        throw AppException("Suite: application name, version and host URL required");
+    }
+
+    application.appname = descriptor.appname;
+    application.version = descriptor.version;
+    application.hosturl = descriptor.hosturl;
+    if (descriptor.publickey && descriptor.publickey[0]) {
+        const std::string key =                 // as Config::SetPublicKey().
+            Updater::Base64::decode_to_string(descriptor.publickey, strlen(descriptor.publickey));
+
+        if (key.length() != ED25519_PUBLIC_LENGTH) {
+            throw SysException("error decoding public-key");
+        } else if (0 == descriptor.keyversion) {
+            throw SysException("Ed25519: version incorrect");
+        }
+        application.publickey = descriptor.publickey;
+        application.keyversion = descriptor.keyversion;
+    }
+    if (descriptor.channel) application.channel = descriptor.channel;
+    if (descriptor.oslabel) application.oslabel = descriptor.oslabel;
+    application.error = "Not checked";
+
+    d_impl->d_applications.push_back(application);
+    return (unsigned)(d_impl->d_applications.size() - 1);
+}
+
+
+unsigned
+AutoUpdateSuite::Count() const
+{
+    return (unsigned)d_impl->d_applications.size();
+}
+
+
+int
+AutoUpdateSuite::Check()
+{
+    int available = 0;
+
+    d_impl->Check(DownloadFlags());
+    for (unsigned index = 0; index < d_impl->d_applications.size(); ++index) {
+        const SuiteApplication &application = d_impl->d_applications[index];
+
+        if (1 == application.status) {
+            ++available;
+        } else if (application.status < 0) {
+            LOG<LOG_WARN>() << "Suite: " << application.appname << " : " << application.error << LOG_ENDL;
+        }
+    }
+    return available;
+}
+
+
+int
+AutoUpdateSuite::Status(unsigned index) const
+{
+    return d_impl->Get(index).status;
+}
+
+
+const char *
+AutoUpdateSuite::LastError(unsigned index) const
+{
+    return d_impl->Get(index).error.c_str();
+}
+
+
+const Updater::AutoManifest &
+AutoUpdateSuite::Manifest(unsigned index) const
+{
+    return d_impl->Get(index).manifest;
+}
+
+
+void
+AutoUpdateSuite::Configure(unsigned index, AutoUpdater &updater) const
+{
+    const SuiteApplication &application = d_impl->Get(index);
+
+    updater.AppName(application.appname.c_str());
+    updater.AppVersion(application.version.c_str());
+    updater.HostURL(application.hosturl.c_str());
+    if (! application.publickey.empty()) {
+        updater.PublicKey(application.publickey.c_str(), application.keyversion);
+    }
+    if (! application.channel.empty()) {
+        Config::SetChannel(application.channel.c_str());
+    }
+    if (! application.oslabel.empty()) {
+        Config::SetOSLabel(application.oslabel.c_str());
+    }
+}
+
+
+unsigned
+AutoUpdateSuite::Feeds() const
+{
+    return (unsigned)d_impl->d_feeds.size();
+}
+
+//end
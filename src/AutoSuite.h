@@ -0,0 +1,96 @@
+#ifndef AUTOSUITE_H_INCLUDED
+#define AUTOSUITE_H_INCLUDED
+//  $Id: AutoSuite.h,v 1.1 2026/10/16 18:20:05 cvsuser Exp $
+//
+//  AutoUpdater: multiple application interface.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Update checks for a suite of applications from the one process. Application state is
+//  held per descriptor rather than within the (process wide) configuration; manifests are
+//  retrieved concurrently by a bounded pool of workers, each distinct feed once, and then
+//  evaluated against every application naming it.
+//
+//  Installation remains that of AutoUpdater, one application at a time; see Configure().
+//
+
+#include "common.h"
+
+#include "AutoManifest.h"
+
+#include  "AutoLinkage.h"
+
+class AutoUpdater;
+
+class LIBAUTOUPDATER_LINKAGE AutoUpdateSuite {
+    AutoUpdateSuite(const AutoUpdateSuite &rhs);
+    AutoUpdateSuite& operator=(const AutoUpdateSuite &rhs);
+
+public:
+    struct Application {                        // application descriptor.
+        const char *appname;                    // application name; registry key.
+        const char *version;                    // application version; x.x.x.x
+        const char *hosturl;                    // manifest URL.
+        const char *publickey;                  // Ed25519 public key, base64; optional.
+        unsigned keyversion;                    // key version.
+        const char *channel;                    // channel; optional, default release.
+        const char *oslabel;                    // OS label; optional, default that configured.
+    };
+
+    enum {
+        WORKERS_DEFAULT = 4,
+        WORKERS_MAXIMUM = 16
+    };
+
+public:
+    AutoUpdateSuite(unsigned workers = WORKERS_DEFAULT);
+    virtual ~AutoUpdateSuite();
+
+    // Configuration
+    unsigned            Add(const Application &application);
+    unsigned            Count() const;
+
+    // Check all applications; returns the number with an update available.
+    int                 Check();
+
+    // Results, by the index returned from Add(); following Check().
+    int                 Status(unsigned index) const;
+    const char *        LastError(unsigned index) const;
+    const Updater::AutoManifest &Manifest(unsigned index) const;
+
+    // Apply the application descriptor to an updater, for installation.
+    void                Configure(unsigned index, AutoUpdater &updater) const;
+
+    // Distinct feeds retrieved by the last Check().
+    unsigned            Feeds() const;
+
+private:
+    virtual int         DownloadFlags()
+            { return 0; }
+
+private:
+    friend class AutoUpdateSuiteImpl;
+    class AutoUpdateSuiteImpl *d_impl;          // implementation.
+};
+
+#endif  /*AUTOSUITE_H_INCLUDED*/
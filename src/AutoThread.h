@@ -71,6 +71,8 @@ public:
         { ::EnterCriticalSection(&m_cs); }
     void Leave()
         { ::LeaveCriticalSection(&m_cs); }
+    bool TryEnter()
+        { return (FALSE != ::TryEnterCriticalSection(&m_cs)); }
 
 private:
     CRITICAL_SECTION m_cs;
@@ -102,6 +104,10 @@ public:
         return (INVALID_HANDLE_VALUE != event_);
     }
 
+    HANDLE Handle() const {
+        return (INVALID_HANDLE_VALUE != event_ ? event_ : NULL);
+    }
+
     int Wait(unsigned milliseconds = 0) {
         if (INVALID_HANDLE_VALUE != event_) {
             if (::WaitForMultipleObjects(1, &event_, FALSE, milliseconds) == WAIT_OBJECT_0) {
@@ -136,6 +142,42 @@ private:
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////////////
+//  AtomicCounter
+//
+//  64-bit counter, updated and read without locking; torn reads are retried.
+//
+
+class AtomicCounter {
+    AtomicCounter(const AtomicCounter &rsh);
+    AtomicCounter& operator=(const AtomicCounter &rsh);
+public:
+    AtomicCounter(int64_t value = 0) : value_(value) { }
+
+    int64_t Add(int64_t delta) {
+        LONGLONG prior;
+        do {
+            prior = value_;
+        } while (::InterlockedCompareExchange64(&value_, prior + delta, prior) != prior);
+        return prior + delta;
+    }
+
+    void Set(int64_t value) {
+        LONGLONG prior;
+        do {
+            prior = value_;
+        } while (::InterlockedCompareExchange64(&value_, value, prior) != prior);
+    }
+
+    int64_t Get() const {
+        return ::InterlockedCompareExchange64(const_cast<volatile LONGLONG *>(&value_), 0, 0);
+    }
+
+private:
+    volatile LONGLONG value_;
+};
+
+
 /////////////////////////////////////////////////////////////////////////////////////////
 //  Thread
 //
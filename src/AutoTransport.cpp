@@ -0,0 +1,412 @@
+//  $Id: AutoTransport.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: download transport, local resources.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include "common.h"
+
+#include <string>
+#include <cassert>
+
+#include "AutoTransport.h"
+#include "AutoDownLoad.h"
+#include "AutoLogger.h"
+#include "AutoError.h"
+#include "../util/Format.h"
+
+namespace Updater {
+
+namespace {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  LocalTransport
+//
+//  allows local paths, in two forms:
+//      \\.\C:\appname.manifest
+//      file:///X:/appname.manifest
+//
+
+class LocalTransport : public ITransport {
+    LocalTransport(const LocalTransport &rhs);
+    LocalTransport& operator=(const LocalTransport &rhs);
+
+public:
+    LocalTransport() : handle_(INVALID_HANDLE_VALUE), mapping_(NULL), view_(NULL), length_(-1), remaining_(-1), aborted_(false) {
+    }
+
+    virtual ~LocalTransport() {
+        if (view_) {
+            ::UnmapViewOfFile(view_);
+        }
+        if (mapping_) {
+            ::CloseHandle(mapping_);
+        }
+        if (INVALID_HANDLE_VALUE != handle_) {
+            ::CloseHandle(handle_);
+        }
+    }
+
+    virtual const char *Name() const {
+        return "local";
+    }
+
+    virtual void Open(const TransportRequest &request, TransportResponse &response) {
+        const char *source = request.url.c_str();
+        int64_t length = -1;
+
+        filename_ = ('f' == *source ? source + 8 : source);
+        LOG<LOG_DEBUG>() << "Download: local file=" << filename_ << LOG_ENDL;
+
+        handle_ = ::CreateFileA(filename_.c_str(), GENERIC_READ,
+                        FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (INVALID_HANDLE_VALUE == handle_) {
+            std::string message;
+            message = "opening <", message += source, message += ">";
+            throw SysException(message);
+        }
+
+        LARGE_INTEGER size = {0};
+        if (::GetFileSizeEx(handle_, &size)) {
+            length = size.QuadPart;
+        }
+        response.status_code = 200;
+        response.content_length = length_ = length;
+        response.accept_ranges = true;
+
+        if (request.range_offset >= 0 && length >= 0) {
+            LARGE_INTEGER offset;               // partial content.
+            int64_t remaining = length - request.range_offset;
+
+            if (remaining < 0) remaining = 0;
+            if (request.range_length >= 0 && request.range_length < remaining) {
+                remaining = request.range_length;
+            }
+
+            offset.QuadPart = request.range_offset;
+            if (! ::SetFilePointerEx(handle_, offset, NULL, FILE_BEGIN)) {
+                throw SysException("seeking <" + filename_ + ">");
+            }
+            response.status_code = 206;
+            response.content_length = remaining;
+            response.range_offset = request.range_offset;
+            remaining_ = remaining;
+        }
+    }
+
+    virtual size_t Read(void *buffer, size_t length) {
+        DWORD read = 0;
+
+        if (aborted_) {
+            throw AppException("Download aborted");
+        }
+
+        if (remaining_ >= 0) {                  // range limit.
+            if (0 == remaining_) {
+                return 0;
+            }
+            if ((int64_t)length > remaining_) {
+                length = (size_t)remaining_;
+            }
+        }
+
+        if (! ::ReadFile(handle_, buffer, (DWORD)length, &read, NULL)) {
+            std::string message;
+            message = "reading <", message += filename_, message += ">";
+            throw SysException(message);
+        }
+        if (remaining_ > 0) {
+            remaining_ -= read;
+        }
+        return read;
+    }
+
+    virtual void Abort() {
+        aborted_ = true;                        // reads are local, test on next segment.
+    }
+
+    // Whole content mapping; unavailable for ranges, empty or address-space exceeding images.
+    virtual const void *View(size_t &length) {
+        length = 0;
+        if (NULL == view_) {
+            if (remaining_ >= 0 || length_ <= 0 || (uint64_t)length_ > (uint64_t)(((size_t)-1) / 4)) {
+                return NULL;
+            }
+
+            if (NULL == (mapping_ = ::CreateFileMappingA(handle_, NULL, PAGE_READONLY, 0, 0, NULL))) {
+                LOG<LOG_DEBUG>() << "Download: unable to map <" << filename_ << "> : " << GetLastError() << LOG_ENDL;
+                return NULL;
+            }
+
+            if (NULL == (view_ = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0))) {
+                LOG<LOG_DEBUG>() << "Download: unable to view <" << filename_ << "> : " << GetLastError() << LOG_ENDL;
+                ::CloseHandle(mapping_), mapping_ = NULL;
+                return NULL;
+            }
+        }
+        length = (size_t)length_;
+        return view_;
+    }
+
+    virtual const char *Path() const {
+        return (remaining_ >= 0 ? NULL : filename_.c_str());
+    }
+
+private:
+    std::string filename_;
+    HANDLE handle_;
+    HANDLE mapping_;                            // file mapping, if any.
+    void *view_;                                // mapped view.
+    int64_t length_;                            // content length, -1 unknown.
+    int64_t remaining_;                         // range remaining, -1 unlimited.
+    volatile bool aborted_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  DecodeTransport
+//
+//  Streaming decompression stage; the source is opened by the caller, reads are
+//  drawn through the Inflater. Zero-copy access is withdrawn, the content differs.
+//
+
+class DecodeTransport : public ITransport, private Inflater::ISource {
+    DecodeTransport(const DecodeTransport &rhs);
+    DecodeTransport& operator=(const DecodeTransport &rhs);
+
+public:
+    DecodeTransport(ITransport &source, Inflater::Format format) : source_(source), inflater_(*this, format) {
+    }
+
+    virtual const char *Name() const {
+        return "decoder";
+    }
+
+    virtual void Open(const TransportRequest &/*request*/, TransportResponse &/*response*/) {
+        assert(false);                          // source already open.
+    }
+
+    virtual size_t Read(void *buffer, size_t length) {
+        return inflater_.Read(buffer, length);
+    }
+
+    virtual void Abort() {
+        source_.Abort();
+    }
+
+private:
+    virtual size_t Fill(void *buffer, size_t length) {
+        return source_.Read(buffer, length);
+    }
+
+private:
+    ITransport &source_;
+    Inflater inflater_;
+};
+
+}   //namespace anon
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  TransportSession
+//
+
+TransportSession::TransportSession()
+    : references_(1), requests_(0), reused_(0)
+{
+    for (unsigned slot = 0; slot < SLOT_MAX; ++slot) {
+        states_[slot] = NULL;
+    }
+}
+
+
+TransportSession::~TransportSession()
+{
+    if (requests_) {
+        LOG<LOG_INFO>() << "Transport session: requests " << (unsigned)requests_
+            << ", reused " << (unsigned)reused_ << " (" << ((unsigned)reused_ * 100) / (unsigned)requests_ << "%)" << LOG_ENDL;
+    }
+
+    for (unsigned slot = 0; slot < SLOT_MAX; ++slot) {
+        delete states_[slot];
+    }
+}
+
+
+void
+TransportSession::AddRef()
+{
+    ::InterlockedIncrement(&references_);
+}
+
+
+void
+TransportSession::Release()
+{
+    if (0 == ::InterlockedDecrement(&references_)) {
+        delete this;
+    }
+}
+
+
+TransportSession::State *
+TransportSession::GetState(Slot slot) const
+{
+    assert(slot < SLOT_MAX);
+    return states_[slot];
+}
+
+
+void
+TransportSession::SetState(Slot slot, State *state)
+{
+    assert(slot < SLOT_MAX);
+    if (states_[slot] != state) {
+        delete states_[slot];
+        states_[slot] = state;
+    }
+}
+
+
+void
+TransportSession::Count(bool reused)
+{
+    ::InterlockedIncrement(&requests_);
+    if (reused) {
+        ::InterlockedIncrement(&reused_);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Transport
+//
+
+//static
+bool
+Transport::IsLocal(const std::string &url)
+{
+    return (0 == url.find("\\\\.\\") || 0 == url.find("file:///"));
+}
+
+
+//static
+ITransport *
+Transport::Create(const std::string &url, unsigned flags, TransportSession *session)
+{
+    ITransport *transport;
+
+    if (IsLocal(url)) {
+        transport = CreateLocal();
+    } else if (Download::SOCKETS & flags) {
+        transport = CreateSocket(session);
+    } else {
+        transport = CreateWinINet(session);
+    }
+
+    if (NULL == transport) {
+        throw AppException("Unable to allocate download transport");
+    }
+    return transport;
+}
+
+
+//static
+std::string
+Transport::RequestHeaders(const TransportRequest &request)
+{
+    std::string headers;
+
+    if (request.range_offset >= 0) {
+        if (request.range_length > 0) {
+            headers = Updater::format("Range: bytes=%llu-%llu\r\n", (unsigned long long)request.range_offset,
+                            (unsigned long long)(request.range_offset + request.range_length - 1));
+        } else {
+            headers = Updater::format("Range: bytes=%llu-\r\n", (unsigned long long)request.range_offset);
+        }
+
+        if (! request.if_range.empty()) {
+            headers += "If-Range: " + request.if_range + "\r\n";
+        }
+    }
+
+    if ((Download::COMPRESSED & request.flags) && request.range_offset < 0) {
+        headers += "Accept-Encoding: gzip, deflate\r\n";
+    }                                           // ranges address the identity encoding.
+
+    if (! request.if_none_match.empty()) {
+        headers += "If-None-Match: " + request.if_none_match + "\r\n";
+    }
+    if (! request.if_modified_since.empty()) {
+        headers += "If-Modified-Since: " + request.if_modified_since + "\r\n";
+    }
+    return headers;
+}
+
+
+//static
+std::string
+Transport::Validator(const TransportResponse &response)
+{
+    if (! response.etag.empty() && 0 != response.etag.find("W/")) {
+        return response.etag;                   // strong entity-tag; weak tags are not permitted.
+    }
+    return response.last_modified;
+}
+
+
+//static
+bool
+Transport::ContentRange(const char *value, int64_t &offset)
+{
+    unsigned long long first = 0, last = 0;
+
+    while (' ' == *value) ++value;
+    if (0 == strncmp(value, "bytes", 5)) {
+        if (2 == sscanf(value + 5, " %llu-%llu", &first, &last) && last >= first) {
+            offset = (int64_t)first;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//static
+ITransport *
+Transport::CreateDecoder(ITransport &source, Inflater::Format format)
+{
+    return new(std::nothrow) DecodeTransport(source, format);
+}
+
+
+//static
+ITransport *
+Transport::CreateLocal()
+{
+    return new(std::nothrow) LocalTransport();
+}
+
+}   // namespace Updater
+
+//end
@@ -0,0 +1,201 @@
+#ifndef AUTOTRANSPORT_H_INCLUDED
+#define AUTOTRANSPORT_H_INCLUDED
+//  $Id: AutoTransport.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: download transport interface.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include "common.h"
+
+#include <string>
+
+#include "AutoThread.h"
+#include "AutoInflate.h"
+
+namespace Updater {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  TransportSession
+//
+//  Connection state shared by the requests of a Download (or an update check), permitting
+//  keep-alive connection reuse; reference counted, as requests may outlive their owner.
+//
+
+class TransportSession {
+    TransportSession(const TransportSession &rhs);
+    TransportSession& operator=(const TransportSession &rhs);
+
+public:
+    // Transport specific state.
+    class State {
+    public:
+        virtual ~State() {}
+    };
+
+    enum Slot {
+        SLOT_WININET,
+        SLOT_SOCKET,
+        SLOT_MAX
+    };
+
+public:
+    TransportSession();
+
+    void                AddRef();
+    void                Release();
+
+    // State access; caller holds Lock(), ownership is transferred on Set.
+    CriticalSection &   Lock() {
+        return lock_;
+    }
+    State *             GetState(Slot slot) const;
+    void                SetState(Slot slot, State *state);
+
+    // Statistics; requests issued and those served by an existing connection.
+    void                Count(bool reused);
+    unsigned            Requests() const {
+        return (unsigned)requests_;
+    }
+    unsigned            Reused() const {
+        return (unsigned)reused_;
+    }
+
+private:
+    ~TransportSession();
+
+private:
+    CriticalSection lock_;
+    State *states_[SLOT_MAX];
+    volatile LONG references_;
+    volatile LONG requests_;
+    volatile LONG reused_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Transport request/response
+//
+
+struct TransportRequest {
+    TransportRequest(const std::string &url__, unsigned flags__) :
+        url(url__), flags(flags__), connect_timeout(-1), response_timeout(-1), enable_login(false),
+            range_offset(-1), range_length(-1) {
+    }
+
+    const std::string url;                      // source url.
+    const unsigned flags;                       // Download::Flags.
+    int connect_timeout;                        // connect timeout, in seconds; -1=default, 0=infinite.
+    int response_timeout;                       // send/receive timeout, in seconds; -1=default, 0=infinite.
+    bool enable_login;                          // prompt for proxy/site credentials.
+    int64_t range_offset;                       // byte range start, -1 for the whole resource.
+    int64_t range_length;                       // byte range length, -1 to end-of-resource.
+    std::string if_range;                       // range validator (ETag/Last-Modified); optional.
+    std::string if_none_match;                  // conditional, cached entity tag; optional.
+    std::string if_modified_since;              // conditional, cached last-modified; optional.
+};
+
+
+struct TransportResponse {
+    TransportResponse() :
+        status_code(0), content_length(-1), accept_ranges(false), range_offset(-1) {
+    }
+
+    unsigned status_code;                       // HTTP status; 200 for local resources.
+    int64_t content_length;                     // content length, -1 if unknown.
+    std::string content_type;                   // content type; optional.
+    std::string content_encoding;               // content encoding, as reported; optional.
+    std::string last_modified;                  // last-modified, HTTP-date as reported; optional.
+    std::string etag;                           // entity tag, as reported; optional.
+    std::string cache_control;                  // cache-control directives, as reported; optional.
+    bool accept_ranges;                         // "Accept-Ranges: bytes" advertised.
+    int64_t range_offset;                       // partial content (206) start, otherwise -1.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ITransport
+//
+//  A single request, driven by the download worker:
+//
+//      Open()          Issue the request; throws on error.
+//      Read()          Next body segment, 0 on end-of-content; throws on error.
+//      Abort()         Asynchronous cancel, from any thread; pending Read() calls shall fail.
+//
+//  Optionally, local resources offer zero-copy access, in place of Read():
+//
+//      View()          Memory mapped image of the content, otherwise NULL.
+//      Path()          Local filename, permitting kernel-side copies; otherwise NULL.
+//
+
+class ITransport {
+public:
+    virtual ~ITransport() {}
+
+    virtual const char *Name() const = 0;
+    virtual void        Open(const TransportRequest &request, TransportResponse &response) = 0;
+    virtual size_t      Read(void *buffer, size_t length) = 0;
+    virtual void        Abort() = 0;
+
+    virtual const void *View(size_t &length) {
+        length = 0;
+        return NULL;
+    }
+    virtual const char *Path() const {
+        return NULL;
+    }
+};
+
+
+class Transport {
+public:
+    // Local resource test; "\\.\" or "file:///" forms.
+    static bool         IsLocal(const std::string &url);
+
+    // Select the transport implementation suitable for the given url and Download::Flags.
+    static ITransport * Create(const std::string &url, unsigned flags, TransportSession *session = NULL);
+
+    // Range, conditional and Accept-Encoding request headers, CRLF terminated; empty if none.
+    static std::string  RequestHeaders(const TransportRequest &request);
+
+    // Entity validator suitable for "If-Range"; a strong ETag otherwise Last-Modified.
+    static std::string  Validator(const TransportResponse &response);
+
+    // "Content-Range: bytes <first>-<last>/<length>" response header decode.
+    static bool         ContentRange(const char *value, int64_t &offset);
+
+    // Streaming decoder stage over 'source', which must outlive the result.
+    static ITransport * CreateDecoder(ITransport &source, Inflater::Format format);
+
+    // Implementations.
+    static ITransport * CreateLocal();
+    static ITransport * CreateWinINet(TransportSession *session = NULL);
+    static ITransport * CreateSocket(TransportSession *session = NULL);
+
+private:
+    Transport();                                // cannot be instantiated
+};
+
+}   // namespace Updater
+
+#endif  //AUTOTRANSPORT_H_INCLUDED
@@ -65,6 +65,8 @@
 #include <cassert>
 #include <memory>
 #include <vector>
+#include <map>
+#include <algorithm>
 
 #include "AutoUpdater.h"
 #include "IAutoUpdaterUI.h"
@@ -78,7 +80,13 @@
 #include "AutoLogger.h"
 #include "AutoThread.h"
 #include "AutoDownLoad.h"
+#include "AutoTransport.h"
 #include "AutoGitHub.h"
+#include "AutoVerify.h"
+#include "AutoPatch.h"
+#include "AutoChunks.h"
+#include "AutoCache.h"
+#include "AutoManifestImage.h"
 
 #include "../ed25519/src/ed25519.h"
 #include "../util/Format.h"
@@ -111,6 +119,17 @@ ConfigKeys[] = {
 #define KEY_SKIPVERSION     "SkipVersion"
 #define KEY_SKIPTIME        "SkipTime"
 #define KEY_SKIPINTERVAL    "SkipInterval"
+#define KEY_DOWNLOADSEGMENTS "DownloadSegments"  // concurrent ranges; 0/1 disables (default).
+#define KEY_CACHESTALE      "CacheStale"        // background checks, serve stale whilst revalidating.
+#define KEY_PREDOWNLOAD     "PreDownload"       // speculative installer download whilst prompting.
+#define KEY_DOWNLOADRATE    "DownloadRate"      // background bandwidth limit, bytes/second; 0 unlimited.
+#define KEY_DOWNLOADBURST   "DownloadBurst"     // background burst allowance, bytes; default one second.
+#define KEY_INSTALLERCACHE  "InstallerCache"    // installer cache capacity, MB; 0 disables.
+#define KEY_MIRRORLATENCY   "MirrorLatency"     // enclosure source latency, "<origin>=<ms> ..."; maintained.
+#define KEY_WRITEBEHIND     "WriteBehind"       // installer write-behind buffers; 0 synchronous.
+#define KEY_WRITEFLUSH      "WriteFlush"        // installer flush; 0 lazy (default), 1 on close, 2 each buffer.
+#define KEY_INSTALLID       "InstallID"         // installation identifier, phased rollout group; maintained.
+#define KEY_IMAGEABSENT     "ImageAbsent"       // compiled manifest last found absent, time; maintained.
 
     KEY_AUTOINTERVAL,
     KEY_AUTOCHECK,
@@ -127,6 +146,209 @@ ConfigKeys[] = {
 
 using namespace Updater;
 
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ReleaseNotesLoader
+//
+//  Background release notes retrieval; reference counted, as the transfer may outlive
+//  the updater instance.
+//
+
+class ReleaseNotesLoader : public IDownloadCompletion {
+    ReleaseNotesLoader(const ReleaseNotesLoader &rsh);
+    ReleaseNotesLoader& operator=(const ReleaseNotesLoader &rsh);
+
+public:
+    static ReleaseNotesLoader *Start(const std::string &url, TransportSession *session, int flags) {
+        ReleaseNotesLoader *loader = new ReleaseNotesLoader(session);
+
+        LOG<LOG_INFO>() << "Release notes: loading <" << url << ">" << LOG_ENDL;
+        loader->references_ = 2;                // owner and transfer.
+        if (! loader->inet_.get_async(url, loader->sink_, *loader, flags)) {
+            loader->references_ = 1;
+            loader->status_ = AutoUpdater::NotesFailed;
+        }
+        return loader;
+    }
+
+    AutoUpdater::ReleaseNotesStatus Status(std::string &content) {
+        CriticalSection::Guard guard(lock_);
+        if (AutoUpdater::NotesAvailable == status_) {
+            content = content_;
+        }
+        return status_;
+    }
+
+    void Release() {
+        unsigned t_references;
+        {   CriticalSection::Guard guard(lock_);
+            assert(references_);
+            t_references = --references_;
+        }
+        if (0 == t_references) {
+            delete this;
+        }
+    }
+
+private:
+    ReleaseNotesLoader(TransportSession *session) :
+        inet_(session), sink_(&body_), references_(1), status_(AutoUpdater::NotesPending) {
+    }
+
+    ~ReleaseNotesLoader() {
+    }
+
+    // Download worker; the transfer has concluded.
+    virtual void completed(bool success) {
+        const AutoUpdater::ReleaseNotesStatus status =
+            (success ? AutoUpdater::NotesAvailable : AutoUpdater::NotesFailed);
+
+        LOG<LOG_INFO>() << "Release notes: " << (AutoUpdater::NotesAvailable == status ? "loaded" : "unavailable") << LOG_ENDL;
+        {   CriticalSection::Guard guard(lock_);
+            if (success) {
+                content_.swap(body_);
+            }
+            status_ = status;
+        }
+        Release();
+    }
+
+private:
+    CriticalSection lock_;
+    Download inet_;                             // retrieval, upon the check session.
+    std::string body_;
+    StringDownloadSink sink_;
+    unsigned references_;
+    AutoUpdater::ReleaseNotesStatus status_;
+    std::string content_;
+};
+
+
+class PreDownload;
+class UpdateScheduler;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ProgressMeter
+//
+//  Transfer progress. Download workers publish counters alone; the UI thread samples them
+//  every PROGRESS_FRAME milliseconds by way of a thread timer, dispatched by the message pump
+//  within Download::completion(), likewise polling for cancellation. Neither occurs on the
+//  I/O path, so a slow repaint cannot throttle reads.
+//
+
+#define PROGRESS_FRAME      100                 // sample interval, milliseconds.
+
+class ProgressMeter {
+    ProgressMeter(const ProgressMeter &rsh);
+    ProgressMeter& operator=(const ProgressMeter &rsh);
+
+public:
+    ProgressMeter() : dialog_(NULL), timer_(0), sampled_(-1), sampled_time_(0), rate_(0) {
+    }
+
+    ~ProgressMeter() {
+        Stop();
+    }
+
+    // Download worker(s)
+    void Total(uint64_t total) {
+        total_.Set((int64_t)total);
+    }
+
+    void Completed(uint64_t completed) {
+        completed_.Set((int64_t)completed);
+    }
+
+    void Add(size_t length) {
+        completed_.Add((int64_t)length);
+    }
+
+    bool Cancelled() const {
+        return (0 != cancelled_.Get());
+    }
+
+    // UI thread
+    void Start(IAutoUpdaterUI *dialog) {
+        Stop();
+        total_.Set(0), completed_.Set(0);
+        sampled_ = -1, sampled_time_ = 0, rate_ = 0;
+        cancelled_.Set(dialog ? 0 : 1);         // as AutoUpdater::ProgressCancelled().
+        if (NULL != (dialog_ = dialog)) {
+            CriticalSection::Guard guard(timers_lock_);
+            if (0 != (timer_ = ::SetTimer(NULL, 0, PROGRESS_FRAME, TimerProc))) {
+                timers_[timer_] = this;
+            }
+        }
+    }
+
+    void Stop() {
+        if (timer_) {
+            {   CriticalSection::Guard guard(timers_lock_);
+                ::KillTimer(NULL, timer_);
+                timers_.erase(timer_);
+                timer_ = 0;
+            }
+            Sample();                           // final state.
+        }
+        dialog_ = NULL;
+    }
+
+    // Transfer rate, bytes/second; moving average of the samples.
+    uint64_t Rate() const {
+        return rate_;
+    }
+
+private:
+    static void CALLBACK TimerProc(HWND /*hwnd*/, UINT /*msg*/, UINT_PTR id, DWORD /*time*/) {
+        ProgressMeter *meter = NULL;
+        {   CriticalSection::Guard guard(timers_lock_);
+            std::map<UINT_PTR, ProgressMeter *>::const_iterator it(timers_.find(id));
+            if (it != timers_.end()) meter = it->second;
+        }
+        if (meter) {
+            meter->Sample();
+        }
+    }
+
+    void Sample() {
+        const int64_t completed = completed_.Get(), total = total_.Get();
+        const DWORD now = ::GetTickCount();
+
+        if (sampled_time_ && now != sampled_time_ && completed >= sampled_) {
+            const uint64_t instant = (uint64_t)(completed - sampled_) * 1000 / (now - sampled_time_);
+            rate_ = (rate_ ? ((rate_ * 3) + instant) / 4 : instant);
+        }
+        sampled_time_ = now;
+
+        if (dialog_) {
+            if (total > 0 && completed != sampled_) {
+                dialog_->ProgressUpdate((int)completed, (int)total);
+            }
+            if (dialog_->ProgressCancelled()) {
+                cancelled_.Set(1);
+            }
+        }
+        sampled_ = completed;
+    }
+
+private:
+    static CriticalSection timers_lock_;
+    static std::map<UINT_PTR, ProgressMeter *> timers_;
+
+    AtomicCounter total_;                       // published, by the worker(s).
+    AtomicCounter completed_;
+    AtomicCounter cancelled_;                   // published, by the sampler.
+    IAutoUpdaterUI *dialog_;
+    UINT_PTR timer_;
+    int64_t sampled_;                           // last sample.
+    DWORD sampled_time_;
+    uint64_t rate_;
+};
+
+CriticalSection ProgressMeter::timers_lock_;
+std::map<UINT_PTR, ProgressMeter *> ProgressMeter::timers_;
+
+
 /////////////////////////////////////////////////////////////////////////////////////////
 //  AutoUpdaterImpl
 //
@@ -134,11 +356,38 @@ using namespace Updater;
 class AutoUpdaterImpl {
 public:
     AutoUpdaterImpl(IAutoUpdaterUI *dialog) : 
-        d_dialog(dialog), d_hTopWnd(0) {
+        d_dialog(dialog), d_hTopWnd(0), d_session(new TransportSession), d_notes(NULL), d_predownload(NULL),
+            d_scheduler(NULL) {
     }
 
     ~AutoUpdaterImpl() {
         CleanTemp();
+        ReleaseNotesReset();
+        d_session->Release();
+    }
+
+    // Bandwidth pacing; background transfers are limited, interactive are not.
+    // Applies live to transfers in progress.
+    void Pacing(bool interactive) {
+        unsigned long rate = 0, burst = 0;
+
+        if (! interactive) {
+            Config::ReadConfigValue(KEY_DOWNLOADRATE, rate);
+            Config::ReadConfigValue(KEY_DOWNLOADBURST, burst);
+        }
+        d_limiter.set(rate, burst);
+    }
+
+    void ReleaseNotesReset() {
+        if (d_notes) {                          // detach; worker completes independently.
+            d_notes->Release();
+            d_notes = NULL;
+        }
+    }
+
+    void Publish(const Updater::AutoManifest &manifest) {
+        ReleaseNotesReset();                    // prior manifest; caller holds d_checking.
+        d_manifest = manifest;
     }
 
     // RAII
@@ -186,7 +435,447 @@ public:
     std::string         d_tempdir;              // temporary working directory.
     std::string         d_tempfile;             // temporary working download file.
     std::string         d_lasterror;            // last reported error, if any.
+    TransportSession   *d_session;              // connections, shared by check and install.
+    ReleaseNotesLoader *d_notes;                // release notes retrieval, on demand.
+    PreDownload        *d_predownload;          // speculative installer download, if any.
+    RateLimiter         d_limiter;              // bandwidth pacing.
+    UpdateScheduler    *d_scheduler;            // background periodic checks, if any.
+    ProgressMeter       d_meter;                // transfer progress, sampled by the UI.
+    CriticalSection     d_checking;             // check in progress, foreground or background; guards d_manifest and d_notes.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Enclosure compression, by type otherwise url suffix; the manifest length and signatures
+//  describe the decompressed image. Returns 1=gzip, 0=none, -1=unsupported.
+//
+
+static bool
+HasSuffix(const std::string &value, const char *suffix)
+{
+    const size_t length = strlen(suffix);
+    return (value.length() > length && 0 == _stricmp(value.c_str() + value.length() - length, suffix));
+}
+
+
+static int
+EnclosureCompression(const Updater::AutoManifest &d_manifest)
+{
+    const std::string &type = d_manifest.attributeType;
+    Inflater::Format format;
+
+    if (Inflater::Encoding(type, format)) {
+        return 1;
+    } else if (0 == _stricmp(type.c_str(), "application/zstd") || 0 == _stricmp(type.c_str(), ".zst")) {
+        return -1;                              // zstd, decoder not available.
+    } else if (type.empty() || 0 == _stricmp(type.c_str(), "application/octet-stream")) {
+        std::string url(d_manifest.attributeURL);
+        const size_t query = url.find('?');
+        if (std::string::npos != query) {
+            url.erase(query);
+        }
+        if (HasSuffix(url, ".gz")) {
+            return 1;
+        } else if (HasSuffix(url, ".zst")) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Delta enclosure applicable to the retained prior installer, if any; the target must
+//  carry a SHA signature, against which the patch header is checked.
+//
+
+static const Updater::AutoDelta *
+DeltaSource(const Updater::AutoManifest &d_manifest, std::string &prior, std::string &prior_sha)
+{
+    std::string prior_version;
+
+    if (d_manifest.deltas.empty() || d_manifest.attributeSHASignature.empty() ||
+            (prior = InstallerCache::Prior(prior_version, prior_sha)).empty()) {
+        return NULL;
+    }
+
+    for (std::vector<Updater::AutoDelta>::const_iterator it(d_manifest.deltas.begin()),
+                end(d_manifest.deltas.end()); it != end; ++it) {
+        if (it->deltaFrom == prior_version &&
+                (it->deltaFromSHASignature.empty() || 0 == _stricmp(it->deltaFromSHASignature.c_str(), prior_sha.c_str()))) {
+            return &(*it);
+        }
+    }
+    LOG<LOG_INFO>() << "Install: no delta from <" << prior_version << ">" << LOG_ENDL;
+    return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Installer cache capacity, bytes; zero when disabled.
+//
+
+#define INSTALLERCACHE_DEFAULT 512              // MB
+
+static uint64_t
+InstallerCapacity()
+{
+    unsigned long capacity = INSTALLERCACHE_DEFAULT;
+
+    Config::ReadConfigValue(KEY_INSTALLERCACHE, capacity);
+    return (uint64_t)capacity * (1024 * 1024);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Enclosure sources, the url plus any mirrors; ordered by the latency observed during
+//  prior runs, per origin (scheme://authority). Unknown origins rank first, so are probed.
+//
+
+#define MIRROR_PENALTY      60000               // failure, milliseconds.
+
+static std::string
+MirrorOrigin(const std::string &url)
+{
+    const std::string::size_type scheme = url.find("://");
+
+    if (std::string::npos == scheme) {
+        return url;
+    }
+    return url.substr(0, url.find('/', scheme + 3));
+}
+
+
+static void
+MirrorLatencies(std::map<std::string, long> &latencies)
+{
+    std::string value;
+
+    if (Config::ReadConfigValue(KEY_MIRRORLATENCY, value)) {
+        const char *cursor = value.c_str();
+
+        while (*cursor) {
+            const size_t length = strcspn(cursor, " ");
+            const std::string element(cursor, length);
+            const std::string::size_type sep = element.rfind('=');
+
+            if (sep != std::string::npos && sep) {
+                latencies[element.substr(0, sep)] = atol(element.c_str() + sep + 1);
+            }
+            cursor += length;
+            cursor += strspn(cursor, " ");
+        }
+    }
+}
+
+
+namespace {
+struct MirrorRank {
+    MirrorRank(const std::map<std::string, long> &latencies) : latencies_(latencies) {
+    }
+
+    long rank(const std::string &url) const {
+        std::map<std::string, long>::const_iterator it(latencies_.find(MirrorOrigin(url)));
+        return (it == latencies_.end() ? 0 : it->second);
+    }
+
+    bool operator()(const std::string &a, const std::string &b) const {
+        return rank(a) < rank(b);
+    }
+
+    const std::map<std::string, long> &latencies_;
 };
+}   //namespace anon
+
+
+static std::vector<std::string>
+MirrorOrder(const Updater::AutoManifest &d_manifest)
+{
+    std::vector<std::string> sources;
+
+    sources.push_back(d_manifest.attributeURL);
+    for (std::vector<std::string>::const_iterator it(d_manifest.attributeMirrors.begin());
+            it != d_manifest.attributeMirrors.end(); ++it) {
+        if (std::find(sources.begin(), sources.end(), *it) == sources.end()) {
+            sources.push_back(*it);
+        }
+    }
+
+    if (sources.size() > 1) {
+        std::map<std::string, long> latencies;
+
+        MirrorLatencies(latencies);
+        std::stable_sort(sources.begin(), sources.end(), MirrorRank(latencies));
+        LOG<LOG_DEBUG>() << "Install: sources=" << sources.size() << ", preferred <" << sources[0] << ">" << LOG_ENDL;
+    }
+    return sources;
+}
+
+
+//  Fold the latencies observed by a transfer into those retained; moving average, with
+//  failures penalised.
+static void
+MirrorUpdate(const std::map<std::string, long> &observed)
+{
+    std::map<std::string, long> latencies;
+
+    if (observed.empty()) {
+        return;
+    }
+
+    MirrorLatencies(latencies);
+    for (std::map<std::string, long>::const_iterator it(observed.begin()); it != observed.end(); ++it) {
+        const std::string origin = MirrorOrigin(it->first);
+        const long sample = (it->second < 0 ? MIRROR_PENALTY : it->second);
+        std::map<std::string, long>::iterator prior(latencies.find(origin));
+
+        if (prior == latencies.end()) {
+            latencies[origin] = sample;
+        } else {
+            prior->second = ((prior->second * 3) + sample) / 4;
+        }
+    }
+
+    std::string value;
+    for (std::map<std::string, long>::const_iterator it(latencies.begin()); it != latencies.end(); ++it) {
+        char element[32];
+
+        sprintf_s(element, sizeof(element), "=%ld", it->second);
+        if (! value.empty()) value += ' ';
+        value += it->first;
+        value += element;
+    }
+    Config::WriteConfigValue(KEY_MIRRORLATENCY, value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Phased rollout group of this installation; derived from an identifier generated upon
+//  first use and persisted, so the group is stable across runs. Optionally that of another
+//  application, by name, under its default registry path; see AutoUpdateSuite.
+//
+
+//static/private
+unsigned
+AutoUpdater::PhasedGroup(const std::string &appname)
+{
+    std::string install_id;
+
+    if (appname.empty()) {
+        (void) Config::ReadConfigValue(KEY_INSTALLID, install_id);
+    } else {
+        install_id = Config::ReadAppConfigValue(appname, KEY_INSTALLID);
+    }
+
+    if (install_id.empty()) {
+        RPC_CSTR uuidStr = 0;
+        UUID uuid = {0};
+
+        (void) ::UuidCreate(&uuid);
+        if (RPC_S_OK == ::UuidToStringA(&uuid, &uuidStr)) {
+            install_id = reinterpret_cast<const char *>(uuidStr);
+            ::RpcStringFreeA(&uuidStr);
+        } else {
+            install_id = Updater::format("%lu.%lu", (unsigned long)::GetTickCount(), (unsigned long)::GetCurrentProcessId());
+        }
+
+        if (appname.empty()) {
+            Config::WriteConfigValue(KEY_INSTALLID, install_id);
+        } else {
+            Config::WriteAppConfigValue(appname, KEY_INSTALLID, install_id);
+        }
+    }
+    return Updater::AutoManifest::PhasedGroup(install_id);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Compiled manifest feed, "<manifest>.bin" alongside the XML form; see ManifestIndex. The
+//  leading index is retrieved by range request, followed by the span of those segments
+//  applicable to the channel; should the server not honour ranges the feed is retrieved in
+//  full. Absence is remembered, the XML form then being retrieved directly for a period.
+//
+
+#define IMAGE_ABSENT_PERIOD (7 * 24 * 60 * 60)  // one week.
+
+struct ManifestFeed {
+    ManifestFeed() : offset(0) {
+    }
+
+    std::string index;                          // index, in full.
+    std::string segments;                       // applicable segments, otherwise the feed in full.
+    uint64_t offset;                            // feed offset of 'segments'.
+};
+
+
+//  Range of the feed, appended to 'data'; a shorter response accepted only when the
+//  feed itself is shorter, see Download::range().
+static bool
+ManifestFeedRange(Download &inet, const std::string &feed_url, int flags, uint64_t offset, uint64_t length, std::string &data)
+{
+    StringDownloadSink sink(&data);
+    bool success;
+
+    inet.range(offset, length);
+    success = (inet.get(feed_url, sink, flags) && inet.completion());
+    inet.range(0, 0);
+    return success;
+}
+
+
+static bool
+ManifestFeedGet(Download &inet, const std::string &manifest_url, int flags, const std::string &channel, ManifestFeed &feed)
+{
+    const time_t now = time(NULL);
+    time_t absent = 0;
+
+    if (Config::ReadConfigValue(KEY_IMAGEABSENT, absent) && absent > 0 &&
+            absent <= now && (now - absent) < IMAGE_ABSENT_PERIOD) {
+        return false;
+    }
+
+    const std::string feed_url = manifest_url + ".bin";
+    std::string prefix;
+
+    // index, then the applicable segments
+    if (ManifestFeedRange(inet, feed_url, flags, 0, Updater::ManifestIndex::PREFIX_SIZE, prefix) &&
+            Updater::ManifestIndex::IsIndex(prefix.data(), prefix.size())) {
+        const size_t index_length = Updater::ManifestIndex::IndexLength(prefix.data(), prefix.size());
+        Updater::ManifestIndex index;
+        uint64_t offset = 0, length = 0;
+        bool ranged = true;
+
+        if (index_length > prefix.size()) {     // index remainder.
+            ranged = (ManifestFeedRange(inet, feed_url, flags, prefix.size(), index_length - prefix.size(), prefix) &&
+                        prefix.size() == index_length);
+        }
+
+        if (ranged && index.Open(prefix.data(), prefix.size())) {
+            if (! Updater::AutoManifest::FeedSpan(index, channel, offset, length)) {
+                feed.segments.clear();          // channel not available.
+
+            } else if (offset + length <= prefix.size()) {
+                feed.segments = prefix;         // within the initial range.
+
+            } else {
+                feed.segments.clear(), feed.offset = offset;
+                ranged = (ManifestFeedRange(inet, feed_url, flags, offset, length, feed.segments) &&
+                            feed.segments.size() == length);
+            }
+
+            if (ranged) {
+                LOG<LOG_INFO>() << "Manifest: feed <" << feed_url << ">, index " << index_length
+                    << " bytes, segments " << length << " of " << index.FeedLength() << " bytes" << LOG_ENDL;
+                feed.index.swap(prefix);
+                if (absent) {
+                    Config::WriteConfigValue(KEY_IMAGEABSENT, 0);
+                }
+                return true;
+            }
+        }
+        LOG<LOG_INFO>() << "Manifest: feed <" << feed_url << "> ranges unavailable, retrieving in full" << LOG_ENDL;
+    }
+
+    // otherwise in full
+    StringDownloadSink sink(&feed.segments);
+
+    feed.segments.clear(), feed.offset = 0;
+    if (inet.get(feed_url, sink, flags) && inet.completion() &&
+            Updater::ManifestIndex::IsIndex(sink.data().data(), sink.data().size())) {
+        LOG<LOG_INFO>() << "Manifest: feed <" << feed_url << ">, " << feed.segments.size() << " bytes" << LOG_ENDL;
+        feed.index.assign(feed.segments, 0,
+            Updater::ManifestIndex::IndexLength(feed.segments.data(), feed.segments.size()));
+        if (absent) {
+            Config::WriteConfigValue(KEY_IMAGEABSENT, 0);
+        }
+        return true;
+    }
+
+    LOG<LOG_INFO>() << "Manifest: feed <" << feed_url << "> not available" << LOG_ENDL;
+    Config::WriteConfigValue(KEY_IMAGEABSENT, now);
+    return false;
+}
+
+
+//  Signature, of the index and of each segment; required when public keys are configured,
+//  as enclosures.
+template <typename Reader>
+static void
+ManifestFeedVerify(const Reader &reader)
+{
+    if (Config::PublicKeyNumber()) {
+        const std::string keyversion = Updater::format("1.%u", reader.KeyVersion());
+        unsigned type = 0;
+        size_t length = 0;
+        const void *key = (reader.KeyVersion() ? Config::PublicKeyFind(keyversion, type, length) : NULL);
+
+        if (NULL == key) {
+            throw AppException(Updater::format("Manifest image: unknown key-version <%s>, contact maintainer.",
+                        (reader.KeyVersion() ? keyversion.c_str() : "unsigned")));
+        }
+        if (! reader.Verify(key, length)) {
+            throw AppException("Manifest image: signature invalid.");
+        }
+    }
+}
+
+
+static bool
+ManifestFeedLoad(const ManifestFeed &feed, const std::string &channel, const std::string &os_label, Updater::AutoManifest &manifest)
+{
+    Updater::ManifestIndex index;
+    std::vector<Updater::ManifestImage> images;
+
+    if (! index.Open(feed.index.data(), feed.index.size())) {
+        throw AppException("Manifest feed malformed.");
+    }
+    ManifestFeedVerify(index);
+
+    Updater::AutoManifest::FeedSegments(index, channel, feed.segments.data(), feed.offset, feed.segments.size(), images);
+    for (std::vector<Updater::ManifestImage>::const_iterator it(images.begin()), end(images.end()); it != end; ++it) {
+        ManifestFeedVerify(*it);
+    }
+    return manifest.LoadImages(images, channel, os_label);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Chunk reuse source, the retained prior installer; applicable when the enclosure publishes
+//  a chunk index and is uncompressed, ranges addressing the enclosure image as stored.
+//
+
+#define RANGE_GAP           (16 * 1024)         // reusable bytes refetched, in preference to a further request.
+
+static bool
+ReuseSource(const Updater::AutoManifest &d_manifest, std::string &prior, std::string &prior_version)
+{
+    std::string prior_sha;
+
+    if (d_manifest.attributeChunks.empty() || 0 != EnclosureCompression(d_manifest) ||
+            (prior = InstallerCache::Prior(prior_version, prior_sha)).empty()) {
+        return false;
+    }
+    return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Installer image write-behind, overlapping network reads and disk writes; in place of
+//  lent (mapped) views, which apply only when configured as 0.
+//
+
+#define WRITEBEHIND_DEFAULT 4                   // buffers, 256K each.
+
+static void
+WriteBehind(FileDownloadSink &sink)
+{
+    unsigned long depth = WRITEBEHIND_DEFAULT, flush = 0;
+
+    Config::ReadConfigValue(KEY_WRITEBEHIND, depth);
+    Config::ReadConfigValue(KEY_WRITEFLUSH, flush);
+    sink.write_behind((unsigned)(depth > 64 ? 64 : depth),
+        (flush >= 2 ? FileDownloadSink::FLUSH_WRITE : (flush ? FileDownloadSink::FLUSH_CLOSE : FileDownloadSink::FLUSH_NEVER)));
+}
 
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -197,41 +886,572 @@ class AutoUpdaterSink : public FileDownloadSink {
     AutoUpdaterSink(const AutoUpdaterSink &rsh);
     AutoUpdaterSink& operator=(const AutoUpdaterSink &rsh);
 
+    enum {
+        CHECKPOINT_SIZE = 4 * 1024 * 1024       // resumption state update interval.
+    };
+
 public:
-    AutoUpdaterSink(AutoUpdater &updater, const char *filename) :
-        FileDownloadSink(filename), updater_(updater), total_(0), completed_(0), percentage_(0) {
+    AutoUpdaterSink(AutoUpdater &updater, const char *filename, const std::string &url, ImageVerifier *verifier = NULL,
+            bool background = false) :
+        FileDownloadSink(filename), updater_(updater), url_(url), statename_(std::string(filename) + ".partial"),
+            verifier_(verifier), lent_(NULL), meter_(background ? NULL : &updater.d_impl->d_meter), total_(0),
+            resumed_(0), contiguous_(0), checkpoint_(0), segmented_(false), unverified_(false), background_(background), stopped_(false) {
+        WriteBehind(*this);
     }
 
     virtual void set_size(size_t size) {
         FileDownloadSink::set_size(size); 
         total_ = size;
+        if (meter_) {
+            meter_->Total(size);
+        }
+    }
+
+    virtual void set_validator(const std::string &validator) {
+        validator_ = validator;
+    }
+
+    virtual bool resume(uint64_t offset) {
+        if (verifier_ && !unverified_) {       // prime verification with the retained image.
+            unverified_ = ! Prime(offset);
+        }
+        if (FileDownloadSink::resume(offset)) {
+            resumed_ = contiguous_ = checkpoint_ = offset;
+            if (meter_) {
+                meter_->Completed(offset);
+            }
+            return true;
+        }
+        return false;
     }
 
     virtual void append(const void *data, size_t length) {
+        if (verifier_ && !unverified_) {       // verify-while-downloading; throws on overrun.
+            verifier_->Update(data, length);
+        }
         FileDownloadSink::append(data, length);
-        completed_ += length;
-        if (total_) {
-            const int percentage = 
-                    (int)(((double)completed_ / total_) * 100.0);
-            if (percentage != percentage_) {
-                updater_.ProgressUpdate(completed_, total_);
-                percentage_ = percentage;
-            }
-        }   
+        contiguous_ += length;
+        if ((contiguous_ - checkpoint_) >= CHECKPOINT_SIZE) {
+            Checkpoint();
+        }
+        progress(length);
+    }
+
+    virtual void *acquire(size_t &length) {
+        return (lent_ = FileDownloadSink::acquire(length));
+    }
+
+    virtual void commit(size_t length) {        // as append(), content in place.
+        if (verifier_ && !unverified_) {
+            verifier_->Update(lent_, length);
+        }
+        FileDownloadSink::commit(length);
+        contiguous_ += length;
+        if ((contiguous_ - checkpoint_) >= CHECKPOINT_SIZE) {
+            Checkpoint();
+        }
+        progress(length);
+    }
+
+    virtual void write_at(uint64_t offset, const void *data, size_t length) {
+        FileDownloadSink::write_at(offset, data, length);
+        segmented_ = true;                      // non-contiguous, not resumable nor verifiable.
+        progress(length);                       // merge segment progress.
     }
 
     virtual bool cancelled() {
-        return updater_.ProgressCancelled();
+        if (background_) {                      // no progress dialog; see Stop().
+            return stopped_;
+        }
+        return meter_->Cancelled();             // as sampled by the UI.
+    }
+
+    // Terminate a background transfer.
+    void Stop() {
+        stopped_ = true;
+    }
+
+    virtual void copied(uint64_t length) {
+        unverified_ = true;                     // kernel-side copy, verification upon completion.
+        progress((size_t)length);
+    }
+
+    // Prior partial image of the same enclosure; returns the resumable byte count, otherwise 0.
+    uint64_t Partial(std::string &validator) {
+        char line[1024];
+        std::string url;
+        unsigned long long length = 0, bytes = 0;
+        FILE *strm;
+
+        if (NULL == (strm = fopen(statename_.c_str(), "r"))) {
+            return 0;
+        }
+
+        while (fgets(line, sizeof(line), strm)) {
+            line[strcspn(line, "\r\n")] = 0;
+            if (0 == strncmp(line, "url=", 4)) {
+                url = line + 4;
+            } else if (0 == strncmp(line, "validator=", 10)) {
+                validator = line + 10;
+            } else if (0 == strncmp(line, "length=", 7)) {
+                length = _strtoui64(line + 7, NULL, 10);
+            } else if (0 == strncmp(line, "bytes=", 6)) {
+                bytes = _strtoui64(line + 6, NULL, 10);
+            }
+        }
+        fclose(strm);
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes = {0};
+        if (url != url_ || validator.empty() || 0 == bytes || (length && bytes >= length) ||
+                ! ::GetFileAttributesExA(filename().c_str(), GetFileExInfoStandard, &attributes) ||
+                ((((uint64_t)attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow) < bytes) {
+            LOG<LOG_INFO>() << "Install: partial image unusable, discarding" << LOG_ENDL;
+            Release();
+            return 0;
+        }
+        return bytes;
+    }
+
+    // Whether the image may be resumed by a later attempt.
+    bool Resumable() const {
+        return (!segmented_ && !validator_.empty() && contiguous_ > resumed_);
+    }
+
+    // Update resumption state; validator, expected length and contiguous byte count.
+    void Checkpoint() {
+        FILE *strm;
+
+        checkpoint_ = contiguous_;
+        if (segmented_ || validator_.empty()) {
+            return;
+        }
+
+        const uint64_t bytes =                  // excluding content queued for write-behind.
+            (written() < contiguous_ ? written() : contiguous_);
+        if (NULL != (strm = fopen(statename_.c_str(), "w"))) {
+            fprintf(strm, "url=%s\nvalidator=%s\nlength=%llu\nbytes=%llu\n", url_.c_str(),
+                validator_.c_str(), (unsigned long long)total_, (unsigned long long)bytes);
+            fclose(strm);
+        }
+    }
+
+    // Discard resumption state.
+    void Release() {
+        ::DeleteFileA(statename_.c_str());
+    }
+
+    // Whether the image was verified whilst streaming, see ImageVerifier::Final().
+    bool Streamed() const {
+        return (verifier_ && !segmented_ && !unverified_ && verifier_->Count() == verifier_->Expected());
+    }
+
+private:
+    bool Prime(uint64_t offset) {
+        HANDLE handle = ::CreateFileA(filename().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        bool success = false;
+
+        if (INVALID_HANDLE_VALUE != handle) {
+            std::vector<char> buffer(64 * 1024);
+            DWORD size = 0;
+
+            try {
+                while (offset && ::ReadFile(handle, &buffer[0], (DWORD)(offset < buffer.size() ? offset : buffer.size()), &size, NULL) && size) {
+                    verifier_->Update(&buffer[0], size);
+                    offset -= size;
+                }
+                success = (0 == offset);
+            } catch (...) {
+            }
+            ::CloseHandle(handle);
+        }
+        return success;
+    }
+
+private:
+    void progress(size_t length) {              // publish; see ProgressMeter.
+        if (meter_) {
+            meter_->Add(length);
+        }
     }
 
 private:
     AutoUpdater &updater_;
+    const std::string url_;                     // enclosure source.
+    const std::string statename_;               // resumption state, "<image>.partial".
+    ImageVerifier *verifier_;                   // optional streaming verification.
+    void *lent_;                                // region lent, see acquire().
+    std::string validator_;                     // entity validator.
+    ProgressMeter *meter_;                      // progress publication; NULL when background.
     size_t total_;
-    size_t completed_;
-    int percentage_;
+    uint64_t resumed_;                          // resumption offset.
+    uint64_t contiguous_;                       // contiguous bytes written.
+    uint64_t checkpoint_;                       // last recorded contiguous count.
+    bool segmented_;
+    bool unverified_;                           // streaming verification unavailable.
+    const bool background_;                     // speculative, progress not reported.
+    volatile bool stopped_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  RangeSink
+//
+//  Byte range content, written positionally into the image from 'offset'.
+//
+
+class RangeSink : public IDownloadSink {
+    RangeSink(const RangeSink &rsh);
+    RangeSink& operator=(const RangeSink &rsh);
+
+public:
+    RangeSink(IDownloadSink &target, uint64_t offset) :
+        target_(target), offset_(offset), count_(0) {
+    }
+
+    virtual void set_size(size_t size) {
+        (void) size;
+    }
+    virtual bool open() {
+        return true;
+    }
+    virtual void append(const void *data, size_t length) {
+        target_.write_at(offset_ + count_, data, length);
+        count_ += length;
+    }
+    virtual bool cancelled() {
+        return target_.cancelled();
+    }
+    virtual void close() {
+    }
+
+    uint64_t Count() const {
+        return count_;
+    }
+
+private:
+    IDownloadSink &target_;
+    const uint64_t offset_;
+    uint64_t count_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  PreDownload
+//
+//  Speculative low-priority installer download, whilst the install prompt is displayed.
+//  Stopping retains any partial image for resumption by InstallNow().
+//
+
+class PreDownload {
+    PreDownload(const PreDownload &rsh);
+    PreDownload& operator=(const PreDownload &rsh);
+
+public:
+    PreDownload(AutoUpdater &updater, const std::string &filename, const std::string &url, TransportSession *session,
+            RateLimiter *limiter, uint64_t decompressed = 0) :
+        sink_(updater, filename.c_str(), url, NULL, true), download_(session), filename_(filename), url_(url),
+            decompressed_(decompressed), started_(false) {
+        download_.limiter(limiter);
+        if (decompressed) {                     // gzip enclosure, not resumable.
+            download_.decompress(true);
+            sink_.set_size((size_t)decompressed);
+        }
+    }
+
+    bool Start(int flags) {
+        std::string validator;
+        const uint64_t partial = (decompressed_ ? 0 : sink_.Partial(validator));
+
+        if (partial) {
+            download_.resume(partial, validator);
+        }
+        LOG<LOG_INFO>() << "PreDownload: <" << url_ << ">, offset=" << partial << LOG_ENDL;
+        return (started_ = download_.get(url_, sink_, flags | Download::BACKGROUND));
+    }
+
+    // Conclude the transfer; returns true when the image is complete.
+    bool Stop(bool pump) {
+        if (! started_) {
+            return false;
+        }
+        started_ = false;
+
+        sink_.Stop();
+        const bool complete = download_.completion(pump);
+        if (complete) {
+            sink_.Release();
+        } else if (sink_.Resumable()) {
+            sink_.Checkpoint();
+        }
+        LOG<LOG_INFO>() << "PreDownload: " << (complete ? "complete" : "stopped") << LOG_ENDL;
+        return complete;
+    }
+
+    // Stop and remove the image, plus resumption state.
+    void Discard() {
+        Stop(false);
+        sink_.Release();
+        ::DeleteFileA(filename_.c_str());
+    }
+
+    const std::string &filename() const {
+        return filename_;
+    }
+
+private:
+    AutoUpdaterSink sink_;
+    Download download_;
+    const std::string filename_;
+    const std::string url_;
+    const uint64_t decompressed_;               // gzip enclosure, decompressed length.
+    bool started_;
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////////////
+//  Periodic check interval, seconds; AutoInterval days, default 2.
+//
+
+static time_t
+CheckInterval()
+{
+    int autointerval = 0;
+
+    (void) Config::ReadConfigValue(KEY_AUTOINTERVAL, autointerval);
+    return ((time_t)((autointerval > 0 && autointerval <= 60 ? autointerval : 2)) * 60 * 60 * 24);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  UpdateScheduler
+//
+//  Background periodic checks. A check is due an interval after the last, plus a jitter
+//  of up to SCHEDULE_JITTER percent, and never before a randomised start-up delay; so
+//  installations do not check in step at login. Failures back off exponentially. The
+//  worker sleeps upon its stop event between wakeups, bounded so the wall clock is
+//  re-evaluated following suspend or configuration change; the same event interrupts the
+//  transfers of a check in progress.
+//
+
+#define SCHEDULE_JITTER     10                  // percent of the interval.
+#define SCHEDULE_STARTUP    (10 * 60)           // start-up delay limit, seconds.
+#define SCHEDULE_BACKOFF    (5 * 60)            // initial failure backoff, seconds; doubling.
+#define SCHEDULE_BUSY       (15 * 60)           // retry, whilst a foreground check is active.
+#define SCHEDULE_WAKEUP     (60 * 60)           // sleep limit, seconds.
+#define SCHEDULE_STOP       (15 * 1000)         // stop limit, milliseconds.
+
+class UpdateScheduler {
+    UpdateScheduler(const UpdateScheduler &rsh);
+    UpdateScheduler& operator=(const UpdateScheduler &rsh);
+
+public:
+    UpdateScheduler(AutoUpdater &owner, IUpdateNotify &notify) :
+            owner_(owner), notify_(notify), thread_(NULL), running_(false), detached_(false),
+                started_(time(NULL)), retry_(0), failures_(0) {
+        seed_ = (uint64_t)started_ ^ ((uint64_t)::GetTickCount() << 20) ^ ((uint64_t)::GetCurrentProcessId() << 40);
+        startup_ = (time_t)(Random(seed_) % SCHEDULE_STARTUP) + 60;
+    }
+
+    ~UpdateScheduler() {
+        assert(NULL == thread_);
+    }
+
+    bool Start() {
+        if (! stop_.Create(true) ||
+                NULL == (thread_ = Updater::Thread::Begin(threadproc, this))) {
+            return false;
+        }
+        running_ = true;
+        thread_->ResumeThread();
+        return true;
+    }
+
+    // Stop the worker, awaiting at most SCHEDULE_STOP; returns false should it not conclude,
+    // the worker then released, releasing the scheduler upon its return.
+    bool Stop() {
+        if (thread_) {
+            stop_.Trigger();                    // wakeup, and interrupt any check.
+            if (WAIT_TIMEOUT == ::WaitForSingleObject(thread_->handle_, SCHEDULE_STOP)) {
+                CriticalSection::Guard guard(lock_);
+                if (running_) {
+                    LOG<LOG_ERROR>() << "Scheduler: worker not stopped, released" << LOG_ENDL;
+                    thread_->SetAutoDelete();
+                    thread_ = NULL;
+                    detached_ = true;
+                    return false;
+                }
+                                                // concluding.
+            }
+            ::WaitForSingleObject(thread_->handle_, INFINITE);
+            delete thread_;
+            thread_ = NULL;
+        }
+        return true;
+    }
+
+private:
+    static unsigned __cdecl threadproc(void *param) {
+        UpdateScheduler *self = static_cast<UpdateScheduler *>(param);
+        bool t_detached;
+
+        self->Run();
+        {   CriticalSection::Guard guard(self->lock_);
+            self->running_ = false;
+            t_detached = self->detached_;
+        }
+        if (t_detached) {                       // see Stop().
+            delete self;
+        }
+        return 0;
+    }
+
+    static uint64_t Random(uint64_t &state) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    void Run();
+    time_t Due(time_t now);
+    void Check(time_t now);
+
+private:
+    AutoUpdater &owner_;
+    IUpdateNotify &notify_;
+    Updater::Thread *thread_;
+    WaitableEvent stop_;
+    CriticalSection lock_;
+    bool running_;                              // worker active, under lock_.
+    bool detached_;                             // worker released, under lock_.
+    uint64_t seed_;                             // jitter source.
+    const time_t started_;
+    time_t startup_;                            // start-up delay.
+    time_t retry_;                              // backoff, not before.
+    unsigned failures_;                         // consecutive failures.
+};
+
+
+void
+UpdateScheduler::Run()
+{
+    LOG<LOG_INFO>() << "Scheduler: started, initial delay " << (long)startup_ << " seconds" << LOG_ENDL;
+    for (;;) {
+        const time_t now = time(NULL), due = Due(now);
+
+        if (due > now) {                        // sleep; 1=stopped, -1=error.
+            const time_t wait = (due - now < SCHEDULE_WAKEUP ? due - now : SCHEDULE_WAKEUP);
+            if (0 != stop_.Wait((unsigned)wait * 1000)) {
+                break;
+            }
+            continue;
+        }
+        Check(now);
+        if (0 != stop_.Wait(0)) {
+            break;
+        }
+    }
+    LOG<LOG_INFO>() << "Scheduler: stopped" << LOG_ENDL;
+}
+
+
+//  Next check; the jitter is a function of the last check, so stable across wakeups.
+//
+time_t
+UpdateScheduler::Due(time_t now)
+{
+    const time_t earliest = started_ + startup_;
+    bool autocheck = false;
+    time_t due;
+
+    if (! Config::ReadConfigValue(KEY_AUTOCHECK, autocheck) || ! autocheck) {
+        return now + SCHEDULE_WAKEUP;           // disabled or not configured; re-evaluate.
+    }
+
+    const time_t interval = CheckInterval();
+    time_t autolast = 0;
+
+    if (! Config::ReadConfigValue(KEY_AUTOLAST, autolast) || autolast <= 0 || autolast > now) {
+        due = earliest;                         // never, or clock skew.
+    } else {
+        uint64_t state = seed_ ^ (uint64_t)autolast;
+        const time_t span = (interval * SCHEDULE_JITTER) / 100;
+        due = autolast + interval + (time_t)(Random(state) % (uint64_t)(span > 0 ? span : 1));
+    }
+
+    if (due < earliest) due = earliest;
+    if (due < retry_) due = retry_;
+    return due;
+}
+
+
+//  Background check; skipped whilst a foreground check is active, the host notified only
+//  when an update not skipped is available.
+//
+void
+UpdateScheduler::Check(time_t now)
+{
+    AutoUpdaterImpl *impl = owner_.d_impl;
+    Updater::AutoManifest manifest;
+    bool success = false, notify = false, stopped = false;
+
+    if (! impl->d_checking.TryEnter()) {
+        LOG<LOG_DEBUG>() << "Scheduler: check active, deferred" << LOG_ENDL;
+        retry_ = now + SCHEDULE_BUSY;
+        return;
+    }
+
+    try {
+        impl->SetLastError("");
+        const int available =                   // UI-less; published under d_checking.
+                owner_.CheckAvailable(false, manifest, stop_.Handle());
+
+        if (0 != stop_.Wait(0)) {               // stopped; result disregarded.
+            LOG<LOG_INFO>() << "Scheduler: check interrupted" << LOG_ENDL;
+            stopped = true;
+
+        } else if (-1 != available) {                  // checked; including channel not available.
+            Config::WriteConfigValue(KEY_AUTOLAST, time(NULL));
+            if (available >= 0) {
+                impl->Publish(manifest);
+            }
+            if (1 == available && ! owner_.IsSkipped()) {
+                notify = true;
+            }
+            success = true;
+        }
+    } catch (const std::exception &e) {
+        LOG<LOG_ERROR>() << "Scheduler: exception : " << e.what() << LOG_ENDL;
+    } catch (...) {
+        LOG<LOG_ERROR>() << "Scheduler: unhandled exception" << LOG_ENDL;
+    }
+    impl->d_checking.Leave();
+
+    if (stopped) {
+        return;
+
+    } else if (success) {                              // spacing, should AutoLast not persist.
+        failures_ = 0, retry_ = now + SCHEDULE_WAKEUP;
+    } else {                                    // exponential, limited by the interval; randomised half.
+        const time_t interval = CheckInterval();
+        time_t backoff = (time_t)SCHEDULE_BACKOFF << (failures_ < 10 ? failures_ : 10);
+
+        if (backoff > interval) backoff = interval;
+        backoff = (backoff / 2) + (time_t)(Random(seed_) % (uint64_t)(backoff / 2 + 1));
+        retry_ = now + backoff;
+        ++failures_;
+        LOG<LOG_WARN>() << "Scheduler: check failed (" << failures_ << "), retry in "
+            << (long)backoff << " seconds" << LOG_ENDL;
+    }
+
+    if (notify) {
+        LOG<LOG_INFO>() << "Scheduler: update available, " << manifest.attributeVersion << LOG_ENDL;
+        notify_.UpdateAvailable(manifest);
+    }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////////
 //  AutoUpdater
 //
@@ -244,6 +1464,8 @@ AutoUpdater::AutoUpdater(IAutoUpdaterUI *dialog) :
 
 AutoUpdater::~AutoUpdater()
 {
+    Unschedule();
+    PreDownloadStop(true);
     delete d_impl;
 }
 
@@ -336,6 +1558,7 @@ int
 AutoUpdater::Execute(enum ExecuteMode mode, bool interactive)
 {
     enum UpdateStatus status = STATUS_PROMPT;
+    CriticalSection::Guard checking(d_impl->d_checking);
 
     Logger::open_instance(AppName(), true);     // logger
     LOG<LOG_INFO>()
@@ -389,10 +1612,12 @@ AutoUpdater::Execute(enum ExecuteMode mode, bool interactive)
                 ret = 3;
                 if (ExecuteReinstall == mode || ExecuteIgnoreSkip == mode || !isSkipped) {
                     LOG<LOG_DEBUG>() << "AutoUpdate: prompting install" << LOG_ENDL;
+                    PreDownloadStart();         // optional, whilst prompting.
                     if (1 == InstallDialog()) { // query install
                         SetOnce(true);
                         ret = 2;
                     }
+                    PreDownloadStop(true);      // unused, discard.
                 } else {
                     LOG<LOG_DEBUG>() << "AutoUpdate: prompting skipped" << LOG_ENDL;
                 }
@@ -455,11 +1680,7 @@ AutoUpdater::Status(const enum ExecuteMode mode)
         return STATUS_ENABLED;
 
     case ExecuteAuto: {
-            int autointerval = 0;
-
-            (void) Config::ReadConfigValue(KEY_AUTOINTERVAL, autointerval);
-            const time_t expires =              // default, 2-days
-                    ((time_t)((autointerval > 0 && autointerval <= 60 ? autointerval : 2)) * 60 * 60 * 24);
+            const time_t expires = CheckInterval();
 
             time_t autolast = 0;
             if (Config::ReadConfigValue(KEY_AUTOLAST, autolast) && autolast) {
@@ -522,19 +1743,52 @@ AutoUpdater::SetOnce(bool state)
 
 
 bool
-AutoUpdater::GetAuto() const
+AutoUpdater::GetAuto() const
+{
+    bool autocheck = false;
+    Config::ReadConfigValue(KEY_AUTOCHECK, autocheck);
+    return autocheck;
+}
+
+
+void
+AutoUpdater::SetAuto(bool state)
+{
+    Config::WriteConfigValue(KEY_AUTOCHECK, state);
+    Config::WriteConfigValue(KEY_AUTOLAST, (state ? time(NULL) : 0));
+}
+
+
+//
+//  Background periodic checks; replaces any prior schedule. Unschedule() must not be
+//  invoked from within the notification.
+//
+bool
+AutoUpdater::Schedule(IUpdateNotify &notify)
 {
-    bool autocheck = false;
-    Config::ReadConfigValue(KEY_AUTOCHECK, autocheck);
-    return autocheck;
+    Unschedule();
+    Logger::open_instance(AppName(), true);     // logger
+
+    UpdateScheduler *scheduler = new UpdateScheduler(*this, notify);
+    if (! scheduler->Start()) {
+        LOG<LOG_ERROR>() << "Scheduler: unable to start : " << GetLastError() << LOG_ENDL;
+        delete scheduler;
+        return false;
+    }
+    d_impl->d_scheduler = scheduler;
+    return true;
 }
 
 
 void
-AutoUpdater::SetAuto(bool state)
+AutoUpdater::Unschedule()
 {
-    Config::WriteConfigValue(KEY_AUTOCHECK, state);
-    Config::WriteConfigValue(KEY_AUTOLAST, (state ? time(NULL) : 0));
+    if (d_impl->d_scheduler) {
+        if (d_impl->d_scheduler->Stop()) {      // stops, interrupting any check in progress.
+            delete d_impl->d_scheduler;
+        }                                       // otherwise released by the worker.
+        d_impl->d_scheduler = NULL;
+    }
 }
 
 
@@ -563,6 +1817,25 @@ AutoUpdater::Dump()
 //
 int
 AutoUpdater::IsAvailable(bool interactive)
+{
+    CriticalSection::Guard checking(d_impl->d_checking);
+    Updater::AutoManifest manifest;
+    const int ret = CheckAvailable(interactive, manifest);
+
+    if (ret >= 0) {                             // loaded; current application manifest.
+        d_impl->Publish(manifest);
+    }
+    return ret;
+}
+
+
+//
+//  Check against the manifest source, loading 'candidate'; the dialog is only engaged
+//  when 'interactive', otherwise no dialog is required and none is consulted. Transfers
+//  are abandoned should 'interrupt' be signalled.
+//
+int
+AutoUpdater::CheckAvailable(bool interactive, Updater::AutoManifest &candidate, HANDLE interrupt /*= NULL*/)
 {
     Logger::open_instance(AppName(), true);     // logger
 
@@ -584,17 +1857,28 @@ AutoUpdater::IsAvailable(bool interactive)
     int ret = -1;
 
     try {                                       // guard progress dialog.
-        Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+        Updater::AutoManifest &d_manifest = candidate;
         Updater::GitHub github;
-        StringDownloadSink manifest;
+
+        Updater::ManifestSink manifest(Config::GetChannel(), Config::GetOSLabel());
         std::string manifest_url;
-        Download inet;
+        Download inet(d_impl->d_session);       // connection reuse across fetches.
+        d_impl->Pacing(interactive);
+        inet.limiter(&d_impl->d_limiter);
+        inet.interrupt(interrupt);              // scheduler stop, if any.
+        int flags = DownloadFlags() | Download::CACHED | Download::COMPRESSED;
+        bool stale = false;
+
+        if (! interactive &&                    // background check, latency over currency.
+                Config::ReadConfigValue(KEY_CACHESTALE, stale) && stale) {
+            flags |= Download::STALE;
+        }
 
         // GitHub redirection
         if (github.IsEndpoint(feed_url)) {
             std::string result;
 
-            if (! github.GetLatestRelease(feed_url, inet, DownloadFlags(), result)) {
+            if (! github.GetLatestRelease(feed_url, inet, flags, result)) {
                 d_impl->SetLastError(result);
 
             } else if (result.empty()) {
@@ -608,19 +1892,31 @@ AutoUpdater::IsAvailable(bool interactive)
             manifest_url = feed_url;
         }
 
-        // Retrieve manifest
-        if (! manifest_url.empty() &&
-                inet.get(manifest_url, manifest, DownloadFlags())) {
+        // Retrieve manifest; the compiled form when published, otherwise XML.
+        if (! manifest_url.empty()) {
+            ManifestFeed feed;
+            bool available = false, loaded = false;
+
+            if (ManifestFeedGet(inet, manifest_url, flags, Config::GetChannel(), feed)) {
+                available = true;
+                loaded = ManifestFeedLoad(feed, Config::GetChannel(), Config::GetOSLabel(), d_manifest);
 
-            if (! inet.completion()) {          // manifest available.
-                d_impl->SetLastError("Unable to download manifest");
+            } else if (inet.get(manifest_url, manifest, flags)) {
+                if (! inet.completion()) {      // manifest available.
+                    d_impl->SetLastError("Unable to download manifest");
+                } else {
+                    available = true;
+                    loaded = manifest.load(d_manifest);
+                }
+            }
 
-            } else if (! d_manifest.Load(manifest.data(),
-                            Config::GetChannel(), Config::GetOSLabel())) {
+            if (! available) {
+                                                // error reported.
+            } else if (! loaded) {
                 d_impl->SetLastError("Channel/label not available");
                 ret = -2;                       // channel not available.
 
-            } else if (! ProgressCancelled()) {
+            } else if (! interactive || ! ProgressCancelled()) {
                 //
                 //  Signature required
                 //
@@ -649,19 +1945,15 @@ AutoUpdater::IsAvailable(bool interactive)
                         LOG<LOG_INFO>() << "same or newer version" << LOG_ENDL;
                         ret = 0;                // same or newer version is already installed.
 
-                    } else {                    // load description, if available.
+                    } else if (! interactive && d_manifest.phasedRolloutInterval > 0 &&
+                                    d_manifest.IsPhased(PhasedGroup(std::string()), time(NULL)) &&
+                                    ! d_manifest.IsCriticalUpdate(app_version)) {
+                        LOG<LOG_INFO>() << "update phased, not yet offered" << LOG_ENDL;
+                        ret = 0;                // rollout group not yet open; user initiated checks are not phased.
+
+                    } else {                    // description, loaded on presentation; see ReleaseNotes().
                         LOG<LOG_INFO>() << "update available" << LOG_ENDL;
                         ret = 1;
-
-                        if (! d_manifest.releaseNotesLink.empty()) {
-                            StringDownloadSink content(&d_manifest.releaseNotesContent);
-
-                            if (! inet.get(d_manifest.releaseNotesLink, content) ||
-                                    ! inet.completion()) {
-                                d_impl->SetLastError("Unable to download release notes");
-                                ret = -1;
-                            }
-                        }
                     }
                 }               
             }
@@ -670,13 +1962,13 @@ AutoUpdater::IsAvailable(bool interactive)
     } catch (const std::exception &e) {
         LOG<LOG_ERROR>() << "IsAvailable: exception : " << e.what() << LOG_ENDL;
         d_impl->SetLastError(e.what());
-        ProgressStop();
+        if (interactive) ProgressStop();
         ret = -1;
 
     } catch (...) {
         LOG<LOG_ERROR>() << "IsAvailable: unhandled exception" << LOG_ENDL;
         d_impl->SetLastError("unhandled exception");
-        ProgressStop();
+        if (interactive) ProgressStop();
         ret = -1;
     }
 
@@ -692,6 +1984,7 @@ AutoUpdater::IsAvailable(bool interactive)
 bool
 AutoUpdater::IsSkipped()
 {
+    CriticalSection::Guard checking(d_impl->d_checking);
     Updater::AutoManifest &d_manifest = d_impl->d_manifest;
     std::string skipped;
 
@@ -743,13 +2036,29 @@ AutoUpdater::IsSkipped()
 bool
 AutoUpdater::InstallNow(IInstallNow &updater, bool interactive)
 {
+    CriticalSection::Guard checking(d_impl->d_checking);    // manifest stable; scheduled checks deferred.
     const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
-    const std::string &targetName = GetTargetName();
+    const std::string &targetName =             // speculative image, otherwise new target.
+            (d_impl->d_predownload ? d_impl->d_tempfile : GetTargetName());
+    d_impl->Pacing(interactive);                // live; releases a paced speculative transfer.
+    const bool predownloaded = PreDownloadStop(false);
     const int exeDirect = TRUE;                 // TODO: configuration option.
 
     LOG<LOG_TRACE>() << "Install: downloading <" << d_manifest.attributeURL << ">" << LOG_ENDL;
     LOG<LOG_TRACE>() << "   target <" << targetName << ">" << LOG_ENDL;
 
+    ImageVerifier verifier(d_manifest);         // verify-while-downloading.
+    const int compression = EnclosureCompression(d_manifest);
+
+    if (compression < 0 && !predownloaded) {
+        const char *msg = "Installer compression not supported";
+        if (interactive) {
+            updater.message("ERROR - %s", msg);
+        }
+        d_impl->SetLastError(msg);
+        return false;
+    }
+
                                                 // progress and browser requirement.
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
 
@@ -758,17 +2067,80 @@ AutoUpdater::InstallNow(IInstallNow &updater, bool interactive)
         ProgressStart(updater.GetParent(), true, "Downloading update ...");
     }
 
-    AutoUpdaterSink filesink(*this, targetName.c_str());
-    Download inet;                              // download.
+    AutoUpdaterSink filesink(*this, targetName.c_str(), d_manifest.attributeURL, &verifier);
+    Download inet(d_impl->d_session);           // download, reusing the check connection.
+    inet.limiter(&d_impl->d_limiter);
+    const std::vector<std::string> sources(MirrorOrder(d_manifest));
+    std::string validator;
+    int segments = 0;                           // default, single stream verified on arrival.
+
+    bool getfile = false, reconstructed = false;
+
+    if (predownloaded) {                        // complete image, verified below.
+        LOG<LOG_INFO>() << "Install: using pre-downloaded image" << LOG_ENDL;
+        getfile = true;
+
+    } else if (Cached(targetName)) {            // installer cache, verified on retrieval.
+        getfile = reconstructed = true;
+
+    } else if (Patch(targetName)) {             // delta from the prior installer, verified on arrival.
+        getfile = reconstructed = true;
+
+    } else if (ProgressCancelled()) {           // cancelled during the delta, no fallback.
+        getfile = false;
+
+    } else if (Reuse(targetName)) {             // chunks of the prior installer, verified once assembled.
+        getfile = reconstructed = true;
+
+    } else if (ProgressCancelled()) {           // cancelled during chunk reuse, no fallback.
+        getfile = false;
 
-    bool getfile = inet.get(d_manifest.attributeURL, filesink);
-    if (getfile) {
-        getfile = inet.completion();
+    } else if (compression > 0) {               // gzip enclosure; decompressed ahead of the sink, verified on arrival.
+        LOG<LOG_INFO>() << "Install: compressed image" << LOG_ENDL;
+        inet.decompress(true);
+        inet.mirrors(std::vector<std::string>(sources.begin() + 1, sources.end()));
+        filesink.set_size((size_t)verifier.Expected());
+        getfile = inet.get(sources[0], filesink);
+        if (getfile) {
+            getfile = inet.completion();
+        }
+        MirrorUpdate(inet.latencies());
+
+    } else {
+        const uint64_t partial = filesink.Partial(validator);
+        if (partial) {                          // prior attempt; resume, otherwise segmented.
+            LOG<LOG_INFO>() << "Install: resuming partial image, bytes=" << partial << LOG_ENDL;
+            inet.resume(partial, validator);
+        } else {
+            Config::ReadConfigValue(KEY_DOWNLOADSEGMENTS, segments);
+            inet.segments(segments > 0 ? (unsigned)segments : 0);
+        }
+
+        inet.mirrors(std::vector<std::string>(sources.begin() + 1, sources.end()));
+        getfile = inet.get(sources[0], filesink);
+        if (getfile) {
+            getfile = inet.completion();
+        }
+        MirrorUpdate(inet.latencies());
+    }
+
+    {   unsigned requests = 0, reused = 0;      // session connection reuse, check plus install.
+        inet.statistics(requests, reused);
+        LOG<LOG_INFO>() << "Install: session requests=" << requests << ", reused=" << reused
+            << ", throttled=" << d_impl->d_limiter.throttled() << "ms, writer blocked=" << filesink.blocked() << "ms"
+            << ", rate=" << (d_impl->d_meter.Rate() / 1024) << "KB/s" << LOG_ENDL;
     }
 
     const bool wasCancelled = ProgressCancelled();
     ProgressStop();
 
+    if ((!getfile || wasCancelled) && filesink.Resumable()) {
+        filesink.Checkpoint();                  // retain partial image for resumption.
+        d_impl->RetainTemp();
+    } else {
+        filesink.Release();
+    }
+
     // verify signature.
     bool verified = false;
     if (getfile && !wasCancelled) {             // verify image.
@@ -779,10 +2151,20 @@ AutoUpdater::InstallNow(IInstallNow &updater, bool interactive)
             ProgressStart(updater.GetParent(), true, "Verifying installer ...");
         }
 
-        verified = Verify(targetName);
+        if (reconstructed) {                    // verified image, see Cached(), Patch() and Reuse().
+            verified = true;
+        } else if (filesink.Streamed()) {       // image digested on arrival.
+            verified = verifier.Final();
+        } else {
+            verified = Verify(targetName);
+        }
         ProgressStop();
 
         if (verified) {                         // execute installer.
+            InstallerCache::Retain(targetName,  // source of future deltas.
+                d_manifest.attributeVersion, d_manifest.attributeSHASignature);
+            InstallerCache::Store(targetName,   // reinstallation, plus other applications.
+                InstallerCache::Key(d_manifest.attributeSHASignature, d_manifest.attributeEDSignature), InstallerCapacity());
             updater("Running installer ...");
             if (exeDirect) {
                 char szCommandLine[1024] = {0};
@@ -868,6 +2250,338 @@ AutoUpdater::Manifest() const
 }
 
 
+//
+//  Release notes, non-blocking; the first call starts the background retrieval.
+//
+AutoUpdater::ReleaseNotesStatus
+AutoUpdater::ReleaseNotes(std::string &content)
+{
+    CriticalSection::Guard checking(d_impl->d_checking);
+    Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+
+    if (d_manifest.releaseNotesLink.empty()) {
+        return NotesNone;                       // description only.
+    }
+
+    if (! d_manifest.releaseNotesContent.empty()) {
+        content = d_manifest.releaseNotesContent;
+        return NotesAvailable;
+    }
+
+    if (NULL == d_impl->d_notes) {
+        d_impl->d_notes = ReleaseNotesLoader::Start(d_manifest.releaseNotesLink,
+                                d_impl->d_session, DownloadFlags() | Download::CACHED | Download::COMPRESSED);
+    }
+
+    const ReleaseNotesStatus status = d_impl->d_notes->Status(content);
+    if (NotesAvailable == status) {
+        d_manifest.releaseNotesContent = content;
+    }
+    return status;
+}
+
+
+//
+//  Installer cache; a stored image is linked to the target then verified, being shared
+//  with other applications. Returns false on a miss or failure, the image then removed.
+//
+bool
+AutoUpdater::Cached(const std::string &targetName)
+{
+    const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+    const std::string key =
+        InstallerCache::Key(d_manifest.attributeSHASignature, d_manifest.attributeEDSignature);
+
+    if (0 == InstallerCapacity() || ! InstallerCache::Fetch(key, targetName)) {
+        return false;
+    }
+
+    try {
+        if (Verify(targetName)) {
+            LOG<LOG_INFO>() << "Install: cached image <" << key << ">" << LOG_ENDL;
+            return true;
+        }
+    } catch (const std::exception &e) {
+        LOG<LOG_WARN>() << "Install: cache exception : " << e.what() << LOG_ENDL;
+    }
+
+    LOG<LOG_WARN>() << "Install: cached image <" << key << "> unverified, removed" << LOG_ENDL;
+    InstallerCache::Remove(key);
+    ::DeleteFileA(targetName.c_str());
+    return false;
+}
+
+
+//
+//  Delta update; the delta from the retained prior installer is applied whilst downloading,
+//  the reconstructed image verified on arrival against the enclosure, plus the patch
+//  against its own signatures. Returns false on any failure, the caller then falling
+//  back to the full enclosure.
+//
+bool
+AutoUpdater::Patch(const std::string &targetName)
+{
+    const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+    std::string prior, prior_sha;
+    const Updater::AutoDelta *delta = DeltaSource(d_manifest, prior, prior_sha);
+
+    if (NULL == delta) {
+        return false;
+    }
+
+    Updater::AutoManifest patch;                // patch image description.
+    patch.attributeURL = delta->attributeURL;
+    patch.attributeLength = delta->attributeLength;
+    patch.attributeType = delta->attributeType;
+    patch.attributeSHASignature = delta->attributeSHASignature;
+    patch.attributeEDSignature = delta->attributeEDSignature;
+    patch.attributeEDKeyVersion = delta->attributeEDKeyVersion;
+
+    const int compression = EnclosureCompression(patch);
+    if (compression < 0) {
+        return false;
+    }
+
+    const std::string patchedName = targetName + ".patched";
+    bool success = false;
+
+    LOG<LOG_INFO>() << "Install: delta from <" << delta->deltaFrom << ">, <" << delta->attributeURL << ">" << LOG_ENDL;
+    try {
+        ImageVerifier patchverifier(patch), verifier(d_manifest);
+        AutoUpdaterSink filesink(*this, patchedName.c_str(), delta->attributeURL, &verifier);
+        PatchSink patchsink(filesink, prior, &patchverifier);
+        Download inet(d_impl->d_session);
+
+        patchsink.expect(prior_sha, d_manifest.attributeSHASignature);
+        inet.limiter(&d_impl->d_limiter);
+        inet.decompress(compression > 0);
+        if (inet.get(delta->attributeURL, patchsink) && inet.completion()) {
+            patchsink.close();
+            if (! patchsink.complete() || ! patchverifier.Final()) {
+                LOG<LOG_WARN>() << "Install: delta incomplete or unverified" << LOG_ENDL;
+            } else if (! filesink.Streamed() || ! verifier.Final()) {
+                LOG<LOG_WARN>() << "Install: reconstructed image unverified" << LOG_ENDL;
+            } else {
+                success = true;
+            }
+        }
+    } catch (const std::exception &e) {
+        LOG<LOG_WARN>() << "Install: delta exception : " << e.what() << LOG_ENDL;
+    }
+
+    if (success && ! ::MoveFileExA(patchedName.c_str(), targetName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        LOG<LOG_WARN>() << "Install: unable to rename <" << patchedName << "> : " << GetLastError() << LOG_ENDL;
+        success = false;
+    }
+    if (! success) {
+        LOG<LOG_INFO>() << "Install: delta unavailable, using full image" << LOG_ENDL;
+        ::DeleteFileA(patchedName.c_str());
+    }
+    return success;
+}
+
+
+//
+//  Chunk reuse; those chunks of the enclosure held within the retained prior installer are
+//  copied, the remainder downloaded as byte ranges, then the image assembled verified in
+//  full. Returns false on any failure, the caller then falling back to the full enclosure.
+//
+bool
+AutoUpdater::Reuse(const std::string &targetName)
+{
+    const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+    std::string prior, prior_version;
+
+    if (! ReuseSource(d_manifest, prior, prior_version)) {
+        return false;
+    }
+
+    const std::string chunkedName = targetName + ".chunked";
+    uint64_t total = 0, fetched = 0;
+    size_t ranges = 0;
+    bool success = false;
+
+    LOG<LOG_INFO>() << "Install: chunk reuse from <" << prior_version << ">, <" << d_manifest.attributeChunks << ">" << LOG_ENDL;
+    try {
+        StringDownloadSink indexsink;
+        Download inet(d_impl->d_session);
+        ChunkIndex index;
+        ChunkSource source(prior);
+
+        inet.limiter(&d_impl->d_limiter);
+        if (! inet.get(d_manifest.attributeChunks, indexsink) || ! inet.completion() ||
+                ! index.Load(indexsink.data()) || index.Length() != _strtoui64(d_manifest.attributeLength.c_str(), NULL, 0)) {
+            throw AppException("chunk index unavailable");
+        }
+
+        if (! source.Scan(index)) {
+            throw AppException("prior installer unavailable");
+        }
+
+        AutoUpdaterSink filesink(*this, chunkedName.c_str(), d_manifest.attributeURL);
+        std::vector<std::pair<uint64_t, uint64_t> > missing;
+
+        total = index.Length();
+        filesink.set_size((size_t)total);
+        if (! filesink.open()) {
+            throw SysException("Unable to create installer image");
+        }
+
+        const std::vector<ChunkEntry> &chunks = index.Chunks();
+        for (std::vector<ChunkEntry>::const_iterator it(chunks.begin()), end(chunks.end()); it != end; ++it) {
+            if (const uint8_t *data = source.Find(*it)) {
+                filesink.write_at(it->offset, data, it->length);
+
+            } else if (! missing.empty() &&     // coalesce, absorbing short runs of reusable chunks.
+                        (it->offset - (missing.back().first + missing.back().second)) <= RANGE_GAP) {
+                missing.back().second = (it->offset + it->length) - missing.back().first;
+
+            } else {
+                missing.push_back(std::make_pair(it->offset, (uint64_t)it->length));
+            }
+        }
+
+        for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator it(missing.begin()), end(missing.end()); it != end; ++it) {
+            RangeSink rangesink(filesink, it->first);
+
+            if (ProgressCancelled()) {
+                throw AppException("cancelled");
+            }
+            inet.range(it->first, it->second);
+            if (! inet.get(d_manifest.attributeURL, rangesink) || ! inet.completion() || rangesink.Count() != it->second) {
+                throw AppException("range transfer incomplete");
+            }
+            fetched += it->second;
+            ++ranges;
+        }
+        filesink.close();
+
+        success = Verify(chunkedName);
+        if (! success) {
+            LOG<LOG_WARN>() << "Install: assembled image unverified" << LOG_ENDL;
+        }
+    } catch (const std::exception &e) {
+        LOG<LOG_WARN>() << "Install: chunk reuse exception : " << e.what() << LOG_ENDL;
+    }
+
+    if (success && ! ::MoveFileExA(chunkedName.c_str(), targetName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        LOG<LOG_WARN>() << "Install: unable to rename <" << chunkedName << "> : " << GetLastError() << LOG_ENDL;
+        success = false;
+    }
+    if (success) {
+        LOG<LOG_INFO>() << "Install: chunk reuse, length=" << total << ", reused=" << (total - fetched)
+            << " (" << (total ? ((total - fetched) * 100) / total : 0) << "%), fetched=" << fetched
+            << " over " << ranges << " ranges" << LOG_ENDL;
+    } else {
+        LOG<LOG_INFO>() << "Install: chunk reuse unavailable, using full image" << LOG_ENDL;
+        ::DeleteFileA(chunkedName.c_str());
+    }
+    return success;
+}
+
+
+//
+//  Speculative installer download whilst the install prompt is displayed; opt-in.
+//
+void
+AutoUpdater::PreDownloadStart()
+{
+    const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+    bool predownload = false;
+
+    if (d_impl->d_predownload || d_manifest.attributeURL.empty() ||
+            ! Config::ReadConfigValue(KEY_PREDOWNLOAD, predownload) || !predownload) {
+        return;
+    }
+
+    try {
+        const int compression = EnclosureCompression(d_manifest);
+        if (compression < 0) {
+            return;                             // reported by InstallNow().
+        }
+
+        if (! InstallerCache::Lookup(
+                InstallerCache::Key(d_manifest.attributeSHASignature, d_manifest.attributeEDSignature)).empty()) {
+            return;                             // cached, see InstallNow().
+        }
+
+        std::string prior, prior_sha;
+        if (DeltaSource(d_manifest, prior, prior_sha) || ReuseSource(d_manifest, prior, prior_sha)) {
+            return;                             // delta or chunk reuse applied by InstallNow().
+        }
+
+        d_impl->Pacing(false);                  // speculative, paced as background.
+        PreDownload *t_predownload =
+            new PreDownload(*this, GetTargetName(), d_manifest.attributeURL, d_impl->d_session, &d_impl->d_limiter,
+                    (compression > 0 ? _strtoui64(d_manifest.attributeLength.c_str(), NULL, 0) : 0));
+        if (t_predownload->Start(DownloadFlags())) {
+            d_impl->d_predownload = t_predownload;
+        } else {
+            delete t_predownload;
+        }
+    } catch (const std::exception &e) {
+        LOG<LOG_ERROR>() << "PreDownload: exception : " << e.what() << LOG_ENDL;
+    }
+}
+
+
+//
+//  Conclude the speculative download, if any; either discarding the image or retaining
+//  it for InstallNow(). When discarding, a complete image may first be placed within the
+//  installer cache. Returns true when the image is complete.
+//
+bool
+AutoUpdater::PreDownloadStop(bool discard, bool cache)
+{
+    PreDownload *t_predownload = d_impl->d_predownload;
+    bool complete = false;
+
+    if (t_predownload) {
+        d_impl->d_predownload = NULL;
+        if (discard) {
+            if (cache && t_predownload->Stop(false)) {
+                try {
+                    const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+                    if (Verify(t_predownload->filename())) {
+                        InstallerCache::Store(t_predownload->filename(),
+                            InstallerCache::Key(d_manifest.attributeSHASignature, d_manifest.attributeEDSignature), InstallerCapacity());
+                    }
+                } catch (const std::exception &e) {
+                    LOG<LOG_WARN>() << "PreDownload: cache exception : " << e.what() << LOG_ENDL;
+                }
+            }
+            t_predownload->Discard();
+        } else {
+            complete = t_predownload->Stop(true);
+        }
+        delete t_predownload;
+    }
+    return complete;
+}
+
+
+static std::string
+TargetImage(const std::string &tempdir, const Updater::AutoManifest &d_manifest)
+{
+    char tempfile[MAX_PATH];
+
+    // download image
+    if (d_manifest.attributeName.length()) {
+        std::string name(d_manifest.attributeName);
+
+        if (EnclosureCompression(d_manifest) > 0 && HasSuffix(name, ".gz")) {
+            name.erase(name.length() - 3);      // decompressed on arrival.
+        }
+        sprintf_s(tempfile, sizeof(tempfile), "%s\\%s",
+                    tempdir.c_str(), name.c_str());
+    } else {
+        sprintf_s(tempfile, sizeof(tempfile), "%s\\installer-%s.exe",
+                    tempdir.c_str(), d_manifest.attributeVersion.c_str());
+    }
+    return tempfile;
+}
+
+
 const std::string&
 AutoUpdater::GetTargetName()
 {
@@ -899,7 +2613,31 @@ AutoUpdater::GetTargetName()
         temppath[len] = '\0';
     }
 
-    // create temporary working directory
+    // stable per-version working directory, permitting resumption across attempts
+    if (! d_manifest.attributeVersion.empty()) {
+        std::string tempdir(temppath);
+
+        tempdir += "AutoUpdate-";
+        tempdir += Config::GetAppName();
+        tempdir += "-";
+        tempdir += d_manifest.attributeVersion;
+        for (size_t idx = len; idx < tempdir.length(); ++idx) {
+            if (strchr("\\/:*?\"<>| ", tempdir[idx])) {
+                tempdir[idx] = '_';             // file-system safe.
+            }
+        }
+
+        if (::CreateDirectoryA(tempdir.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS) {
+            const DWORD attributes = ::GetFileAttributesA(tempdir.c_str());
+            if (INVALID_FILE_ATTRIBUTES != attributes && (attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                d_impl->d_tempdir = tempdir;
+                d_impl->d_tempfile = TargetImage(tempdir, d_manifest);
+                return d_impl->d_tempfile;
+            }
+        }
+    }
+
+    // otherwise unique temporary working directory
     for (;;) {
         std::string tempdir(temppath);
         RPC_CSTR uuidStr = 0;
@@ -913,19 +2651,8 @@ AutoUpdater::GetTargetName()
 
         // create localised unique directory
         if (::CreateDirectoryA(tempdir.c_str(), NULL)) {
-            char tempfile[MAX_PATH];
-
-            // download image
-            if (d_manifest.attributeName.length()) {
-                sprintf_s(tempfile, sizeof(tempfile), "%s\\%s",
-                            tempdir.c_str(), d_manifest.attributeName.c_str());
-            } else {
-                sprintf_s(tempfile, sizeof(tempfile), "%s\\installer-%s.exe",
-                            tempdir.c_str(), d_manifest.attributeVersion.c_str());
-            }
-
             d_impl->d_tempdir = tempdir;
-            d_impl->d_tempfile.assign(tempfile);
+            d_impl->d_tempfile = TargetImage(tempdir, d_manifest);
             return d_impl->d_tempfile;
 
         } else if (GetLastError() != ERROR_ALREADY_EXISTS) {
@@ -936,49 +2663,20 @@ AutoUpdater::GetTargetName()
 }
 
 
+//
+//  Verify the installer image; compressed enclosures are decompressed on arrival, as such
+//  the length and signatures are those of the decompressed image.
+//
 bool
 AutoUpdater::Verify(const std::string &filename)
 {
     const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
-    uint8_t ed25519_signature[ED25519_SIGNATURE_LENGTH] = {0};
-    const void *ed25519_public_key = NULL;
-    HCRYPTPROV hProv = 0;
-    HCRYPTHASH hHash = 0;
     DWORD fileSize;
     HANDLE hFile;
 
     LOG<LOG_TRACE>() << "Verify: target image <" << filename << ">" << LOG_ENDL;
 
-    // Signature
-    if (Config::PublicKeyNumber()) {
-        unsigned key_type = 0;
-        size_t key_length = 0;
-
-        ed25519_public_key = 
-                Config::PublicKeyFind(d_manifest.attributeEDKeyVersion, key_type, key_length);
-        if (ed25519_public_key == NULL || key_type != 0x01 /*ed25519*/) {
-            throw AppException(Updater::format("Verify: unknown key-version <%s>", 
-                        d_manifest.attributeEDKeyVersion.c_str()));
-        }
-
-        if (key_length != ED25519_PUBLIC_LENGTH) {
-            throw AppException(Updater::format("Verify: invalid public key length, key-version <%s>",
-                    d_manifest.attributeEDKeyVersion.c_str()));
-        }
-
-        const std::string &edSignature = d_manifest.attributeEDSignature;
-        if (edSignature.empty()) {
-            throw AppException(Updater::format("Verify: edSignature missing for key-version <%s>",
-                        d_manifest.attributeEDKeyVersion.c_str()));
-        }
-
-        const size_t signature_length =
-                Updater::Base64::decode(edSignature.c_str(), edSignature.size(), ed25519_signature, sizeof(ed25519_signature));
-        if (signature_length != ED25519_SIGNATURE_LENGTH) {
-            throw AppException(Updater::format("Verify: invalid signature length, key-version <%s>",
-                        d_manifest.attributeEDKeyVersion.c_str()));
-        }
-    }
+    ImageVerifier verifier(d_manifest);         // signature and hash context.
 
     // Open source
     if (INVALID_HANDLE_VALUE == (hFile = CreateFileA(filename.c_str(),
@@ -994,116 +2692,64 @@ AutoUpdater::Verify(const std::string &filename)
         CloseHandle(hFile);
         return false;
 
-    } else if (fileSize != static_cast<DWORD>(strtol(d_manifest.attributeLength.c_str(), NULL, 0))) {
+    } else if (fileSize != verifier.Expected()) {
         LOG<LOG_WARN>() << "target-length incorrect (" << fileSize
                 << " and " << d_manifest.attributeLength << ")" << LOG_ENDL;
         CloseHandle(hFile);
         return false;
     }
 
-    // Crypt provider handle
-    const int hashType =
-        (d_manifest.attributeSHASignature.length() ? CALG_SHA : CALG_MD5);
-
-    if (! CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) ||
-            ! CryptCreateHash(hProv, hashType, 0, 0, &hHash)) {
-        DWORD dwStatus = GetLastError();
-        if (hProv) CryptReleaseContext(hProv, 0);
-        CloseHandle(hFile);
-        throw SysException(dwStatus, "CryptAcquireContext failed.");
-    }
-
     // Calculate hash
-    int ed22519_verification = 1;               // ed22519 verify result.
-    std::string hash;                           // MD5/SHA derived hash.
-
     {
 #define IOBUFFER_SIZE (64 * 1024)
-        void *ed22519_context = NULL;
         const char *dwMessage = NULL;
         DWORD dwStatus = 0;
         BYTE *ioBuffer;
 
         if (NULL == (ioBuffer = static_cast<BYTE *>(malloc(IOBUFFER_SIZE)))) {
+            CloseHandle(hFile);
             throw SysException(ERROR_NOT_ENOUGH_MEMORY, "Memory allocation.");
         }
 
-        if (ed25519_public_key != NULL) {       // ed22519 signature
-            ed22519_context = ed25519_verify_init(ed25519_signature, static_cast<const uint8_t *>(ed25519_public_key));
-            ed22519_verification = -1;
-        }
-
-        while (1) {
-            DWORD ioSize = 0;
+        try {
+            while (1) {
+                DWORD ioSize = 0;
 
-            if (! ::ReadFile(hFile, ioBuffer, IOBUFFER_SIZE, &ioSize, NULL)) {
-                dwMessage = "Unable to read working file.";
-                dwStatus = GetLastError();
-                break;
-            }
+                if (! ::ReadFile(hFile, ioBuffer, IOBUFFER_SIZE, &ioSize, NULL)) {
+                    dwMessage = "Unable to read working file.";
+                    dwStatus = GetLastError();
+                    break;
+                }
 
-            if (ioSize == 0) {
-                break;
-            }
+                if (ioSize == 0) {
+                    break;
+                }
 
-            if (! CryptHashData(hHash, ioBuffer, ioSize, 0)) {
-                dwMessage = "CryptHashData failed.";
-                dwStatus = GetLastError();
-                break;
+                verifier.Update(ioBuffer, ioSize);
             }
-
-            ed25519_verify_update(ed22519_context, ioBuffer, ioSize);
+        } catch (...) {
+            CloseHandle(hFile);
+            free(ioBuffer);
+            throw;
         }
 
         CloseHandle(hFile);
         free(ioBuffer);
 
-        if (NULL == dwMessage) {
-            BYTE hashBuffer[20] = {0};          // 16=MD5,20=SHA
-            DWORD hashSize = sizeof(hashBuffer);
-
-            if (CryptGetHashParam(hHash, HP_HASHVAL, hashBuffer, &hashSize, 0)) {
-                hash = Updater::Hex::to_string(hashBuffer, hashSize);
-            }
-        }
-
-        CryptDestroyHash(hHash);
-        CryptReleaseContext(hProv, 0);
-
-        if (ed22519_context) {                  // ed22519 signature
-            ed22519_verification = ed25519_verify_final(ed22519_context);
-            ed22519_context = NULL;
-        }
-
         if (dwMessage) {
             throw SysException(dwStatus, dwMessage);
         }
     }
 
     // Hash/sign comparisons
-    LOG<LOG_TRACE>() << "Verify: target-hash=<" << hash << ">" << LOG_ENDL;
-
-    if ((hashType == CALG_SHA && hash == d_manifest.attributeSHASignature) ||
-            (hashType == CALG_MD5 && hash == d_manifest.attributeMD5Signature)) {
-
-        if (ed25519_public_key) {
-            if (ed22519_verification != 1) {
-                LOG<LOG_WARN>() << "ed25519-verify failed" << LOG_ENDL;
-                return false;
-            }
-            LOG<LOG_TRACE>() << "Verify: target-signature=<ed25519-verified>" << LOG_ENDL;
-        }
-        return true;
-    }
-
-    LOG<LOG_WARN>() << "target-hash incorrect" << LOG_ENDL;
-    return false;
+    return verifier.Final();
 }
 
 
 void
 AutoUpdater::InstallLater()
 {
+    PreDownloadStop(true, true);                // complete image, cached for the later install.
     Config::WriteConfigValue(KEY_AUTOLAST, time(NULL));
     Config::WriteConfigValue(KEY_SKIPVERSION, "");
     Config::WriteConfigValue(KEY_SKIPTIME, 0);
@@ -1113,7 +2759,9 @@ AutoUpdater::InstallLater()
 void
 AutoUpdater::InstallSkip()
 {
+    CriticalSection::Guard checking(d_impl->d_checking);
     const Updater::AutoManifest &d_manifest = d_impl->d_manifest;
+    PreDownloadStop(true);
     Config::WriteConfigValue(KEY_SKIPVERSION, d_manifest.attributeVersion.c_str());
     Config::WriteConfigValue(KEY_SKIPTIME, time(NULL));
 }
@@ -1133,6 +2781,8 @@ int
 AutoUpdater::InstallDialog()
 {
     if (IAutoUpdaterUI *dialog = d_impl->GetDialog()) {
+        std::string content;
+        ReleaseNotes(content);                  // start retrieval, ahead of presentation.
         return dialog->InstallDialog(*this);
     }
     return -1;
@@ -1154,6 +2804,7 @@ AutoUpdater::ProgressStart(HWND parent, bool indeterminate, const char *msg)
     if (IAutoUpdaterUI *dialog = d_impl->GetDialog()) {
         dialog->ProgressStart(*this, parent, indeterminate, msg);
     }
+    d_impl->d_meter.Start(d_impl->GetDialog());
 }
 
 
@@ -1179,6 +2830,7 @@ AutoUpdater::ProgressCancelled()
 bool
 AutoUpdater::ProgressStop()
 {
+    d_impl->d_meter.Stop();
     if (IAutoUpdaterUI *dialog = d_impl->GetDialog()) {
         return dialog->ProgressStop();
     }
@@ -58,6 +58,11 @@ public:
     virtual HWND GetParent() = 0;
 };
 
+class IUpdateNotify {                           // background checks, see AutoUpdater::Schedule().
+public:
+    virtual void UpdateAvailable(const Updater::AutoManifest &manifest) = 0;
+};
+
 class LIBAUTOUPDATER_LINKAGE AutoUpdater {
 public:
     AutoUpdater(IAutoUpdaterUI *dialog = NULL);
@@ -92,10 +97,25 @@ public:
     // Retrieve application details
     const Updater::AutoManifest& Manifest() const;
 
+    // Release notes; retrieved in the background on first request.
+    enum ReleaseNotesStatus {
+        NotesNone = 0,                          // none published, see Manifest().description.
+        NotesPending,                           // retrieval in progress.
+        NotesAvailable,                         // content available.
+        NotesFailed                             // retrieval failed.
+    };
+
+    ReleaseNotesStatus  ReleaseNotes(std::string &content);
+
     // Public registry interface
     bool                GetAuto() const;
     void                SetAuto(bool state);
 
+    // Background periodic checks, at the configured interval with jitter; 'notify' is invoked
+    // from the scheduler thread, only when an update not skipped is available.
+    bool                Schedule(IUpdateNotify &notify);
+    void                Unschedule();
+
 public:
     // Dialog actions
     bool                InstallNow(IInstallNow &updater, bool interactive = false);
@@ -108,8 +128,14 @@ public:
 
 private:
     // Support functions
+    int                 CheckAvailable(bool interactive, Updater::AutoManifest &candidate, HANDLE interrupt = NULL);
     const std::string&  GetTargetName();
+    void                PreDownloadStart();
+    bool                PreDownloadStop(bool discard, bool cache = false);
     bool                Verify(const std::string &filename);
+    bool                Cached(const std::string &targetName);
+    bool                Patch(const std::string &targetName);
+    bool                Reuse(const std::string &targetName);
 
     // Registry functions
     enum UpdateStatus {
@@ -120,6 +146,7 @@ private:
     };
 
     enum UpdateStatus   Status(const enum ExecuteMode mode);
+    static unsigned     PhasedGroup(const std::string &appname);
     bool                Once() const;
     void                SetOnce(bool val);
     void                Dump();
@@ -141,6 +168,8 @@ private:
 private:
     friend class AutoUpdaterImpl;
     friend class AutoUpdaterSink;
+    friend class UpdateScheduler;
+    friend class AutoUpdateSuiteImpl;
     class AutoUpdaterImpl *d_impl;              // implementation.
 };
 
@@ -0,0 +1,204 @@
+//  $Id: AutoVerify.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: installer image verification.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+#include <cassert>
+
+#include "AutoVerify.h"
+#include "AutoConfig.h"
+#include "AutoError.h"
+#include "AutoLogger.h"
+
+#include "../util/Format.h"
+#include "../util/Base64.h"
+#include "../util/Hex.h"
+
+#include <Wincrypt.h>
+
+namespace Updater {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ImageVerifier
+//
+
+ImageVerifier::ImageVerifier(const AutoManifest &manifest) :
+    manifest_(manifest), ed25519_public_key_(NULL), ed25519_context_(NULL), hProv_(0), hHash_(0),
+        hashType_(manifest.attributeSHASignature.length() ? CALG_SHA : CALG_MD5),
+        expected_(_strtoui64(manifest.attributeLength.c_str(), NULL, 0)), count_(0)
+{
+    memset(ed25519_signature_, 0, sizeof(ed25519_signature_));
+
+    // Signature
+    if (Config::PublicKeyNumber()) {
+        unsigned key_type = 0;
+        size_t key_length = 0;
+
+        ed25519_public_key_ = 
+                Config::PublicKeyFind(manifest.attributeEDKeyVersion, key_type, key_length);
+        if (ed25519_public_key_ == NULL || key_type != 0x01 /*ed25519*/) {
+            throw AppException(Updater::format("Verify: unknown key-version <%s>", 
+                        manifest.attributeEDKeyVersion.c_str()));
+        }
+
+        if (key_length != ED25519_PUBLIC_LENGTH) {
+            throw AppException(Updater::format("Verify: invalid public key length, key-version <%s>",
+                    manifest.attributeEDKeyVersion.c_str()));
+        }
+
+        const std::string &edSignature = manifest.attributeEDSignature;
+        if (edSignature.empty()) {
+            throw AppException(Updater::format("Verify: edSignature missing for key-version <%s>",
+                        manifest.attributeEDKeyVersion.c_str()));
+        }
+
+        const size_t signature_length =
+                Updater::Base64::decode(edSignature.c_str(), edSignature.size(), ed25519_signature_, sizeof(ed25519_signature_));
+        if (signature_length != ED25519_SIGNATURE_LENGTH) {
+            throw AppException(Updater::format("Verify: invalid signature length, key-version <%s>",
+                        manifest.attributeEDKeyVersion.c_str()));
+        }
+    }
+
+    // Crypt provider handle
+    HCRYPTPROV hProv = 0;
+    HCRYPTHASH hHash = 0;
+
+    if (! CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) ||
+            ! CryptCreateHash(hProv, hashType_, 0, 0, &hHash)) {
+        DWORD dwStatus = GetLastError();
+        if (hProv) CryptReleaseContext(hProv, 0);
+        throw SysException(dwStatus, "CryptAcquireContext failed.");
+    }
+    hProv_ = hProv, hHash_ = hHash;
+
+    if (ed25519_public_key_ != NULL) {          // ed22519 signature
+        ed25519_context_ = ed25519_verify_init(ed25519_signature_, static_cast<const uint8_t *>(ed25519_public_key_));
+    }
+}
+
+
+ImageVerifier::~ImageVerifier()
+{
+    Release();
+}
+
+
+void
+ImageVerifier::Update(const void *data, size_t length)
+{
+    if (0 == length) {
+        return;
+    }
+
+    if ((count_ + length) > expected_) {        // early rejection.
+        LOG<LOG_WARN>() << "target-length exceeded (" << (count_ + length)
+                << " and " << manifest_.attributeLength << ")" << LOG_ENDL;
+        throw AppException("Installer image exceeds expected length.");
+    }
+
+    if (! CryptHashData((HCRYPTHASH)hHash_, static_cast<const BYTE *>(data), (DWORD)length, 0)) {
+        throw SysException("CryptHashData failed.");
+    }
+    ed25519_verify_update(ed25519_context_, static_cast<const uint8_t *>(data), length);
+    count_ += length;
+}
+
+
+bool
+ImageVerifier::Final()
+{
+    std::string hash;                           // MD5/SHA derived hash.
+    int ed22519_verification = 1;               // ed22519 verify result.
+
+    if (0 == count_ || count_ != expected_) {
+        LOG<LOG_WARN>() << "target-length incorrect (" << count_
+                << " and " << manifest_.attributeLength << ")" << LOG_ENDL;
+        Release();
+        return false;
+    }
+
+    if (hHash_) {
+        BYTE hashBuffer[20] = {0};              // 16=MD5,20=SHA
+        DWORD hashSize = sizeof(hashBuffer);
+
+        if (CryptGetHashParam((HCRYPTHASH)hHash_, HP_HASHVAL, hashBuffer, &hashSize, 0)) {
+            hash = Updater::Hex::to_string(hashBuffer, hashSize);
+        }
+    }
+
+    if (ed25519_public_key_) {                  // ed22519 signature
+        ed22519_verification = ed25519_verify_final(ed25519_context_);
+        ed25519_context_ = NULL;
+    }
+    Release();
+
+    // Hash/sign comparisons
+    LOG<LOG_TRACE>() << "Verify: target-hash=<" << hash << ">" << LOG_ENDL;
+
+    if ((hashType_ == CALG_SHA && hash == manifest_.attributeSHASignature) ||
+            (hashType_ == CALG_MD5 && hash == manifest_.attributeMD5Signature)) {
+
+        if (ed25519_public_key_) {
+            if (ed22519_verification != 1) {
+                LOG<LOG_WARN>() << "ed25519-verify failed" << LOG_ENDL;
+                return false;
+            }
+            LOG<LOG_TRACE>() << "Verify: target-signature=<ed25519-verified>" << LOG_ENDL;
+        }
+        return true;
+    }
+
+    LOG<LOG_WARN>() << "target-hash incorrect" << LOG_ENDL;
+    return false;
+}
+
+
+//private
+void
+ImageVerifier::Release()
+{
+    if (ed25519_context_) {
+        (void) ed25519_verify_final(ed25519_context_);
+        ed25519_context_ = NULL;
+    }
+
+    if (hHash_) {
+        CryptDestroyHash((HCRYPTHASH)hHash_);
+        hHash_ = 0;
+    }
+
+    if (hProv_) {
+        CryptReleaseContext((HCRYPTPROV)hProv_, 0);
+        hProv_ = 0;
+    }
+}
+
+}   // namespace Updater
+
+//end
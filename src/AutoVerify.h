@@ -0,0 +1,85 @@
+#ifndef AUTOVERIFY_H_INCLUDED
+#define AUTOVERIFY_H_INCLUDED
+//  $Id: AutoVerify.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: installer image verification.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+
+#include "common.h"
+
+#include <string>
+
+#include "AutoManifest.h"
+#include "../ed25519/src/ed25519.h"
+
+namespace Updater {
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  ImageVerifier
+//
+//  Incremental installer image verification against the manifest; image length,
+//  SHA-1 (otherwise MD5) digest and optional ed25519 signature.
+//
+//      Update()        Feed the next image segment; throws once the image exceeds
+//                      the manifest length.
+//      Final()         Complete verification, true on success.
+//
+
+class ImageVerifier {
+    ImageVerifier(const ImageVerifier &rhs);
+    ImageVerifier& operator=(const ImageVerifier &rhs);
+
+public:
+    ImageVerifier(const AutoManifest &manifest);
+    ~ImageVerifier();
+
+    uint64_t            Expected() const {
+        return expected_;
+    }
+    uint64_t            Count() const {
+        return count_;
+    }
+
+    void                Update(const void *data, size_t length);
+    bool                Final();
+
+private:
+    void                Release();
+
+private:
+    const AutoManifest &manifest_;
+    uint8_t             ed25519_signature_[ED25519_SIGNATURE_LENGTH];
+    const void *        ed25519_public_key_;
+    void *              ed25519_context_;
+    ULONG_PTR           hProv_;                 // HCRYPTPROV
+    ULONG_PTR           hHash_;                 // HCRYPTHASH
+    unsigned            hashType_;
+    uint64_t            expected_;              // manifest image length.
+    uint64_t            count_;                 // bytes processed.
+};
+
+}   // namespace Updater
+
+#endif  //AUTOVERIFY_H_INCLUDED
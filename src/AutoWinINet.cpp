@@ -0,0 +1,668 @@
+//  $Id: AutoWinINet.cpp,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: download transport, WinINet implementation.
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2012 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+#include "common.h"
+
+#include <string>
+#include <cassert>
+
+#include "AutoTransport.h"
+#include "AutoDownLoad.h"
+#include "AutoString.h"
+#include "AutoConfig.h"
+#include "AutoLogger.h"
+#include "AutoError.h"
+
+#include <wininet.h>
+#if defined(PRAGMA_COMMENT_LIB)
+#pragma comment(lib, "Wininet.lib")
+#endif
+
+// supported on Windows 10, version 1507 and later.
+#if !defined(INTERNET_OPTION_ENABLE_HTTP_PROTOCOL)
+#define INTERNET_OPTION_ENABLE_HTTP_PROTOCOL 148
+#endif
+#if !defined(HTTP_PROTOCOL_FLAG_HTTP2)
+#define HTTP_PROTOCOL_FLAG_HTTP2 0x2
+#endif
+
+namespace Updater {
+
+namespace {
+class INETHandle {
+    INETHandle(INETHandle &rhs);
+    INETHandle& operator=(INETHandle &rhs);
+
+public:
+    INETHandle(HINTERNET handle = 0) : handle_(handle), callback_(false) { }
+
+    ~INETHandle() {
+        close();
+    }
+
+    INETHandle& operator=(HINTERNET handle) {
+        if (handle != handle_) {
+            close(), handle_ = handle;
+        }
+        return *this;
+    }
+
+    operator HINTERNET() const {
+        return handle_;
+    }
+
+    bool set_callback(INTERNET_STATUS_CALLBACK callback) {
+        INTERNET_STATUS_CALLBACK CallbackPointer =
+                ::InternetSetStatusCallback(handle_, callback);
+        if (INTERNET_INVALID_STATUS_CALLBACK == CallbackPointer) {
+            return false;
+        }
+        callback_ = true;
+        return true;
+    }
+
+    void close() {
+        if (HINTERNET handle = handle_) {
+            handle_ = 0;
+            if (callback_) { //unhook callback, stop closing notification.
+                ::InternetSetStatusCallback(handle, NULL);
+                callback_ = false;
+            }
+            ::InternetCloseHandle(handle);
+        }
+    }
+
+private:
+    HINTERNET handle_;
+    bool callback_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  WinINetState
+//
+//  Internet handle shared by the requests of a session; WinINet maintains its keep-alive
+//  connection pool per internet handle, hence reuse is only possible when shared.
+//
+
+class WinINetState : public TransportSession::State {
+public:
+    INETHandle internet_handle_;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//  WinINetTransport
+//
+
+class WinINetTransport : public ITransport {
+    WinINetTransport(const WinINetTransport &rhs);
+    WinINetTransport& operator=(const WinINetTransport &rhs);
+
+public:
+    WinINetTransport(TransportSession *session);
+    virtual ~WinINetTransport();
+
+    virtual const char *Name() const {
+        return "wininet";
+    }
+
+    virtual void Open(const TransportRequest &request, TransportResponse &response);
+    virtual size_t Read(void *buffer, size_t length);
+    virtual void Abort();
+
+private:
+    HINTERNET InternetOpen();
+    void InternetError(const char *message, const DWORD ret = GetLastError());
+    static bool Loopback(const std::string &host);
+
+    static VOID CALLBACK callback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus,
+            LPVOID lpvStatusInformation, DWORD dwStatusInformationLength);
+
+private:
+    CriticalSection lock_;
+    TransportSession *session_;
+    INETHandle session_handle_;                 // private internet handle, otherwise shared.
+    HINTERNET internet_handle_;
+    INETHandle request_handle_;
+    HANDLE callback_trigger_;
+    volatile bool connected_;
+};
+
+
+WinINetTransport::WinINetTransport(TransportSession *session) :
+    session_(session),
+    internet_handle_(0),
+    callback_trigger_(::CreateEventW(NULL, FALSE, FALSE, NULL)),
+    connected_(false)
+{
+    if (session_) {
+        session_->AddRef();
+    }
+}
+
+
+WinINetTransport::~WinINetTransport()
+{
+    Abort();
+    if (callback_trigger_) {
+        ::CloseHandle(callback_trigger_);
+    }
+    if (session_) {
+        session_->Release();
+    }
+}
+
+
+//private
+HINTERNET
+WinINetTransport::InternetOpen()
+{
+    const std::string user_agent =
+        Config::GetAppName() + "/" +  Config::GetAppVersion() + " AutoUpdate";
+    HINTERNET handle =
+        InternetOpenA(user_agent.c_str(), INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL,  0);
+
+    if (handle) {
+        DWORD http2_option = HTTP_PROTOCOL_FLAG_HTTP2;
+        ::InternetSetOption(handle, INTERNET_OPTION_ENABLE_HTTP_PROTOCOL, &http2_option, sizeof(http2_option));
+    }
+    return handle;
+}
+
+
+void
+WinINetTransport::Open(const TransportRequest &request, TransportResponse &response)
+{
+    const std::string &url = request.url;
+
+    // extract url components
+    URL_COMPONENTSA uc = { sizeof(uc) };
+
+    uc.dwHostNameLength = 1;
+    uc.dwUrlPathLength = 1;
+    uc.dwExtraInfoLength = 1;
+    if (! InternetCrackUrlA(url.c_str(), 0, 0, &uc)) {
+        throw SysException("Invalid URL");
+    }
+
+    if (NULL == uc.lpszHostName || 0 == uc.dwHostNameLength) {
+        throw AppException("Invalid URL, missing hostname");
+
+    } else if (NULL == uc.lpszUrlPath || 0 == uc.dwUrlPathLength) {
+        throw AppException("Invalid URL, missing url_path");
+
+    } else if (INTERNET_SCHEME_HTTP == uc.nScheme && (0 == (Download::LOOPBACK & request.flags) ||
+                    ! Loopback(std::string(uc.lpszHostName, uc.dwHostNameLength)))) {
+        throw AppException("Invalid URL, insecure transport");
+    }
+
+    // open session
+    const DWORD dwFlags =
+            INTERNET_FLAG_RELOAD | // Forces a download of the requested file from the origin server, not from the cache.
+            INTERNET_FLAG_NO_CACHE_WRITE | // Does not add the returned entity to the cache.
+            (uc.nScheme == INTERNET_SCHEME_HTTPS ? INTERNET_FLAG_SECURE : 0) | // Secure transaction semantics.
+            (Download::NOCACHED & request.flags ? INTERNET_FLAG_PRAGMA_NOCACHE : 0);
+
+    if (session_) {                             // shared handle, created on first use.
+        CriticalSection::Guard session_guard(session_->Lock());
+        WinINetState *state = static_cast<WinINetState *>(session_->GetState(TransportSession::SLOT_WININET));
+        if (NULL == state) {
+            if (HINTERNET handle = InternetOpen()) {
+                state = new WinINetState;
+                state->internet_handle_ = handle;
+                state->internet_handle_.set_callback(callback);
+                session_->SetState(TransportSession::SLOT_WININET, state);
+            }
+        }
+        CriticalSection::Guard guard(lock_);
+        internet_handle_ = (state ? (HINTERNET)state->internet_handle_ : 0);
+
+    } else {
+        CriticalSection::Guard guard(lock_);
+        session_handle_ = InternetOpen();
+        internet_handle_ = session_handle_;
+    }
+    if (! internet_handle_) {
+        InternetError("Opening Internet connection");
+    }
+
+    if (request.connect_timeout >= 0) {
+        DWORD dw = (request.connect_timeout == 0 ? 0xFFFFFFFF : request.connect_timeout * 1000);
+        ::InternetSetOption(internet_handle_, INTERNET_OPTION_CONNECT_TIMEOUT, &dw, sizeof(dw));
+    }
+
+    if (request.response_timeout >= 0) {
+        DWORD dw = (request.response_timeout == 0 ? 0xFFFFFFFF : request.response_timeout * 1000);
+        ::InternetSetOption(internet_handle_, INTERNET_OPTION_SEND_TIMEOUT, &dw, sizeof(dw));
+        ::InternetSetOption(internet_handle_, INTERNET_OPTION_RECEIVE_TIMEOUT, &dw, sizeof(dw));
+    }
+
+    // url canonicalization
+    char canonical_url[2000] = {0};
+    DWORD nSize = sizeof(canonical_url);
+    if (! InternetCanonicalizeUrlA(url.c_str(), canonical_url, &nSize, ICU_BROWSER_MODE)) {
+        InternetError("Canonicalizing URL");
+    }
+
+    if (session_handle_) {
+        session_handle_.set_callback(callback);
+    }
+
+    // optional range/conditional headers
+    const std::string headers = Transport::RequestHeaders(request);
+
+    // request
+again:
+    connected_ = false;                         // see INTERNET_STATUS_CONNECTED_TO_SERVER
+    {   CriticalSection::Guard guard(lock_);
+        request_handle_ =
+            ::InternetOpenUrlA(internet_handle_, canonical_url,
+                (headers.empty() ? NULL : headers.c_str()), (headers.empty() ? 0 : (DWORD)-1), dwFlags, (DWORD_PTR)this);
+    }
+    if (! request_handle_) {
+        const DWORD ret = GetLastError();
+        if (ERROR_IO_PENDING != ret) {
+            std::string msg;
+
+            msg += "Opening URL <", msg += canonical_url, msg += ">";
+            if (ERROR_INVALID_HANDLE == ret) {
+                msg += "\nUnable to connect";
+                throw AppException(msg);
+            }
+            InternetError(msg.c_str(), ret);
+        }
+    }
+
+    ::WaitForSingleObject(callback_trigger_, 0);
+
+    if (session_) {                             // reuse, no new connection was established.
+        session_->Count(! connected_);
+    }
+
+    // status
+    DWORD status_code = 0, status_code_len = sizeof(status_code);
+    if (! HttpQueryInfo(request_handle_, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+            &status_code, &status_code_len, 0)) {
+        InternetError("Reading Internet connection");
+
+    } else if (status_code >= 400) {                // error, decode and report
+        DWORD http_msg_len = 0;
+
+        if (request.enable_login) {
+            if (HTTP_STATUS_PROXY_AUTH_REQ == status_code) {
+                if (::InternetErrorDlg(GetDesktopWindow(), request_handle_, ERROR_INTERNET_INCORRECT_PASSWORD,
+                        FLAGS_ERROR_UI_FILTER_FOR_ERRORS |FLAGS_ERROR_UI_FLAGS_GENERATE_DATA |
+                        FLAGS_ERROR_UI_FLAGS_CHANGE_OPTIONS, NULL) == ERROR_INTERNET_FORCE_RETRY) {
+                    goto again;
+                }
+            }
+
+            if (HTTP_STATUS_DENIED == status_code) {
+                if (::InternetErrorDlg(GetDesktopWindow(), request_handle_, ERROR_INTERNET_INCORRECT_PASSWORD,
+                        FLAGS_ERROR_UI_FILTER_FOR_ERRORS |FLAGS_ERROR_UI_FLAGS_GENERATE_DATA |
+                        FLAGS_ERROR_UI_FLAGS_CHANGE_OPTIONS, NULL) == ERROR_INTERNET_FORCE_RETRY) {
+                    goto again;
+                }
+            }
+        }
+
+        if (! ::HttpQueryInfoA(request_handle_, HTTP_QUERY_STATUS_TEXT, NULL, &http_msg_len, 0) &&
+                    GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+            std::string http_msg;
+
+            http_msg.resize(http_msg_len);
+            if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_STATUS_TEXT, NULL, &http_msg_len, 0)) {
+                throw AppException(http_msg);
+            }
+        }
+
+        throw AppException("Unable to download component");
+
+    } else if (status_code < 200 || status_code >= 300) {
+                                                    // reject?
+        LOG<LOG_INFO>() << "Download: unexpected status_code=" << status_code << LOG_ENDL;
+    }
+    response.status_code = status_code;
+
+    // context type
+    {   char content_type[1000] = {0};
+        DWORD content_type_len = sizeof(content_type);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_CONTENT_TYPE,
+                    content_type, &content_type_len, NULL)) {
+            LOG<LOG_INFO>() << "Download: content_type=" << content_type << LOG_ENDL;
+            response.content_type = content_type;
+        }
+    }
+
+    // context size, if available
+    {   char content_length[1000] = {0};
+        DWORD content_length_len = sizeof(content_length);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_CONTENT_LENGTH,
+                content_length, &content_length_len, NULL)) {
+            const int64_t size = _strtoi64(content_length, NULL, 10);
+            if (size > 0) {
+                LOG<LOG_INFO>() << "Download: size=" << size << LOG_ENDL;
+                response.content_length = size;
+            }
+        }
+    }
+
+    // range support; if available
+    {   char accept_ranges[64] = {0};
+        DWORD accept_ranges_len = sizeof(accept_ranges);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_ACCEPT_RANGES,
+                accept_ranges, &accept_ranges_len, NULL)) {
+            response.accept_ranges = (NULL != strstr(accept_ranges, "bytes"));
+        }
+
+        if (HTTP_STATUS_PARTIAL_CONTENT == status_code) {
+            char content_range[128] = {0};
+            DWORD content_range_len = sizeof(content_range);
+            if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_CONTENT_RANGE,
+                    content_range, &content_range_len, NULL)) {
+                LOG<LOG_INFO>() << "Download: content_range=" << content_range << LOG_ENDL;
+                Transport::ContentRange(content_range, response.range_offset);
+            }
+            response.accept_ranges = true;
+        }
+    }
+
+    // last modified; if available
+    {   char last_modified[128] = {0};
+        DWORD last_modified_len = sizeof(last_modified);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_LAST_MODIFIED,
+                last_modified, &last_modified_len, NULL)) {
+            LOG<LOG_INFO>() << "Download: last_modified=" << last_modified << LOG_ENDL;
+            response.last_modified = last_modified;
+        }
+    }
+
+    // entity tag; if available
+    {   char etag[256] = {0};
+        DWORD etag_len = sizeof(etag);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_ETAG,
+                etag, &etag_len, NULL)) {
+            LOG<LOG_INFO>() << "Download: etag=" << etag << LOG_ENDL;
+            response.etag = etag;
+        }
+    }
+
+    // content encoding; decoded by the caller, WinINet decoding is not enabled.
+    {   char content_encoding[64] = {0};
+        DWORD content_encoding_len = sizeof(content_encoding);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_CONTENT_ENCODING,
+                content_encoding, &content_encoding_len, NULL)) {
+            LOG<LOG_INFO>() << "Download: content_encoding=" << content_encoding << LOG_ENDL;
+            response.content_encoding = content_encoding;
+        }
+    }
+
+    // cache directives; if available
+    {   char cache_control[256] = {0};
+        DWORD cache_control_len = sizeof(cache_control);
+        if (::HttpQueryInfoA(request_handle_, HTTP_QUERY_CACHE_CONTROL,
+                cache_control, &cache_control_len, NULL)) {
+            response.cache_control = cache_control;
+        }
+    }
+}
+
+
+size_t
+WinINetTransport::Read(void *buffer, size_t length)
+{
+    DWORD read = 0;
+    if (! InternetReadFile(request_handle_, buffer, (DWORD)length, &read)) {
+        throw SysException("Reading Internet connection");
+    }
+    return read;
+}
+
+
+void
+WinINetTransport::Abort()
+{
+    CriticalSection::Guard guard(lock_);
+    if (internet_handle_) {
+        if (request_handle_) {
+            request_handle_.close();
+            ::SetEvent(callback_trigger_);
+        }
+        session_handle_.close();                // private handle only; shared retained by session.
+        internet_handle_ = 0;
+    }
+}
+
+
+//private
+void
+WinINetTransport::InternetError(const char *message, const DWORD ret)
+{
+    if (ERROR_INTERNET_EXTENDED_ERROR == ret) {
+        char buffer[256] = {0};
+        DWORD err, buflen = sizeof(buffer);
+
+        ::InternetGetLastResponseInfoA(&err, buffer, &buflen);
+        do {
+            char *p = buffer + strlen(buffer) - 1;
+            if (*p == '\n' || *p == '\r') {
+                *p = '\0';
+                continue; //next
+            }
+        } while(0);
+
+        std::string msg;
+        msg += message, msg += " : ", msg += buffer;
+
+        LOG<LOG_ERROR>() << "Download: " << msg << LOG_ENDL;
+        throw AppException(msg);
+    }
+
+    LOG<LOG_ERROR>() << "Download: " << message << " : " << ret << LOG_ENDL;
+    throw SysException(ret, message);
+}
+
+
+//static/private
+//  Loopback host; the one destination http:// is permitted, and only by explicit request
+//  (Download::LOOPBACK), local benchmark servers.
+//
+bool
+WinINetTransport::Loopback(const std::string &host)
+{
+    if (0 == host.compare(0, 4, "127.")) {      // dotted-quad only, not a "127.*" dns name.
+        return (std::string::npos == host.find_first_not_of("0123456789."));
+    }
+    return (0 == _stricmp(host.c_str(), "localhost") ||
+                host == "::1" || host == "[::1]");
+}
+
+
+//static/private
+VOID CALLBACK
+WinINetTransport::callback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus,
+        LPVOID lpvStatusInformation, DWORD dwStatusInformationLength)
+{
+    WinINetTransport *self = reinterpret_cast<WinINetTransport *>(dwContext);
+
+    switch (dwInternetStatus) {
+    case INTERNET_STATUS_COOKIE_SENT:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Cookie found and will be sent with request" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_COOKIE_RECEIVED:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Cookie Received" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_COOKIE_HISTORY: {
+            InternetCookieHistory cookieHistory =
+                    *((InternetCookieHistory*)lpvStatusInformation);
+
+            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+                    " Status: Cookie History" << LOG_ENDL;
+
+            if (cookieHistory.fAccepted) {
+                LOG<LOG_DEBUG>() << "Download: Cookie Accepted" << LOG_ENDL;
+            }
+            if (cookieHistory.fLeashed) {
+                LOG<LOG_DEBUG>() << "Download: Cookie Leashed" << LOG_ENDL;
+            }
+            if (cookieHistory.fDowngraded) {
+                LOG<LOG_DEBUG>() << "Download: Cookie Downgraded" << LOG_ENDL;
+            }
+            if (cookieHistory.fRejected) {
+                LOG<LOG_DEBUG>() << "Download: Cookie Rejected" << LOG_ENDL;
+            }
+        }
+        break;
+
+    case INTERNET_STATUS_CLOSING_CONNECTION:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Closing Connection" << LOG_ENDL;
+        if (self) {
+            ::SetEvent(self->callback_trigger_);
+        }
+        break;
+
+    case INTERNET_STATUS_CONNECTED_TO_SERVER:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Connected to Server=" <<  ((const char *)lpvStatusInformation) << LOG_ENDL;
+        if (self) {
+            self->connected_ = true;
+        }
+        break;
+
+    case INTERNET_STATUS_CONNECTING_TO_SERVER:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Connecting to Server=" << ((const char *)lpvStatusInformation) << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_CONNECTION_CLOSED:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Connection Closed" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_HANDLE_CREATED: {
+            const INTERNET_ASYNC_RESULT *res = (const INTERNET_ASYNC_RESULT*)lpvStatusInformation;
+            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+                " Created: Handle created" << LOG_ENDL;
+            if (self) {
+                self->request_handle_ = (HINTERNET)(res->dwResult);
+            }
+        }
+        break;
+
+    case INTERNET_STATUS_HANDLE_CLOSING:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Handle Closing" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_INTERMEDIATE_RESPONSE:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Intermediate response" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_RECEIVING_RESPONSE:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Receiving Response" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_RESPONSE_RECEIVED:
+        assert(dwStatusInformationLength == sizeof(DWORD));
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Response received=" << *((LPDWORD)lpvStatusInformation) << " bytes" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_REDIRECT:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Redirect=" << to_string((const wchar_t *)lpvStatusInformation) << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_REQUEST_COMPLETE: {
+            const INTERNET_ASYNC_RESULT *res = (const INTERNET_ASYNC_RESULT*)lpvStatusInformation;
+            LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+                " Status: Request complete, result=" << res->dwResult << ", error=" << res->dwError << LOG_ENDL;
+        }
+        break;
+
+    case INTERNET_STATUS_REQUEST_SENT:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Request sent=" << *((LPDWORD)lpvStatusInformation) << " bytes" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_DETECTING_PROXY:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Detecting Proxy" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_RESOLVING_NAME:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Resolving Name=" << to_string((const wchar_t *)lpvStatusInformation) << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_NAME_RESOLVED:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Name Resolved=" << ((const char *)lpvStatusInformation) << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_SENDING_REQUEST:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Sending request" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_STATE_CHANGE:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: State Change" << LOG_ENDL;
+        break;
+
+    case INTERNET_STATUS_P3P_HEADER:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Received P3P header" << LOG_ENDL;
+        break;
+
+    default:
+        LOG<LOG_DEBUG>() << "Download: " << (void *)hInternet <<
+            " Status: Unknown <" << dwInternetStatus << ">" << LOG_ENDL;
+        break;
+    }
+}
+
+}   //namespace anon
+
+
+//static
+ITransport *
+Transport::CreateWinINet(TransportSession *session)
+{
+    return new(std::nothrow) WinINetTransport(session);
+}
+
+}   // namespace Updater
+
+//end
@@ -39,6 +39,8 @@
 #include "CSimpleBrowser.h"
 #include "resource.h"
 
+#define IDT_NOTES       (WM_APP + 4)            // release notes poll timer.
+
 /////////////////////////////////////////////////////////////////////////////////////////
 //  AboutDlg
 
@@ -281,10 +283,10 @@ CUpdateInstallDlg::ReleaseNotes()
         d_browser->CreateFromControl(GetSafeHwnd(), IDC_INSTALL_NOTES);
         if (manifest.releaseNotesLink.empty()) {
             d_browser->Content(Updater::to_wstring(manifest.description));
-        } else if (! manifest.releaseNotesContent.empty()) {
-            d_browser->Content(Updater::to_wstring(manifest.releaseNotesContent));
-        } else {
-            d_browser->Navigate(Updater::to_wstring(manifest.releaseNotesLink));
+        } else if (! ReleaseNotesUpdate()) {    // placeholder, until loaded.
+            d_browser->Content(L"<html><body style=\"font-family:Segoe UI,sans-serif;color:gray\">"
+                                    L"Loading release notes ...</body></html>");
+            ::SetTimer(GetSafeHwnd(), IDT_NOTES, 250 /*ms*/, NULL);
         }
         AutoPull(IDC_INSTALL_NOTES, &BrowserResizer, (void *)d_browser);
 
@@ -309,6 +311,44 @@ CUpdateInstallDlg::ReleaseNotes()
 }
 
 
+//private
+//  Apply the release notes, if retrieval has concluded; returns false whilst pending.
+//
+bool
+CUpdateInstallDlg::ReleaseNotesUpdate()
+{
+    std::string content;
+
+    switch (d_owner.ReleaseNotes(content)) {
+    case AutoUpdater::NotesPending:
+        return false;
+    case AutoUpdater::NotesAvailable:
+        d_browser->Content(Updater::to_wstring(content));
+        break;
+    case AutoUpdater::NotesFailed:              // direct navigation, as fallback.
+        d_browser->Navigate(Updater::to_wstring(d_owner.Manifest().releaseNotesLink));
+        break;
+    default:
+        d_browser->Content(Updater::to_wstring(d_owner.Manifest().description));
+        break;
+    }
+    return true;
+}
+
+
+void
+CUpdateInstallDlg::OnTimer(UINT_PTR id)
+{
+    if (IDT_NOTES == id) {
+        if (d_browser && ReleaseNotesUpdate()) {
+            ::KillTimer(GetSafeHwnd(), IDT_NOTES);
+        }
+        return;
+    }
+    AutoDialog::OnTimer(id);
+}
+
+
 LRESULT
 CUpdateInstallDlg::OnCtlColorStatic(WPARAM wParam, LPARAM lParam)
 {
@@ -67,6 +67,7 @@ private:
     typedef std::vector<SMove> SMoving_t;
 
     void            ReleaseNotes();
+    bool            ReleaseNotesUpdate();
 
     void            AutoPush(SMove &s, int iID = 0);
     void            AutoMove(int iID, SMove::What what = SMove::XY, HWND hWnd = 0);
@@ -93,6 +94,7 @@ protected:
     virtual BOOL    OnInitDialog();
     virtual BOOL    OnGetMinMaxInfo(MINMAXINFO *mmi);
     virtual void    OnSize(UINT nType, int cx, int cy);
+    virtual void    OnTimer(UINT_PTR id);
     virtual BOOL    OnCommand(WPARAM wParam, LPARAM lParam);
     virtual void    OnSysCommand(UINT nID, LPARAM lParam);
     virtual LRESULT OnCtlColorStatic(WPARAM wParam, LPARAM lParam);
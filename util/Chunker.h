@@ -0,0 +1,120 @@
+#ifndef CHUNKER_H_INCLUDED
+#define CHUNKER_H_INCLUDED
+//  $Id: Chunker.h,v 1.1 2026/10/16 14:02:11 cvsuser Exp $
+//
+//  AutoUpdater: content-defined chunking
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2024 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Gear rolling hash boundaries (as FastCDC), shared by signtool when publishing a
+//  chunk index and the client when scanning a retained installer; both sides must
+//  apply identical parameters, as recorded within the index.
+//
+//  Chunk index image, integers little-endian:
+//
+//      header          magic       "AUCHUNK1"
+//                      u64         image length
+//                      u32         chunk count
+//                      u32         minimum chunk length
+//                      u32         maximum chunk length
+//                      u32         boundary mask bits
+//
+//      chunk(s)        u32         length, offsets being cumulative
+//                      byte[20]    SHA-1
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace Updater {
+
+#define CHUNK_MAGIC         "AUCHUNK1"
+
+class Chunker {
+public:
+    enum {
+        HEADER_SIZE = 32,
+        ENTRY_SIZE = 24,
+        MINIMUM = 2 * 1024,
+        MAXIMUM = 64 * 1024,
+        MASK_BITS = 14                          // average ~16K beyond the minimum.
+    };
+
+    Chunker(unsigned minimum = MINIMUM, unsigned maximum = MAXIMUM, unsigned bits = MASK_BITS) :
+        minimum_(minimum), maximum_(maximum), mask_(0)
+    {
+        if (bits && bits < 64)                  // upper bits; the lower see only the last few bytes.
+            mask_ = (((uint64_t)1 << bits) - 1) << (64 - bits);
+    }
+
+    bool
+    valid() const
+    {
+        return (minimum_ && minimum_ <= maximum_ && mask_);
+    }
+
+    // Length of the chunk leading 'data'; 'length' at the end of the image.
+    size_t
+    next(const uint8_t *data, size_t length) const
+    {
+        const uint64_t *table = gear();
+        const size_t limit = (length < maximum_ ? length : maximum_);
+        uint64_t hash = 0;
+
+        if (length <= minimum_)
+            return length;
+        for (size_t i = minimum_; i < limit; ++i) {
+            hash = (hash << 1) + table[data[i]];
+            if (0 == (hash & mask_))
+                return i + 1;
+        }
+        return limit;
+    }
+
+private:
+    static const uint64_t *
+    gear()
+    {
+        static uint64_t table[256];
+
+        if (0 == table[255]) {                  // splitmix64, fixed seed.
+            uint64_t seed = 0x4155434855524b31ULL;
+            for (unsigned n = 0; n < 256; ++n) {
+                uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                table[n] = z ^ (z >> 31);
+            }
+        }
+        return table;
+    }
+
+private:
+    size_t minimum_;
+    size_t maximum_;
+    uint64_t mask_;
+};
+
+} // namespace Updater
+
+#endif //CHUNKER_H_INCLUDED
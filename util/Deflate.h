@@ -0,0 +1,178 @@
+#ifndef DEFLATE_H_INCLUDED
+#define DEFLATE_H_INCLUDED
+//  $Id: Deflate.h,v 1.1 2026/10/16 09:12:40 cvsuser Exp $
+//
+//  AutoUpdater: minimal gzip encoder
+//
+//  This file is part of libappupdater (https://github.com/adamyg/libappupdater)
+//
+//  Copyright (c) 2024 - 2026, Adam Young
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+//
+//  Greedy LZ77 with fixed Huffman codes (RFC 1951 3.2.6) in gzip framing (RFC 1952);
+//  modest ratios, yet long runs such as those of binary patches collapse well.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+namespace Updater {
+
+class Deflate {
+public:
+    static std::string
+    gzip(const void *src, size_t length)
+    {
+        static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        const uint8_t *data = static_cast<const uint8_t *>(src);
+        std::string out((const char *)header, sizeof(header));
+        std::vector<int64_t> head(1 << 15, -1);
+        BitWriter w(out);
+        size_t pos = 0;
+
+        out.reserve(sizeof(header) + (length / 2) + 64);
+        w.put(1, 1);                            // final block.
+        w.put(1, 2);                            // fixed codes.
+        while (pos < length) {
+            unsigned match = 0, distance = 0;
+
+            if (pos + 3 <= length) {
+                const unsigned hash = ((unsigned)data[pos] << 10 ^ (unsigned)data[pos + 1] << 5 ^ data[pos + 2]) & 0x7fff;
+                const int64_t candidate = head[hash];
+
+                head[hash] = (int64_t)pos;
+                if (candidate >= 0 && pos - (size_t)candidate <= 32768) {
+                    const size_t limit = (length - pos < 258 ? length - pos : 258);
+                    while (match < limit && data[candidate + match] == data[pos + match])
+                        ++match;
+                    distance = (unsigned)(pos - (size_t)candidate);
+                }
+            }
+
+            if (match >= 3) {
+                pair(w, match, distance);
+                pos += match;
+            } else {
+                symbol(w, data[pos++]);
+            }
+        }
+        symbol(w, 256);                         // end-of-block.
+        w.flush();
+
+        const uint32_t crc = crc32(data, length), isize = (uint32_t)length;
+        for (unsigned i = 0; i < 4; ++i)
+            out.push_back((char)((crc >> (8 * i)) & 0xff));
+        for (unsigned i = 0; i < 4; ++i)
+            out.push_back((char)((isize >> (8 * i)) & 0xff));
+        return out;
+    }
+
+    static uint32_t
+    crc32(const void *src, size_t length)
+    {
+        static uint32_t table[256];
+        const uint8_t *data = static_cast<const uint8_t *>(src);
+        uint32_t crc = 0xffffffff;
+
+        if (0 == table[1]) {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (unsigned k = 0; k < 8; ++k)
+                    c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+                table[n] = c;
+            }
+        }
+        while (length--)
+            crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+        return crc ^ 0xffffffff;
+    }
+
+private:
+    struct BitWriter {
+        BitWriter(std::string &out__) : out(out__), bits(0), count(0) {
+        }
+
+        void put(unsigned value, unsigned length) {
+            bits |= (uint64_t)value << count;
+            count += length;
+            while (count >= 8) {
+                out.push_back((char)(bits & 0xff));
+                bits >>= 8, count -= 8;
+            }
+        }
+
+        void code(unsigned value, unsigned length) {
+            unsigned reversed = 0;              // Huffman codes are packed MSB first.
+            for (unsigned bit = 0; bit < length; ++bit)
+                reversed |= ((value >> bit) & 1) << (length - 1 - bit);
+            put(reversed, length);
+        }
+
+        void flush() {
+            if (count)
+                put(0, 8 - count);
+        }
+
+        std::string &out;
+        uint64_t bits;
+        unsigned count;
+    };
+
+    static void
+    symbol(BitWriter &w, unsigned symbol)
+    {
+        if (symbol < 144)       w.code(0x30 + symbol, 8);
+        else if (symbol < 256)  w.code(0x190 + (symbol - 144), 9);
+        else if (symbol < 280)  w.code(symbol - 256, 7);
+        else                    w.code(0xc0 + (symbol - 280), 8);
+    }
+
+    static void
+    pair(BitWriter &w, unsigned length, unsigned distance)
+    {
+        static const unsigned short lbase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const unsigned char lext[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const unsigned short dbase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const unsigned char dext[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        unsigned l = 28, d = 29;
+
+        while (lbase[l] > length) --l;
+        while (dbase[d] > distance) --d;
+        symbol(w, 257 + l);
+        w.put(length - lbase[l], lext[l]);
+        w.code(d, 5);
+        w.put(distance - dbase[d], dext[d]);
+    }
+};
+
+} // namespace Updater
+
+#endif //DEFLATE_H_INCLUDED
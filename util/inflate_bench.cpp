@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Decompression stage benchmark
+//
+//  Drives the streaming Inflater, as stacked beneath Download for compressed
+//  manifests and enclosures, from memory; reporting decoded MB/s and CPU
+//  nanoseconds per decoded byte.
+//
+//  Usage: inflate_bench [-b buffer-KB] [file.gz ...]
+//
+//      -b      Read() size, default 64KB (the download buffer).
+//
+//  Without files, manifest-like payloads of 10, 100 and 1024 MB are synthesised;
+//  gzip members produced by the minimal encoder within Deflate.h, concatenated.
+//  As that encoder emits fixed-Huffman blocks alone, a zlib produced member
+//  (dynamic Huffman) is also embedded and run.
+//
+//  Decoded output is compared with the source in an untimed pass ahead of each
+//  run; for a file "name.gz" the source is "name", where present.
+//
+
+#include "../src/common.h"
+#include "../src/AutoInflate.h"
+#include "Deflate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <exception>
+
+namespace {
+
+struct MemorySource : public Updater::Inflater::ISource {
+    MemorySource(const std::string &image, unsigned long long repeat) :
+        image_(image), repeat_(repeat), cursor_(0) {
+    }
+
+    virtual size_t Fill(void *buffer, size_t length) {
+        if (cursor_ == image_.size()) {
+            if (0 == repeat_ || 0 == --repeat_)
+                return 0;
+            cursor_ = 0;                    // next member.
+        }
+        const size_t remaining = image_.size() - cursor_;
+        if (length > remaining)
+            length = remaining;
+        memcpy(buffer, image_.data() + cursor_, length);
+        cursor_ += length;
+        return length;
+    }
+
+    const std::string &image_;
+    unsigned long long repeat_;
+    size_t cursor_;
+};
+
+
+static unsigned long long
+FileTime100ns(const FILETIME &ft)
+{
+    return (((unsigned long long)ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+
+static unsigned long long
+ThreadCPU100ns()
+{
+    FILETIME create, exit, kernel, user;
+    if (! ::GetThreadTimes(::GetCurrentThread(), &create, &exit, &kernel, &user))
+        return 0;
+    return FileTime100ns(kernel) + FileTime100ns(user);
+}
+
+
+//  Decode 'repeat' members of 'image', comparing against 'expected' per member.
+static bool
+Verify(const std::string &image, unsigned long long repeat, const std::string &expected, std::vector<char> &buffer)
+{
+    MemorySource source(image, repeat);
+    unsigned long long out = 0;
+
+    try {
+        Updater::Inflater inflater(source, Updater::Inflater::FORMAT_GZIP);
+        size_t read;
+
+        while ((read = inflater.Read(&buffer[0], buffer.size())) > 0) {
+            for (size_t done = 0; done < read;) {
+                const size_t offset = (size_t)(out % expected.size());
+                size_t length = expected.size() - offset;
+
+                if (length > read - done)
+                    length = read - done;
+                if (0 != memcmp(&buffer[done], expected.data() + offset, length))
+                    return false;
+                done += length, out += length;
+            }
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+    return (out == (unsigned long long)expected.size() * repeat);
+}
+
+
+//  zlib (level 9) gzip member of Sample(); dynamic Huffman, BTYPE 2.
+static const unsigned char sample_gz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xc5, 0xd6, 0xcd, 0x4e, 0x84, 0x30,
+    0x14, 0x05, 0xe0, 0xbd, 0x4f, 0x81, 0xb8, 0x96, 0xfe, 0x53, 0x6a, 0x3a, 0x24, 0x13, 0x8d, 0x89,
+    0x7b, 0x77, 0xc6, 0x05, 0x61, 0x6e, 0x9c, 0xc6, 0x02, 0x0d, 0xed, 0xe8, 0xf8, 0xf6, 0xa2, 0x2e,
+    0x34, 0x90, 0x98, 0xd8, 0xd4, 0x61, 0x45, 0xc2, 0xa5, 0x50, 0xbe, 0x9e, 0xc5, 0xd1, 0x26, 0x40,
+    0x57, 0xeb, 0x60, 0x82, 0x85, 0x7a, 0xeb, 0x9c, 0x35, 0x6d, 0x13, 0xcc, 0xd0, 0x67, 0xb4, 0xc0,
+    0x05, 0xd1, 0xe8, 0x6b, 0xa0, 0x77, 0xe0, 0xdb, 0xd1, 0xb8, 0x8f, 0x49, 0xad, 0xcf, 0x1f, 0xae,
+    0x6f, 0xb6, 0xf7, 0xdb, 0x07, 0x7d, 0xb0, 0xb5, 0xb6, 0xa6, 0xbe, 0x35, 0x47, 0xd8, 0x65, 0xc6,
+    0xfb, 0x03, 0x64, 0x17, 0x84, 0x49, 0x8d, 0xa6, 0x9b, 0x1f, 0x83, 0xbb, 0xce, 0x8d, 0xc3, 0xcb,
+    0x34, 0xeb, 0x21, 0xbc, 0x0e, 0xe3, 0x73, 0xb6, 0x6f, 0xfa, 0x9d, 0x35, 0xfd, 0xd3, 0xd7, 0x13,
+    0x68, 0x5a, 0xff, 0xf8, 0x38, 0x5d, 0x7f, 0xbe, 0xfd, 0x4c, 0x43, 0xdf, 0xda, 0xc1, 0x1f, 0x46,
+    0xc8, 0x0e, 0xa3, 0xdd, 0xe4, 0xfb, 0x10, 0x9c, 0xbf, 0x42, 0x08, 0x8e, 0x4d, 0xe7, 0x2c, 0x14,
+    0xed, 0xd0, 0xa1, 0x11, 0x2c, 0x34, 0x1e, 0x3c, 0x6a, 0x9c, 0xbb, 0xfc, 0xdc, 0x69, 0x01, 0x47,
+    0xc8, 0x33, 0x0b, 0xfd, 0x53, 0xd8, 0x6f, 0x72, 0x8e, 0xb1, 0x54, 0x44, 0xe5, 0x59, 0x78, 0x73,
+    0xb0, 0xc9, 0x9b, 0xef, 0xff, 0x42, 0x43, 0x1b, 0x20, 0x5c, 0xfa, 0x30, 0x42, 0xd3, 0xe5, 0x68,
+    0xfa, 0xf8, 0x27, 0xc0, 0x99, 0xfe, 0xcd, 0x81, 0xc6, 0x38, 0x48, 0xbe, 0x74, 0xd8, 0x19, 0xef,
+    0x6c, 0xf3, 0xf6, 0x7f, 0x0e, 0x74, 0xee, 0x40, 0x44, 0xc5, 0xaa, 0x54, 0x0e, 0x2c, 0xc2, 0x81,
+    0x12, 0xb2, 0x42, 0x1e, 0xd8, 0xdc, 0x81, 0x32, 0x29, 0x64, 0x2a, 0x07, 0x1e, 0xe3, 0xc0, 0xab,
+    0x15, 0xf2, 0xc0, 0xe7, 0x0e, 0x8c, 0x94, 0xb2, 0x4c, 0xe5, 0x20, 0x62, 0x1c, 0x2a, 0xb1, 0x42,
+    0x1e, 0xc4, 0xc2, 0x41, 0x09, 0x25, 0x52, 0x39, 0x94, 0x11, 0x0e, 0x8c, 0xd2, 0x15, 0xf2, 0x50,
+    0xce, 0x1d, 0xb8, 0x14, 0x84, 0xa7, 0x72, 0x90, 0x31, 0x0e, 0x42, 0xad, 0x90, 0x07, 0x39, 0x77,
+    0x10, 0x82, 0x33, 0x96, 0xca, 0xa1, 0x8a, 0x71, 0x50, 0xe5, 0x0a, 0x79, 0xa8, 0xe6, 0x0e, 0x25,
+    0x63, 0x82, 0xa6, 0x72, 0x50, 0x11, 0x0e, 0xd3, 0x31, 0xac, 0x90, 0x07, 0x35, 0x77, 0x90, 0x84,
+    0x4a, 0x92, 0xc6, 0x81, 0x14, 0x38, 0xc6, 0x41, 0xe2, 0x93, 0xe7, 0x61, 0xda, 0xe9, 0xc2, 0x61,
+    0xaa, 0x51, 0x38, 0x95, 0x43, 0x4c, 0x9f, 0x14, 0xf8, 0xf4, 0x7d, 0x92, 0x2c, 0xfb, 0x64, 0x25,
+    0x09, 0x56, 0xa9, 0x1c, 0x62, 0xfa, 0xa4, 0xe0, 0x7c, 0x85, 0x3c, 0x2c, 0xfa, 0xa4, 0x12, 0x98,
+    0xfe, 0xa5, 0x4f, 0xbe, 0x03, 0xda, 0x9f, 0x1e, 0xc2, 0x60, 0x0c, 0x00, 0x00
+};
+
+
+//  Content of sample_gz.
+static std::string
+Sample()
+{
+    std::string content;
+    char item[512];
+
+    for (unsigned version = 1; version <= 12; ++version) {
+        _snprintf(item, sizeof(item),
+            "<item><title>Application 2.%u.%u</title><description><![CDATA[<ul><li>Fixed issue #%u</li><li>Improved %s handling</li></ul>]]></description>\n"
+            "<enclosure url=\"https://example.com/releases/app-2.%u.%u.exe\" length=\"%u\" type=\"application/octet-stream\"/></item>\n",
+            version / 10, version % 10, 100 + version * 37, (version & 1 ? "network" : "display"),
+            version / 10, version % 10, 4000000 + version * 7919);
+        content += item;
+    }
+    return content;
+}
+
+
+//  Manifest-like content; <item> history with CDATA change logs.
+static std::string
+Manifest(size_t length)
+{
+    std::string content;
+    char item[512];
+    unsigned seed = 1;
+
+    for (unsigned version = 1; content.size() < length; ++version) {
+        seed = seed * 1103515245 + 12345;
+        _snprintf(item, sizeof(item),
+            "<item><title>Application 1.%u.%u</title><pubDate>%u</pubDate>\n"
+            "<description><![CDATA[<ul><li>Fixed issue #%u</li><li>Improved %s handling</li></ul>]]></description>\n"
+            "<enclosure url=\"https://example.com/releases/app-1.%u.%u.exe\" length=\"%u\" type=\"application/octet-stream\"/>"
+            "</item>\n", version / 10, version % 10, 1600000000 + (seed % 100000000), (seed >> 8) % 5000,
+            ((seed >> 4) & 1 ? "network" : "display"), version / 10, version % 10, 4000000 + (seed % 1000000));
+        content += item;
+    }
+    content.resize(length);
+    return content;
+}
+
+}   //namespace anon
+
+
+int
+main(int argc, char *argv[])
+{
+    static const unsigned defaults[] = { 10, 100, 1024 };
+    size_t buffer_size = 64 * 1024;
+    int argi = 1;
+
+    if (argi + 1 < argc && 0 == strcmp(argv[argi], "-b")) {
+        buffer_size = (size_t)atoi(argv[argi + 1]) * 1024;
+        argi += 2;
+    }
+    if (0 == buffer_size) {
+        fprintf(stderr, "inflate_bench: invalid buffer size\n");
+        return 1;
+    }
+
+    std::vector<char> buffer(buffer_size);
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+
+    printf("buffer=%uKB\n", (unsigned)(buffer_size / 1024));
+    printf("%-24s %10s %10s %8s %12s %10s %12s %9s\n",
+        "source", "in MB", "out MB", "ratio", "seconds", "MB/s", "CPU ns/byte", "verified");
+
+    std::string member, content;            // synthesised, 1MB decoded.
+    const int count = (argi < argc ? argc - argi : (int)(sizeof(defaults)/sizeof(defaults[0])) + 1);
+
+    for (int i = 0; i < count; ++i) {
+        unsigned long long repeat = 1;
+        std::string image, label, expected;
+
+        if (argi < argc) {                  // gzip file.
+            FILE *file = fopen(argv[argi + i], "rb");
+            char chunk[64 * 1024];
+            size_t read;
+
+            if (NULL == file) {
+                printf("%-24s %10s\n", argv[argi + i], "unreadable");
+                continue;
+            }
+            while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+                image.append(chunk, read);
+            fclose(file);
+            label = argv[argi + i];
+
+            if (label.size() > 3 && 0 == label.compare(label.size() - 3, 3, ".gz") &&
+                    NULL != (file = fopen(label.substr(0, label.size() - 3).c_str(), "rb"))) {
+                while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+                    expected.append(chunk, read);
+                fclose(file);
+            }
+
+        } else if (0 == i) {                // dynamic Huffman, ~25MB decoded.
+            image.assign((const char *)sample_gz, sizeof(sample_gz));
+            expected = Sample();
+            repeat = 8192;
+            label = "sample-dynamic";
+
+        } else {
+            if (member.empty()) {
+                content = Manifest(1024 * 1024);
+                member = Updater::Deflate::gzip(content.data(), content.size());
+            }
+            image = member;
+            expected = content;
+            repeat = defaults[i - 1];
+            label = "manifest-" + std::to_string((unsigned long long)defaults[i - 1]) + "MB";
+        }
+
+        const char *verified = "-";         // untimed; against the source, where known.
+        if (! expected.empty()) {
+            if (! Verify(image, repeat, expected, buffer)) {
+                printf("%-24s %10s (decoded output differs from source)\n", label.c_str(), "failed");
+                continue;
+            }
+            verified = "ok";
+        }
+
+        MemorySource source(image, repeat);
+        unsigned long long in = 0, out = 0;
+        LARGE_INTEGER start, end;
+
+        const unsigned long long cpu = ThreadCPU100ns();
+        ::QueryPerformanceCounter(&start);
+        try {
+            Updater::Inflater inflater(source, Updater::Inflater::FORMAT_GZIP);
+            size_t read;
+
+            while ((read = inflater.Read(&buffer[0], buffer.size())) > 0)
+                out += read;                // discard, as would a counting sink.
+            in = inflater.In();
+        } catch (const std::exception &e) {
+            printf("%-24s %10s (%s)\n", label.c_str(), "failed", e.what());
+            continue;
+        }
+        ::QueryPerformanceCounter(&end);
+        const unsigned long long used = ThreadCPU100ns() - cpu;
+
+        const double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+        printf("%-24s %10.1f %10.1f %8.2f %12.3f %10.1f %12.3f %9s\n", label.c_str(),
+            (double)in / (1024.0 * 1024.0), (double)out / (1024.0 * 1024.0), (in ? (double)out / (double)in : 0.0),
+            seconds, ((double)out / (1024.0 * 1024.0)) / seconds, (out ? ((double)used * 100.0) / (double)out : 0.0), verified);
+    }
+    return 0;
+}
+
+//end
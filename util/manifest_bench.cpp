@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Manifest load benchmark
+//
+//  Generates a synthetic multi-channel manifest and its compiled image (see
+//  AutoManifestImage.h), contrasting AutoManifest::Load() of the XML against that
+//  of the image for each channel, plus the feed as retrieved by range request, the
+//  index and the channel's segments alone; reporting the bytes retrieved,
+//  microseconds per load and the peak heap in use during the load.
+//
+//  Usage: manifest_bench [-c channels] [-i items] [-n iterations]
+//
+//      -c      Channels, default 4.
+//      -i      Items per channel, default 50.
+//      -n      Loads per measurement, default 200.
+//
+//  Heap usage is that of operator new, as such excludes the expat parser's own
+//  allocations; the XML figures are conservative.
+//
+
+#include "../src/common.h"
+#include "../src/AutoManifest.h"
+#include "../src/AutoManifestImage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+static const char *oslabels[] = {
+    "windows-x86", "windows-x64", "windows"
+};
+
+struct HeapCounter {
+    size_t current, peak;
+};
+
+static HeapCounter heap = {0, 0};
+
+union HeapHeader {                              // size prefix, alignment preserved.
+    size_t size;
+    double align;
+};
+
+
+static double
+Seconds(const LARGE_INTEGER &start, const LARGE_INTEGER &end)
+{
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+    return (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+}
+
+
+static std::string
+Channel(unsigned channel)
+{
+    char name[32];
+    sprintf(name, "channel%u", channel);
+    return name;
+}
+
+
+//  Synthetic manifest; per channel, items cycling the os-labels, each with release notes
+//  and a delta.
+static std::string
+Manifest(unsigned channels, unsigned items)
+{
+    std::string xml =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<manifest version=\"2.0\" xmlns:updater=\"http://www.updater.org/xml-namespaces/updater\">\n";
+    std::string notes;
+    char buffer[2048];
+
+    for (unsigned n = 0; n < 16; ++n) {
+        notes += "<li>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</li>";
+    }
+
+    for (unsigned c = 0; c < channels; ++c) {
+        xml += "<channel name=\"" + Channel(c) + "\">\n";
+        for (unsigned i = 0; i < items; ++i) {
+            const unsigned build = (c * items) + i;
+
+            sprintf(buffer,
+                "<item>\n"
+                "\t<title>Version 1.%u.%u</title>\n"
+                "\t<link>https://updates.example.com/app</link>\n"
+                "\t<published>%u</published>\n"
+                "\t<pubDate>Sun, 20 Apr 2025 08:40:22 +0000</pubDate>\n"
+                "\t<enclosure url=\"https://updates.example.com/app-1.%u.%u.exe\"\n"
+                "\t\tos=\"%s\" name=\"app-1.%u.%u.exe\" version=\"1.%u.%u\" length=\"%u\"\n"
+                "\t\tshaSignature=\"8c4ba5a53a8e28e1cbb3ad4c5d8a3a01a86cc3e4%08x\"\n"
+                "\t\tedSignature=\"Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFy%08x\"\n"
+                "\t\tedKeyVersion=\"1.1\" type=\"application/octet-stream\" />\n"
+                "\t<updater:deltas>\n"
+                "\t\t<enclosure url=\"https://updates.example.com/app-1.%u.%u-from-1.%u.%u.patch.gz\"\n"
+                "\t\t\tdeltaFrom=\"1.%u.%u\" length=\"%u\" type=\"application/gzip\" />\n"
+                "\t</updater:deltas>\n",
+                c, i, 1745138422 + build, c, i, oslabels[i % 3], c, i, c, i, 10000000 + build, build, build,
+                c, i, c, (i ? i - 1 : 0), c, (i ? i - 1 : 0), 100000 + build);
+            xml += buffer;
+            xml += "\t<description><![CDATA[<ul>" + notes + "</ul>]]></description>\n</item>\n";
+        }
+        xml += "</channel>\n";
+    }
+    xml += "</manifest>\n";
+    return xml;
+}
+
+}   //namespace anon
+
+
+void *
+operator new(size_t size)
+{
+    HeapHeader *header = static_cast<HeapHeader *>(malloc(sizeof(HeapHeader) + size));
+    if (NULL == header) {
+        throw std::bad_alloc();
+    }
+    header->size = size;
+    if ((heap.current += size) > heap.peak) {
+        heap.peak = heap.current;
+    }
+    return header + 1;
+}
+
+
+void
+operator delete(void *ptr) throw()
+{
+    if (ptr) {
+        HeapHeader *header = static_cast<HeapHeader *>(ptr) - 1;
+        heap.current -= header->size;
+        free(header);
+    }
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    unsigned channels = 4, items = 50, iterations = 200;
+
+    for (int argi = 1; argi + 1 < argc; argi += 2) {
+        if (0 == strcmp(argv[argi], "-c")) {
+            channels = (unsigned)atoi(argv[argi + 1]);
+        } else if (0 == strcmp(argv[argi], "-i")) {
+            items = (unsigned)atoi(argv[argi + 1]);
+        } else if (0 == strcmp(argv[argi], "-n")) {
+            iterations = (unsigned)atoi(argv[argi + 1]);
+        } else {
+            fprintf(stderr, "manifest_bench: unknown option <%s>\n", argv[argi]);
+            return 1;
+        }
+    }
+    if (0 == channels || 0 == items || 0 == iterations) {
+        fprintf(stderr, "manifest_bench: invalid channels, items or iterations\n");
+        return 1;
+    }
+
+    // compile, as signtool -M
+    const std::string xml = Manifest(channels, items);
+    std::vector<Updater::AutoManifest> manifests;
+    bool channels_omitted = false;
+
+    if (! Updater::AutoManifest::LoadAll(xml, manifests, channels_omitted)) {
+        fprintf(stderr, "manifest_bench: manifest load failure\n");
+        return 1;
+    }
+    const std::string image = Updater::ManifestImage::Build(manifests, channels_omitted, 0);
+
+    std::vector<Updater::ManifestImage::SectionKey> keys;
+    std::vector<std::vector<unsigned> > members;
+    std::vector<std::string> segments;
+
+    Updater::ManifestImage::Group(manifests, channels_omitted, keys, members);
+    for (unsigned s = 0; s < keys.size(); ++s) {
+        segments.push_back(Updater::ManifestImage::Build(manifests,
+            std::vector<Updater::ManifestImage::SectionKey>(1, keys[s]), std::vector<std::vector<unsigned> >(1, members[s]),
+            channels_omitted, 0));
+    }
+    const std::string feed = Updater::ManifestIndex::Build(keys, segments, channels_omitted, 0);
+    const size_t index_length = Updater::ManifestIndex::IndexLength(feed.data(), feed.size());
+    manifests.clear(), segments.clear();
+
+    printf("channels=%u, items=%u, xml=%u bytes, image=%u bytes, feed=%u bytes (index %u)\n",
+        channels, items, (unsigned)xml.size(), (unsigned)image.size(), (unsigned)feed.size(), (unsigned)index_length);
+    printf("%-10s %-10s %10s %12s %12s\n", "channel", "format", "bytes", "us/load", "peak-heap");
+
+    for (unsigned c = 0; c < channels; c += (channels > 1 ? channels - 1 : 1)) {
+        const std::string channel = Channel(c);
+        static const char *formats[] = {"xml", "image", "ranged"};
+        std::string titles[3];
+        size_t retrieved = 0;
+
+        for (int run = 0; run < 3; ++run) {
+            const std::string &content = (0 == run ? xml : (1 == run ? image : feed));
+            LARGE_INTEGER start, end;
+            size_t peak = 0;
+
+            ::QueryPerformanceCounter(&start);
+            for (unsigned n = 0; n < iterations; ++n) {
+                Updater::AutoManifest manifest;
+                const size_t base = heap.current;
+                bool loaded;
+
+                heap.peak = base;
+                if (2 == run) {                 // index, then the channel's segments; as retrieved.
+                    Updater::ManifestIndex index;
+                    std::vector<Updater::ManifestImage> images;
+                    uint64_t offset = 0, length = 0;
+
+                    loaded = (index.Open(feed.data(), index_length) &&
+                                Updater::AutoManifest::FeedSpan(index, channel, offset, length));
+                    if (loaded) {
+                        Updater::AutoManifest::FeedSegments(index, channel, feed.data() + offset, offset, (size_t)length, images);
+                        loaded = manifest.LoadImages(images, channel, "windows-x64");
+                    }
+                    retrieved = index_length + (size_t)length;
+                } else {
+                    loaded = manifest.Load(content, channel, "windows-x64");
+                    retrieved = content.size();
+                }
+                if (! loaded) {
+                    fprintf(stderr, "manifest_bench: %s load failure\n", formats[run]);
+                    return 1;
+                }
+                if (heap.peak - base > peak) peak = heap.peak - base;
+                titles[run] = manifest.title;
+            }
+            ::QueryPerformanceCounter(&end);
+
+            printf("%-10s %-10s %10u %12.1f %12u\n", channel.c_str(), formats[run],
+                (unsigned)retrieved, (Seconds(start, end) * 1e6) / iterations, (unsigned)peak);
+        }
+
+        if (titles[0] != titles[1] || titles[0] != titles[2]) {
+            fprintf(stderr, "manifest_bench: selection differs <%s>, <%s> and <%s>\n",
+                titles[0].c_str(), titles[1].c_str(), titles[2].c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//end
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Phased rollout simulation
+//
+//  Assigns a population of installations, each with a generated identifier in
+//  the form persisted by the updater (UUID string), to rollout groups by way of
+//  AutoManifest::PhasedGroup(); then steps through the rollout of an item,
+//  reporting those newly offered the item per interval as AutoManifest::IsPhased().
+//
+//  Usage: phased_sim [-n installations] [-s seed]
+//
+//      -n      Population, default 100000.
+//      -s      Identifier generator seed, default fixed.
+//
+//  Exits non-zero should the spread over the groups not be uniform; chi-squared
+//  beyond the 0.1% critical value, or a group deviating by more than 5%.
+//
+
+#include "../src/common.h"
+#include "../src/AutoManifest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+enum {
+    GROUPS = Updater::AutoManifest::PHASED_GROUPS,
+    INTERVAL = 24 * 60 * 60                     // one day.
+};
+
+static const double CHI_CRITICAL = 22.458;      // 6 degrees of freedom, p=0.001.
+
+static uint64_t
+SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+//  As UuidToString(), version 4.
+static std::string
+InstallID(uint64_t &state)
+{
+    const uint64_t hi = SplitMix64(state), lo = SplitMix64(state);
+    char buffer[40];
+
+    sprintf(buffer, "%08x-%04x-4%03x-%04x-%012llx",
+        (unsigned)(hi >> 32), (unsigned)((hi >> 16) & 0xffff), (unsigned)(hi & 0xfff),
+        (unsigned)(0x8000 | ((lo >> 48) & 0x3fff)), (unsigned long long)(lo & 0xffffffffffffULL));
+    return buffer;
+}
+
+}   //namespace anon
+
+
+int
+main(int argc, char *argv[])
+{
+    unsigned long population = 100000;
+    uint64_t state = 0x5048415345443031ULL;
+
+    for (int argi = 1; argi + 1 < argc; argi += 2) {
+        if (0 == strcmp(argv[argi], "-n")) {
+            population = strtoul(argv[argi + 1], NULL, 0);
+        } else if (0 == strcmp(argv[argi], "-s")) {
+            state = strtoull(argv[argi + 1], NULL, 0);
+        } else {
+            fprintf(stderr, "phased_sim: unknown option <%s>\n", argv[argi]);
+            return 1;
+        }
+    }
+    if (population < GROUPS * 100) {
+        fprintf(stderr, "phased_sim: population too small\n");
+        return 1;
+    }
+
+    std::vector<unsigned> groups;
+    unsigned long counts[GROUPS] = {0};
+
+    groups.reserve(population);
+    for (unsigned long i = 0; i < population; ++i) {
+        const std::string id = InstallID(state);
+        const unsigned group = Updater::AutoManifest::PhasedGroup(id);
+
+        if (group != Updater::AutoManifest::PhasedGroup(id) || group >= GROUPS) {
+            fprintf(stderr, "phased_sim: unstable group <%s>\n", id.c_str());
+            return 1;
+        }
+        groups.push_back(group);
+        ++counts[group];
+    }
+
+    // group spread
+    const double expected = (double)population / GROUPS;
+    double chi = 0, worst = 0;
+
+    printf("population=%lu, groups=%u, expected=%.1f\n", population, (unsigned)GROUPS, expected);
+    printf("%-6s %10s %10s\n", "group", "clients", "deviation");
+    for (unsigned g = 0; g < GROUPS; ++g) {
+        const double deviation = ((double)counts[g] - expected) / expected;
+
+        chi += (((double)counts[g] - expected) * ((double)counts[g] - expected)) / expected;
+        if (fabs(deviation) > worst) worst = fabs(deviation);
+        printf("%-6u %10lu %9.2f%%\n", g, counts[g], deviation * 100.0);
+    }
+    printf("chi-squared=%.3f (critical %.3f), worst deviation=%.2f%%\n", chi, CHI_CRITICAL, worst * 100.0);
+
+    // rollout, those newly offered per interval
+    Updater::AutoManifest manifest;
+    std::vector<bool> offered(population, false);
+    const time_t published = 1745138422;
+
+    manifest.published = published;
+    manifest.phasedRolloutInterval = INTERVAL;
+
+    printf("%-6s %10s %10s\n", "day", "offered", "total");
+    for (unsigned day = 0, total = 0; day <= GROUPS; ++day) {
+        const time_t now = published + ((time_t)day * INTERVAL);
+        unsigned long fresh = 0;
+
+        for (unsigned long i = 0; i < population; ++i) {
+            if (! offered[i] && ! manifest.IsPhased(groups[i], now)) {
+                offered[i] = true;
+                ++fresh;
+            }
+        }
+        total += fresh;
+        printf("%-6u %10lu %10u\n", day, fresh, total);
+        if ((day < GROUPS && fresh != counts[day]) || (day == GROUPS && fresh)) {
+            fprintf(stderr, "phased_sim: rollout day %u, offered %lu\n", day, fresh);
+            return 1;
+        }
+    }
+
+    if (chi > CHI_CRITICAL || worst > 0.05) {
+        fprintf(stderr, "phased_sim: uneven spread\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+//end
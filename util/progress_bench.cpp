@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Progress publication benchmark
+//
+//  Drives the read loop of the download worker from memory against a deliberately
+//  slow UI, contrasting progress reported synchronously from the worker upon each
+//  percentage change, as prior, against counters published by the worker and
+//  sampled by a UI thread at its own frame rate (see ProgressMeter); reporting
+//  read-loop MB/s and the number of UI updates.
+//
+//  Usage: progress_bench [-s size-MB] [-u ui-milliseconds] [-f frame-milliseconds]
+//
+//      -s      Transfer size, default 256MB.
+//      -u      UI update cost, default 20ms; e.g. a console or dialog repaint.
+//      -f      Sample interval, default 100ms.
+//
+
+#include "../src/common.h"
+#include "../src/AutoThread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+enum {
+    IOBUFFER_SIZE = 64 * 1024                   // as the download worker.
+};
+
+struct SlowUI {
+    SlowUI(unsigned cost) : cost_(cost), updates_(0) {
+    }
+
+    void ProgressUpdate(int64_t completed, int64_t total) {
+        (void) completed, (void) total;
+        ::Sleep(cost_);                         // repaint.
+        ++updates_;
+    }
+
+    unsigned cost_;
+    unsigned updates_;
+};
+
+
+struct Sampler {
+    Sampler(SlowUI &ui, unsigned frame, int64_t total) :
+        ui_(ui), frame_(frame), total_(total), sampled_(-1) {
+        stop_.Create(true);
+    }
+
+    static unsigned __cdecl threadproc(void *param) {
+        Sampler *self = static_cast<Sampler *>(param);
+        while (0 == self->stop_.Wait(self->frame_)) {
+            self->Sample();
+        }
+        self->Sample();
+        return 0;
+    }
+
+    void Sample() {
+        const int64_t completed = completed_.Get();
+        if (completed != sampled_) {
+            ui_.ProgressUpdate(completed, total_);
+            sampled_ = completed;
+        }
+    }
+
+    SlowUI &ui_;
+    const unsigned frame_;
+    const int64_t total_;
+    int64_t sampled_;
+    Updater::AtomicCounter completed_;
+    Updater::WaitableEvent stop_;
+};
+
+
+static double
+Seconds(const LARGE_INTEGER &start, const LARGE_INTEGER &end)
+{
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+    return (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+}
+
+
+//  Emulated transport; copy from a (cache resident) receive buffer.
+static size_t
+Read(const std::vector<char> &receive, char *buffer, uint64_t &remaining)
+{
+    const size_t length = (size_t)(remaining < IOBUFFER_SIZE ? remaining : IOBUFFER_SIZE);
+    memcpy(buffer, &receive[0], length);
+    remaining -= length;
+    return length;
+}
+
+}   //namespace anon
+
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t length = 256 * 1024 * 1024;
+    unsigned cost = 20, frame = 100;
+
+    for (int argi = 1; argi + 1 < argc; argi += 2) {
+        if (0 == strcmp(argv[argi], "-s")) {
+            length = (uint64_t)atoi(argv[argi + 1]) * 1024 * 1024;
+        } else if (0 == strcmp(argv[argi], "-u")) {
+            cost = (unsigned)atoi(argv[argi + 1]);
+        } else if (0 == strcmp(argv[argi], "-f")) {
+            frame = (unsigned)atoi(argv[argi + 1]);
+        } else {
+            fprintf(stderr, "progress_bench: unknown option <%s>\n", argv[argi]);
+            return 1;
+        }
+    }
+    if (0 == length || 0 == frame) {
+        fprintf(stderr, "progress_bench: invalid size or frame\n");
+        return 1;
+    }
+
+    std::vector<char> receive(IOBUFFER_SIZE, 'x'), buffer(IOBUFFER_SIZE);
+    const int64_t total = (int64_t)length;
+
+    printf("size=%uMB, ui=%ums, frame=%ums\n", (unsigned)(length / (1024 * 1024)), cost, frame);
+    printf("%-12s %12s %10s %10s\n", "progress", "seconds", "MB/s", "updates");
+
+    for (int run = 0; run < 2; ++run) {
+        const bool sampled = (1 == run);
+        SlowUI ui(cost);
+        Sampler sampler(ui, frame, total);
+        Updater::Thread *thread = NULL;
+        uint64_t remaining = length;
+        int64_t completed = 0;
+        int percentage = -1;
+        LARGE_INTEGER start, end;
+
+        if (sampled) {
+            if (NULL == (thread = Updater::Thread::Begin(Sampler::threadproc, &sampler))) {
+                fprintf(stderr, "progress_bench: unable to create sampler\n");
+                return 1;
+            }
+            thread->ResumeThread();
+        }
+
+        ::QueryPerformanceCounter(&start);
+        while (remaining) {
+            const size_t read = Read(receive, &buffer[0], remaining);
+
+            if (sampled) {                      // publish alone.
+                sampler.completed_.Add((int64_t)read);
+            } else {                            // synchronous, upon percentage change.
+                completed += read;
+                const int t_percentage = (int)((completed * 100) / total);
+                if (t_percentage != percentage) {
+                    ui.ProgressUpdate(completed, total);
+                    percentage = t_percentage;
+                }
+            }
+        }
+        ::QueryPerformanceCounter(&end);
+
+        if (thread) {
+            sampler.stop_.Trigger();
+            ::WaitForSingleObject(thread->handle_, INFINITE);
+            delete thread;
+        }
+
+        const double seconds = Seconds(start, end);
+        printf("%-12s %12.3f %10.1f %10u\n", (sampled ? "sampled" : "synchronous"), seconds,
+            ((double)length / (1024.0 * 1024.0)) / (seconds > 0 ? seconds : 1e-9), ui.updates_);
+    }
+    return 0;
+}
+
+//end
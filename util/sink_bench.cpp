@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Download sink benchmark
+//
+//  Drives the sink read path of the download worker from memory, contrasting
+//  append(), content read into the worker buffer and copied by the sink, against
+//  acquire()/commit(), content read directly into the region lent by the sink;
+//  reporting MB/s and CPU nanoseconds per byte. A final run applies write-behind,
+//  as the installer download (default depth 4), under which the sink declines to
+//  lend; the milliseconds append() spent blocked on the writer are reported.
+//
+//  Usage: sink_bench [-s size-MB] [-d directory] [-w depth]
+//
+//      -s      Transfer size, default 64MB.
+//      -d      FileDownloadSink image directory, default the working directory.
+//      -w      Write-behind depth, default 4.
+//
+//  The source emulates a transport, itself copying from a (cache resident)
+//  receive buffer; as the transport's own copy is common to both paths, the
+//  difference is that of the copy removed.
+//
+
+#include "../src/common.h"
+#include "../src/AutoDownLoad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <exception>
+#include <stdexcept>
+
+namespace {
+
+enum {
+    IOBUFFER_SIZE = 64 * 1024,              // as the download worker.
+    RECEIVE_SIZE = 256 * 1024               // emulated receive buffer.
+};
+
+struct MemoryTransport {
+    MemoryTransport(uint64_t length) :
+        receive_(RECEIVE_SIZE), remaining_(length), cursor_(0) {
+        for (size_t i = 0; i < receive_.size(); ++i)
+            receive_[i] = (char)(i * 131);
+    }
+
+    size_t Read(char *buffer, size_t length) {
+        if (length > remaining_)
+            length = (size_t)remaining_;
+        for (size_t done = 0; done < length;) {
+            size_t count = receive_.size() - cursor_;
+            if (count > length - done)
+                count = length - done;
+            memcpy(buffer + done, &receive_[cursor_], count);
+            cursor_ = (cursor_ + count) % receive_.size();
+            done += count;
+        }
+        remaining_ -= length;
+        return length;
+    }
+
+    std::vector<char> receive_;
+    uint64_t remaining_;
+    size_t cursor_;
+};
+
+
+static unsigned long long
+FileTime100ns(const FILETIME &ft)
+{
+    return (((unsigned long long)ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+
+static unsigned long long
+ThreadCPU100ns()
+{
+    FILETIME create, exit, kernel, user;
+    if (! ::GetThreadTimes(::GetCurrentThread(), &create, &exit, &kernel, &user))
+        return 0;
+    return FileTime100ns(kernel) + FileTime100ns(user);
+}
+
+
+//  As DownloadContext::execute(), single stream.
+static uint64_t
+Transfer(Updater::IDownloadSink &sink, uint64_t length, bool lend, uint64_t &lent)
+{
+    MemoryTransport source(length);
+    std::vector<char> buffer(IOBUFFER_SIZE);
+    uint64_t result = 0;
+
+    lent = 0;
+    sink.set_size((size_t)length);
+    if (! sink.open())
+        throw std::runtime_error("unable to open sink");
+    for (;;) {
+        size_t capacity = IOBUFFER_SIZE, read;
+        char *destination = (lend ? static_cast<char *>(sink.acquire(capacity)) : NULL);
+
+        if (NULL == destination || 0 == capacity)
+            destination = &buffer[0], capacity = IOBUFFER_SIZE;
+        if (0 == (read = source.Read(destination, capacity)))
+            break;
+        if (destination == &buffer[0]) {
+            sink.append(destination, read);
+        } else {
+            sink.commit(read);
+            lent += read;
+        }
+        result += read;
+    }
+    sink.close();
+    return result;
+}
+
+}   //namespace anon
+
+
+int
+main(int argc, char *argv[])
+{
+    uint64_t length = 64 * 1024 * 1024;
+    std::string directory(".");
+    unsigned depth = 4;
+
+    for (int argi = 1; argi + 1 < argc; argi += 2) {
+        if (0 == strcmp(argv[argi], "-s")) {
+            length = (uint64_t)atoi(argv[argi + 1]) * 1024 * 1024;
+        } else if (0 == strcmp(argv[argi], "-d")) {
+            directory = argv[argi + 1];
+        } else if (0 == strcmp(argv[argi], "-w")) {
+            depth = (unsigned)atoi(argv[argi + 1]);
+        } else {
+            fprintf(stderr, "sink_bench: unknown option <%s>\n", argv[argi]);
+            return 1;
+        }
+    }
+    if (0 == length) {
+        fprintf(stderr, "sink_bench: invalid size\n");
+        return 1;
+    }
+
+    const std::string filename = directory + "\\sink_bench.tmp";
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+
+    printf("size=%uMB\n", (unsigned)(length / (1024 * 1024)));
+    printf("%-12s %-8s %10s %10s %12s %10s %12s %10s\n",
+        "sink", "path", "MB", "lent MB", "seconds", "MB/s", "CPU ns/byte", "blocked ms");
+
+    for (int run = 0; run < 5; ++run) {
+        const bool file = (run >= 2), behind = (4 == run), lend = (behind || 1 == (run & 1));
+        const char *path = (behind ? "behind" : (lend ? "lent" : "append"));
+        uint64_t result = 0, lent = 0, blocked = 0;
+        LARGE_INTEGER start, end;
+
+        const unsigned long long cpu = ThreadCPU100ns();
+        ::QueryPerformanceCounter(&start);
+        try {
+            if (file) {
+                Updater::FileDownloadSink sink(filename.c_str());
+                if (behind) {
+                    sink.write_behind(depth);
+                }
+                result = Transfer(sink, length, lend, lent);
+                blocked = sink.blocked();
+            } else {
+                std::string content;
+                Updater::StringDownloadSink sink(&content);
+                result = Transfer(sink, length, lend, lent);
+            }
+        } catch (const std::exception &e) {
+            printf("%-12s %-8s %10s (%s)\n", (file ? "file" : "string"), path, "failed", e.what());
+            continue;
+        }
+        ::QueryPerformanceCounter(&end);
+        const unsigned long long used = ThreadCPU100ns() - cpu;
+
+        const double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+        printf("%-12s %-8s %10.1f %10.1f %12.3f %10.1f %12.3f %10u\n", (file ? "file" : "string"), path,
+            (double)result / (1024.0 * 1024.0), (double)lent / (1024.0 * 1024.0), seconds,
+            ((double)result / (1024.0 * 1024.0)) / seconds, (result ? ((double)used * 100.0) / (double)result : 0.0),
+            (unsigned)blocked);
+    }
+
+    ::DeleteFileA(filename.c_str());
+    return 0;
+}
+
+//end
@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Download transport benchmark
+//
+//  Pushes payloads through Download/IDownloadSink against a local stand-in
+//  HTTP server (127.0.0.1), reporting MB/s and CPU nanoseconds per byte.
+//
+//  Usage: transport_bench [-w] [size-MB ...]
+//
+//      -w      WinINet transport, otherwise the socket transport.
+//
+//  Default payloads are 10, 100, 1024 and 2048 MB. The CPU figure is the
+//  client's; the stand-in server thread's own time is subtracted. Windows
+//  only, as are the transports; see TODO.md.
+//
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "../src/AutoDownLoad.h"
+#include "../src/AutoConfig.h"
+#include "../src/AutoThread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace {
+
+struct CountingSink : public Updater::IDownloadSink {
+    CountingSink() : expected(0), total(0), checksum(0) {
+    }
+
+    virtual void set_size(size_t size) {
+        expected = size;
+    }
+
+    virtual bool open() {
+        total = checksum = 0;
+        return true;
+    }
+
+    virtual void append(const void *data, size_t len) {
+        checksum += reinterpret_cast<const unsigned char *>(data)[0];
+        total += len;                       // touch, do not copy.
+    }
+
+    virtual bool cancelled() {
+        return false;
+    }
+
+    virtual void close() {
+    }
+
+    size_t expected;
+    unsigned long long total;
+    unsigned checksum;
+};
+
+
+struct StandIn {
+    SOCKET listener;
+    unsigned short port;
+    volatile LONG stop;
+    unsigned long long server_cpu100ns;     // accumulated, per-connection.
+};
+
+
+static unsigned long long
+FileTime100ns(const FILETIME &ft)
+{
+    return (((unsigned long long)ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+
+static unsigned long long
+ThreadCPU100ns()
+{
+    FILETIME create, exit, kernel, user;
+    if (! ::GetThreadTimes(::GetCurrentThread(), &create, &exit, &kernel, &user))
+        return 0;
+    return FileTime100ns(kernel) + FileTime100ns(user);
+}
+
+
+static unsigned long long
+ProcessCPU100ns()
+{
+    FILETIME create, exit, kernel, user;
+    if (! ::GetProcessTimes(::GetCurrentProcess(), &create, &exit, &kernel, &user))
+        return 0;
+    return FileTime100ns(kernel) + FileTime100ns(user);
+}
+
+
+//  Stand-in server; one connection at a time, "GET /<bytes> HTTP/1.1".
+static unsigned __cdecl
+ServerThread(void *param)
+{
+    StandIn *server = static_cast<StandIn *>(param);
+    const size_t chunk = 256 * 1024;
+    char *payload = (char *)malloc(chunk);
+
+    for (size_t i = 0; i < chunk; ++i)
+        payload[i] = (char)('A' + (i % 26));
+
+    while (! server->stop) {
+        SOCKET s = ::accept(server->listener, NULL, NULL);
+        if (INVALID_SOCKET == s)
+            break;
+
+        const unsigned long long cpu = ThreadCPU100ns();
+        char request[2048] = {0};
+        size_t rlen = 0;
+        int ret;
+
+        while (rlen < sizeof(request) - 1 &&
+                    (ret = ::recv(s, request + rlen, (int)(sizeof(request) - 1 - rlen), 0)) > 0) {
+            rlen += ret;
+            if (strstr(request, "\r\n\r\n"))
+                break;
+        }
+
+        unsigned long long length = 0;
+        if (0 == strncmp(request, "GET /", 5))
+            length = _strtoui64(request + 5, NULL, 10);
+
+        char header[256];
+        const int hlen = _snprintf(header, sizeof(header),
+                            "HTTP/1.1 200 OK\r\n"
+                            "Content-Type: application/octet-stream\r\n"
+                            "Content-Length: %I64u\r\n"
+                            "Connection: close\r\n\r\n", length);
+        ::send(s, header, hlen, 0);
+
+        while (length && ! server->stop) {
+            const int part = (int)(length > chunk ? chunk : length);
+            if ((ret = ::send(s, payload, part, 0)) <= 0)
+                break;
+            length -= ret;
+        }
+
+        ::shutdown(s, SD_SEND);
+        ::closesocket(s);
+        server->server_cpu100ns += ThreadCPU100ns() - cpu;
+    }
+
+    free(payload);
+    return 0;
+}
+
+
+static bool
+ServerStart(StandIn &server)
+{
+    struct sockaddr_in addr = {0};
+    int addrlen = sizeof(addr);
+
+    server.listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    server.stop = 0;
+    server.server_cpu100ns = 0;
+    if (INVALID_SOCKET == server.listener)
+        return false;
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;                      // ephemeral.
+    if (SOCKET_ERROR == ::bind(server.listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+            SOCKET_ERROR == ::listen(server.listener, 4) ||
+            SOCKET_ERROR == ::getsockname(server.listener, (struct sockaddr *)&addr, &addrlen)) {
+        ::closesocket(server.listener);
+        return false;
+    }
+    server.port = ntohs(addr.sin_port);
+
+    Updater::Thread *thread = Updater::Thread::Begin(ServerThread, &server);
+    if (NULL == thread) {
+        ::closesocket(server.listener);
+        return false;
+    }
+    thread->SetAutoDelete();
+    thread->ResumeThread();
+    return true;
+}
+
+
+static void
+ServerStop(StandIn &server)
+{
+    ::InterlockedExchange(&server.stop, 1);
+    ::closesocket(server.listener);         // release accept().
+}
+
+}   //namespace anon
+
+
+int
+main(int argc, char *argv[])
+{
+    static const unsigned defaults[] = { 10, 100, 1024, 2048 };
+    unsigned flags = Updater::Download::SOCKETS;
+    StandIn server;
+    WSADATA wsa;
+    int argi = 1;
+
+    if (argi < argc && 0 == strcmp(argv[argi], "-w")) {
+        flags = Updater::Download::LOOPBACK;  // plain http:// to the stand-in, by request.
+        ++argi;
+    }
+
+    Updater::Config::SetAppName("transport_bench");
+    Updater::Config::SetAppVersion("1.0.0");
+
+    ::WSAStartup(MAKEWORD(2, 2), &wsa);
+    if (! ServerStart(server)) {
+        fprintf(stderr, "transport_bench: unable to start stand-in server\n");
+        return 1;
+    }
+
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+
+    printf("transport=%s, port=%u\n", (flags & Updater::Download::SOCKETS ? "socket" : "wininet"), server.port);
+    printf("%10s %12s %10s %12s\n", "MB", "seconds", "MB/s", "CPU ns/byte");
+
+    const int count = (argi < argc ? argc - argi : (int)(sizeof(defaults)/sizeof(defaults[0])));
+    for (int i = 0; i < count; ++i) {
+        const unsigned mb = (argi < argc ? (unsigned)atoi(argv[argi + i]) : defaults[i]);
+        const unsigned long long bytes = (unsigned long long)mb * 1024 * 1024;
+        char url[128];
+
+        _snprintf(url, sizeof(url), "http://127.0.0.1:%u/%I64u", server.port, bytes);
+
+        CountingSink sink;
+        Updater::Download download;
+        LARGE_INTEGER start, end;
+
+        const unsigned long long server_cpu = server.server_cpu100ns;
+        const unsigned long long cpu = ProcessCPU100ns();
+        ::QueryPerformanceCounter(&start);
+        const bool success = download.get(url, sink, flags) && download.completion(false);
+        ::QueryPerformanceCounter(&end);
+        const unsigned long long client_cpu =
+                (ProcessCPU100ns() - cpu) - (server.server_cpu100ns - server_cpu);
+
+        if (! success || sink.total != bytes) {
+            printf("%10u %12s (received %I64u of %I64u)\n", mb, "failed", sink.total, bytes);
+            continue;
+        }
+
+        const double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+        printf("%10u %12.3f %10.1f %12.3f\n", mb, seconds,
+            ((double)bytes / (1024.0 * 1024.0)) / seconds, ((double)client_cpu * 100.0) / (double)bytes);
+    }
+
+    ServerStop(server);
+    ::WSACleanup();
+    return 0;
+}
+
+//end